@@ -35,6 +35,7 @@
 #include <lib_manager/LibInterface.hpp>
 #include <mars/interfaces/sim/SimulatorInterface.h>
 #include <mars/interfaces/gui/MarsGuiInterface.h>
+#include <mars/interfaces/graphics/GraphicsManagerInterface.h>
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/utils/Thread.h>
 #include <mars/utils/misc.h>
@@ -81,10 +82,11 @@ namespace mars {
 
     MARS::MARS() : configDir(DEFAULT_CONFIG_DIR),
                    libManager(new lib_manager::LibManager()),
-                   marsGui(NULL), ownLibManager(true),
+                   marsGui(NULL), marsGraphics(NULL), ownLibManager(true),
 		   argConfDir(false) {
       needQApp = true;
       noGUI = false;
+      offscreen = false;
       graphicsTimer = NULL;
       initialized = false;
 #ifdef WIN32
@@ -95,10 +97,11 @@ namespace mars {
 
     MARS::MARS(lib_manager::LibManager *theManager) : configDir(DEFAULT_CONFIG_DIR),
                    libManager(theManager),
-                   marsGui(NULL), ownLibManager(false),
+                   marsGui(NULL), marsGraphics(NULL), ownLibManager(false),
 		   argConfDir(false) {
       needQApp = true;
       noGUI = false;
+      offscreen = false;
       graphicsTimer = NULL;
       initialized = false;
 #ifdef WIN32
@@ -195,6 +198,10 @@ namespace mars {
           libManager->loadLibrary("mars_gui");
           libManager->loadLibrary("entity_view");
         }
+        else if(offscreen) {
+          // render the sensor cameras without any window
+          libManager->loadLibrary("mars_graphics");
+        }
       }
     }
 
@@ -245,7 +252,6 @@ namespace mars {
       mars::main_gui::MainGUI *mainGui = NULL;
       mainGui = libManager->getLibraryAs<mars::main_gui::MainGUI>("main_gui");
 
-      mars::interfaces::GraphicsManagerInterface *marsGraphics = NULL;
       lib_manager::LibInterface *lib= libManager->getLibrary("mars_graphics");
       if(lib) {
         if( (marsGraphics = dynamic_cast<mars::interfaces::GraphicsManagerInterface*>(lib)) ) {
@@ -257,6 +263,9 @@ namespace mars {
             mainGui->mainWindow_p()->setCentralWidget(widget);
           }
           else {
+            if(offscreen) {
+              control->cfg->setProperty("Graphics", "offscreen", true);
+            }
             marsGraphics->initializeOSG(NULL, false);
           }
         }
@@ -311,6 +320,7 @@ namespace mars {
         {"config_dir", required_argument, 0, 'C'},
         {"no-gui",no_argument,0,'G'},
         {"noQApp",no_argument,0,'Q'},
+        {"offscreen",no_argument,0,'O'},
         {0, 0, 0, 0}
       };
 
@@ -328,9 +338,9 @@ namespace mars {
       while (1) {
 
 #ifdef __linux__
-        c = getopt_long(argc, argv, "GC:Q", long_options, &option_index);
+        c = getopt_long(argc, argv, "GC:QO", long_options, &option_index);
 #else
-        c = getopt_long(argc, argv_copy, "GC:Q", long_options, &option_index);
+        c = getopt_long(argc, argv_copy, "GC:QO", long_options, &option_index);
 #endif
         if (c == -1)
           break;
@@ -350,6 +360,12 @@ namespace mars {
         case 'G':
           noGUI = true;
           break;
+        case 'O':
+          // headless run that only renders the sensor cameras
+          noGUI = true;
+          needQApp = false;
+          offscreen = true;
+          break;
         }
       }
 
@@ -372,7 +388,12 @@ namespace mars {
     int MARS::runWoQApp() {
       while(!quit) {
         if(control->sim->getAllowDraw() || !control->sim->getSyncGraphics()) {
-          control->sim->finishedDraw();
+          if(offscreen && marsGraphics) {
+            marsGraphics->draw();
+          }
+          else {
+            control->sim->finishedDraw();
+          }
         }
         //mars::utils::msleep(2);
       }
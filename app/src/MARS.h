@@ -48,6 +48,7 @@ namespace mars {
 
   namespace interfaces {
     class MarsGuiInterface;
+    class GraphicsManagerInterface;
   }
 
   namespace app {
@@ -79,12 +80,13 @@ namespace mars {
       static bool quit;
       std::string configDir;
       std::string coreConfigFile;
-      bool needQApp, noGUI;
+      bool needQApp, noGUI, offscreen;
 
     private:
       lib_manager::LibManager *libManager;
       app::GraphicsTimer *graphicsTimer;
       interfaces::MarsGuiInterface *marsGui;
+      interfaces::GraphicsManagerInterface *marsGraphics;
       bool ownLibManager;
       bool argConfDir;
       bool initialized;
@@ -28,11 +28,6 @@
  */
 
 /*
- * FIXME:
- *  - the unregister stuff has potential problems.
- *    consider the AsyncReceivers. in the main loop they are cached for the
- *    deferred callbacks. if they then get unregistered and the object deleted
- *    we will crash when doing the actual deferred call!
  * TODO:
  *  - add buffer struct containing length and void* to DataItem union.
  *    the buffer content should be copied in the pushData() and kept until
@@ -50,7 +45,19 @@
 
 #include <cstdio>
 #include <cerrno>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
 
+// default number of queued DataPackages of an asynchronous receiver
+#define ASYNC_DEFAULT_QUEUE_SIZE 256
+// period of the "data_broker/asyncStats" packages in ms
+#define ASYNC_STATS_PERIOD 1000
+// the _REALTIME_ thread checks for new registrations at least this often (ms)
+#define REALTIME_MAX_SLEEP 10
+// period of the "data_broker/realtimeStats" packages in ms
+#define REALTIME_STATS_PERIOD 1000
 
 
 namespace mars {
@@ -62,20 +69,44 @@ namespace mars {
     /// \cond HIDDEN_SYMBOLS
     struct DeferredCallback {
       std::list<Receiver> receivers;
-      DataInfo info;
-      DataPackage package;
+      const DataInfo *info;
+      std::shared_ptr<const DataPackage> package;
       const ReceiverInterface *producer;
     };
+
+    class AsyncDispatchThread : public mars::utils::Thread {
+    public:
+      explicit AsyncDispatchThread(DataBroker *broker) : broker(broker) {}
+    protected:
+      void run() {broker->dispatchAsync();}
+    private:
+      DataBroker *broker;
+    };
     /// \endcond
 
+    // the subscriber whose receiver the calling dispatch thread calls
+    static thread_local AsyncSubscriber *dispatchedSubscriber = NULL;
 
-    // C-function to be called by pthreads to start the thread
-    static void* createDataBrokerThread(void *theObject) {
-      ((DataBroker*)theObject)->setThreadStopped(false);
-      ((DataBroker*)theObject)->run();
-      ((DataBroker*)theObject)->setThreadStopped(true);
-      pthread_exit(NULL);
-      return 0;
+    // time stamps of the asynchronous deliveries in microseconds
+    static long long getSteadyTime() {
+      using namespace std::chrono;
+      return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    // sleeps until the steady time \a wakeup in microseconds
+    static void sleepUntil(long long wakeup) {
+#ifdef __linux__
+      // steady_clock is CLOCK_MONOTONIC, an absolute wakeup does not drift
+      struct timespec ts;
+      ts.tv_sec = wakeup / 1000000;
+      ts.tv_nsec = (wakeup % 1000000) * 1000;
+      while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#else
+      long long now = getSteadyTime();
+      if(wakeup > now) {
+        msleep((wakeup - now + 999) / 1000);
+      }
+#endif
     }
 
     // C-function to be called by pthreads to start the _REALTIME_ thread
@@ -91,17 +122,26 @@ namespace mars {
 
     DataBroker::DataBroker(lib_manager::LibManager *theManager) :
       DataBrokerInterface(theManager),
-      mars::utils::Thread(),
-      next_id(1), thread_running(false), stop_thread(false),
-      realtimeThreadRunning(false), startingRealtimeThread(false) {
+      next_id(1), realtimeThreadRunning(false), startingRealtimeThread(false),
+      numDispatchThreads(1), activeDispatchThreads(0), nextSubscriberId(1),
+      nextAsyncStatsTime(0), stopDispatch(false) {
 
-      updatedElementsBackBuffer = new std::set<DataElement*>;
-      updatedElementsFrontBuffer = new std::set<DataElement*>;
+      for(size_t i=0; i<ELEMENT_NAME_TABLE_SIZE; ++i) {
+        elementNameTable[i].store(NULL, std::memory_order_relaxed);
+      }
 
       DataElement *e;
       e = createDataElement("data_broker", "newStream", DATA_PACKAGE_READ_FLAG);
       newStreamId = e->info.dataId;
 
+      DataElement *asyncStatsElement, *realtimeStatsElement;
+      asyncStatsElement = createDataElement("data_broker", "asyncStats",
+                                            DATA_PACKAGE_READ_FLAG);
+      asyncStatsId = asyncStatsElement->info.dataId;
+      realtimeStatsElement = createDataElement("data_broker", "realtimeStats",
+                                               DATA_PACKAGE_READ_FLAG);
+      realtimeStatsId = realtimeStatsElement->info.dataId;
+
       DataElement *fatalElement, *errorElement, *warningElement;
       DataElement *infoElement, *debugElement;
 
@@ -127,22 +167,35 @@ namespace mars {
       publishDataElement(warningElement);
       publishDataElement(infoElement);
       publishDataElement(debugElement);
+      publishDataElement(asyncStatsElement);
+      publishDataElement(realtimeStatsElement);
       elementsLock.unlock();
 
       createTimer("_REALTIME_");
-
-      //pthread_create(&theThread, NULL, createDataBrokerThread, (void*)this);
-      //start();
     }
 
     DataBroker::~DataBroker() {
+      std::map<ReceiverInterface*, AsyncSubscriber*>::iterator subscriberIt;
+      std::vector<AsyncDispatchThread*>::iterator threadIt;
+
       stopRealtimeThread = true;
-      stop_thread = true;
-      if(wakeupMutex.tryLock() == MUTEX_ERROR_NO_ERROR) {
-        wakeupCondition.wakeOne();
-        wakeupMutex.unlock();
+      asyncMutex.lock();
+      stopDispatch = true;
+      asyncCondition.wakeAll();
+      asyncMutex.unlock();
+      for(threadIt = dispatchThreads.begin();
+          threadIt != dispatchThreads.end(); ++threadIt) {
+        (*threadIt)->wait();
+        delete *threadIt;
+      }
+      dispatchThreads.clear();
+      for(subscriberIt = asyncSubscribers.begin();
+          subscriberIt != asyncSubscribers.end(); ++subscriberIt) {
+        delete subscriberIt->second;
       }
-      while(thread_running || realtimeThreadRunning) {
+      asyncSubscribers.clear();
+      readySubscribers.clear();
+      while(realtimeThreadRunning) {
         msleep(10);
       }
       std::map<unsigned long, DataElement*>::iterator elementIt;
@@ -152,11 +205,6 @@ namespace mars {
       elementsLock.lockForWrite();
       timersLock.lockForWrite();
       triggersLock.lockForWrite();
-      updatedElementsLock.lock();
-      updatedElementsBackBuffer->clear();
-      updatedElementsFrontBuffer->clear();
-      delete updatedElementsBackBuffer;
-      delete updatedElementsFrontBuffer;
       for(timerIt = timers.begin(); timerIt != timers.end(); ++timerIt) {
         //destroyLock(&timerIt->second.lock);
       }
@@ -171,13 +219,18 @@ namespace mars {
         DataElement *element = elementIt->second;
         //destroyLock(&element->receiverLock);
         //destroyLock(&element->bufferLock);
-        delete element->backBuffer;
-        delete element->frontBuffer;
         delete element;
       }
       elementsById.clear();
       elementsByName.clear();
-      updatedElementsLock.unlock();
+      for(size_t i=0; i<ELEMENT_NAME_TABLE_SIZE; ++i) {
+        ElementNameEntry *entry = elementNameTable[i].exchange(NULL);
+        while(entry) {
+          ElementNameEntry *next = entry->next;
+          delete entry;
+          entry = next;
+        }
+      }
       triggersLock.unlock();
       timersLock.unlock();
       elementsLock.unlock();
@@ -186,7 +239,6 @@ namespace mars {
       //      destroyLock(&timersLock);
       //      destroyLock(&elementsLock);
       //      destroyLock(&idMutex);
-      //      destroyLock(&updatedElementsLock);
       //      destroyLock(&pendingRegistrationLock);
       //fprintf(stderr, "Delete data_broker\n");
     }
@@ -214,6 +266,9 @@ namespace mars {
         timers[timerName].t = 0;
         timers[timerName].receivers.clear();
         timers[timerName.c_str()].lock = new mars::utils::ReadWriteLock();
+        timers[timerName].everyStep.updatePeriod = 0;
+        timers[timerName].scheduleDirty = false;
+        timers[timerName].timePackage.add("t", 0L);
         ok = true;
         std::map<std::pair<std::string, std::string>, DataElement*>::iterator elementIt;
 
@@ -240,7 +295,7 @@ namespace mars {
                                              pendingIt->updatePeriod,
                                              timerIt->second.t,
                                              pendingIt->callbackParam};
-              timerIt->second.receivers.locked_push_back(timedReceiver);
+              addTimedReceiver(&timerIt->second, timedReceiver);
               pendingIt = pendingTimedRegistrations.erase(pendingIt);
               advanceIterator = false;
             }
@@ -271,7 +326,7 @@ namespace mars {
                                            pendingProducerIt->updatePeriod,
                                            timerIt->second.t,
                                            pendingProducerIt->callbackParam};
-            timerIt->second.producers.locked_push_back(timedProducer);
+            addTimedProducer(&timerIt->second, timedProducer);
             pendingProducerIt = pendingTimedProducers.erase(pendingProducerIt);
           } else {
             ++pendingProducerIt;
@@ -285,12 +340,18 @@ namespace mars {
       return ok;
     }
 
+    // heap order of the TimerSlots, the earliest slot is on top
+    static bool laterSlot(const TimerSlot *a, const TimerSlot *b) {
+      return a->nextTriggerTime > b->nextTriggerTime;
+    }
+
     bool DataBroker::stepTimer(const std::string &timerName, long step) {
       std::map<std::string, Timer>::iterator timerIt, endIt;
       std::list<DeferredCallback> deferredCallbacks;
-      std::set<DataItemConnection> activeConnections;
       std::set<DataElement*> connectionActivatedElements;
-      DataItem currentItem;
+      std::shared_ptr<const DataPackage> package;
+      std::vector<TimerSlot*> dueSlots;
+      std::vector<TimerSlot*>::iterator slotIt;
 
       //bool ok = false;
       timersLock.lockForRead();
@@ -303,51 +364,50 @@ namespace mars {
         return false;
       }
       //ok = true;
-      timerIt->second.lock->lockForWrite();
-      timerIt->second.t += step;
-      // call all producers
+      Timer &timer = timerIt->second;
+      timer.lock->lockForWrite();
+      timer.t += step;
+      updateSchedule(&timer);
+      // only the due slots are taken from the heap
+      if(!timer.everyStep.producers.empty() ||
+         !timer.everyStep.receivers.empty()) {
+        dueSlots.push_back(&timer.everyStep);
+      }
+      while(!timer.queue.empty() &&
+            timer.queue.front()->nextTriggerTime <= timer.t) {
+        std::pop_heap(timer.queue.begin(), timer.queue.end(), laterSlot);
+        dueSlots.push_back(timer.queue.back());
+        timer.queue.pop_back();
+      }
+
+      // call all due producers
       DeferredCallback deferredCallback;
-      std::list<TimedProducer>::iterator producerIt;
-      for(producerIt = timerIt->second.producers.begin();
-          producerIt != timerIt->second.producers.end();
-          ++producerIt) {
-        if(producerIt->nextTriggerTime <= timerIt->second.t) {
-          while(producerIt->updatePeriod > 0 &&
-                producerIt->nextTriggerTime <= timerIt->second.t) {
-            producerIt->nextTriggerTime += producerIt->updatePeriod;
-          }
-          DataElement *element = producerIt->element;
+      std::vector<TimedProducer*>::iterator producerIt;
+      for(slotIt = dueSlots.begin(); slotIt != dueSlots.end(); ++slotIt) {
+        for(producerIt = (*slotIt)->producers.begin();
+            producerIt != (*slotIt)->producers.end(); ++producerIt) {
+          TimedProducer *timedProducer = *producerIt;
+          DataElement *element = timedProducer->element;
 
           deferredCallback.receivers.clear();
 
           element->bufferLock->lockForWrite();
-          producerIt->producer->produceData(element->info,
-                                            element->backBuffer,
-                                            producerIt->callbackParam);
-          std::swap(element->backBuffer, element->frontBuffer);
+          timedProducer->producer->produceData(element->info,
+                                               element->backBuffer.get(),
+                                               timedProducer->callbackParam);
+          swapBuffers(element);
+          package = element->frontBuffer;
           element->receiverLock->lockForRead();
           if(!element->syncReceivers.empty()) {
-            deferredCallback.package = *element->frontBuffer;
-            deferredCallback.info = element->info;
+            deferredCallback.package = package;
+            deferredCallback.info = &element->info;
             deferredCallback.producer = NULL;
             deferredCallback.receivers = element->syncReceivers;
           }
-          std::list<DataItemConnection>::iterator connectionIt;
-          for(connectionIt = element->connections.begin();
-              connectionIt != element->connections.end(); ++connectionIt) {
-            long fromIdx = connectionIt->fromDataItemIndex;
-            long toIdx = connectionIt->toDataItemIndex;
-            currentItem = (*connectionIt->fromElement->frontBuffer)[fromIdx];
-            currentItem.setName((*connectionIt->toElement->backBuffer)[toIdx].getName());
-            (*connectionIt->toElement->frontBuffer)[toIdx] = currentItem;
-            connectionActivatedElements.insert(connectionIt->toElement);
-          }
           element->receiverLock->unlock();
           element->bufferLock->unlock();
-
-          updatedElementsLock.lock();
-          updatedElementsBackBuffer->insert(element);
-          updatedElementsLock.unlock();
+          applyConnections(element, &connectionActivatedElements);
+          queueAsync(element, package, NULL);
 
           // defer synchronous callbacks until we do not hold any locks anymore
           if(!deferredCallback.receivers.empty())
@@ -356,28 +416,41 @@ namespace mars {
       }
 
       // push time package
-      DataPackage p;
-      p.add("t", timerIt->second.t);
-      pushData(timerIt->second.timerElementId, p);
-
-      // defer receivers
-      long time = timerIt->second.t;
-      std::list<TimedReceiver> deferredReceivers;
-      std::list<TimedReceiver>::iterator timedReceiverIt;
-
-      for(timedReceiverIt = timerIt->second.receivers.begin();
-          timedReceiverIt != timerIt->second.receivers.end();
-          ++timedReceiverIt) {
-        if(timedReceiverIt->nextTriggerTime <= time) {
-          while(timedReceiverIt->updatePeriod > 0 &&
-                timedReceiverIt->nextTriggerTime <= time) {
-            timedReceiverIt->nextTriggerTime += timedReceiverIt->updatePeriod;
-          }
-          deferredReceivers.push_back(*timedReceiverIt);
+      timer.timePackage.set(0, timer.t);
+      pushData(timer.timerElementId, timer.timePackage);
+
+      // defer receivers and reschedule the due slots
+      long time = timer.t;
+      std::vector<TimedReceiver> deferredReceivers;
+      std::vector<TimedReceiver>::iterator timedReceiverIt;
+      std::vector<TimedReceiver*>::iterator receiverIt;
+
+      for(slotIt = dueSlots.begin(); slotIt != dueSlots.end(); ++slotIt) {
+        TimerSlot *slot = *slotIt;
+        for(receiverIt = slot->receivers.begin();
+            receiverIt != slot->receivers.end(); ++receiverIt) {
+          deferredReceivers.push_back(**receiverIt);
+        }
+        if(slot->updatePeriod <= 0) {
+          continue;
         }
+        while(slot->nextTriggerTime <= time) {
+          slot->nextTriggerTime += slot->updatePeriod;
+        }
+        // keep the entries in sync for the next rebuild of the schedule
+        for(producerIt = slot->producers.begin();
+            producerIt != slot->producers.end(); ++producerIt) {
+          (*producerIt)->nextTriggerTime = slot->nextTriggerTime;
+        }
+        for(receiverIt = slot->receivers.begin();
+            receiverIt != slot->receivers.end(); ++receiverIt) {
+          (*receiverIt)->nextTriggerTime = slot->nextTriggerTime;
+        }
+        timer.queue.push_back(slot);
+        std::push_heap(timer.queue.begin(), timer.queue.end(), laterSlot);
       }
 
-      timerIt->second.lock->unlock();
+      timer.lock->unlock();
 
       // call all deferred receivers
       for(timedReceiverIt = deferredReceivers.begin();
@@ -385,39 +458,194 @@ namespace mars {
           ++timedReceiverIt) {
         DataElement *element = timedReceiverIt->element;
         element->bufferLock->lockForRead();
-        timedReceiverIt->receiver->receiveData(element->info,
-                                               *element->frontBuffer,
-                                               timedReceiverIt->callbackParam);
+        package = element->frontBuffer;
         element->bufferLock->unlock();
+        timedReceiverIt->receiver->receiveData(element->info, *package,
+                                               timedReceiverIt->callbackParam);
       }
+      package.reset();
 
       // connections
-      std::set<DataElement*>::iterator toElementIt;
-      fflush(stderr);
-      for(toElementIt = connectionActivatedElements.begin();
-          toElementIt != connectionActivatedElements.end(); ++toElementIt) {
-        DataElement *toElement = *toElementIt;
-        //      std::swap(toElement->frontBuffer, toElement->backBuffer);
-        pushData(toElement->info.dataId, *toElement->frontBuffer);
-      }
+      pushConnections(connectionActivatedElements);
       // call deferred sync callbacks
       std::list<DeferredCallback>::iterator callbackIt;
-      std::list<Receiver>::iterator receiverIt;
+      std::list<Receiver>::iterator syncReceiverIt;
       for(callbackIt = deferredCallbacks.begin();
           callbackIt != deferredCallbacks.end();
           ++callbackIt) {
-        for(receiverIt = callbackIt->receivers.begin();
-            receiverIt != callbackIt->receivers.end();
-            ++receiverIt) {
-          receiverIt->receiver->receiveData(callbackIt->info,
-                                            callbackIt->package,
-                                            receiverIt->callbackParam);
+        for(syncReceiverIt = callbackIt->receivers.begin();
+            syncReceiverIt != callbackIt->receivers.end();
+            ++syncReceiverIt) {
+          syncReceiverIt->receiver->receiveData(*callbackIt->info,
+                                                *callbackIt->package,
+                                                syncReceiverIt->callbackParam);
         }
       }
 
       return true;
     }
 
+    bool DataBroker::saveTimerState(const std::string &timerName,
+                                    std::vector<long> *state) {
+      std::map<std::string, Timer>::iterator timerIt, endIt;
+      std::list<TimedProducer>::iterator pIt;
+      std::list<TimedReceiver>::iterator rIt;
+
+      timersLock.lockForRead();
+      timerIt = timers.find(timerName);
+      endIt = timers.end();
+      timersLock.unlock();
+      if(timerIt == endIt) {
+        return false;
+      }
+      Timer &timer = timerIt->second;
+      timer.lock->lockForRead();
+      timer.producers.lock();
+      timer.receivers.lock();
+      // stepTimer writes the slot times back to the entries
+      state->push_back(timer.t);
+      state->push_back(timer.producers.size());
+      for(pIt = timer.producers.begin(); pIt != timer.producers.end(); ++pIt) {
+        state->push_back(pIt->nextTriggerTime);
+      }
+      state->push_back(timer.receivers.size());
+      for(rIt = timer.receivers.begin(); rIt != timer.receivers.end(); ++rIt) {
+        state->push_back(rIt->nextTriggerTime);
+      }
+      timer.receivers.unlock();
+      timer.producers.unlock();
+      timer.lock->unlock();
+      return true;
+    }
+
+    bool DataBroker::restoreTimerState(const std::string &timerName,
+                                       const std::vector<long> &state) {
+      std::map<std::string, Timer>::iterator timerIt, endIt;
+      std::list<TimedProducer>::iterator pIt;
+      std::list<TimedReceiver>::iterator rIt;
+      size_t pos = 0;
+      bool ok = false;
+
+      timersLock.lockForRead();
+      timerIt = timers.find(timerName);
+      endIt = timers.end();
+      timersLock.unlock();
+      if(timerIt == endIt) {
+        return false;
+      }
+      Timer &timer = timerIt->second;
+      timer.lock->lockForWrite();
+      timer.producers.lock();
+      timer.receivers.lock();
+      if(state.size() >= 3 &&
+         state[1] == (long)timer.producers.size() &&
+         state.size() == 3 + timer.producers.size() + timer.receivers.size() &&
+         state[2 + timer.producers.size()] == (long)timer.receivers.size()) {
+        timer.t = state[pos++];
+        ++pos;
+        for(pIt = timer.producers.begin(); pIt != timer.producers.end();
+            ++pIt) {
+          pIt->nextTriggerTime = state[pos++];
+        }
+        ++pos;
+        for(rIt = timer.receivers.begin(); rIt != timer.receivers.end();
+            ++rIt) {
+          rIt->nextTriggerTime = state[pos++];
+        }
+        // the slots are rebuilt from the entries with the next step
+        timer.scheduleDirty = true;
+        ok = true;
+      }
+      timer.receivers.unlock();
+      timer.producers.unlock();
+      timer.lock->unlock();
+      return ok;
+    }
+
+    void DataBroker::addTimedProducer(Timer *timer,
+                                      const TimedProducer &producer) {
+      timer->producers.lock();
+      timer->producers.push_back(producer);
+      timer->scheduleDirty = true;
+      timer->producers.unlock();
+    }
+
+    void DataBroker::addTimedReceiver(Timer *timer,
+                                      const TimedReceiver &receiver) {
+      timer->receivers.lock();
+      timer->receivers.push_back(receiver);
+      timer->scheduleDirty = true;
+      timer->receivers.unlock();
+    }
+
+    /**
+     * \brief Rebuilds the schedule of \a timer if its producers or
+     * receivers changed.
+     *
+     * Entries with the same update period and next trigger time share a
+     * TimerSlot. Has to be called with the timer locked for writing.
+     */
+    void DataBroker::updateSchedule(Timer *timer) {
+      std::map<std::pair<int, long>, size_t> slotIndex;
+      std::map<std::pair<int, long>, size_t>::iterator indexIt;
+      std::list<TimedProducer>::iterator producerIt;
+      std::list<TimedReceiver>::iterator receiverIt;
+
+      timer->producers.lock();
+      timer->receivers.lock();
+      if(!timer->scheduleDirty) {
+        timer->receivers.unlock();
+        timer->producers.unlock();
+        return;
+      }
+      timer->scheduleDirty = false;
+      timer->slots.clear();
+      timer->queue.clear();
+      timer->everyStep.producers.clear();
+      timer->everyStep.receivers.clear();
+      for(producerIt = timer->producers.begin();
+          producerIt != timer->producers.end(); ++producerIt) {
+        if(producerIt->updatePeriod <= 0) {
+          timer->everyStep.producers.push_back(&*producerIt);
+          continue;
+        }
+        std::pair<int, long> key(producerIt->updatePeriod,
+                                 producerIt->nextTriggerTime);
+        indexIt = slotIndex.find(key);
+        if(indexIt == slotIndex.end()) {
+          indexIt = slotIndex.insert(std::make_pair(key, timer->slots.size())).first;
+          timer->slots.push_back(TimerSlot());
+          timer->slots.back().updatePeriod = key.first;
+          timer->slots.back().nextTriggerTime = key.second;
+        }
+        timer->slots[indexIt->second].producers.push_back(&*producerIt);
+      }
+      for(receiverIt = timer->receivers.begin();
+          receiverIt != timer->receivers.end(); ++receiverIt) {
+        if(receiverIt->updatePeriod <= 0) {
+          timer->everyStep.receivers.push_back(&*receiverIt);
+          continue;
+        }
+        std::pair<int, long> key(receiverIt->updatePeriod,
+                                 receiverIt->nextTriggerTime);
+        indexIt = slotIndex.find(key);
+        if(indexIt == slotIndex.end()) {
+          indexIt = slotIndex.insert(std::make_pair(key, timer->slots.size())).first;
+          timer->slots.push_back(TimerSlot());
+          timer->slots.back().updatePeriod = key.first;
+          timer->slots.back().nextTriggerTime = key.second;
+        }
+        timer->slots[indexIt->second].receivers.push_back(&*receiverIt);
+      }
+      timer->receivers.unlock();
+      timer->producers.unlock();
+
+      for(size_t i=0; i<timer->slots.size(); ++i) {
+        timer->queue.push_back(&timer->slots[i]);
+      }
+      std::make_heap(timer->queue.begin(), timer->queue.end(), laterSlot);
+    }
+
     bool DataBroker::registerTimedReceiver(ReceiverInterface *receiver,
                                            const std::string &groupName,
                                            const std::string &dataName,
@@ -439,7 +667,7 @@ namespace mars {
           DataElement *element = elementIt->second;
           TimedReceiver timedReceiver = {receiver, element, updatePeriod,
                                          timerIt->second.t, callbackParam};
-          timerIt->second.receivers.locked_push_back(timedReceiver);
+          addTimedReceiver(&timerIt->second, timedReceiver);
           ok = true;
           if(timerName == "_REALTIME_") {
             lockRealtimeMutex();
@@ -483,12 +711,14 @@ namespace mars {
       timersLock.unlock();
       if(timerIt != endIt) {
         timerIt->second.lock->lockForWrite();
+        timerIt->second.receivers.lock();
         for(receiverIt = timerIt->second.receivers.begin();
             receiverIt != timerIt->second.receivers.end(); /* do nothing */){
           if(receiverIt->receiver == receiver) {
             if(matchPattern(groupName, receiverIt->element->info.groupName) &&
                matchPattern(dataName, receiverIt->element->info.dataName)) {
               receiverIt = timerIt->second.receivers.erase(receiverIt);
+              timerIt->second.scheduleDirty = true;
               ok = true;
             }
             else {
@@ -498,6 +728,7 @@ namespace mars {
             ++receiverIt;
           }
         }
+        timerIt->second.receivers.unlock();
         if(timerName == "_REALTIME_" &&
            timerIt->second.receivers.empty() &&
            timerIt->second.producers.empty()) {
@@ -547,7 +778,7 @@ namespace mars {
         }
         TimedProducer timedProducer = {producer, element, updatePeriod,
                                        timerIt->second.t, callbackParam};
-        timerIt->second.producers.locked_push_back(timedProducer);
+        addTimedProducer(&timerIt->second, timedProducer);
         elementsLock.unlock();
         ok = true;
         if(timerName == "_REALTIME_") {
@@ -586,16 +817,19 @@ namespace mars {
       timersLock.unlock();
       if(timerIt != endIt) {
         timerIt->second.lock->lockForWrite();
+        timerIt->second.producers.lock();
         for(producerIt = timerIt->second.producers.begin();
             producerIt != timerIt->second.producers.end(); /* do nothing */) {
           if(producerIt->producer == producer) {
             // todo: match group and data name
             producerIt = timerIt->second.producers.erase(producerIt);
+            timerIt->second.scheduleDirty = true;
             ok = true;
           } else {
             ++producerIt;
           }
         }
+        timerIt->second.producers.unlock();
         if(timerName == "_REALTIME_" &&
            timerIt->second.receivers.empty() &&
            timerIt->second.producers.empty()) {
@@ -674,10 +908,10 @@ namespace mars {
             ++receiverIt) {
           DataElement *element = receiverIt->element;
           element->bufferLock->lockForRead();
-          receiverIt->receiver->receiveData(element->info,
-                                            *element->frontBuffer,
-                                            receiverIt->callbackParam);
+          std::shared_ptr<const DataPackage> package = element->frontBuffer;
           element->bufferLock->unlock();
+          receiverIt->receiver->receiveData(element->info, *package,
+                                            receiverIt->callbackParam);
         }
         triggerIt->second.lock->unlock();
         ok = true;
@@ -772,7 +1006,7 @@ namespace mars {
       for(std::vector<DataElement*>::iterator elementIt = elements.begin();
           elementIt != elements.end(); ++elementIt){
         DataElement *element = *elementIt;
-        Receiver r = { receiver, callbackParam };
+        Receiver r = { receiver, callbackParam, NULL };
         element->syncReceivers.locked_push_back(r);
       }
       if(wildcards || elements.empty()) {
@@ -830,14 +1064,25 @@ namespace mars {
                                            const std::string &dataName,
                                            int callbackParam) {
       std::vector<DataElement*> elements;
+      AsyncSubscriber *subscriber;
       bool wildcards = hasWildcards(groupName) || hasWildcards(dataName);
       elementsLock.lockForRead();
       getElementsByName(groupName, dataName, &elements);
+      // the subscriber is created with the first matching stream
+      subscriber = NULL;
+      if(!elements.empty()) {
+        asyncMutex.lock();
+        subscriber = getAsyncSubscriber(receiver);
+        subscriber->registrations += elements.size();
+        asyncMutex.unlock();
+      }
       for(std::vector<DataElement*>::iterator elementIt = elements.begin();
           elementIt != elements.end(); ++elementIt){
         DataElement *element = *elementIt;
-        Receiver r = { receiver, callbackParam };
-        element->asyncReceivers.locked_push_back(r);
+        Receiver r = { receiver, callbackParam, subscriber };
+        element->receiverLock->lockForWrite();
+        element->asyncReceivers.push_back(r);
+        element->receiverLock->unlock();
       }
       if(wildcards || elements.empty()) {
         PendingRegistration tmp = { receiver, groupName.c_str(),
@@ -852,8 +1097,11 @@ namespace mars {
                                              const std::string &groupName,
                                              const std::string &dataName) {
       std::vector<DataElement*> elements;
+      std::set<DataElement*> unregisteredElements;
       std::list<Receiver>::iterator receiverIt;
       std::list<PendingRegistration>::iterator pendingRegistrationIt;
+      AsyncSubscriber *subscriber = NULL;
+      bool pending = false;
       elementsLock.lockForRead();
       getElementsByName(groupName, dataName, &elements);
       int cnt = 0;
@@ -864,6 +1112,8 @@ namespace mars {
         for(receiverIt = element->asyncReceivers.begin();
             receiverIt != element->asyncReceivers.end(); /* do nothing */) {
           if(receiverIt->receiver == receiver) {
+            subscriber = receiverIt->subscriber;
+            unregisteredElements.insert(element);
             receiverIt = element->asyncReceivers.erase(receiverIt);
             ++cnt;
           } else {
@@ -881,46 +1131,198 @@ namespace mars {
            (matchPattern(dataName, pendingRegistrationIt->dataName))) {
           pendingRegistrationIt = pendingAsyncRegistrations.erase(pendingRegistrationIt);
         } else {
+          pending |= (pendingRegistrationIt->receiver == receiver);
           ++pendingRegistrationIt;
         }
       }
       pendingAsyncRegistrations.unlock();
       elementsLock.unlock();
+      if(subscriber) {
+        releaseAsyncSubscriber(subscriber, cnt, unregisteredElements);
+      }
+      else if(!pending) {
+        // a policy of a receiver without streams is dropped as well
+        asyncMutex.lock();
+        asyncPolicies.erase(receiver);
+        asyncMutex.unlock();
+      }
       return cnt;
     }
 
+    void DataBroker::setAsyncReceiverPolicy(ReceiverInterface *receiver,
+                                            AsyncQueuePolicy policy,
+                                            unsigned int maxQueueSize,
+                                            const std::string &name) {
+      std::map<ReceiverInterface*, AsyncSubscriber*>::iterator it;
+      MutexLocker locker(&asyncMutex);
+      it = asyncSubscribers.find(receiver);
+      if(it == asyncSubscribers.end()) {
+        // kept until the first stream of the receiver creates its subscriber
+        AsyncPolicy &stored = asyncPolicies[receiver];
+        stored.policy = policy;
+        stored.maxQueueSize = std::max(maxQueueSize, 1u);
+        if(!name.empty()) {
+          stored.name = name;
+        }
+        return;
+      }
+      AsyncSubscriber *subscriber = it->second;
+      subscriber->policy = policy;
+      subscriber->maxQueueSize = std::max(maxQueueSize, 1u);
+      if(!name.empty()) {
+        subscriber->name = name;
+      }
+    }
+
+    void DataBroker::setAsyncDispatchThreads(unsigned int numThreads) {
+      MutexLocker locker(&asyncMutex);
+      numDispatchThreads = std::max(numThreads, 1u);
+      if(!asyncSubscribers.empty()) {
+        startAsyncDispatch();
+      }
+      // surplus threads exit when they wake up
+      asyncCondition.wakeAll();
+    }
+
+    /**
+     * \brief Returns the subscriber of \a receiver and creates it if needed.
+     *
+     * Has to be called with asyncMutex locked. The dispatch threads are
+     * started with the first subscriber. A policy set before is applied.
+     */
+    AsyncSubscriber* DataBroker::getAsyncSubscriber(ReceiverInterface *receiver) {
+      std::map<ReceiverInterface*, AsyncSubscriber*>::iterator it;
+      std::map<ReceiverInterface*, AsyncPolicy>::iterator policyIt;
+      it = asyncSubscribers.find(receiver);
+      if(it != asyncSubscribers.end()) {
+        return it->second;
+      }
+      AsyncSubscriber *subscriber = new AsyncSubscriber;
+      char name[32];
+      snprintf(name, sizeof(name), "receiver%lu", nextSubscriberId++);
+      subscriber->receiver = receiver;
+      subscriber->name = name;
+      subscriber->policy = ASYNC_QUEUE_COALESCE;
+      subscriber->maxQueueSize = ASYNC_DEFAULT_QUEUE_SIZE;
+      subscriber->registrations = 0;
+      subscriber->scheduled = false;
+      subscriber->dispatching = false;
+      subscriber->removed = false;
+      subscriber->delivered = subscriber->dropped = subscriber->coalesced = 0;
+      subscriber->maxQueueDepth = 0;
+      subscriber->latencySum = subscriber->latencyMax = 0;
+      policyIt = asyncPolicies.find(receiver);
+      if(policyIt != asyncPolicies.end()) {
+        subscriber->policy = policyIt->second.policy;
+        subscriber->maxQueueSize = policyIt->second.maxQueueSize;
+        if(!policyIt->second.name.empty()) {
+          subscriber->name = policyIt->second.name;
+        }
+        asyncPolicies.erase(policyIt);
+      }
+      asyncSubscribers[receiver] = subscriber;
+      startAsyncDispatch();
+      return subscriber;
+    }
+
+    /**
+     * \brief Removes \a registrations stream registrations from
+     * \a subscriber and drops its pending data of \a elements.
+     *
+     * Unless called from within the callback of the receiver this waits
+     * for a running callback, thus the receiver may be deleted afterwards.
+     * The subscriber is deleted with its last registration.
+     */
+    void DataBroker::releaseAsyncSubscriber(AsyncSubscriber *subscriber,
+                                            size_t registrations,
+                                            const std::set<DataElement*> &elements) {
+      std::deque<AsyncDelivery>::iterator deliveryIt;
+      MutexLocker locker(&asyncMutex);
+
+      subscriber->registrations -= std::min(registrations,
+                                            subscriber->registrations);
+      for(deliveryIt = subscriber->queue.begin();
+          deliveryIt != subscriber->queue.end(); /* do nothing */) {
+        if(elements.count(deliveryIt->element)) {
+          deliveryIt = subscriber->queue.erase(deliveryIt);
+        } else {
+          ++deliveryIt;
+        }
+      }
+      if(subscriber != dispatchedSubscriber) {
+        while(subscriber->dispatching) {
+          asyncIdleCondition.wait(&asyncMutex);
+        }
+      }
+      if(subscriber->registrations) {
+        return;
+      }
+      asyncSubscribers.erase(subscriber->receiver);
+      if(subscriber->dispatching) {
+        // unregistered from within a callback
+        subscriber->removed = true;
+        return;
+      }
+      if(subscriber->scheduled) {
+        readySubscribers.erase(std::find(readySubscribers.begin(),
+                                         readySubscribers.end(), subscriber));
+      }
+      delete subscriber;
+    }
+
+    /**
+     * \brief Starts dispatch threads until numDispatchThreads are running.
+     *
+     * Has to be called with asyncMutex locked.
+     */
+    void DataBroker::startAsyncDispatch() {
+      std::vector<AsyncDispatchThread*>::iterator threadIt;
+      for(threadIt = dispatchThreads.begin();
+          threadIt != dispatchThreads.end(); /* do nothing */) {
+        if((*threadIt)->isFinished()) {
+          (*threadIt)->wait();
+          delete *threadIt;
+          threadIt = dispatchThreads.erase(threadIt);
+        } else {
+          ++threadIt;
+        }
+      }
+      while(!stopDispatch && activeDispatchThreads < numDispatchThreads) {
+        AsyncDispatchThread *thread = new AsyncDispatchThread(this);
+        dispatchThreads.push_back(thread);
+        ++activeDispatchThreads;
+        thread->start();
+      }
+    }
+
     unsigned long DataBroker::pushData(const std::string &groupName,
                                        const std::string &dataName,
                                        const DataPackage &dataPackage,
                                        const ReceiverInterface *producer,
                                        PackageFlag flags) {
       std::map<std::pair<std::string, std::string>, DataElement*>::iterator elementIt;
-      DataElement *element = NULL;
-      elementsLock.lockForWrite();
-      elementIt = elementsByName.find(std::make_pair(groupName, dataName));
-      if(elementIt != elementsByName.end()) {
-        element = elementIt->second;
-      } else {
-        element = createDataElement(groupName, dataName, flags);
-        publishDataElement(element);
+      // existing elements are found without locking
+      DataElement *element = findElementByName(groupName, dataName);
+      if(!element) {
+        elementsLock.lockForWrite();
+        elementIt = elementsByName.find(std::make_pair(groupName, dataName));
+        if(elementIt != elementsByName.end()) {
+          element = elementIt->second;
+        } else {
+          element = createDataElement(groupName, dataName, flags);
+          publishDataElement(element);
+        }
+        elementsLock.unlock();
       }
-      elementsLock.unlock();
-
-      pushData(element->info.dataId, dataPackage, producer);
-      // hack to solve empty backBuffer problem while using producerCallbacks
-      *element->backBuffer = dataPackage;
 
+      pushElementData(element, dataPackage, producer);
       return element->info.dataId;
     }
 
     unsigned long DataBroker::pushData(unsigned long id,
                                        const DataPackage &dataPackage,
                                        const ReceiverInterface *producer) {
-      std::list<Receiver>::iterator syncReceiverIt;
       std::map<unsigned long, DataElement*>::iterator elementIt;
-      std::set<DataElement*> connectionActivatedElements;
-      std::list<Receiver> syncReceivers;
-      DataInfo info;
       DataElement *element = NULL;
       elementsLock.lockForRead();
       elementIt = elementsById.find(id);
@@ -928,57 +1330,122 @@ namespace mars {
         // ERROR: id not found!
         elementsLock.unlock();
         return 0;
-      } else {
-        element = elementIt->second;
-        *element->backBuffer = dataPackage;
-        element->bufferLock->lockForWrite();
-        std::swap(element->backBuffer, element->frontBuffer);
-        element->lastProducer = producer;
-        element->bufferLock->unlock();
-
-        updatedElementsLock.lock();
-        updatedElementsBackBuffer->insert(element);
-        updatedElementsLock.unlock();
-
-        element->receiverLock->lockForRead();
-        // defer synchronous callbacks until we do not hold any locks anymore
-        syncReceivers = element->syncReceivers;
-        info = element->info;
-        element->receiverLock->unlock();
-        for(std::list<DataItemConnection>::iterator connectionIt = element->connections.begin(); connectionIt != element->connections.end(); ++connectionIt) {
-          long fromIdx = connectionIt->fromDataItemIndex;
-          long toIdx = connectionIt->toDataItemIndex;
-          DataItem currentItem;
-          currentItem = (*connectionIt->fromElement->frontBuffer)[fromIdx];
-          currentItem.setName((*connectionIt->toElement->frontBuffer)[toIdx].getName());
-          (*connectionIt->toElement->frontBuffer)[toIdx] = currentItem;
-          connectionActivatedElements.insert(connectionIt->toElement);
-        }
       }
+      element = elementIt->second;
       elementsLock.unlock();
 
+      pushElementData(element, dataPackage, producer);
+      return id;
+    }
+
+    /**
+     * \brief Publishes \a dataPackage on \a element and calls the
+     * synchronous receivers.
+     *
+     * The elements are never deleted while the DataBroker exists, thus no
+     * lock on the element maps is needed here.
+     */
+    void DataBroker::pushElementData(DataElement *element,
+                                     const DataPackage &dataPackage,
+                                     const ReceiverInterface *producer) {
+      std::list<Receiver>::iterator syncReceiverIt;
+      std::set<DataElement*> connectionActivatedElements;
+      std::list<Receiver> syncReceivers;
+      std::shared_ptr<const DataPackage> package;
+
+      element->bufferLock->lockForWrite();
+      *element->backBuffer = dataPackage;
+      swapBuffers(element);
+      element->lastProducer = producer;
+      package = element->frontBuffer;
+      element->bufferLock->unlock();
+
+      queueAsync(element, package, producer);
+
+      element->receiverLock->lockForRead();
+      // defer synchronous callbacks until we do not hold any locks anymore
+      syncReceivers = element->syncReceivers;
+      element->receiverLock->unlock();
+      applyConnections(element, &connectionActivatedElements);
+
       // do the synchronous callbacks
       for(syncReceiverIt = syncReceivers.begin();
           syncReceiverIt != syncReceivers.end();
           ++syncReceiverIt) {
         if(syncReceiverIt->receiver != producer)
-          syncReceiverIt->receiver->receiveData(info, dataPackage,
+          syncReceiverIt->receiver->receiveData(element->info, dataPackage,
                                                 syncReceiverIt->callbackParam);
       }
 
-      for(std::set<DataElement*>::iterator toElementIt = connectionActivatedElements.begin(); toElementIt != connectionActivatedElements.end(); ++toElementIt) {
-        DataElement *toElement = *toElementIt;
-        pushData(toElement->info.dataId, *toElement->frontBuffer);
-      }
+      pushConnections(connectionActivatedElements);
+    }
+
+    /**
+     * \brief Appends \a package to the queues of the asynchronous receivers
+     * of \a element and wakes a dispatch thread.
+     *
+     * The queue policy of each receiver decides whether a pending package
+     * of the same stream is replaced or which package is dropped when the
+     * queue is full.
+     */
+    void DataBroker::queueAsync(DataElement *element,
+                                const std::shared_ptr<const DataPackage> &package,
+                                const ReceiverInterface *producer) {
+      std::list<Receiver>::iterator receiverIt;
+      std::deque<AsyncDelivery>::iterator deliveryIt;
+      size_t numReady = 0;
 
-      // The main thread only releases the wakeupMutex when it goes to sleep.
-      // So if we can lock it, we wake up the main thread so it can process the
-      // data we just pushed. Otherwise it is still running and will process it.
-      if(wakeupMutex.tryLock() == MUTEX_ERROR_NO_ERROR) {
-        wakeupCondition.wakeOne();
-        wakeupMutex.unlock();
+      element->receiverLock->lockForRead();
+      if(element->asyncReceivers.empty()) {
+        element->receiverLock->unlock();
+        return;
       }
-      return id;
+      AsyncDelivery delivery = {element, package, 0, getSteadyTime()};
+      asyncMutex.lock();
+      for(receiverIt = element->asyncReceivers.begin();
+          receiverIt != element->asyncReceivers.end(); ++receiverIt) {
+        if(receiverIt->receiver == producer) {
+          continue;
+        }
+        AsyncSubscriber *subscriber = receiverIt->subscriber;
+        std::deque<AsyncDelivery> &queue = subscriber->queue;
+        delivery.callbackParam = receiverIt->callbackParam;
+        if(subscriber->policy == ASYNC_QUEUE_COALESCE) {
+          for(deliveryIt = queue.begin(); deliveryIt != queue.end(); ++deliveryIt) {
+            if(deliveryIt->element == element &&
+               deliveryIt->callbackParam == delivery.callbackParam) {
+              break;
+            }
+          }
+          if(deliveryIt != queue.end()) {
+            *deliveryIt = delivery;
+            ++subscriber->coalesced;
+            continue;
+          }
+        }
+        if(queue.size() >= subscriber->maxQueueSize) {
+          ++subscriber->dropped;
+          if(subscriber->policy == ASYNC_QUEUE_DROP_NEWEST) {
+            continue;
+          }
+          queue.pop_front();
+        }
+        queue.push_back(delivery);
+        subscriber->maxQueueDepth = std::max(subscriber->maxQueueDepth,
+                                             queue.size());
+        if(!subscriber->scheduled) {
+          subscriber->scheduled = true;
+          readySubscribers.push_back(subscriber);
+          ++numReady;
+        }
+      }
+      if(numReady == 1) {
+        asyncCondition.wakeOne();
+      } else if(numReady > 1) {
+        asyncCondition.wakeAll();
+      }
+      asyncMutex.unlock();
+      element->receiverLock->unlock();
     }
 
     void DataBroker::pushMessage(MessageType messageType,
@@ -1034,77 +1501,188 @@ namespace mars {
       va_end(args);
     }
 
+    /**
+     * \brief Main loop of the _REALTIME_ thread.
+     *
+     * The thread sleeps until the next producer or receiver of the timer is
+     * due and then steps the timer by the elapsed milliseconds. The wakeups
+     * are absolute times, so the periods do not drift. The wakeup delay is
+     * published as "data_broker/realtimeStats".
+     */
     void DataBroker::runRealtime() {
-      long t = getTime();
-      long dt;
+      std::map<std::string, Timer>::iterator timerIt;
+      DataPackage statsPackage;
+      long long start, wakeup, now, late, lateSum = 0, lateMax = 0;
+      unsigned long wakeups = 0, missed = 0;
+      long t = 0, next, nextStats = REALTIME_STATS_PERIOD;
+
+      timersLock.lockForRead();
+      timerIt = timers.find("_REALTIME_");
+      timersLock.unlock();
+      Timer *timer = &timerIt->second;
+
+      start = getSteadyTime();
       while(!stopRealtimeThread) {
-        dt = getTimeDiff(t);
-        stepTimer("_REALTIME_", dt);
-        t += dt;
-        msleep(10);
+        timer->lock->lockForRead();
+        next = t + getNextTriggerTime(timer, REALTIME_MAX_SLEEP) - timer->t;
+        timer->lock->unlock();
+        wakeup = start + next*1000LL;
+        now = getSteadyTime();
+        if(wakeup < now) {
+          wakeup = now;
+        }
+        sleepUntil(wakeup);
+        now = getSteadyTime();
+        late = now - wakeup;
+        lateSum += late;
+        lateMax = std::max(lateMax, late);
+        ++wakeups;
+        if(late >= 1000) {
+          ++missed;
+        }
+        next = (now - start) / 1000;
+        stepTimer("_REALTIME_", next - t);
+        t = next;
+
+        if(t >= nextStats) {
+          nextStats = t + REALTIME_STATS_PERIOD;
+          statsPackage.clear();
+          statsPackage.add("wakeups", (long)wakeups);
+          statsPackage.add("missed", (long)missed);
+          statsPackage.add("jitter", lateSum*0.001/wakeups);
+          statsPackage.add("maxJitter", lateMax*0.001);
+          pushData(realtimeStatsId, statsPackage);
+          lateSum = lateMax = 0;
+          wakeups = missed = 0;
+        }
       }
     }
 
-    void DataBroker::run() {
-      std::set<DataElement*>::iterator updatedElementsIt;
-      std::list<Receiver>::iterator receiverIt;
-      std::list<DeferredCallback> deferredCallbacks;
-      std::list<DeferredCallback>::iterator callbackIt;
-
-      wakeupMutex.lock();
-      while(!stop_thread) {
-        elementsLock.lockForRead();
-        updatedElementsLock.lock();
-        std::swap(updatedElementsBackBuffer, updatedElementsFrontBuffer);
-        updatedElementsLock.unlock();
-
-        for(updatedElementsIt = updatedElementsFrontBuffer->begin();
-            updatedElementsIt != updatedElementsFrontBuffer->end();
-            ++updatedElementsIt) {
-          DataElement *element = *updatedElementsIt;
+    /**
+     * \brief Returns the time of \a timer at which the next producer or
+     * receiver is due, but at most \a maxDelay ms after the current time.
+     *
+     * Entries without an update period are called on every step and do
+     * not shorten the delay. Has to be called with the timer locked.
+     */
+    long DataBroker::getNextTriggerTime(Timer *timer, long maxDelay) const {
+      long next = timer->t + maxDelay;
+      bool dirty;
+
+      timer->producers.lock();
+      timer->receivers.lock();
+      dirty = timer->scheduleDirty;
+      timer->receivers.unlock();
+      timer->producers.unlock();
+      if(dirty) {
+        // new entries are due with the next step
+        return timer->t;
+      }
+      if(!timer->queue.empty()) {
+        next = std::min(next, timer->queue.front()->nextTriggerTime);
+      }
+      return next;
+    }
 
-          element->bufferLock->lockForRead();
-          element->receiverLock->lockForRead();
-          // defer callbacks until we do not hold any lock anymore
-          if(!element->asyncReceivers.empty()) {
-            DeferredCallback deferred;
-            deferred.receivers = element->asyncReceivers;
-            deferred.info = element->info;
-            deferred.package = *element->frontBuffer;
-            deferred.producer = element->lastProducer;
-            deferredCallbacks.push_back(deferred);
+    /**
+     * \brief Main loop of the dispatch threads.
+     *
+     * A thread takes the whole queue of the next ready subscriber and
+     * calls the receiver without holding a lock. The threads sleep until
+     * data is queued or the next "asyncStats" package is due.
+     */
+    void DataBroker::dispatchAsync() {
+      std::deque<AsyncDelivery> deliveries;
+      std::deque<AsyncDelivery>::iterator deliveryIt;
+      DataPackage statsPackage;
+
+      asyncMutex.lock();
+      while(!stopDispatch && activeDispatchThreads <= numDispatchThreads) {
+        long long now = getSteadyTime();
+        if(now >= nextAsyncStatsTime) {
+          nextAsyncStatsTime = now + ASYNC_STATS_PERIOD*1000LL;
+          if(collectAsyncStats(&statsPackage)) {
+            asyncMutex.unlock();
+            pushData(asyncStatsId, statsPackage);
+            asyncMutex.lock();
+            continue;
           }
-          element->receiverLock->unlock();
-          element->bufferLock->unlock();
         }
-        updatedElementsFrontBuffer->clear();
-        elementsLock.unlock();
-
-        // make the callbacks
-        //pushError("DataBroker::deferredCallbacks %d", deferredCallbacks.size());
-        for(callbackIt = deferredCallbacks.begin();
-            callbackIt != deferredCallbacks.end(); ++callbackIt) {
-          for(receiverIt = callbackIt->receivers.begin();
-              receiverIt != callbackIt->receivers.end();
-              ++receiverIt) {
-            if(receiverIt->receiver != callbackIt->producer)
-              receiverIt->receiver->receiveData(callbackIt->info,
-                                                callbackIt->package,
-                                                receiverIt->callbackParam);
-          }
+        if(readySubscribers.empty()) {
+          asyncCondition.wait(&asyncMutex, ASYNC_STATS_PERIOD);
+          continue;
+        }
+        AsyncSubscriber *subscriber = readySubscribers.front();
+        readySubscribers.pop_front();
+        deliveries.swap(subscriber->queue);
+        subscriber->dispatching = true;
+        dispatchedSubscriber = subscriber;
+        asyncMutex.unlock();
+
+        long long latency, latencySum = 0, latencyMax = 0;
+        for(deliveryIt = deliveries.begin();
+            deliveryIt != deliveries.end() && !subscriber->removed;
+            ++deliveryIt) {
+          latency = getSteadyTime() - deliveryIt->pushTime;
+          latencySum += latency;
+          latencyMax = std::max(latencyMax, latency);
+          subscriber->receiver->receiveData(deliveryIt->element->info,
+                                            *deliveryIt->package,
+                                            deliveryIt->callbackParam);
+        }
+        size_t numDelivered = deliveryIt - deliveries.begin();
+        deliveries.clear();
+
+        asyncMutex.lock();
+        dispatchedSubscriber = NULL;
+        subscriber->dispatching = false;
+        asyncIdleCondition.wakeAll();
+        if(subscriber->removed) {
+          delete subscriber;
+          continue;
+        }
+        subscriber->delivered += numDelivered;
+        subscriber->latencySum += latencySum;
+        subscriber->latencyMax = std::max(subscriber->latencyMax, latencyMax);
+        if(subscriber->queue.empty()) {
+          subscriber->scheduled = false;
+        } else {
+          readySubscribers.push_back(subscriber);
         }
-        deferredCallbacks.clear();
+      }
+      --activeDispatchThreads;
+      asyncMutex.unlock();
+    }
 
-        // If there is no data to process go to sleep. pushData() will wake us up.
-        updatedElementsLock.lock();
-        bool bufferIsEmpty = updatedElementsBackBuffer->empty();
-        updatedElementsLock.unlock();
-        if(bufferIsEmpty) {
-          wakeupCondition.wait(&wakeupMutex);
+    /**
+     * \brief Fills \a package with the statistics of the asynchronous
+     * receivers since the last call and resets them.
+     *
+     * Has to be called with asyncMutex locked.
+     * \return \c false if there are no asynchronous receivers.
+     */
+    bool DataBroker::collectAsyncStats(DataPackage *package) {
+      std::map<ReceiverInterface*, AsyncSubscriber*>::iterator it;
+      package->clear();
+      for(it = asyncSubscribers.begin(); it != asyncSubscribers.end(); ++it) {
+        AsyncSubscriber *subscriber = it->second;
+        const std::string &name = subscriber->name;
+        double latencyAvg = 0.0;
+        if(subscriber->delivered) {
+          latencyAvg = subscriber->latencySum*0.001/subscriber->delivered;
         }
-        msleep(10);
+        package->add(name + "/queueDepth", (long)subscriber->queue.size());
+        package->add(name + "/maxQueueDepth", (long)subscriber->maxQueueDepth);
+        package->add(name + "/delivered", (long)subscriber->delivered);
+        package->add(name + "/dropped", (long)subscriber->dropped);
+        package->add(name + "/coalesced", (long)subscriber->coalesced);
+        package->add(name + "/latency", latencyAvg);
+        package->add(name + "/maxLatency", subscriber->latencyMax*0.001);
+        subscriber->delivered = subscriber->dropped = subscriber->coalesced = 0;
+        subscriber->maxQueueDepth = subscriber->queue.size();
+        subscriber->latencySum = subscriber->latencyMax = 0;
       }
-      wakeupMutex.unlock();
+      return !asyncSubscribers.empty();
     }
 
 
@@ -1177,17 +1755,125 @@ namespace mars {
       element->info.groupName = groupName.c_str();
       element->info.dataName = dataName.c_str();
       element->info.flags = flags;
-      element->backBuffer = new DataPackage;
-      element->frontBuffer = new DataPackage;
+      element->backBuffer.reset(new DataPackage);
+      element->frontBuffer.reset(new DataPackage);
       element->bufferLock = new ReadWriteLock;
       element->receiverLock = new ReadWriteLock;
       elementsByName[std::make_pair(groupName.c_str(),
                                     dataName.c_str())] = element;
       elementsById[element->info.dataId] = element;
+      addElementName(element);
       updatePendingRegistrations(element);
       return element;
     }
 
+    /**
+     * \brief Publishes the back buffer of \a element as its new front buffer.
+     *
+     * Has to be called with the bufferLock of \a element locked for writing.
+     * The old front buffer becomes the new back buffer unless a receiver
+     * still holds it. In that case the back buffer is replaced by a copy
+     * of the new front buffer. The producers expect the back buffer to
+     * contain the items of the stream, thus it is also filled from the
+     * front buffer when the items differ, e.g. after the first push.
+     */
+    void DataBroker::swapBuffers(DataElement *element) {
+      std::swap(element->backBuffer, element->frontBuffer);
+      if(element->backBuffer.use_count() > 1) {
+        element->backBuffer.reset(new DataPackage(*element->frontBuffer));
+      }
+      else if(element->backBuffer->size() != element->frontBuffer->size()) {
+        *element->backBuffer = *element->frontBuffer;
+      }
+    }
+
+    /**
+     * \brief Copies the connected items of \a element into the front
+     * buffers of the connected elements.
+     *
+     * The elements that were written to are added to \a activatedElements
+     * and have to be pushed with pushConnections.
+     */
+    void DataBroker::applyConnections(DataElement *element,
+                                      std::set<DataElement*> *activatedElements) {
+      std::list<DataItemConnection>::iterator connectionIt;
+      DataItem currentItem;
+
+      for(connectionIt = element->connections.begin();
+          connectionIt != element->connections.end(); ++connectionIt) {
+        long fromIdx = connectionIt->fromDataItemIndex;
+        long toIdx = connectionIt->toDataItemIndex;
+        DataElement *toElement = connectionIt->toElement;
+
+        element->bufferLock->lockForRead();
+        currentItem = (*element->frontBuffer)[fromIdx];
+        element->bufferLock->unlock();
+
+        toElement->bufferLock->lockForWrite();
+        // never write into a snapshot that a receiver still holds
+        if(toElement->frontBuffer.use_count() > 1) {
+          toElement->frontBuffer.reset(new DataPackage(*toElement->frontBuffer));
+        }
+        currentItem.setName((*toElement->frontBuffer)[toIdx].getName());
+        (*toElement->frontBuffer)[toIdx] = currentItem;
+        toElement->bufferLock->unlock();
+        activatedElements->insert(toElement);
+      }
+    }
+
+    void DataBroker::pushConnections(const std::set<DataElement*> &activatedElements) {
+      std::set<DataElement*>::const_iterator toElementIt;
+      std::shared_ptr<const DataPackage> package;
+
+      for(toElementIt = activatedElements.begin();
+          toElementIt != activatedElements.end(); ++toElementIt) {
+        DataElement *toElement = *toElementIt;
+        toElement->bufferLock->lockForRead();
+        package = toElement->frontBuffer;
+        toElement->bufferLock->unlock();
+        pushData(toElement->info.dataId, *package);
+      }
+    }
+
+    size_t DataBroker::hashElementName(const std::string &groupName,
+                                       const std::string &dataName) {
+      std::hash<std::string> hashString;
+      size_t hash = hashString(groupName);
+      hash ^= hashString(dataName) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      return hash % ELEMENT_NAME_TABLE_SIZE;
+    }
+
+    DataElement* DataBroker::findElementByName(const std::string &groupName,
+                                               const std::string &dataName) const {
+      size_t bucket = hashElementName(groupName, dataName);
+      const ElementNameEntry *entry;
+      entry = elementNameTable[bucket].load(std::memory_order_acquire);
+      for(; entry; entry = entry->next) {
+        if(entry->dataName == dataName && entry->groupName == groupName) {
+          return entry->element;
+        }
+      }
+      return NULL;
+    }
+
+    /**
+     * \brief Adds \a element to the lock free name lookup.
+     *
+     * Has to be called with elementsLock locked for writing. The new entry
+     * is prepended to its chain, so concurrent readers either see the old
+     * or the new head of a complete chain.
+     */
+    void DataBroker::addElementName(DataElement *element) {
+      size_t bucket = hashElementName(element->info.groupName,
+                                      element->info.dataName);
+      ElementNameEntry *entry = new ElementNameEntry;
+      entry->groupName = element->info.groupName;
+      entry->dataName = element->info.dataName;
+      entry->element = element;
+      entry->next = elementNameTable[bucket].load(std::memory_order_relaxed);
+      elementNameTable[bucket].store(entry, std::memory_order_release);
+    }
+
     void DataBroker::publishDataElement(const DataElement *element)
     {
       // Inform receivers about new Stream.
@@ -1220,8 +1906,15 @@ namespace mars {
           registrationIt != pendingAsyncRegistrations.end(); ) {
         if(matchPattern(registrationIt->groupName, newGroupName) &&
            matchPattern(registrationIt->dataName, newDataName)) {
-          Receiver r = {registrationIt->receiver, registrationIt->callbackParam};
+          asyncMutex.lock();
+          AsyncSubscriber *subscriber = getAsyncSubscriber(registrationIt->receiver);
+          ++subscriber->registrations;
+          asyncMutex.unlock();
+          Receiver r = {registrationIt->receiver, registrationIt->callbackParam,
+                        subscriber};
+          newElement->receiverLock->lockForWrite();
           newElement->asyncReceivers.push_back(r);
+          newElement->receiverLock->unlock();
           // if the registration has wildcards keep it in the pending list...
           if(hasWildcards(registrationIt->groupName) ||
              hasWildcards(registrationIt->dataName)) {
@@ -1240,7 +1933,8 @@ namespace mars {
           registrationIt != pendingSyncRegistrations.end(); ) {
         if(matchPattern(registrationIt->groupName, newGroupName) &&
            matchPattern(registrationIt->dataName, newDataName)) {
-          Receiver r = {registrationIt->receiver, registrationIt->callbackParam};
+          Receiver r = {registrationIt->receiver, registrationIt->callbackParam,
+                        NULL};
           newElement->syncReceivers.push_back(r);
           // if the registration has wildcards keep it in the pending list...
           if(hasWildcards(registrationIt->groupName) ||
@@ -1268,7 +1962,7 @@ namespace mars {
                                 timedRegistrationIt->updatePeriod,
                                 timerIt->second.t,
                                 timedRegistrationIt->callbackParam };
-            timerIt->second.receivers.push_back(r);
+            addTimedReceiver(&timerIt->second, r);
             // if the registration has wildcards keep it in the pending list...
             if(!hasWildcards(timedRegistrationIt->groupName) &&
                !hasWildcards(timedRegistrationIt->dataName)) {
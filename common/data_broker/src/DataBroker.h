@@ -41,16 +41,24 @@
 #include <list>
 #include <map>
 #include <set>
+#include <deque>
+#include <memory>
+#include <atomic>
 
 #include <pthread.h>
 
+// number of buckets of the name lookup table of the DataElements
+#define ELEMENT_NAME_TABLE_SIZE 1024
+
 namespace mars {
 
   namespace data_broker {
 
     class ReceiverInterface;
     class ProducerInterface;
+    class AsyncDispatchThread;
     struct DataElement;
+    struct AsyncSubscriber;
 
     inline bool hasWildcards(const std::string &str) {
       return (str.find("*") != str.npos);
@@ -106,12 +114,36 @@ namespace mars {
       int callbackParam;
     };
 
+    /**
+     * The timed producers and receivers of a Timer that have the same
+     * update period and are due at the same time. They are called in one
+     * batch and rescheduled together.
+     */
+    struct TimerSlot {
+      int updatePeriod;
+      long nextTriggerTime;
+      std::vector<TimedProducer*> producers;
+      std::vector<TimedReceiver*> receivers;
+    };
+
     struct Timer {
       long t;
       LockableContainer<std::list<TimedProducer> > producers;
       LockableContainer<std::list<TimedReceiver> > receivers;
       mars::utils::ReadWriteLock *lock;
       unsigned long timerElementId;
+      /**
+       * Schedule of the entries of the lists above. queue is a min heap of
+       * the slots by nextTriggerTime, thus a step only touches the due
+       * slots. The entries without an update period are in everyStep.
+       * The schedule is rebuilt by stepTimer once the lists changed, which
+       * is marked by scheduleDirty under the locks of the lists.
+       */
+      std::vector<TimerSlot> slots;
+      std::vector<TimerSlot*> queue;
+      TimerSlot everyStep;
+      bool scheduleDirty;
+      DataPackage timePackage;
     };
 
     struct TriggeredReceiver {
@@ -128,13 +160,58 @@ namespace mars {
     struct Receiver {
       ReceiverInterface *receiver;
       int callbackParam;
+      AsyncSubscriber *subscriber; ///< only set for asynchronous receivers
     };
 
+    struct AsyncDelivery {
+      DataElement *element;
+      std::shared_ptr<const DataPackage> package;
+      int callbackParam;
+      long long pushTime; ///< steady clock in microseconds
+    };
+
+    /// policy set for a receiver that has no asynchronous stream yet
+    struct AsyncPolicy {
+      AsyncQueuePolicy policy;
+      size_t maxQueueSize;
+      std::string name;
+    };
+
+    /**
+     * The queue of an asynchronous receiver. It is shared by all streams
+     * the receiver is registered to and is guarded by asyncMutex. Only
+     * one dispatch thread at a time takes the queue of a subscriber, so
+     * the receiver gets its DataPackages in order.
+     */
+    struct AsyncSubscriber {
+      ReceiverInterface *receiver;
+      std::string name;
+      AsyncQueuePolicy policy;
+      size_t maxQueueSize;
+      std::deque<AsyncDelivery> queue;
+      size_t registrations; ///< number of Receiver entries pointing here
+      bool scheduled; ///< in readySubscribers or taken by a dispatch thread
+      bool dispatching; ///< a dispatch thread is calling the receiver
+      /// set by an unregistration from within the callback, the
+      /// dispatch thread stops the batch and deletes the subscriber
+      std::atomic<bool> removed;
+      // statistics since the last asyncStats package
+      unsigned long delivered, dropped, coalesced;
+      size_t maxQueueDepth;
+      long long latencySum, latencyMax;
+    };
+
+    /**
+     * The producers write into the back buffer, which is swapped with the
+     * front buffer to publish the data. The receivers get the front buffer
+     * as a shared snapshot instead of a copy. A snapshot that is still
+     * referenced after a swap is not written to again, see swapBuffers.
+     */
     struct DataElement {
       DataInfo info;
       //    bool updated;
-      DataPackage *backBuffer;
-      DataPackage *frontBuffer;
+      std::shared_ptr<DataPackage> backBuffer;
+      std::shared_ptr<DataPackage> frontBuffer;
       LockableContainer<std::list<Receiver> > syncReceivers;
       LockableContainer<std::list<Receiver> > asyncReceivers;
       mars::utils::ReadWriteLock *bufferLock;
@@ -142,13 +219,23 @@ namespace mars {
       const ReceiverInterface *lastProducer;
       std::list<DataItemConnection> connections;
     };
+
+    /**
+     * Entry of the lock free name lookup of the DataElements. The entries
+     * are immutable once they are published in the table.
+     */
+    struct ElementNameEntry {
+      std::string groupName;
+      std::string dataName;
+      DataElement *element;
+      ElementNameEntry *next;
+    };
     /// \endcond
 
     /**
      * Central class of the DataBroker library.
      */
-    class DataBroker : public DataBrokerInterface,
-                       public mars::utils::Thread {
+    class DataBroker : public DataBrokerInterface {
 
     public:
       DataBroker(lib_manager::LibManager *theManager);
@@ -160,6 +247,10 @@ namespace mars {
        *         false if no timer with the given name exists.
        */
       bool stepTimer(const std::string &timerName, long step=1);
+      bool saveTimerState(const std::string &timerName,
+                          std::vector<long> *state);
+      bool restoreTimerState(const std::string &timerName,
+                             const std::vector<long> &state);
       bool registerTimedReceiver(ReceiverInterface *receiver,
                                  const std::string &groupName,
                                  const std::string &dataName,
@@ -208,6 +299,11 @@ namespace mars {
       bool unregisterAsyncReceiver(ReceiverInterface *receiver,
                                    const std::string &groupName,
                                    const std::string &dataName);
+      void setAsyncReceiverPolicy(ReceiverInterface *receiver,
+                                  AsyncQueuePolicy policy,
+                                  unsigned int maxQueueSize,
+                                  const std::string &name="");
+      void setAsyncDispatchThreads(unsigned int numThreads);
 
       unsigned long pushData(const std::string &groupName,
                              const std::string &dataName,
@@ -245,9 +341,8 @@ namespace mars {
                                const std::string &toItemName);
 
 
-      void run(void);
+      void dispatchAsync(void);
       void runRealtime(void);
-      inline void setThreadStopped(bool val) {thread_running = !val;}
       inline void setRTThreadStopped(bool val) {
         realtimeThreadRunning = !val;
         startingRealtimeThread = false;
@@ -274,6 +369,31 @@ namespace mars {
                                      const std::string &dataName,
                                      PackageFlag flags);
       void publishDataElement(const DataElement *element);
+      void swapBuffers(DataElement *element);
+      void applyConnections(DataElement *element,
+                            std::set<DataElement*> *activatedElements);
+      void pushConnections(const std::set<DataElement*> &activatedElements);
+      void pushElementData(DataElement *element,
+                           const DataPackage &dataPackage,
+                           const ReceiverInterface *producer);
+      void queueAsync(DataElement *element,
+                      const std::shared_ptr<const DataPackage> &package,
+                      const ReceiverInterface *producer);
+      AsyncSubscriber* getAsyncSubscriber(ReceiverInterface *receiver);
+      void releaseAsyncSubscriber(AsyncSubscriber *subscriber,
+                                  size_t registrations,
+                                  const std::set<DataElement*> &elements);
+      void startAsyncDispatch();
+      bool collectAsyncStats(DataPackage *package);
+      long getNextTriggerTime(Timer *timer, long maxDelay) const;
+      void addTimedProducer(Timer *timer, const TimedProducer &producer);
+      void addTimedReceiver(Timer *timer, const TimedReceiver &receiver);
+      void updateSchedule(Timer *timer);
+      DataElement* findElementByName(const std::string &groupName,
+                                     const std::string &dataName) const;
+      void addElementName(DataElement *element);
+      static size_t hashElementName(const std::string &groupName,
+                                    const std::string &dataName);
       void updatePendingRegistrations(DataElement *newElement);
       unsigned long createId();
       //void destroyLock(pthread_rwlock_t *rwlock);
@@ -291,15 +411,10 @@ namespace mars {
                              const std::string &dataName,
                              std::vector<DataElement*> *elements) const;
 
-      std::set<DataElement*> *updatedElementsBackBuffer;
-      std::set<DataElement*> *updatedElementsFrontBuffer;
-
       unsigned long next_id;
-      pthread_t theThread;
       pthread_t realtimeThread;
       mars::utils::Mutex idMutex;
       mars::utils::Mutex realtimeMutex;
-      bool thread_running, stop_thread;
       bool realtimeThreadRunning, stopRealtimeThread;
       bool startingRealtimeThread;
 
@@ -311,16 +426,41 @@ namespace mars {
       std::map<unsigned long, DataElement*> elementsById;
       std::map<std::string, Trigger> triggers;
       std::map<std::pair<std::string, std::string>, DataElement*> elementsByName;
+      /**
+       * Hash table to look up existing elements by name without locking.
+       * Elements are only added while holding elementsLock for writing and
+       * are never removed until the DataBroker is destroyed. A chain is
+       * published by a release store of its head, thus readers can walk
+       * it without a lock.
+       */
+      std::atomic<ElementNameEntry*> elementNameTable[ELEMENT_NAME_TABLE_SIZE];
       mutable mars::utils::ReadWriteLock elementsLock;
       mars::utils::ReadWriteLock timersLock;
       mars::utils::ReadWriteLock triggersLock;
-      mars::utils::Mutex updatedElementsLock;
       mars::utils::Mutex pendingRegistrationLock;
 
-      mars::utils::WaitCondition wakeupCondition;
-      mars::utils::Mutex wakeupMutex;
+      /**
+       * The asynchronous receivers are called by the dispatch threads,
+       * which are started with the first asynchronous registration. The
+       * pushing thread appends to the queues of the subscribers and wakes
+       * one dispatch thread, thus the data is delivered without polling.
+       */
+      mars::utils::Mutex asyncMutex;
+      mars::utils::WaitCondition asyncCondition;
+      mars::utils::WaitCondition asyncIdleCondition;
+      std::map<ReceiverInterface*, AsyncSubscriber*> asyncSubscribers;
+      std::map<ReceiverInterface*, AsyncPolicy> asyncPolicies;
+      std::deque<AsyncSubscriber*> readySubscribers;
+      std::vector<AsyncDispatchThread*> dispatchThreads;
+      unsigned int numDispatchThreads, activeDispatchThreads;
+      unsigned long nextSubscriberId;
+      long long nextAsyncStatsTime;
+      bool stopDispatch;
+
       std::map<std::string, Timer> timers;
       unsigned long newStreamId;
+      unsigned long asyncStatsId;
+      unsigned long realtimeStatsId;
       unsigned long pushMessageIds[__DB_MESSAGE_TYPE_COUNT];
     }; // end of class definition DataBroker
 
@@ -101,6 +101,20 @@ namespace mars {
       __DB_MESSAGE_TYPE_COUNT
     };
 
+    /**
+     * \brief What happens to the DataPackages pushed for an asynchronous
+     *        receiver while it is still busy.
+     * \see DataBrokerInterface::setAsyncReceiverPolicy
+     */
+    enum AsyncQueuePolicy {
+      /** Only the latest DataPackage of each stream is kept. */
+      ASYNC_QUEUE_COALESCE,
+      /** Every DataPackage is kept, the oldest one is dropped when full. */
+      ASYNC_QUEUE_DROP_OLDEST,
+      /** Every DataPackage is kept, new ones are dropped when full. */
+      ASYNC_QUEUE_DROP_NEWEST,
+    };
+
     /** \brief The interface every DataBroker should implement. */
     class DataBrokerInterface : public lib_manager::LibInterface {
 
@@ -151,6 +165,27 @@ namespace mars {
        */
       virtual bool stepTimer(const std::string &timerName, long step=1) = 0;
 
+      /**
+       * \brief appends the internal state of the timer timerName to state
+       * \return \c false if no timer with the name \a timerName exists.
+       *
+       * The state holds the timer time and the next trigger time of every
+       * registered producer and receiver. It can be passed to
+       * \ref restoreTimerState as long as the registrations did not change.
+       * \see createTimer, stepTimer
+       */
+      virtual bool saveTimerState(const std::string &timerName,
+                                  std::vector<long> *state) = 0;
+
+      /**
+       * \brief restores a timer state created by \ref saveTimerState
+       * \return \c false if no timer with the name \a timerName exists or
+       *         the state does not match the current registrations.
+       * \see createTimer, stepTimer
+       */
+      virtual bool restoreTimerState(const std::string &timerName,
+                                     const std::vector<long> &state) = 0;
+
       /**
        * \brief registers a receiver for a group/data with a timer
        * \param receiver The ReceiverInterface that should be called back.
@@ -433,6 +468,41 @@ namespace mars {
                                            const std::string &groupName,
                                            const std::string &dataName) = 0;
 
+      /**
+       * \brief sets how the DataPackages are queued for an asynchronous
+       *        receiver
+       * \param receiver The ReceiverInterface the policy applies to. The
+       *                 setting is kept until the receiver is unregistered
+       *                 from all its asynchronous streams.
+       * \param policy How new DataPackages are queued while the receiver
+       *               did not process the previous ones yet.
+       * \param maxQueueSize The maximum number of queued DataPackages.
+       *                     With ASYNC_QUEUE_COALESCE this bounds the
+       *                     number of streams with pending data.
+       * \param name Identifies the receiver in the "data_broker/asyncStats"
+       *             stream, which publishes the queue depth, latency and
+       *             dropped packages of every asynchronous receiver.
+       *
+       * Without a call to this method a receiver uses ASYNC_QUEUE_COALESCE,
+       * which matches the behavior described in \ref registerAsyncReceiver.
+       *
+       * \see registerAsyncReceiver, setAsyncDispatchThreads
+       */
+      virtual void setAsyncReceiverPolicy(ReceiverInterface *receiver,
+                                          AsyncQueuePolicy policy,
+                                          unsigned int maxQueueSize,
+                                          const std::string &name="") = 0;
+
+      /**
+       * \brief sets the number of threads that call the asynchronous
+       *        receivers
+       *
+       * A receiver is only called by one thread at a time and gets its
+       * DataPackages in the order they were pushed. More threads only
+       * help if several receivers are slow. The default is one thread.
+       */
+      virtual void setAsyncDispatchThreads(unsigned int numThreads) = 0;
+
       /**
        * \brief pushes a DataPackage into the DataBroker
        * \param groupName A string to identify different 
@@ -19,18 +19,83 @@
  */
 
 #include "DataItem.h"
+
+#include <mars/utils/Mutex.h>
+#include <mars/utils/MutexLocker.h>
+
+#include <atomic>
 #include <cstdio>
 
+// size of the table of item names, has to be a power of two
+#define NAME_TABLE_SIZE 4096
+// the table is kept half empty to keep the probe sequences short
+#define MAX_INTERNED_NAMES (NAME_TABLE_SIZE / 2)
+
 namespace mars {
 
   namespace data_broker {
 
-    DataItem::DataItem() {
+    static std::atomic<const std::string*> nameTable[NAME_TABLE_SIZE];
+
+    static size_t hashName(const std::string &name) {
+      // FNV-1a
+      size_t hash = 2166136261u;
+      for(size_t i=0; i<name.size(); ++i) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+      }
+      return hash;
+    }
+
+    /**
+     * Returns the string stored for \a name in the table of item names,
+     * or 0 if the table is full. The strings are never removed, thus the
+     * pointers stay valid and can be shared between threads.
+     *
+     * A name that is already in the table is found without a lock and
+     * without a temporary string. Only new names are added under the
+     * mutex. The slots are only written once, from 0 to a string.
+     */
+    static const std::string* internName(const std::string &name) {
+      static mars::utils::Mutex namesMutex;
+      static size_t numNames = 0;
+      size_t hash = hashName(name);
+      size_t i, slot;
+      const std::string *entry;
+
+      for(i=0; i<NAME_TABLE_SIZE; ++i) {
+        slot = (hash + i) & (NAME_TABLE_SIZE - 1);
+        entry = nameTable[slot].load(std::memory_order_acquire);
+        if(!entry) break;
+        if(*entry == name) return entry;
+      }
+
+      mars::utils::MutexLocker locker(&namesMutex);
+      // another thread may have added the name since the lookup
+      for(; i<NAME_TABLE_SIZE; ++i) {
+        slot = (hash + i) & (NAME_TABLE_SIZE - 1);
+        entry = nameTable[slot].load(std::memory_order_acquire);
+        if(!entry) {
+          if(numNames >= MAX_INTERNED_NAMES) return 0;
+          // make sure to explicitly copy the string
+          entry = new std::string(name.c_str());
+          nameTable[slot].store(entry, std::memory_order_release);
+          ++numNames;
+          return entry;
+        }
+        if(*entry == name) return entry;
+      }
+      return 0;
+    }
+
+    DataItem::DataItem() : type(UNDEFINED_TYPE), ownName(false) {
+      static const std::string *emptyName = internName("");
+      name = emptyName;
     }
     DataItem::~DataItem() {
+      if(ownName) delete name;
     }
 
-    DataItem::DataItem(const DataItem &other) {
+    DataItem::DataItem(const DataItem &other) : name(0), ownName(false) {
       *this = other;
     }
     // make sure to explicitly copy the string to avoid threading problems 
@@ -46,7 +111,13 @@ namespace mars {
         this->d = other.d;
       }
       this->type = other.type;
-      this->name = other.name.c_str();
+      if(this->ownName) delete this->name;
+      this->ownName = other.ownName;
+      if(other.ownName) {
+        this->name = new std::string(other.name->c_str());
+      } else {
+        this->name = other.name;
+      }
       return *this;
     }
 
@@ -54,8 +125,8 @@ namespace mars {
     // Getter Methods
     ////////////////////////////////////
 
-    std::string DataItem::getName() const {
-      return name;
+    const std::string& DataItem::getName() const {
+      return *name;
     }
 
     bool DataItem::get(int *val) const {
@@ -128,7 +199,14 @@ namespace mars {
     ////////////////////////////////////
 
     void DataItem::setName(const std::string &newName) {
-      name = newName.c_str();
+      if(&newName == name || newName == *name) {
+        return;
+      }
+      const std::string *interned = internName(newName);
+      if(ownName) delete name;
+      ownName = (interned == 0);
+      // the names that do not fit into the table are owned by the item
+      name = ownName ? new std::string(newName.c_str()) : interned;
     }
 
     bool DataItem::set(int val) {
@@ -78,7 +78,15 @@ namespace mars {
       };
       std::string s;
 
-      std::string getName() const;
+      /**
+       * \brief returns the name of the DataItem.
+       *
+       * The names are interned: all DataItems with the same name share one
+       * immutable string, thus copying a DataItem doesn't copy its name.
+       * The table holds the first 2048 distinct names. Further names are
+       * copied with the item, as the table never shrinks.
+       */
+      const std::string& getName() const;
       void setName(const std::string &newName);
 
       /**
@@ -130,7 +138,8 @@ namespace mars {
       bool set(bool val);
 
     private:
-      std::string name;
+      const std::string *name;
+      bool ownName; ///< true if name is not interned and has to be deleted
 
     }; // end of class DataItem
 
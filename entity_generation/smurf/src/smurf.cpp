@@ -39,6 +39,8 @@
 #include <mars/utils/mathUtils.h>
 #include <smurf_parser/SMURFParser.h>
 
+#include <cstring>
+
 //#define DEBUG_PARSE_SENSOR 1
 //#define DEBUG_SCENE_MAP
 
@@ -112,7 +114,11 @@ namespace mars {
       visualNameMap.clear();
 
       robotname = "";
+      rootNode = "";
       model.reset();
+      uriFiles.clear();
+      fromCache = false;
+      bakedMeshes.clear();
 
       entity = NULL;
       entityconfig.clear();
@@ -124,6 +130,7 @@ namespace mars {
 
     void SMURF::handleURI(ConfigMap *map, std::string uri) {
       ConfigMap map2 = ConfigMap::fromYamlFile(uri);
+      uriFiles.push_back(uri);
       handleURIs(&map2);
       map->append(map2);
     }
@@ -183,13 +190,27 @@ namespace mars {
 
     sim::SimEntity* SMURF::createEntity(const ConfigMap& config) {
       reset();
+      int groupIDBase = groupID;
       entityconfig = config;
       std::string path = (std::string)entityconfig["path"];
       tmpPath = path;
       entityconfig["abs_path"] = pathJoin(getCurrentWorkingDir(), path);
       std::string filename = (std::string)entityconfig["file"];
       fprintf(stderr, "SMURF::createEntity: Creating entity of type %s\n", ((std::string)entityconfig["type"]).c_str());
-      if((std::string)entityconfig["type"] == "smurf" || entityconfig["type"].getString() == "particle") {
+
+      // the pose is set after loading, thus entities that only differ in
+      // their pose share one cache
+      ConfigMap variantConfig = config;
+      if (variantConfig.hasKey("position")) variantConfig["position"] = "";
+      if (variantConfig.hasKey("rotation")) variantConfig["rotation"] = "";
+      scene_loader::SceneCache cache(path + filename,
+                                     getCurrentWorkingDir() + "\n" +
+                                     variantConfig.toYamlString());
+      fromCache = readCache(&cache, config);
+      if (fromCache) {
+        LOG_INFO("SMURF: using entity cache: %s", cache.getCacheFile().c_str());
+        entity = new sim::SimEntity(control, entityconfig);
+      } else if((std::string)entityconfig["type"] == "smurf" || entityconfig["type"].getString() == "particle") {
         model = smurf_parser::parseFile(&entityconfig, path, filename, true);
 #ifdef DEBUG_SCENE_MAP
         debugMap.append(entityconfig);
@@ -237,11 +258,94 @@ namespace mars {
       mapIndex = control->loadCenter->getMappedSceneByName(robotname);
       fprintf(stderr, "mapIndex: %d\n", mapIndex);
 
-      load();
+      if (load() && !fromCache) {
+        writeCache(&cache, config, groupIDBase);
+      }
 
       return entity;
     }
 
+    scene_loader::SceneCacheData SMURF::getCacheData() {
+      scene_loader::SceneCacheData data;
+      data.lists.push_back(&materialList);
+      data.lists.push_back(&nodeList);
+      data.lists.push_back(&jointList);
+      data.lists.push_back(&motorList);
+      data.lists.push_back(&sensorList);
+      data.lists.push_back(&controllerList);
+      data.lists.push_back(&graphicList);
+      data.lists.push_back(&lightList);
+      data.bakedMeshes = &bakedMeshes;
+      return data;
+    }
+
+    bool SMURF::readCache(scene_loader::SceneCache *cache,
+                          const ConfigMap &config) {
+      scene_loader::SceneCacheData data = getCacheData();
+      if (!cache->read(&data)) return false;
+
+      entityconfig = data.info["entity"];
+      robotname = (std::string)data.info["robotname"];
+      rootNode = (std::string)data.info["rootNode"];
+      // the pose of the entity is not part of the cache
+      ConfigMap input = config;
+      if (input.hasKey("position") && !entityconfig.hasKey("position")) {
+        entityconfig["position"] = input["position"];
+      }
+      if (input.hasKey("rotation") && !entityconfig.hasKey("rotation")) {
+        entityconfig["rotation"] = input["rotation"];
+      }
+      // move the cached group ids behind the ones of the current scene
+      int groupIDOffset = groupID - (int)data.info["groupID"];
+      for (unsigned int i = 0; i < nodeList.size(); ++i) {
+        if (nodeList[i].hasKey("groupid") && (int)nodeList[i]["groupid"]) {
+          nodeList[i]["groupid"] = (int)nodeList[i]["groupid"] + groupIDOffset;
+        }
+      }
+      return true;
+    }
+
+    void SMURF::writeCache(scene_loader::SceneCache *cache,
+                           const ConfigMap &config, int groupIDBase) {
+      scene_loader::SceneCacheData data = getCacheData();
+      std::string file = (std::string)entityconfig["path"] +
+        (std::string)entityconfig["file"];
+
+      // the urdf and yaml files referenced by the smurf file
+      if ((std::string)entityconfig["type"] != "urdf") {
+        ConfigMap smurfMap = ConfigMap::fromYamlFile(file);
+        ConfigVector::iterator it;
+        for (it = smurfMap["files"].begin(); it != smurfMap["files"].end(); ++it) {
+          cache->addDependency(pathJoin(getPathOfFile(file), (std::string)*it));
+        }
+      }
+      for (unsigned int i = 0; i < uriFiles.size(); ++i) {
+        cache->addDependency(uriFiles[i]);
+      }
+
+      // keep the pose only if it was set by the smurf file
+      ConfigMap input = config;
+      ConfigMap cachedConfig = entityconfig;
+      ConfigMap pose, inputPose;
+      const char *poseKeys[] = {"position", "rotation"};
+      for (unsigned int i = 0; i < 2; ++i) {
+        if (!input.hasKey(poseKeys[i])) continue;
+        pose["v"] = entityconfig[poseKeys[i]];
+        inputPose["v"] = input[poseKeys[i]];
+        if (pose.toYamlString() == inputPose.toYamlString()) {
+          cachedConfig.erase(poseKeys[i]);
+        }
+      }
+      data.info["entity"] = cachedConfig;
+      data.info["robotname"] = robotname;
+      data.info["rootNode"] = rootNode;
+      data.info["groupID"] = groupIDBase;
+      if (!cache->write(data)) {
+        LOG_DEBUG("SMURF: could not write entity cache: %s",
+                  cache->getCacheFile().c_str());
+      }
+    }
+
     void SMURF::addConfigMap(ConfigMap &config) {
       ConfigVector::iterator it;
       for (it = config["motors"].begin(); it != config["motors"].end(); ++it) {
@@ -963,6 +1067,7 @@ namespace mars {
         createMaterial(it->second);
       }
 
+      rootNode = model->root_link_->name;
       translateLink(model->root_link_, fixed);
     }
 
@@ -975,7 +1080,7 @@ namespace mars {
         if (!loadMaterial(materialList[i]))
           return 0;
       for (unsigned int i = 0; i < nodeList.size(); ++i)
-        if (!loadNode(nodeList[i])) {
+        if (!loadNode(nodeList[i], i)) {
           fprintf(stderr, "Couldn't load node %lu, %s..\n'", (unsigned long)nodeList[i]["index"], ((std::string)nodeList[i]["name"]).c_str());
           return 0;
         }
@@ -1009,7 +1114,7 @@ namespace mars {
 
       // set model pose
       ConfigMap map;
-      map["rootNode"] = model->root_link_->name;
+      map["rootNode"] = rootNode;
       entity->appendConfig(map);
       entity->setInitialPose();
 
@@ -1018,7 +1123,7 @@ namespace mars {
       return 1;
     }
 
-    unsigned int SMURF::loadNode(ConfigMap config) {
+    unsigned int SMURF::loadNode(ConfigMap config, unsigned int listIndex) {
       NodeData node;
       config["mapIndex"] = mapIndex;
       string suffix, tmpfilename;
@@ -1081,6 +1186,32 @@ namespace mars {
       }
 
 
+      // a baked mesh saves the NodeManager from reading the mesh file
+      std::map<unsigned int, scene_loader::BakedMesh>::iterator meshIt;
+      meshIt = bakedMeshes.find(listIndex);
+      if (fromCache && meshIt != bakedMeshes.end() &&
+          node.physicMode == NODE_TYPE_MESH && !node.terrain &&
+          meshIt->second.file == node.filename &&
+          meshIt->second.mtime == scene_loader::SceneCache::getMTime(node.filename)) {
+        const scene_loader::BakedMesh &baked = meshIt->second;
+        node.ext = baked.ext;
+        node.mesh.vertexcount = baked.vertices.size()/3;
+        node.mesh.indexcount = baked.indices.size();
+        if (node.mesh.vertexcount > 0) {
+          node.mesh.vertices = new mydVector3[node.mesh.vertexcount];
+          for (int i = 0; i < node.mesh.vertexcount; ++i) {
+            for (int k = 0; k < 3; ++k) {
+              node.mesh.vertices[i][k] = baked.vertices[i*3+k];
+            }
+          }
+        }
+        if (node.mesh.indexcount > 0) {
+          node.mesh.indices = new int[node.mesh.indexcount];
+          memcpy(node.mesh.indices, &baked.indices[0],
+                 node.mesh.indexcount*sizeof(int));
+        }
+      }
+
       NodeId oldId = node.index;
 #ifdef DEBUG_SCENE_MAP
       config.toYamlFile("SMURFNode.yml");
@@ -1090,6 +1221,23 @@ namespace mars {
         LOG_ERROR("addNode returned 0");
         return 0;
       }
+
+      // the NodeManager filled in the collision mesh, keep it for the cache
+      if (!fromCache && node.physicMode == NODE_TYPE_MESH && !node.terrain &&
+          node.mesh.vertices) {
+        scene_loader::BakedMesh &baked = bakedMeshes[listIndex];
+        baked.file = node.filename;
+        baked.mtime = scene_loader::SceneCache::getMTime(node.filename);
+        baked.ext = node.ext;
+        baked.vertices.resize(node.mesh.vertexcount*3);
+        for (int i = 0; i < node.mesh.vertexcount; ++i) {
+          for (int k = 0; k < 3; ++k) {
+            baked.vertices[i*3+k] = node.mesh.vertices[i][k];
+          }
+        }
+        baked.indices.assign(node.mesh.indices,
+                             node.mesh.indices+node.mesh.indexcount);
+      }
       control->loadCenter->setMappedID(oldId, newId, MAP_TYPE_NODE, mapIndex);
       entity->addNode(node.index, node.name);
       return 1;
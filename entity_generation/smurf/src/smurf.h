@@ -35,6 +35,7 @@
 
 #include <mars/interfaces/sim/MarsPluginTemplate.h>
 #include <mars/entity_generation/entity_factory/EntityFactoryInterface.h>
+#include <mars/scene_loader/SceneCache.h>
 
 #include <urdf_parser/urdf_parser.h>
 //#include <boost/function.hpp>
@@ -108,6 +109,13 @@ namespace mars {
       configmaps::ConfigMap debugMap;
       configmaps::ConfigMap entityconfig;
       std::string robotname;
+      std::string rootNode;
+      // yaml files read by handleURI, the entity cache depends on them
+      std::vector<std::string> uriFiles;
+      // the lists and meshes were read from the entity cache
+      bool fromCache;
+      // baked collision meshes by the position of the node in nodeList
+      std::map<unsigned int, scene_loader::BakedMesh> bakedMeshes;
       urdf::ModelInterfaceSharedPtr model;
       sim::SimEntity* entity;
 
@@ -115,6 +123,13 @@ namespace mars {
       void handleURIs(configmaps::ConfigMap *map);
       void getSensorIDList(configmaps::ConfigMap *map);
 
+      // entity cache
+      scene_loader::SceneCacheData getCacheData();
+      bool readCache(scene_loader::SceneCache *cache,
+                     const configmaps::ConfigMap &config);
+      void writeCache(scene_loader::SceneCache *cache,
+                      const configmaps::ConfigMap &config, int groupIDBase);
+
       // creating URDF objects
       void translateLink(urdf::LinkSharedPtr link, bool fixed); // handleKinematics
       void translateJoint(urdf::LinkSharedPtr childlink); // handleKinematics
@@ -139,7 +154,7 @@ namespace mars {
 
       // load functions
       unsigned int loadMaterial(configmaps::ConfigMap config);
-      unsigned int loadNode(configmaps::ConfigMap config);
+      unsigned int loadNode(configmaps::ConfigMap config, unsigned int listIndex);
       unsigned int loadJoint(configmaps::ConfigMap config);
       unsigned int loadMotor(configmaps::ConfigMap config);
       interfaces::BaseSensor* loadSensor(configmaps::ConfigMap config);
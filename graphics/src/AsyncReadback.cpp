@@ -0,0 +1,253 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file AsyncReadback.cpp
+ *
+ */
+
+#include "AsyncReadback.h"
+
+#ifdef HAVE_OSG_VERSION_H
+  #include <osg/Version>
+#else
+  #include <osg/Export>
+#endif
+
+#include <osg/BufferObject>
+#include <osg/GL>
+#include <osg/State>
+
+#if (OPENSCENEGRAPH_MAJOR_VERSION > 3 || (OPENSCENEGRAPH_MAJOR_VERSION == 3 && OPENSCENEGRAPH_MINOR_VERSION >= 4))
+#include <osg/GLExtensions>
+#define OSG_GL_EXTENSIONS
+#endif
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef GL_UNSIGNED_INT_8_8_8_8_REV
+#define GL_UNSIGNED_INT_8_8_8_8_REV 0x8367
+#endif
+
+namespace mars {
+  namespace graphics {
+
+#ifdef OSG_GL_EXTENSIONS
+    typedef osg::GLExtensions BufferExtensions;
+
+    static BufferExtensions* getBufferExtensions(osg::State *state) {
+      return osg::GLExtensions::Get(state->getContextID(), true);
+    }
+
+    static bool isPBOSupported(BufferExtensions *ext) {
+      return ext->isPBOSupported;
+    }
+#else
+    typedef osg::GLBufferObject::Extensions BufferExtensions;
+
+    static BufferExtensions* getBufferExtensions(osg::State *state) {
+      return osg::GLBufferObject::getExtensions(state->getContextID(), true);
+    }
+
+    static bool isPBOSupported(BufferExtensions *ext) {
+      return ext->isPBOSupported();
+    }
+#endif
+
+    AsyncReadback::MapOperation::MapOperation(AsyncReadback *readback)
+      : osg::GraphicsOperation("AsyncReadback", true), readback(readback) {
+      memset(pbo, 0, sizeof(pbo));
+    }
+
+    void AsyncReadback::MapOperation::operator () (osg::GraphicsContext *context) {
+      osg::ref_ptr<AsyncReadback> locked;
+
+      if(readback.lock(locked)) {
+        locked->mapBuffers(context->getState());
+        return;
+      }
+      if(pbo[0]) {
+        getBufferExtensions(context->getState())->glDeleteBuffers(4, pbo);
+        memset(pbo, 0, sizeof(pbo));
+      }
+      setKeep(false);
+    }
+
+    AsyncReadback::AsyncReadback(osg::Texture2D *colorTexture,
+                                 osg::Texture2D *depthTexture,
+                                 int width, int height)
+      : colorTexture(colorTexture), depthTexture(depthTexture),
+        width(width), height(height), writeIndex(0),
+        initialized(false), supported(false), hasData(false) {
+      pending[0] = pending[1] = false;
+      copyFrame[0] = copyFrame[1] = 0;
+      colorData.resize(width*height*4);
+      depthData.resize(width*height);
+      pthread_mutex_init(&dataMutex, NULL);
+    }
+
+    AsyncReadback::~AsyncReadback() {
+      // the map operation deletes the buffers in the next frame
+      pthread_mutex_destroy(&dataMutex);
+    }
+
+    void AsyncReadback::init(osg::State *state) const {
+      BufferExtensions *ext = getBufferExtensions(state);
+
+      initialized = true;
+      supported = ext && isPBOSupported(ext);
+      if(!supported) {
+        fprintf(stderr, "AsyncReadback: pixel buffer objects are not supported\n");
+        return;
+      }
+      ext->glGenBuffers(4, &pbo[0][0]);
+      for(int i=0; i<2; ++i) {
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pbo[i][0]);
+        ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, width*height*4, NULL,
+                          GL_STREAM_READ_ARB);
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pbo[i][1]);
+        ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB,
+                          width*height*sizeof(float), NULL,
+                          GL_STREAM_READ_ARB);
+      }
+      ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+      mapOperation = new MapOperation(const_cast<AsyncReadback*>(this));
+      memcpy(mapOperation->pbo, &pbo[0][0], sizeof(mapOperation->pbo));
+      state->getGraphicsContext()->add(mapOperation.get());
+    }
+
+    void AsyncReadback::operator () (osg::RenderInfo& renderInfo) const {
+      osg::State *state = renderInfo.getState();
+      unsigned int contextID = renderInfo.getContextID();
+      osg::Texture::TextureObject *colorObject, *depthObject;
+      BufferExtensions *ext;
+      double fovy, aspectRatio, zn, zf;
+      GLint boundTexture;
+
+      colorObject = colorTexture->getTextureObject(contextID);
+      depthObject = depthTexture->getTextureObject(contextID);
+      if(!colorObject || !depthObject) return;
+      if(!initialized) init(state);
+      if(!supported) return;
+      ext = getBufferExtensions(state);
+
+      // only if the camera renders twice in a frame the buffers are
+      // not mapped yet
+      if(pending[writeIndex]) {
+        readBuffers(state, writeIndex);
+      }
+
+      renderInfo.getCurrentCamera()->getProjectionMatrixAsPerspective(fovy,
+                                                                      aspectRatio,
+                                                                      zn, zf);
+      nearPlane[writeIndex] = zn;
+      farPlane[writeIndex] = zf;
+      copyFrame[writeIndex] = state->getFrameStamp() ?
+        state->getFrameStamp()->getFrameNumber() : 0;
+
+      // the copies into the buffers return without waiting for the gpu;
+      // the texture binding of osg is restored afterwards
+      glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+      ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pbo[writeIndex][0]);
+      glBindTexture(GL_TEXTURE_2D, colorObject->id());
+      glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, 0);
+      ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pbo[writeIndex][1]);
+      glBindTexture(GL_TEXTURE_2D, depthObject->id());
+      glGetTexImage(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+      glBindTexture(GL_TEXTURE_2D, boundTexture);
+      ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+      pending[writeIndex] = true;
+      writeIndex = 1-writeIndex;
+    }
+
+    /**
+     * \brief Maps the buffers that were filled in an earlier frame. The
+     * operation runs after the cameras of the context have been drawn,
+     * thus the copies of the current frame are left for the next one.
+     */
+    void AsyncReadback::mapBuffers(osg::State *state) const {
+      unsigned int frame = state->getFrameStamp() ?
+        state->getFrameStamp()->getFrameNumber() : 0;
+
+      // the older buffer first, thus the newer data is kept
+      for(int i=0; i<2; ++i) {
+        int index = (writeIndex+i) % 2;
+        if(pending[index] && copyFrame[index] != frame) {
+          readBuffers(state, index);
+        }
+      }
+    }
+
+    void AsyncReadback::readBuffers(osg::State *state, int index) const {
+      BufferExtensions *ext = getBufferExtensions(state);
+      const void *color;
+      const float *depth;
+
+      ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pbo[index][0]);
+      color = ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+      pthread_mutex_lock(&dataMutex);
+      if(color) {
+        memcpy(colorData.data(), color, colorData.size());
+        ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+      }
+      ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pbo[index][1]);
+      depth = (const float*)ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB,
+                                             GL_READ_ONLY_ARB);
+      if(depth) {
+        linearizeDepth(depth, 1.0f, depthData.data(), width, height,
+                       nearPlane[index], farPlane[index]);
+        ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+      }
+      hasData = color && depth;
+      pthread_mutex_unlock(&dataMutex);
+      ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+      pending[index] = false;
+    }
+
+    bool AsyncReadback::getImageData(char *buffer, int &width,
+                                     int &height) const {
+      bool valid;
+      pthread_mutex_lock(&dataMutex);
+      width = this->width;
+      height = this->height;
+      valid = hasData;
+      if(valid) memcpy(buffer, colorData.data(), colorData.size());
+      pthread_mutex_unlock(&dataMutex);
+      return valid;
+    }
+
+    bool AsyncReadback::getDepthData(float *buffer, int &width,
+                                     int &height) const {
+      bool valid;
+      pthread_mutex_lock(&dataMutex);
+      width = this->width;
+      height = this->height;
+      valid = hasData;
+      if(valid) {
+        memcpy(buffer, depthData.data(), depthData.size()*sizeof(float));
+      }
+      pthread_mutex_unlock(&dataMutex);
+      return valid;
+    }
+
+  } // end of namespace graphics
+} // end of namespace mars
@@ -0,0 +1,137 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file AsyncReadback.h
+ * \brief "AsyncReadback" reads the render to texture targets of a camera
+ *        back through pixel buffer objects without stalling the draw.
+ */
+
+#ifndef MARS_GRAPHICS_ASYNCREADBACK_H
+#define MARS_GRAPHICS_ASYNCREADBACK_H
+
+#include <osg/Camera>
+#include <osg/GraphicsThread>
+#include <osg/observer_ptr>
+#include <osg/Texture2D>
+
+#include <pthread.h>
+#include <limits>
+#include <vector>
+
+namespace mars {
+  namespace graphics {
+
+    /**
+     * Converts the depth buffer values src*scale in [0, 1] of a
+     * perspective projection with the near and far plane zn and zf into
+     * distances. The rows are flipped, so dst starts with the top row.
+     * The far plane is stored as NaN. The inner loop is branch free and
+     * uses only float operations, thus it is vectorized by the compiler.
+     */
+    template <typename T>
+    void linearizeDepth(const T *src, float scale, float *dst,
+                        int width, int height, float zn, float zf) {
+      const float a = zn*zf;
+      const float b = zf-zn;
+      const float nan = std::numeric_limits<float>::quiet_NaN();
+
+      for(int i=height-1; i>=0; --i) {
+        const T *srcRow = src + i*width;
+        for(int k=0; k<width; ++k) {
+          const float dv = srcRow[k]*scale;
+          const float d = a / (zf-dv*b);
+          dst[k] = dv < 1.0f ? d : nan;
+        }
+        dst += width;
+      }
+    }
+
+    /**
+     * A final draw callback of a render to texture camera. It copies the
+     * color and depth texture into one of two pixel buffer objects each.
+     * The buffers are mapped by an operation of the graphics context in
+     * the next frame, thus the draw only issues the transfer and the data
+     * is available one frame later, however seldom the camera renders.
+     * The buffer functions are taken from the GL extensions of osg and
+     * need only GL 2.1, so it also runs on software renderers like Mesa
+     * llvmpipe.
+     */
+    class AsyncReadback : public osg::Camera::DrawCallback {
+    public:
+      AsyncReadback(osg::Texture2D *colorTexture,
+                    osg::Texture2D *depthTexture,
+                    int width, int height);
+      ~AsyncReadback();
+
+      virtual void operator () (osg::RenderInfo& renderInfo) const;
+
+      /**
+       * Copies the last color image (RGBA, bottom row first) into buffer.
+       * Returns false if no image was read back yet.
+       */
+      bool getImageData(char *buffer, int &width, int &height) const;
+
+      /**
+       * Copies the last distance image (top row first) into buffer.
+       * Returns false if no image was read back yet.
+       */
+      bool getDepthData(float *buffer, int &width, int &height) const;
+
+    private:
+      /**
+       * Maps the buffers of the readback that were filled in an earlier
+       * frame. It stays in the operation queue of the graphics context
+       * until the readback is deleted.
+       */
+      class MapOperation : public osg::GraphicsOperation {
+      public:
+        MapOperation(AsyncReadback *readback);
+        virtual void operator () (osg::GraphicsContext *context);
+        // the buffers are deleted by the operation in the graphics
+        // thread, since the readback can be deleted by any thread
+        unsigned int pbo[4];
+      private:
+        osg::observer_ptr<AsyncReadback> readback;
+      };
+
+      osg::ref_ptr<osg::Texture2D> colorTexture, depthTexture;
+      int width, height;
+      // [buffer index][0: color, 1: depth]
+      mutable unsigned int pbo[2][2];
+      mutable float nearPlane[2], farPlane[2];
+      mutable unsigned int copyFrame[2];
+      mutable bool pending[2];
+      mutable int writeIndex;
+      mutable bool initialized, supported, hasData;
+      mutable osg::ref_ptr<MapOperation> mapOperation;
+      mutable std::vector<char> colorData;
+      mutable std::vector<float> depthData;
+      mutable pthread_mutex_t dataMutex;
+
+      void init(osg::State *state) const;
+      void mapBuffers(osg::State *state) const;
+      void readBuffers(osg::State *state, int index) const;
+    };
+
+  } // end of namespace graphics
+} // end of namespace mars
+
+#endif /* MARS_GRAPHICS_ASYNCREADBACK_H */
@@ -204,9 +204,12 @@ namespace mars {
           showSelectionProp = cfg->getOrCreateProperty("Graphics",
                                                        "showSelection",
                                                        true, this);
+          offscreenProp = cfg->getOrCreateProperty("Graphics", "offscreen",
+                                                   false, this);
         }
         else {
           marsShadow.bValue = false;
+          offscreenProp.bValue = false;
         }
         globalStateset->setGlobalDefaults();
 
@@ -348,7 +351,8 @@ namespace mars {
         viewer->setThreadingModel(osgViewer::CompositeViewer::DrawThreadPerContext);
 #endif
 
-        if(createWindow) {
+        // the offscreen mode renders only the sensor cameras
+        if(createWindow && !offscreenProp.bValue) {
           new3DWindow(data);
         }
 
@@ -562,7 +566,15 @@ namespace mars {
                                                int width, int height, const std::string &name) {
       GraphicsWidget *gw;
 
-      if (graphicsWindows.size() > 0) {
+      if(offscreenProp.bValue) {
+        // no qt and no window, the first widget creates the offscreen
+        // context that is shared by all following ones
+        gw = new GraphicsWidget(myQTWidget, scene.get(), next_window_id++,
+                                true, 0, this);
+        gw->initializeOSG(myQTWidget, graphicsWindows.size() > 0 ?
+                          graphicsWindows[0] : 0, width, height);
+      }
+      else if (graphicsWindows.size() > 0) {
         gw = QtOsgMixGraphicsWidget::createInstance(myQTWidget, scene.get(),
                                                     next_window_id++, rtt,
                                                     0, this);
@@ -588,7 +600,7 @@ namespace mars {
       viewer->addView(gw->getView());
       graphicsWindows.push_back(gw);
 
-      if(!rtt) {
+      if(!rtt && !offscreenProp.bValue) {
         setActiveWindow(next_window_id-1);
         gw->setGraphicsEventHandler((GraphicsEventInterface*)this);
 
@@ -757,8 +769,12 @@ namespace mars {
         materialManager->setShadowScale(shadowMap->getTexScale());
       }
 
-      // Render a complete new frame.
-      if(viewer) viewer->frame();
+      // Render a complete new frame. In offscreen mode the sensors
+      // activate their cameras only at their update rate, thus the frame
+      // is skipped if no camera has to be rendered.
+      if(viewer && (!offscreenProp.bValue || hasActiveWindow())) {
+        viewer->frame();
+      }
       ++framecount;
       for(it=graphicsUpdateObjects.begin();
           it!=graphicsUpdateObjects.end(); ++it) {
@@ -766,6 +782,15 @@ namespace mars {
       }
     }
 
+    bool GraphicsManager::hasActiveWindow() const {
+      std::vector<GraphicsWidget*>::const_iterator iter;
+
+      for(iter=graphicsWindows.begin(); iter!=graphicsWindows.end(); ++iter) {
+        if((*iter)->getView()->getCamera()->getNodeMask()) return true;
+      }
+      return false;
+    }
+
     void GraphicsManager::setGrabFrames(bool value) {
       graphicsWindows[0]->setGrabFrames(value);
       graphicsWindows[0]->setSaveFrames(value);
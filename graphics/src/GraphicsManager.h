@@ -302,6 +302,11 @@ namespace mars {
 
       void removeGraphicsWidget(unsigned long id);
       virtual bool isInitialized() const {return initialized;}
+      /**
+       * Returns true if only the sensor cameras are rendered into an
+       * offscreen context (cfg property "Graphics/offscreen").
+       */
+      bool isOffscreen() const {return offscreenProp.bValue;}
       osg_material_manager::MaterialNode* getMaterialNode(const std::string &name);
       void setDrawLineLaser(bool val);
       osg_material_manager::MaterialNode* getSharedStateGroup(unsigned long id);
@@ -401,7 +406,7 @@ namespace mars {
         multisamples, noiseProp, brightness, marsShader, backfaceCulling,
         drawLineLaserProp, drawMainCamera, marsShadow, hudWidthProp,
         hudHeightProp, defaultMaxNumNodeLights, shadowTextureSize,
-        showGridProp, showCoordsProp, showSelectionProp;
+        showGridProp, showCoordsProp, showSelectionProp, offscreenProp;
       cfg_manager::cfgPropertyStruct grab_frames;
       cfg_manager::cfgPropertyStruct resources_path;
       cfg_manager::cfgPropertyStruct configPath;
@@ -413,6 +418,7 @@ namespace mars {
       GraphicsWidget *activeWindow;
       osg_material_manager::OsgMaterialManager *materialManager;
       void setupCFG(void);
+      bool hasActiveWindow(void) const;
 
       unsigned long findCoreObject(unsigned long draw_id) const;
       void setMultisampling(int num_samples);
@@ -22,6 +22,7 @@
 #include "GraphicsWidget.h"
 #include "HUD.h"
 #include "GraphicsManager.h"
+#include "OffscreenGraphicsWindow.h"
 
 #include <mars/utils/Color.h>
 
@@ -874,11 +875,19 @@ namespace mars {
           traits->windowDecoration = false;
 
           osg::ref_ptr<osg::GraphicsContext> gc;
-          gc = osg::GraphicsContext::createGraphicsContext(traits.get());
+          if(gm && gm->isOffscreen()) {
+            // headless: all sensor cameras share one window-less context
+            gc = OffscreenGraphicsWindow::create(traits.get());
+          }
+          else {
+            gc = osg::GraphicsContext::createGraphicsContext(traits.get());
+          }
           osgCamera->setGraphicsContext(gc.get());
         }
         else {
-          osgCamera->setGraphicsContext(shared->getGraphicsWindow());
+          // the first window of an offscreen run is a rtt widget without
+          // a GraphicsWindow, thus share the context of its camera
+          osgCamera->setGraphicsContext(shared->getView()->getCamera()->getGraphicsContext());
         }
 
         osg::DisplaySettings* ds = osg::DisplaySettings::instance();
@@ -1100,7 +1109,12 @@ namespace mars {
 
     void GraphicsWidget::getImageData(char* buffer, int& width, int& height)
     {
-      if(isRTTWidget) {
+      if(asyncReadback.valid()) {
+        if(!asyncReadback->getImageData(buffer, width, height)) {
+          memset(buffer, 0, width*height*4);
+        }
+      }
+      else if(isRTTWidget) {
         osg::Image *image = rttImage;
         width = image->s();
         height = image->t();
@@ -1130,27 +1144,23 @@ namespace mars {
 
     void GraphicsWidget::getRTTDepthData(float* buffer, int& width, int& height)
     {
-      if(isRTTWidget) {
+      if(asyncReadback.valid()) {
+        if(!asyncReadback->getDepthData(buffer, width, height)) {
+          std::fill(buffer, buffer + width*height,
+                    std::numeric_limits<float>::quiet_NaN());
+        }
+      }
+      else if(isRTTWidget) {
         GLuint* data2 = (GLuint *)rttDepthImage->data();
         width = rttDepthImage->s();
         height = rttDepthImage->t();
 
         double fovy, aspectRatio, Zn, Zf;
         graphicsCamera->getOSGCamera()->getProjectionMatrixAsPerspective( fovy, aspectRatio, Zn, Zf );
-        int d = 0;
-        for(int i=height-1; i>=0; --i) {
-          for(int k=0; k<width; ++k) {
-              GLuint di = data2[i*width+k];
-
-            const float dv = ((float) di) / std::numeric_limits< GLuint >::max() ;
-            // 1.0 is the max depth in the depth buffer, and
-            // is represented as a nan in the distance image
-            if( dv >= 1.0 )
-              buffer[d++] = std::numeric_limits<float>::quiet_NaN();
-            else
-              buffer[d++] = Zn*Zf/(Zf-dv*(Zf-Zn));
-          }
-        }
+        // 1.0 is the max depth in the depth buffer, and
+        // is represented as a nan in the distance image
+        linearizeDepth(data2, 1.0f / std::numeric_limits< GLuint >::max(),
+                       buffer, width, height, Zn, Zf);
       } else {
         throw std::runtime_error("Depth image not supported on non RTT Widges");
       }
@@ -1161,12 +1171,48 @@ namespace mars {
         width = rttDepthImage->s();
         height = rttDepthImage->t();
         *data = (float*)malloc(width*height*sizeof(float));
-        getRTTDepthData(data, width, height);
+        getRTTDepthData(*data, width, height);
       } else {
         throw std::runtime_error("Depth image not supported on non RTT Widges");
       }
     }
 
+    /**
+     * \brief Attaches the color and depth textures instead of the images
+     * to the camera and reads them back with an AsyncReadback callback.
+     */
+    void GraphicsWidget::setAsyncReadback(bool enable) {
+      osg::Camera *osgCamera = view->getCamera();
+
+      if(!isRTTWidget || enable == asyncReadback.valid()) return;
+
+      osgCamera->detach(osg::Camera::COLOR_BUFFER);
+      osgCamera->detach(osg::Camera::DEPTH_BUFFER);
+      if(enable) {
+        rttTexture->setImage(0);
+        rttDepthTexture->setImage(0);
+        rttDepthTexture->setInternalFormat(GL_DEPTH_COMPONENT24);
+        rttDepthTexture->setSourceType(GL_FLOAT);
+        osgCamera->attach(osg::Camera::COLOR_BUFFER, rttTexture.get());
+        osgCamera->attach(osg::Camera::DEPTH_BUFFER, rttDepthTexture.get());
+        asyncReadback = new AsyncReadback(rttTexture.get(),
+                                          rttDepthTexture.get(),
+                                          widgetWidth, widgetHeight);
+        osgCamera->setFinalDrawCallback(asyncReadback.get());
+      }
+      else {
+        osgCamera->setFinalDrawCallback(0);
+        asyncReadback = 0;
+        rttDepthTexture->setSourceType(GL_UNSIGNED_INT);
+        osgCamera->attach(osg::Camera::COLOR_BUFFER, rttImage.get());
+        osgCamera->attach(osg::Camera::DEPTH_BUFFER, rttDepthImage.get());
+        rttTexture->setImage(rttImage);
+        rttDepthTexture->setImage(rttDepthImage);
+      }
+      // the render stage is recreated with the new attachments
+      osgCamera->setRenderingCache(0);
+    }
+
     bool GraphicsWidget::handle(
                                 const osgGA::GUIEventAdapter& ea,
                                 osgGA::GUIActionAdapter& aa)
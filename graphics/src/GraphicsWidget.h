@@ -28,6 +28,7 @@
 #include "gui_helper_functions.h"
 #include "GraphicsCamera.h"
 #include "PostDrawCallback.h"
+#include "AsyncReadback.h"
 
 #include <mars/interfaces/MARSDefs.h>
 #include <mars/utils/Vector.h>
@@ -195,6 +196,7 @@ namespace mars {
        * */
       virtual void getRTTDepthData(float *buffer, int &width, int &height);
       virtual void getRTTDepthData(float **data, int &width, int &height);
+      virtual void setAsyncReadback(bool enable);
 
       virtual osg::Group* getScene(){
         return scene;
@@ -301,6 +303,9 @@ namespace mars {
       osg::ref_ptr<osg::Texture2D> rttDepthTexture;
       // destination image if isRTTWidget==true
       osg::ref_ptr<osg::Image> rttDepthImage;
+      // replaces the destination images if the asynchronous readback is
+      // enabled; rttImage and rttDepthImage are not updated then
+      osg::ref_ptr<AsyncReadback> asyncReadback;
 
       // list of picked objects
       std::vector<osg::Node*> pickedObjects;
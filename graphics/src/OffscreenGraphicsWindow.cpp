@@ -0,0 +1,178 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file OffscreenGraphicsWindow.cpp
+ *
+ */
+
+#include "OffscreenGraphicsWindow.h"
+
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#endif
+
+#include <cstdio>
+
+namespace mars {
+  namespace graphics {
+
+    OffscreenGraphicsWindow::OffscreenGraphicsWindow(osg::GraphicsContext::Traits *traits)
+      : display(0), surface(0), context(0),
+        initialized(false), realized(false) {
+      _traits = traits;
+
+#ifdef HAVE_EGL
+      EGLint major, minor;
+      EGLDisplay eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+      if(eglDisplay != EGL_NO_DISPLAY &&
+         eglInitialize(eglDisplay, &major, &minor)) {
+        display = eglDisplay;
+        initialized = true;
+      }
+      else {
+        fprintf(stderr, "OffscreenGraphicsWindow: no EGL display\n");
+      }
+#endif
+
+      if(initialized) {
+        setState(new osg::State);
+        getState()->setGraphicsContext(this);
+        if(_traits.valid() && _traits->sharedContext.valid()) {
+          getState()->setContextID(_traits->sharedContext->getState()->getContextID());
+          incrementContextIDUsageCount(getState()->getContextID());
+        }
+        else {
+          getState()->setContextID(osg::GraphicsContext::createNewContextID());
+        }
+      }
+    }
+
+    OffscreenGraphicsWindow::~OffscreenGraphicsWindow() {
+      close(true);
+#ifdef HAVE_EGL
+      if(initialized) eglTerminate((EGLDisplay)display);
+#endif
+    }
+
+    osg::GraphicsContext* OffscreenGraphicsWindow::create(osg::GraphicsContext::Traits *traits) {
+#ifdef HAVE_EGL
+      osg::ref_ptr<OffscreenGraphicsWindow> window;
+      window = new OffscreenGraphicsWindow(traits);
+      if(window->valid()) return window.release();
+#endif
+      // fall back to the pbuffer of osg that needs a display
+      traits->pbuffer = true;
+      return osg::GraphicsContext::createGraphicsContext(traits);
+    }
+
+    bool OffscreenGraphicsWindow::realizeImplementation() {
+#ifdef HAVE_EGL
+      if(realized) return true;
+      if(!initialized) return false;
+
+      const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, _traits->alpha ? 8 : 0,
+        EGL_DEPTH_SIZE, 24,
+        EGL_STENCIL_SIZE, (EGLint)_traits->stencil,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+      };
+      const EGLint pbufferAttribs[] = {
+        EGL_WIDTH, _traits->width,
+        EGL_HEIGHT, _traits->height,
+        EGL_NONE
+      };
+      EGLConfig config;
+      EGLint numConfigs;
+      EGLContext sharedContext = EGL_NO_CONTEXT;
+      OffscreenGraphicsWindow *shared;
+
+      if(!eglChooseConfig((EGLDisplay)display, configAttribs, &config, 1,
+                          &numConfigs) || numConfigs < 1) {
+        fprintf(stderr, "OffscreenGraphicsWindow: no EGL pbuffer config\n");
+        return false;
+      }
+      surface = eglCreatePbufferSurface((EGLDisplay)display, config,
+                                        pbufferAttribs);
+      if((EGLSurface)surface == EGL_NO_SURFACE) {
+        fprintf(stderr, "OffscreenGraphicsWindow: could not create the pbuffer\n");
+        return false;
+      }
+      eglBindAPI(EGL_OPENGL_API);
+      shared = dynamic_cast<OffscreenGraphicsWindow*>(_traits->sharedContext.get());
+      if(shared) sharedContext = (EGLContext)shared->context;
+      context = eglCreateContext((EGLDisplay)display, config, sharedContext,
+                                 NULL);
+      if((EGLContext)context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "OffscreenGraphicsWindow: could not create the context\n");
+        eglDestroySurface((EGLDisplay)display, (EGLSurface)surface);
+        surface = 0;
+        return false;
+      }
+      realized = true;
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    void OffscreenGraphicsWindow::closeImplementation() {
+#ifdef HAVE_EGL
+      if(!realized) return;
+      eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                     EGL_NO_CONTEXT);
+      eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+      eglDestroySurface((EGLDisplay)display, (EGLSurface)surface);
+      context = surface = 0;
+#endif
+      realized = false;
+    }
+
+    bool OffscreenGraphicsWindow::makeCurrentImplementation() {
+#ifdef HAVE_EGL
+      if(!realized) return false;
+      return eglMakeCurrent((EGLDisplay)display, (EGLSurface)surface,
+                            (EGLSurface)surface, (EGLContext)context);
+#else
+      return false;
+#endif
+    }
+
+    bool OffscreenGraphicsWindow::releaseContextImplementation() {
+#ifdef HAVE_EGL
+      if(!realized) return false;
+      return eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE,
+                            EGL_NO_SURFACE, EGL_NO_CONTEXT);
+#else
+      return false;
+#endif
+    }
+
+    void OffscreenGraphicsWindow::swapBuffersImplementation() {
+      // nothing is rendered to the pbuffer itself
+    }
+
+  } // end of namespace graphics
+} // end of namespace mars
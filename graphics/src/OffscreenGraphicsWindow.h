@@ -0,0 +1,71 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file OffscreenGraphicsWindow.h
+ * \brief "OffscreenGraphicsWindow" is a graphics context without a window
+ *        for rendering the sensor cameras without an X server.
+ */
+
+#ifndef MARS_GRAPHICS_OFFSCREENGRAPHICSWINDOW_H
+#define MARS_GRAPHICS_OFFSCREENGRAPHICSWINDOW_H
+
+#include <osgViewer/GraphicsWindow>
+
+namespace mars {
+  namespace graphics {
+
+    /**
+     * A context on an EGL pbuffer surface. With Mesa the EGL display
+     * does not need an X server (e.g. EGL_PLATFORM=surfaceless), so the
+     * render to texture cameras of the sensors can be rendered on
+     * headless machines, also by the llvmpipe software renderer.
+     * The surface itself is not used, all cameras render into frame
+     * buffer objects.
+     */
+    class OffscreenGraphicsWindow : public osgViewer::GraphicsWindow {
+    public:
+      OffscreenGraphicsWindow(osg::GraphicsContext::Traits *traits);
+      ~OffscreenGraphicsWindow();
+
+      /**
+       * Creates an OffscreenGraphicsWindow if mars_graphics is built
+       * with EGL, else a pbuffer context of osg.
+       */
+      static osg::GraphicsContext* create(osg::GraphicsContext::Traits *traits);
+
+      virtual bool valid() const {return initialized;}
+      virtual bool realizeImplementation();
+      virtual bool isRealizedImplementation() const {return realized;}
+      virtual void closeImplementation();
+      virtual bool makeCurrentImplementation();
+      virtual bool releaseContextImplementation();
+      virtual void swapBuffersImplementation();
+
+    private:
+      // the EGL handles are not exposed to keep EGL out of the headers
+      void *display, *surface, *context;
+      bool initialized, realized;
+    };
+
+  } // end of namespace graphics
+} // end of namespace mars
+
+#endif /* MARS_GRAPHICS_OFFSCREENGRAPHICSWINDOW_H */
@@ -43,6 +43,14 @@
 #endif
 
 #include <mars/utils/mathUtils.h>
+#include <mars/utils/misc.h>
+#include <mars/utils/Thread.h>
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/interfaces/Logging.hpp>
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <thread>
 
 namespace mars {
   namespace graphics {
@@ -53,9 +61,58 @@ namespace mars {
     using mars::utils::Quaternion;
     using mars::interfaces::snmesh;
 
-    vector<nodeFileStruct> GuiHelper::nodeFiles;
-    vector<textureFileStruct> GuiHelper::textureFiles;
-    vector<imageFileStruct> GuiHelper::imageFiles;
+    utils::Mutex GuiHelper::fileMutex;
+    unordered_map<string, nodeFileStruct> GuiHelper::nodeFiles;
+    unordered_map<string, textureFileStruct> GuiHelper::textureFiles;
+    unordered_map<string, imageFileStruct> GuiHelper::imageFiles;
+
+    static time_t getFileMTime(const std::string &fileName) {
+      struct stat fileStat;
+      if(stat(fileName.c_str(), &fileStat) != 0) return 0;
+      return fileStat.st_mtime;
+    }
+
+    static bool isBobjFile(const std::string &fileName) {
+      return (fileName.size() > 5 &&
+              fileName.substr(fileName.size()-5, 5) == ".bobj");
+    }
+
+    /**
+     * Takes the next file of the job list and decodes it into the file
+     * cache of the GuiHelper until the list is processed. The first
+     * numMeshes entries of the list are meshes, the others images.
+     */
+    class FileLoadWorker : public utils::Thread {
+    public:
+      FileLoadWorker(const std::vector<std::string> *files, size_t numMeshes,
+                     size_t *nextJob, utils::Mutex *jobMutex)
+        : files(files), numMeshes(numMeshes), nextJob(nextJob),
+          jobMutex(jobMutex) {
+      }
+
+    protected:
+      void run() {
+        size_t job;
+        while(1) {
+          jobMutex->lock();
+          job = (*nextJob)++;
+          jobMutex->unlock();
+          if(job >= files->size()) break;
+          if(job < numMeshes) {
+            GuiHelper::cachedNode((*files)[job], isBobjFile((*files)[job]));
+          }
+          else {
+            GuiHelper::loadImage((*files)[job]);
+          }
+        }
+      }
+
+    private:
+      const std::vector<std::string> *files;
+      size_t numMeshes;
+      size_t *nextJob;
+      utils::Mutex *jobMutex;
+    };
 
     /////////////
 
@@ -379,31 +436,52 @@ namespace mars {
     }
 
     osg::ref_ptr<osg::Node> GuiHelper::readNodeFromFile(string fileName) {
-      std::vector<nodeFileStruct>::iterator iter;
-
-      for(iter = GuiHelper::nodeFiles.begin();
-          iter != GuiHelper::nodeFiles.end(); iter++) {
-        if((*iter).fileName == fileName) return (*iter).node;
-      }
-      nodeFileStruct newNodeFile;
-      newNodeFile.fileName = fileName;
-      newNodeFile.node = osgDB::readNodeFile(fileName);
-      GuiHelper::nodeFiles.push_back(newNodeFile);
-      return newNodeFile.node;
+      return cachedNode(fileName, false);
     }
 
-
     osg::ref_ptr<osg::Node> GuiHelper::readBobjFromFile(const std::string &filename) {
+      return cachedNode(filename, true);
+    }
 
-      std::vector<nodeFileStruct>::iterator iter;
+    /**
+     * \brief Returns the node of the file from the cache or decodes the
+     * file if it is not cached or was modified since it was loaded.
+     *
+     * The file is decoded without holding the cache lock, thus the
+     * preload workers can decode several files at the same time.
+     */
+    osg::ref_ptr<osg::Node> GuiHelper::cachedNode(const std::string &fileName,
+                                                  bool bobj) {
+      unordered_map<string, nodeFileStruct>::iterator iter;
+      osg::ref_ptr<osg::Node> node;
+      time_t mtime = getFileMTime(fileName);
+
+      fileMutex.lock();
+      iter = nodeFiles.find(fileName);
+      if(iter != nodeFiles.end() && iter->second.mtime == mtime) {
+        node = iter->second.node;
+        fileMutex.unlock();
+        return node;
+      }
+      fileMutex.unlock();
+
+      long long startTime = utils::getTime();
+      if(bobj) node = decodeBobj(fileName);
+      else node = osgDB::readNodeFile(fileName);
+      if(!node.valid()) return node;
 
-      for(iter = GuiHelper::nodeFiles.begin();
-          iter != GuiHelper::nodeFiles.end(); iter++) {
-        if((*iter).fileName == filename) return (*iter).node;
-      }
       nodeFileStruct newNodeFile;
-      newNodeFile.fileName = filename;
+      newNodeFile.fileName = fileName;
+      newNodeFile.mtime = mtime;
+      newNodeFile.loadTime = utils::getTimeDiff(startTime);
+      newNodeFile.node = node;
+      fileMutex.lock();
+      nodeFiles[fileName] = newNodeFile;
+      fileMutex.unlock();
+      return node;
+    }
 
+    osg::Node* GuiHelper::decodeBobj(const std::string &filename) {
       FILE* input = fopen(filename.c_str(), "rb");
       if(!input) {
 	fprintf(stderr, "ERROR: reading file: %s\n", filename.c_str());
@@ -558,9 +636,7 @@ namespace mars {
       osgUtil::Optimizer optimizer;
       optimizer.optimize( geode );
 
-      newNodeFile.node = geode;
-      GuiHelper::nodeFiles.push_back(newNodeFile);
-      return newNodeFile.node;
+      return geode;
     }
 
     // TODO: should not be in graphics!
@@ -613,7 +689,7 @@ namespace mars {
       }
 #endif
 
-      osg::Image* image = osgDB::readImageFile(terrain->srcname);
+      osg::ref_ptr<osg::Image> image = loadImage(terrain->srcname);
 
       if(image) {
         terrain->width = image->s();
@@ -647,14 +723,20 @@ namespace mars {
     }
 
     osg::ref_ptr<osg::Texture2D> GuiHelper::loadTexture(string filename) {
-      std::vector<textureFileStruct>::iterator iter;
+      unordered_map<string, textureFileStruct>::iterator iter;
+      osg::ref_ptr<osg::Image> textureImage = loadImage(filename);
 
-      for (iter = textureFiles.begin();
-           iter != textureFiles.end(); iter++) {
-        if ((*iter).fileName == filename) {
-          return (*iter).texture;
-        }
+      // a reloaded image also needs a new texture
+      fileMutex.lock();
+      iter = textureFiles.find(filename);
+      if(iter != textureFiles.end() &&
+         iter->second.texture->getImage() == textureImage.get()) {
+        osg::ref_ptr<osg::Texture2D> texture = iter->second.texture;
+        fileMutex.unlock();
+        return texture;
       }
+      fileMutex.unlock();
+
       textureFileStruct newTextureFile;
       newTextureFile.fileName = filename;
       newTextureFile.texture = new osg::Texture2D;
@@ -663,29 +745,137 @@ namespace mars {
       newTextureFile.texture->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
       newTextureFile.texture->setWrap(osg::Texture::WRAP_R, osg::Texture::REPEAT);
 
-      osg::Image* textureImage = loadImage(filename);
-      newTextureFile.texture->setImage(textureImage);
-      textureFiles.push_back(newTextureFile);
+      newTextureFile.texture->setImage(textureImage.get());
+      fileMutex.lock();
+      textureFiles[filename] = newTextureFile;
+      fileMutex.unlock();
 
       return newTextureFile.texture;
     }
 
     osg::ref_ptr<osg::Image> GuiHelper::loadImage(string filename) {
-      std::vector<imageFileStruct>::iterator iter;
+      unordered_map<string, imageFileStruct>::iterator iter;
+      osg::ref_ptr<osg::Image> image;
+      time_t mtime = getFileMTime(filename);
 
-      for (iter = imageFiles.begin();
-           iter != imageFiles.end(); iter++) {
-        if ((*iter).fileName == filename) {
-          return (*iter).image;
-        }
+      fileMutex.lock();
+      iter = imageFiles.find(filename);
+      if(iter != imageFiles.end() && iter->second.mtime == mtime) {
+        image = iter->second.image;
+        fileMutex.unlock();
+        return image;
       }
+      fileMutex.unlock();
+
+      long long startTime = utils::getTime();
+      image = osgDB::readImageFile(filename);
+
       imageFileStruct newImageFile;
       newImageFile.fileName = filename;
-      osg::Image* image = osgDB::readImageFile(filename);
+      newImageFile.mtime = mtime;
+      newImageFile.loadTime = utils::getTimeDiff(startTime);
       newImageFile.image = image;
-      imageFiles.push_back(newImageFile);
+      fileMutex.lock();
+      imageFiles[filename] = newImageFile;
+      fileMutex.unlock();
+
+      return image;
+    }
+
+    void GuiHelper::preloadMeshes(const std::vector<std::string> &filenames) {
+      preloadFiles(filenames, std::vector<std::string>());
+    }
+
+    void GuiHelper::preloadHeightmaps(const std::vector<std::string> &filenames) {
+      preloadFiles(std::vector<std::string>(), filenames);
+    }
 
-      return newImageFile.image;
+    static bool compareLoadTime(const std::pair<double, std::string> &a,
+                                const std::pair<double, std::string> &b) {
+      return a.first > b.first;
+    }
+
+    void GuiHelper::preloadFiles(const std::vector<std::string> &meshes,
+                                 const std::vector<std::string> &images) {
+      std::vector<std::string> files;
+      std::vector<std::string>::const_iterator it;
+      size_t numMeshes, nextJob = 0;
+      utils::Mutex jobMutex;
+
+      // collect the files that are not cached yet, each only once
+      fileMutex.lock();
+      for(it=meshes.begin(); it!=meshes.end(); ++it) {
+        if(it->empty() || *it == "PRIMITIVE") continue;
+        if(std::find(files.begin(), files.end(), *it) != files.end()) continue;
+        unordered_map<string, nodeFileStruct>::iterator iter = nodeFiles.find(*it);
+        if(iter != nodeFiles.end() &&
+           iter->second.mtime == getFileMTime(*it)) continue;
+        files.push_back(*it);
+      }
+      numMeshes = files.size();
+      for(it=images.begin(); it!=images.end(); ++it) {
+        if(it->empty()) continue;
+        if(std::find(files.begin()+numMeshes, files.end(), *it) != files.end()) continue;
+        unordered_map<string, imageFileStruct>::iterator iter = imageFiles.find(*it);
+        if(iter != imageFiles.end() &&
+           iter->second.mtime == getFileMTime(*it)) continue;
+        files.push_back(*it);
+      }
+      fileMutex.unlock();
+      if(files.empty()) return;
+
+      size_t numThreads = std::thread::hardware_concurrency();
+      if(numThreads < 1) numThreads = 1;
+      if(numThreads > files.size()) numThreads = files.size();
+
+      long long startTime = utils::getTime();
+      std::vector<FileLoadWorker*> workers;
+      for(size_t i=0; i<numThreads; ++i) {
+        workers.push_back(new FileLoadWorker(&files, numMeshes,
+                                             &nextJob, &jobMutex));
+        workers.back()->start();
+      }
+      for(size_t i=0; i<workers.size(); ++i) {
+        workers[i]->wait();
+        delete workers[i];
+      }
+      long long wallTime = utils::getTimeDiff(startTime);
+
+      // report the load time breakdown, slowest files first
+      std::vector<std::pair<double, std::string> > loadTimes;
+      double serialTime = 0.0;
+      fileMutex.lock();
+      for(size_t i=0; i<files.size(); ++i) {
+        double loadTime = -1.0;
+        if(i < numMeshes) {
+          unordered_map<string, nodeFileStruct>::iterator iter = nodeFiles.find(files[i]);
+          if(iter != nodeFiles.end()) loadTime = iter->second.loadTime;
+        }
+        else {
+          unordered_map<string, imageFileStruct>::iterator iter = imageFiles.find(files[i]);
+          if(iter != imageFiles.end() && iter->second.image.valid()) {
+            loadTime = iter->second.loadTime;
+          }
+        }
+        if(loadTime >= 0.0) serialTime += loadTime;
+        loadTimes.push_back(std::make_pair(loadTime, files[i]));
+      }
+      fileMutex.unlock();
+      std::sort(loadTimes.begin(), loadTimes.end(), compareLoadTime);
+
+      LOG_INFO("GuiHelper: preloaded %lu files in %lld ms using %lu threads (%g ms serial)",
+               (unsigned long)files.size(), wallTime,
+               (unsigned long)numThreads, serialTime);
+      for(size_t i=0; i<loadTimes.size(); ++i) {
+        if(loadTimes[i].first < 0.0) {
+          LOG_WARN("GuiHelper: could not preload %s",
+                   loadTimes[i].second.c_str());
+        }
+        else {
+          LOG_DEBUG("GuiHelper: preloaded %s in %g ms",
+                    loadTimes[i].second.c_str(), loadTimes[i].first);
+        }
+      }
     }
 
   } // end of namespace graphics
@@ -34,12 +34,15 @@
 
 #include <vector>
 #include <sstream>
+#include <unordered_map>
+#include <ctime>
 
 #include <mars/interfaces/sim_common.h>
 #include <mars/interfaces/terrainStruct.h>
 #include <mars/interfaces/sim/LoadCenter.h>
 
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
+#include <mars/utils/Mutex.h>
 
 
 namespace mars {
@@ -62,8 +65,15 @@ namespace mars {
       mars::interfaces::NodeData snode;
     }; // end of struct nodemanager
 
+    /**
+     * Cache entry of a loaded file. The entry is only valid as long as
+     * the modification time of the file is unchanged. loadTime holds the
+     * time in ms that was needed to decode the file.
+     */
     struct nodeFileStruct {
       std::string fileName;
+      time_t mtime;
+      double loadTime;
       osg::ref_ptr<osg::Node> node;
     }; // end of struct nodeFileStruct
 
@@ -74,6 +84,8 @@ namespace mars {
 
     struct imageFileStruct {
       std::string fileName;
+      time_t mtime;
+      double loadTime;
       osg::ref_ptr<osg::Image> image;
     }; // end of struct imageFileStruct
 
@@ -120,6 +132,16 @@ namespace mars {
       virtual std::vector<double> getMeshSize(const std::string &filename);
       virtual void getPhysicsFromMesh(mars::interfaces::NodeData *node);
       virtual void readPixelData(mars::interfaces::terrainStruct *terrain);
+      virtual void preloadMeshes(const std::vector<std::string> &filenames);
+      virtual void preloadHeightmaps(const std::vector<std::string> &filenames);
+
+      /**
+       * \brief Decodes the given meshes and images into the file cache
+       * using a pool of worker threads and prints the load time of
+       * each file. Files that are already cached are skipped.
+       */
+      static void preloadFiles(const std::vector<std::string> &meshes,
+                               const std::vector<std::string> &images);
 
       static osg::ref_ptr<osg::Node> readNodeFromFile(std::string fileName);
       static osg::ref_ptr<osg::Node> readBobjFromFile(const std::string &filename);
@@ -133,13 +155,21 @@ namespace mars {
       //GraphicsWidget *gw;
       //for compatibility
       mars::interfaces::GraphicData gs;
-      static std::vector<nodeFileStruct> nodeFiles;
-      // vector to prevent double load of textures
-      static std::vector<textureFileStruct> textureFiles;
-      // vector to prevent double load of images
-      static std::vector<imageFileStruct> imageFiles;
+      // the file caches are shared by the preload workers
+      static utils::Mutex fileMutex;
+      static std::unordered_map<std::string, nodeFileStruct> nodeFiles;
+      // map to prevent double load of textures
+      static std::unordered_map<std::string, textureFileStruct> textureFiles;
+      // map to prevent double load of images
+      static std::unordered_map<std::string, imageFileStruct> imageFiles;
       void getPhysicsFromNode(mars::interfaces::NodeData* node,
                               osg::ref_ptr<osg::Node> completeNode);
+
+      static osg::ref_ptr<osg::Node> cachedNode(const std::string &fileName,
+                                                bool bobj);
+      static osg::Node* decodeBobj(const std::string &filename);
+
+      friend class FileLoadWorker;
     }; // end of class GuiHelper
 
   } // end of namespace graphics
@@ -0,0 +1,172 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file test_async_readback.cpp
+ * \brief Checks that AsyncReadback reads the color and depth texture of
+ *        a render to texture camera back in the frame after the draw.
+ *
+ * A camera renders a green quad at a distance of QUAD_DISTANCE into a
+ * pbuffer. After the first frame no data may be available yet. The
+ * camera is then disabled, and the next frame alone has to map the
+ * buffers of the first one.
+ */
+
+#include "AsyncReadback.h"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osgViewer/Viewer>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace mars::graphics;
+
+#define WIDTH 64
+#define HEIGHT 48
+#define QUAD_DISTANCE 5.0
+#define MAX_DEPTH_DIFF 1e-3
+// ctest counts this exit code as skipped
+#define SKIP_TEST 77
+
+static osg::Node* createQuad(void) {
+  osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+  osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+  osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
+  osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+
+  // much larger than the view
+  vertices->push_back(osg::Vec3(-100, -100, -QUAD_DISTANCE));
+  vertices->push_back(osg::Vec3(100, -100, -QUAD_DISTANCE));
+  vertices->push_back(osg::Vec3(100, 100, -QUAD_DISTANCE));
+  vertices->push_back(osg::Vec3(-100, 100, -QUAD_DISTANCE));
+  colors->push_back(osg::Vec4(0, 1, 0, 1));
+  geometry->setVertexArray(vertices.get());
+  geometry->setColorArray(colors.get(), osg::Array::BIND_OVERALL);
+  geometry->addPrimitiveSet(new osg::DrawArrays(GL_QUADS, 0, 4));
+  geode->addDrawable(geometry.get());
+  geode->getOrCreateStateSet()->setMode(GL_LIGHTING,
+                                        osg::StateAttribute::OFF);
+  return geode.release();
+}
+
+static osg::Texture2D* createTexture(GLint internalFormat, GLenum format,
+                                     GLenum type) {
+  osg::Texture2D *texture = new osg::Texture2D;
+  texture->setTextureSize(WIDTH, HEIGHT);
+  texture->setInternalFormat(internalFormat);
+  texture->setSourceFormat(format);
+  texture->setSourceType(type);
+  texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+  texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+  return texture;
+}
+
+int main(void) {
+  osg::ref_ptr<osg::GraphicsContext::Traits> traits;
+  osg::ref_ptr<osg::GraphicsContext> gc;
+  osg::ref_ptr<osg::Texture2D> colorTexture, depthTexture;
+  osg::ref_ptr<osg::Camera> camera;
+  osg::ref_ptr<AsyncReadback> readback;
+  osgViewer::Viewer viewer;
+  std::vector<char> image(WIDTH*HEIGHT*4);
+  std::vector<float> depth(WIDTH*HEIGHT);
+  int width, height, errors = 0;
+
+  traits = new osg::GraphicsContext::Traits;
+  traits->width = WIDTH;
+  traits->height = HEIGHT;
+  traits->pbuffer = true;
+  traits->doubleBuffer = false;
+  gc = osg::GraphicsContext::createGraphicsContext(traits.get());
+  if(!gc.valid()) {
+    fprintf(stderr, "no pbuffer context, skip the test\n");
+    return SKIP_TEST;
+  }
+
+  colorTexture = createTexture(GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE);
+  depthTexture = createTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT,
+                               GL_FLOAT);
+  readback = new AsyncReadback(colorTexture.get(), depthTexture.get(),
+                               WIDTH, HEIGHT);
+
+  camera = new osg::Camera;
+  camera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+  camera->setRenderOrder(osg::Camera::PRE_RENDER);
+  camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+  camera->setViewport(0, 0, WIDTH, HEIGHT);
+  camera->setClearColor(osg::Vec4(1, 0, 0, 1));
+  camera->setProjectionMatrixAsPerspective(60.0, (double)WIDTH/HEIGHT,
+                                           1.0, 100.0);
+  camera->setViewMatrix(osg::Matrix::identity());
+  camera->attach(osg::Camera::COLOR_BUFFER, colorTexture.get());
+  camera->attach(osg::Camera::DEPTH_BUFFER, depthTexture.get());
+  camera->setFinalDrawCallback(readback.get());
+  camera->addChild(createQuad());
+
+  viewer.setThreadingModel(osgViewer::Viewer::SingleThreaded);
+  viewer.getCamera()->setGraphicsContext(gc.get());
+  viewer.getCamera()->setViewport(0, 0, WIDTH, HEIGHT);
+  viewer.setSceneData(camera.get());
+  viewer.realize();
+
+  viewer.frame();
+  if(readback->getImageData(&image[0], width, height)) {
+    fprintf(stderr, "the buffers were mapped in the frame of the draw\n");
+    ++errors;
+  }
+
+  // the camera does not render again, the buffers are mapped anyway
+  camera->setNodeMask(0);
+  viewer.frame();
+  if(!readback->getImageData(&image[0], width, height) ||
+     !readback->getDepthData(&depth[0], width, height)) {
+    fprintf(stderr, "the buffers were not mapped in the next frame\n");
+    return 1;
+  }
+  if(width != WIDTH || height != HEIGHT) {
+    fprintf(stderr, "wrong size %dx%d\n", width, height);
+    return 1;
+  }
+  for(int i=0; i<WIDTH*HEIGHT; ++i) {
+    const unsigned char *pixel = (const unsigned char*)&image[4*i];
+    if(pixel[0] != 0 || pixel[1] != 255 || pixel[2] != 0 ||
+       pixel[3] != 255) {
+      fprintf(stderr, "pixel %d: color %d %d %d %d instead of green\n", i,
+              pixel[0], pixel[1], pixel[2], pixel[3]);
+      ++errors;
+      break;
+    }
+  }
+  for(int i=0; i<WIDTH*HEIGHT; ++i) {
+    if(!(std::fabs(depth[i] - QUAD_DISTANCE) < MAX_DEPTH_DIFF)) {
+      fprintf(stderr, "pixel %d: distance %g instead of %g\n", i,
+              depth[i], QUAD_DISTANCE);
+      ++errors;
+      break;
+    }
+  }
+
+  if(errors) return 1;
+  printf("AsyncReadback: ok\n");
+  return 0;
+}
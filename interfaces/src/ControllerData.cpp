@@ -36,6 +36,7 @@ namespace mars {
 
     ControllerData::ControllerData() {
       rate = 20;
+      lockstep = false;
     }
 
     bool ControllerData::fromConfigMap(ConfigMap *config,
@@ -51,6 +52,8 @@ namespace mars {
       GET_VALUE("index", id, ULong);
       GET_VALUE("rate", rate, Double);
       dylib_path = config->get("dylib_path", dylib_path);
+      transport = config->get("transport", transport);
+      lockstep = config->get("lockstep", lockstep);
 
       if((it = config->find("sensorid")) != config->end()) {
         ConfigVector _ids = (*config)["sensorid"];
@@ -99,6 +102,10 @@ namespace mars {
       SET_VALUE("index", id);
       SET_VALUE("rate", rate);
       SET_VALUE("dylib_path", dylib_path);
+      if(!transport.empty()) {
+        SET_VALUE("transport", transport);
+        SET_VALUE("lockstep", lockstep);
+      }
 
       for(it=sensors.begin(); it!=sensors.end(); ++it) {
         (*config)["sensorid"] << *it;
@@ -49,6 +49,8 @@ namespace mars {
       std::vector<unsigned long> sensors;
       std::vector<unsigned long> sNodes;
       std::string dylib_path;
+      std::string transport; ///< "shm:<name>" or "unix:<path>", empty for tcp
+      bool lockstep; ///< wait each update for the external controller
     }; // end of class ControllerData
 
   } // end of namespace interfaces
@@ -208,6 +208,9 @@ namespace mars {
                                         terrain->targetHeight));
         GET_VALUE("t_tex_scale_x", terrain->texScaleX, Double);
         GET_VALUE("t_tex_scale_y", terrain->texScaleY, Double);
+        // the sample count of a raw DEM, an image defines it by itself
+        GET_VALUE("t_samples_x", terrain->width, Int);
+        GET_VALUE("t_samples_y", terrain->height, Int);
       }
 
       GET_OBJECT("visualposition", visual_offset_pos, vector);
@@ -325,6 +328,10 @@ namespace mars {
         (*config)["t_scale"] = terrain->scale;
         (*config)["t_tex_scale_x"] = terrain->texScaleX;
         (*config)["t_tex_scale_y"] = terrain->texScaleY;
+        if(terrain->isFloatDEM()) {
+          (*config)["t_samples_x"] = terrain->width;
+          (*config)["t_samples_y"] = terrain->height;
+        }
       }
 
       SET_OBJECT("visualposition", visual_offset_pos, vector, true);
@@ -80,6 +80,15 @@ namespace mars {
        * */
       virtual void getRTTDepthData(float *buffer, int &width, int &height) = 0;
       virtual void getRTTDepthData(float **data, int &width, int &height) = 0;      
+
+      /**
+       * Reads the image and depth data of a render to texture window
+       * back through pixel buffer objects. The frame does not wait for
+       * the transfer, instead getImageData() and getRTTDepthData()
+       * return the data of the previous render of the window.
+       * Has to be called before the window is rendered the first time.
+       */
+      virtual void setAsyncReadback(bool enable) = 0;
       virtual osg::Group* getScene() = 0;
       virtual void setScene(osg::Group *scene) = 0;
       virtual void addGraphicsEventHandler(GraphicsEventInterface *graphicsEventHandler) = 0;
@@ -33,6 +33,8 @@
 
 #include <vector>
 #include <limits>
+#include <cstdlib>
+#include <cstring>
 
 
 namespace mars {
@@ -78,6 +80,22 @@ namespace mars {
         return 0;
       };
 
+      /**
+       * Writes the sensor values into a buffer of the caller. Sensors
+       * override it to avoid the allocation of getSensorData(double**).
+       * \return the number of values of the sensor, if it is greater
+       *         than \c size nothing is written
+       */
+      virtual int fillSensorData(double *data, int size) const{
+        double *values = 0;
+        int count = getSensorData(&values);
+        if(count <= size && count > 0) {
+          memcpy(data, values, count*sizeof(double));
+        }
+        free(values);
+        return count;
+      }
+
       virtual int getAsciiData(char *data) const{
         return 0;
       }
@@ -0,0 +1,80 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file CheckpointInterface.h
+ * \brief "CheckpointInterface" declares the section of a manager in a
+ *        checkpoint of SimulatorInterface::saveCheckpoint.
+ */
+
+#ifndef CHECKPOINT_INTERFACE_H
+#define CHECKPOINT_INTERFACE_H
+
+#ifdef _PRINT_HEADER_
+  #warning "CheckpointInterface.h"
+#endif
+
+#include "../MARSDefs.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace mars {
+  namespace interfaces {
+
+    /**
+     * A manager that writes its dynamic state as one section of a
+     * checkpoint. The section starts with the number of objects and
+     * their ids, thus it can be checked against the scene before any
+     * section of the checkpoint is restored.
+     */
+    class CheckpointInterface {
+    public:
+      virtual ~CheckpointInterface() {}
+
+      /**
+       * \brief Appends the dynamic state of all objects to \c state.
+       * \sa SimulatorInterface::saveCheckpoint
+       */
+      virtual void saveState(std::vector<sReal> *state) = 0;
+
+      /**
+       * \brief Checks that the objects stored in \c state at \c pos match
+       *        the ones of the simulation, without changing them.
+       * \returns \c false if they don't match; otherwise \c pos is moved
+       *          behind the values that restoreState would read.
+       */
+      virtual bool checkState(const std::vector<sReal> &state,
+                              size_t *pos) = 0;
+
+      /**
+       * \brief Restores the objects from \c state starting at \c pos.
+       * \returns \c false without any change if the stored objects don't
+       *          match the ones of the simulation; otherwise \c pos is
+       *          moved behind the read values.
+       */
+      virtual bool restoreState(const std::vector<sReal> &state,
+                                size_t *pos) = 0;
+    };
+
+  } // end of namespace interfaces
+} // end of namespace mars
+
+#endif  // CHECKPOINT_INTERFACE_H
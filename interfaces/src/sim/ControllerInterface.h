@@ -37,6 +37,15 @@
 #include "../sim_common.h"
 
 #include <list>
+#include <cstddef>
+
+/**
+ * Controller libraries that implement updateBuffers() export
+ *   extern "C" int controller_abi_version(void)
+ *   {return CONTROLLER_ABI_VERSION;}
+ * Libraries without this symbol are updated via update().
+ */
+#define CONTROLLER_ABI_VERSION 2
 
 namespace mars {
   namespace interfaces {
@@ -50,13 +59,25 @@ namespace mars {
       ControllerInterface(void) {};
       virtual ~ControllerInterface(void) {};
       virtual void update(sReal time_ms, sReal *sensors,
-                          sReal *motors, int *flags, char **other) = 0;
+                          sReal *motors, int *flags, char **other) {}
       virtual void handleError(void) {}
       virtual std::list<sReal> getSensorValues(void) = 0;
+      /**
+       * Like update() but with the number of sensor and motor values. The
+       * buffers are allocated once by the simulation and have exactly
+       * the size of the values.
+       */
+      virtual void updateBuffers(sReal time_ms,
+                                 const sReal *sensors, size_t numSensors,
+                                 sReal *motors, size_t numMotors,
+                                 int *flags, char **other) {
+        update(time_ms, const_cast<sReal*>(sensors), motors, flags, other);
+      }
     };
 
     typedef ControllerInterface* create_controller(void);
     typedef void destroy_controller(ControllerInterface*);
+    typedef int controller_abi_version(void);
 
   } // end of namespace interfaces
 } // end of namespace mars
@@ -0,0 +1,161 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file ControllerShm.h
+ * \brief "ControllerShm" defines the shared memory segment of the binary
+ *        controller transport. External controllers include this header
+ *        to attach to a segment created by the simulation.
+ */
+
+#ifndef MARS_INTERFACES_CONTROLLER_SHM_H
+#define MARS_INTERFACES_CONTROLLER_SHM_H
+
+#ifdef _PRINT_HEADER_
+  #warning "ControllerShm.h"
+#endif
+
+#ifndef WIN32
+#include <semaphore.h>
+#endif
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+
+#define CONTROLLER_SHM_MAGIC 0x4d415253
+#define CONTROLLER_SHM_VERSION 1
+#define CONTROLLER_SHM_SLOTS 4
+
+namespace mars {
+  namespace interfaces {
+
+    /**
+     * Header at the start of the segment. It is followed by
+     * CONTROLLER_SHM_SLOTS sensor slots of numSensors+1 doubles (the
+     * simulation time in ms followed by the sensor values) and
+     * CONTROLLER_SHM_SLOTS motor slots of numMotors doubles.
+     *
+     * Both directions are single producer rings: the writer fills the
+     * slot seq % CONTROLLER_SHM_SLOTS and publishes seq+1 afterwards. A
+     * reader copies the newest slot and retries if the writer lapped it
+     * in the meantime, thus no lock is shared between the processes.
+     *
+     * In lockstep mode the simulation posts sensorsReady after writing
+     * the sensor values and waits on motorsReady, which the controller
+     * posts after writing the motor values. The simulation only waits
+     * while controllerAttached is set by the controller.
+     *
+     * If the number of sensor or motor values changes the simulation
+     * replaces the segment by a new one of the same name. It clears the
+     * magic of the old segment and posts its sensorsReady, thus a
+     * controller has to check the magic after each wait and attach to
+     * the new segment once it is cleared.
+     *
+     * macOS has no process shared unnamed semaphores. There the
+     * semaphores are opened with sem_open under the names returned by
+     * controllerShmSemName and the sem_t members are unused.
+     */
+    struct ControllerShmHeader {
+      uint32_t magic;
+      uint32_t version;
+      uint32_t numSensors;
+      uint32_t numMotors;
+      uint32_t lockstep;
+      uint32_t controllerAttached;
+      uint32_t flags; ///< set by the controller to reset the simulation
+      uint32_t reserved;
+      uint64_t sensorSeq;
+      uint64_t motorSeq;
+#ifndef WIN32
+      sem_t sensorsReady;
+      sem_t motorsReady;
+#endif
+    };
+
+#ifdef __APPLE__
+    /**
+     * The name of the named semaphore sensorsReady or motorsReady of the
+     * segment \a shmName. macOS limits the names to 31 characters.
+     */
+    inline std::string controllerShmSemName(const std::string &shmName,
+                                            bool motors) {
+      return shmName + (motors ? ".m" : ".s");
+    }
+#endif
+
+    inline size_t controllerShmSize(uint32_t numSensors, uint32_t numMotors) {
+      return sizeof(ControllerShmHeader) +
+        CONTROLLER_SHM_SLOTS*(numSensors+1+numMotors)*sizeof(double);
+    }
+
+    inline double* controllerShmSensorSlot(ControllerShmHeader *header,
+                                           uint64_t seq) {
+      double *slots = (double*)(header+1);
+      return slots + (seq % CONTROLLER_SHM_SLOTS)*(header->numSensors+1);
+    }
+
+    inline double* controllerShmMotorSlot(ControllerShmHeader *header,
+                                          uint64_t seq) {
+      double *slots = (double*)(header+1);
+      slots += CONTROLLER_SHM_SLOTS*(header->numSensors+1);
+      return slots + (seq % CONTROLLER_SHM_SLOTS)*header->numMotors;
+    }
+
+    /**
+     * Writes one slot of a ring and publishes it.
+     * \param seq either &header->sensorSeq or &header->motorSeq
+     */
+    inline void controllerShmWrite(ControllerShmHeader *header, uint64_t *seq,
+                                   const double *values, size_t count) {
+      uint64_t next = __atomic_load_n(seq, __ATOMIC_RELAXED);
+      double *slot = (seq == &header->sensorSeq ?
+                      controllerShmSensorSlot(header, next) :
+                      controllerShmMotorSlot(header, next));
+      memcpy(slot, values, count*sizeof(double));
+      __atomic_store_n(seq, next+1, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * Copies the newest slot of a ring if it is newer than *lastSeq.
+     * \return true if new values were copied
+     */
+    inline bool controllerShmRead(ControllerShmHeader *header, uint64_t *seq,
+                                  double *values, size_t count,
+                                  uint64_t *lastSeq) {
+      uint64_t published, after;
+      do {
+        published = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        if(published == *lastSeq) return false;
+        memcpy(values, (seq == &header->sensorSeq ?
+                        controllerShmSensorSlot(header, published-1) :
+                        controllerShmMotorSlot(header, published-1)),
+               count*sizeof(double));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(seq, __ATOMIC_RELAXED);
+      } while(after - (published-1) >= CONTROLLER_SHM_SLOTS);
+      *lastSeq = published;
+      return true;
+    }
+
+  } // end of namespace interfaces
+} // end of namespace mars
+
+#endif  // MARS_INTERFACES_CONTROLLER_SHM_H
@@ -36,6 +36,9 @@
 
 #include "../JointData.h"
 #include "../core_objects_exchange.h"
+#include "CheckpointInterface.h"
+
+#include <list>
 
 namespace mars {
 
@@ -49,7 +52,7 @@ namespace mars {
      * Interface class for the node organization.
      *
      */
-    class JointManagerInterface {
+    class JointManagerInterface : public CheckpointInterface {
     public:
       virtual ~JointManagerInterface() {}
 
@@ -125,6 +128,12 @@ namespace mars {
        */
       virtual void reloadJoints(void) = 0;
 
+      /**
+       * \brief Copies and replaces the JointData pool used by reloadJoints.
+       */
+      virtual void getReloadJoints(std::list<JointData> *joints) const = 0;
+      virtual void setReloadJoints(const std::list<JointData> &joints) = 0;
+
       /**
        * \brief Update the Joint values from the physics
        */
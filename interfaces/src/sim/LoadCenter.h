@@ -57,6 +57,12 @@ namespace mars {
       virtual ~LoadMeshInterface() {}
       virtual void getPhysicsFromMesh(NodeData *node) = 0;
       virtual std::vector<double> getMeshSize(const std::string &filename) = 0;
+      /**
+       * Decodes the given mesh files in advance, e.g. in parallel, so
+       * that the following getPhysicsFromMesh calls are served from a
+       * cache. The default implementation does nothing.
+       */
+      virtual void preloadMeshes(const std::vector<std::string> &filenames) {}
     };
 
 
@@ -64,6 +70,11 @@ namespace mars {
     public:
       virtual ~LoadHeightmapInterface() {}
       virtual void readPixelData(terrainStruct *terrain) = 0;
+      /**
+       * Decodes the given heightmap images in advance. The default
+       * implementation does nothing.
+       */
+      virtual void preloadHeightmaps(const std::vector<std::string> &filenames) {}
     };
 
     class LoadSceneInterface;
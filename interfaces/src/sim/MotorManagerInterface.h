@@ -37,6 +37,9 @@
 #endif
 
 #include "../MotorData.h"
+#include "CheckpointInterface.h"
+
+#include <list>
 
 namespace mars {
 
@@ -61,7 +64,7 @@ namespace mars {
      * is only guaranteed by calling it within the main thread (update 
      * callback from \c gui_thread).
      */
-    class MotorManagerInterface {
+    class MotorManagerInterface : public CheckpointInterface {
     public:
       /**
        * \brief Destructor.
@@ -268,6 +271,12 @@ namespace mars {
        * are added back to the simulation again with a \c reload value of \c true. 
        */
       virtual void reloadMotors(void) = 0;
+
+      /**
+       * \brief Copies and replaces the MotorData pool used by reloadMotors.
+       */
+      virtual void getReloadMotors(std::list<MotorData> *motors) const = 0;
+      virtual void setReloadMotors(const std::list<MotorData> &motors) = 0;
   
       /**
        * \brief This function updates all motors with timing value \c calc_ms in miliseconds.
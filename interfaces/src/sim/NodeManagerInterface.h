@@ -38,10 +38,13 @@
 #include "../sensor_bases.h"
 #include "../NodeData.h"
 #include "../nodeState.h"
+#include "CheckpointInterface.h"
 
 #include <mars/utils/Vector.h>
 #include <mars/utils/Quaternion.h>
 
+#include <list>
+
 namespace mars {
 
   namespace sim {
@@ -50,13 +53,26 @@ namespace mars {
 
   namespace interfaces {
 
+    /**
+     * Counters of the node manager since the last call of
+     * NodeManagerInterface::getDebugStats. The simulator publishes them
+     * on the data broker as "mars_sim/simDebug".
+     */
+    struct NodeManagerDebugStats {
+      NodeManagerDebugStats() : numUpdateContentions(0), numLockedReads(0),
+                                numSnapshotReads(0) {}
+      unsigned long numUpdateContentions; ///< blocked node updates of the physics thread
+      unsigned long numLockedReads; ///< state reads that locked the node manager
+      unsigned long numSnapshotReads; ///< state reads served by the snapshot
+    };
+
     /**
      * \author Malte Langosz, Lorenz Quack \n
      * \brief "NodeManagerInterface" declares the interfaces for all NodeOperations
      * that are used for the communication between the simulation modules.
      *
      */
-    class NodeManagerInterface {
+    class NodeManagerInterface : public CheckpointInterface {
     public:
       virtual ~NodeManagerInterface() {}
 
@@ -545,6 +561,20 @@ namespace mars {
        */
       virtual void reloadNodes(bool reloadGraphics) = 0;
 
+      /**
+       * \brief Copies the NodeData pool used by reloadNodes.
+       *
+       * The copies share the terrain and contact data with this manager,
+       * thus they must not be modified or freed.
+       */
+      virtual void getReloadNodes(std::list<NodeData> *nodes) const = 0;
+
+      /**
+       * \brief Replaces the NodeData pool used by reloadNodes. Used to
+       * set up a world with the scene of another one.
+       */
+      virtual void setReloadNodes(const std::list<NodeData> &nodes) = 0;
+
       /**
        * \brief Updates the node values of dynamic nodes from the physics.
        *
@@ -805,6 +835,11 @@ namespace mars {
        */
       virtual void edit(NodeId id, const std::string &key,
                         const std::string &value) = 0;
+
+      /**
+       * \brief Gives the lock counters since the last call and resets them.
+       */
+      virtual void getDebugStats(NodeManagerDebugStats *stats) = 0;
     };
 
   } // end of namespace interfaces
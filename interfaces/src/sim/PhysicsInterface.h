@@ -49,6 +49,56 @@ namespace mars {
       PHYSICS_UNKNOWN,
     };
 
+    /**
+     * Counters of the last physics step. The simulator publishes them
+     * on the data broker as "mars_sim/simDebug".
+     */
+    struct PhysicsDebugStats {
+      PhysicsDebugStats() : numContacts(0), numContactAllocs(0) {}
+      unsigned long numContacts; ///< number of colliding geom pairs
+      unsigned long numContactAllocs; ///< heap allocations of the contact arena
+    };
+
+    /**
+     * Contiguous state of a list of nodes as filled by
+     * PhysicsInterface::getNodeStates. The values of the i-th node are
+     * stored at pos[3*i], rot[4*i] (x, y, z, w), lin_vel[3*i], ang_vel[3*i],
+     * force[3*i] and torque[3*i].
+     */
+    struct NodeStateBuffer {
+      std::vector<sReal> pos, rot, lin_vel, ang_vel, force, torque;
+
+      void resize(size_t numNodes) {
+        pos.resize(numNodes*3);
+        rot.resize(numNodes*4);
+        lin_vel.resize(numNodes*3);
+        ang_vel.resize(numNodes*3);
+        force.resize(numNodes*3);
+        torque.resize(numNodes*3);
+      }
+    };
+
+    /**
+     * Rays for PhysicsInterface::castRays. The i-th ray starts at
+     * origin[3*i] and points along direction[3*i]. Before the call
+     * distance[i] holds the maximum length of the ray, afterwards the
+     * distance to the closest hit or the unchanged maximum length.
+     */
+    struct RayBatch {
+      RayBatch() : ignoreNode(0), collideBits(~0u) {}
+      std::vector<sReal> origin, direction, distance;
+      const NodeInterface *ignoreNode; ///< the rays pass through this node
+      unsigned int collideBits; ///< the rays only hit geoms with matching bits
+
+      size_t size() const {return distance.size();}
+
+      void resize(size_t numRays) {
+        origin.resize(numRays*3);
+        direction.resize(numRays*3);
+        distance.resize(numRays);
+      }
+    };
+
     class PhysicsInterface {
 
     public:
@@ -56,17 +106,35 @@ namespace mars {
       sReal step_size; /**< Step size in seconds */
       utils::Vector world_gravity;
       bool fast_step;
+      int num_threads; /**< Number of threads used to step the world */
+      bool deterministic; /**< Reproduce runs with the same num_threads */
       bool draw_contact_points;
       sReal world_cfm, world_erp;
 
       virtual ~PhysicsInterface() {}
       virtual void initTheWorld(void) = 0;
       virtual void freeTheWorld(void) = 0;
+      /**
+       * Allocates the engine data of the calling thread. Has to be
+       * called once by each thread that steps the world.
+       */
+      virtual void initThread(void) = 0;
       virtual void stepTheWorld(void) = 0;
       virtual bool existsWorld(void) const = 0;
       virtual const utils::Vector getCenterOfMass(const std::vector<NodeInterface*> &nodes) const = 0;
       virtual int checkCollisions(void) = 0;
       virtual sReal getVectorCollision(const utils::Vector &pos, const utils::Vector &ray) const = 0;
+      /**
+       * Casts all rays of the batch with a single lock of the world. The
+       * rays are tested against a bounding box list of the geoms that is
+       * built once per call and are split over the collision threads.
+       */
+      virtual void castRays(RayBatch *rays) const = 0;
+      virtual void getDebugStats(PhysicsDebugStats *stats) const = 0;
+      virtual void getNodeStates(const std::vector<NodeInterface*> &nodes,
+                                 NodeStateBuffer *states) const = 0;
+      virtual void setNodeStates(const std::vector<NodeInterface*> &nodes,
+                                 const NodeStateBuffer &states) = 0;
     };
 
   } // end of namespace interfaces
@@ -86,6 +86,35 @@ namespace mars {
       virtual bool sceneChanged() const = 0;
       virtual void sceneHasChanged(bool reset) = 0;
 
+      /**
+       * \brief Stores the simulation time and the state of the dynamic
+       * nodes, joints and motor controllers of the loaded scene.
+       *
+       * The checkpoint can be restored as long as no object is added to or
+       * removed from the scene. Both functions have to be called from the
+       * simulation thread (e.g. in PluginInterface::update) or while
+       * holding physicsThreadLock.
+       */
+      virtual void saveCheckpoint(std::vector<sReal> *checkpoint) = 0;
+      virtual bool restoreCheckpoint(const std::vector<sReal> &checkpoint) = 0;
+
+      /**
+       * \brief Creates an independent world, e.g. for parallel rollouts.
+       *
+       * The world has its own physics, managers and simulation thread and
+       * is set up with the nodes, joints and motors of the loaded scene.
+       * Image heightmaps are copied from the data already read by this
+       * simulator and meshes are read again, while the collision buffers
+       * built from them are shared read-only between the worlds. The
+       * world has no graphics, configuration or data broker, thus sensors
+       * and controllers are not copied and setGravity changes its physics
+       * directly. It is started with StartSimulation, controlled through
+       * its ControlCenter, reset with restoreCheckpoint and deleted with
+       * destroyWorld.
+       */
+      virtual SimulatorInterface* createWorld(void) = 0;
+      virtual void destroyWorld(SimulatorInterface *world) = 0;
+
       //threads
       bool allConcurrencysHandled();
       virtual void setSyncThreads(bool value) = 0;
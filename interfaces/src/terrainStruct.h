@@ -53,6 +53,17 @@ namespace mars {
       double *pixelData;
       int mesh;
 
+      /**
+       * A source file with the suffix ".f32" is a raw elevation model of
+       * width x height native floats, stored row by row with the row at
+       * the +y edge of the terrain first. The physics maps the file
+       * directly instead of using pixelData.
+       */
+      bool isFloatDEM() const {
+        return (srcname.size() > 4 &&
+                srcname.compare(srcname.size()-4, 4, ".f32") == 0);
+      }
+
     }; // end of struct terrainStruct
 
   } // end of namespace interfaces
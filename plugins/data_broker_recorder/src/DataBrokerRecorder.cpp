@@ -0,0 +1,272 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file DataBrokerRecorder.cpp
+ * \brief "DataBrokerRecorder" writes DataBroker streams into a RecordLog.
+ */
+
+#include "DataBrokerRecorder.h"
+
+#include <mars/data_broker/DataBrokerInterface.h>
+#include <mars/utils/MutexLocker.h>
+#include <mars/utils/misc.h>
+
+#include <chrono>
+#include <cstring>
+
+// milliseconds after which buffered records are written at the latest
+#define RECORD_FLUSH_PERIOD 100
+
+namespace mars {
+  namespace plugins {
+    namespace data_broker_recorder {
+
+      using namespace mars::data_broker;
+      using namespace mars::utils;
+
+      static long long getSteadyTime() {
+        using namespace std::chrono;
+        return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+      }
+
+      DataBrokerRecorder::DataBrokerRecorder(DataBrokerInterface *dataBroker)
+        : dataBroker(dataBroker), numStreams(0), bufferSize(0), stop(false),
+          startTime(0), numRecords(0), numDropped(0), file(0), fileOffset(0),
+          numDataWritten(0) {
+      }
+
+      DataBrokerRecorder::~DataBrokerRecorder() {
+        stopRecording();
+      }
+
+      bool DataBrokerRecorder::startRecording(const std::string &filename,
+                                              const std::vector<std::string> &patterns,
+                                              size_t bufferSize) {
+        MutexLocker recordLocker(&recordMutex);
+        if(file) return false;
+
+        file = fopen(filename.c_str(), "wb");
+        if(!file) {
+          fprintf(stderr, "DataBrokerRecorder: could not open %s\n",
+                  filename.c_str());
+          return false;
+        }
+        RecordFileHeader header;
+        memset(&header, 0, sizeof(header));
+        strncpy(header.magic, RECORD_LOG_MAGIC, sizeof(header.magic));
+        header.version = RECORD_LOG_VERSION;
+        fwrite(&header, sizeof(header), 1, file);
+        fileOffset = sizeof(header);
+        numDataWritten = 0;
+        schemaOffsets.clear();
+        index.clear();
+
+        this->patterns.clear();
+        for(size_t i=0; i<patterns.size(); ++i) {
+          size_t split = patterns[i].find('/');
+          if(split == std::string::npos) {
+            this->patterns.push_back(std::make_pair(patterns[i],
+                                                    std::string("*")));
+          } else {
+            this->patterns.push_back(std::make_pair(patterns[i].substr(0, split),
+                                                    patterns[i].substr(split+1)));
+          }
+        }
+        streamStates.clear();
+        numStreams = 0;
+        numRecords = numDropped = 0;
+        this->bufferSize = bufferSize;
+        frontBuffer.clear();
+        backBuffer.clear();
+        frontBuffer.reserve(bufferSize);
+        backBuffer.reserve(bufferSize);
+        startTime = getSteadyTime();
+        stop = false;
+        start();
+        registerStreams();
+        return true;
+      }
+
+      void DataBrokerRecorder::stopRecording() {
+        MutexLocker recordLocker(&recordMutex);
+        if(!file) return;
+
+        std::set<std::pair<std::string, std::string> >::iterator it;
+        for(it=registered.begin(); it!=registered.end(); ++it) {
+          dataBroker->unregisterSyncReceiver(this, it->first, it->second);
+        }
+        registered.clear();
+
+        bufferMutex.lock();
+        stop = true;
+        bufferCondition.wakeOne();
+        bufferMutex.unlock();
+        wait();
+        fclose(file);
+        file = 0;
+        if(numDropped) {
+          fprintf(stderr, "DataBrokerRecorder: dropped %lu of %lu records\n",
+                  numDropped, numRecords + numDropped);
+        }
+      }
+
+      bool DataBrokerRecorder::matchStream(const DataInfo &info) const {
+        for(size_t i=0; i<patterns.size(); ++i) {
+          if(matchPattern(patterns[i].first, info.groupName) &&
+             matchPattern(patterns[i].second, info.dataName)) {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      bool DataBrokerRecorder::isRecording() const {
+        MutexLocker recordLocker(&recordMutex);
+        return file != 0;
+      }
+
+      void DataBrokerRecorder::updateStreams() {
+        MutexLocker recordLocker(&recordMutex);
+        if(!file) return;
+        registerStreams();
+      }
+
+      /// Has to be called with recordMutex locked.
+      void DataBrokerRecorder::registerStreams() {
+        std::vector<DataInfo> dataList = dataBroker->getDataList();
+        for(size_t i=0; i<dataList.size(); ++i) {
+          std::pair<std::string, std::string> name(dataList[i].groupName,
+                                                   dataList[i].dataName);
+          if(!registered.count(name) && matchStream(dataList[i])) {
+            dataBroker->registerSyncReceiver(this, name.first, name.second);
+            registered.insert(name);
+          }
+        }
+      }
+
+      void DataBrokerRecorder::receiveData(const DataInfo &info,
+                                           const DataPackage &package,
+                                           int callbackParam) {
+        long long time = getSteadyTime() - startTime;
+        MutexLocker locker(&bufferMutex);
+        if(stop) return;
+
+        // a stream gets a new schema whenever the layout of its items changes
+        std::map<unsigned long, StreamState>::iterator it;
+        it = streamStates.find(info.dataId);
+        bool newSchema = (it == streamStates.end() ||
+                          it->second.types.size() != package.size());
+        for(size_t i=0; !newSchema && i<package.size(); ++i) {
+          newSchema = (it->second.types[i] != package[i].type ||
+                       it->second.names[i] != &package[i].getName());
+        }
+
+        size_t schemaSize = newSchema ? getSchemaPayloadSize(info, package) : 0;
+        size_t dataSize = getDataPayloadSize(package);
+        size_t size = recordSize(dataSize);
+        if(newSchema) size += recordSize(schemaSize);
+        if(frontBuffer.size() + size > bufferSize) {
+          ++numDropped;
+          bufferCondition.wakeOne();
+          return;
+        }
+
+        if(newSchema) {
+          StreamState &state = streamStates[info.dataId];
+          state.stream = numStreams++;
+          state.types.resize(package.size());
+          state.names.resize(package.size());
+          for(size_t i=0; i<package.size(); ++i) {
+            state.types[i] = package[i].type;
+            state.names[i] = &package[i].getName();
+          }
+          appendSchemaRecord(&frontBuffer, state.stream, time, schemaSize,
+                             info, package);
+          it = streamStates.find(info.dataId);
+        }
+        appendDataRecord(&frontBuffer, it->second.stream, time, dataSize,
+                         package);
+        ++numRecords;
+        if(frontBuffer.size() > bufferSize / 2) {
+          bufferCondition.wakeOne();
+        }
+      }
+
+      void DataBrokerRecorder::run() {
+        MutexLocker locker(&bufferMutex);
+        bool done = false;
+
+        while(!done) {
+          if(!stop && frontBuffer.size() <= bufferSize / 2) {
+            bufferCondition.wait(&bufferMutex, RECORD_FLUSH_PERIOD);
+          }
+          frontBuffer.swap(backBuffer);
+          done = stop;
+          locker.unlock();
+          writeBuffer();
+          locker.relock();
+        }
+        locker.unlock();
+        writeIndex();
+      }
+
+      void DataBrokerRecorder::writeBuffer() {
+        RecordHeader header;
+        size_t position = 0;
+
+        // collect the file offsets of the schemas and the index entries
+        while(position < backBuffer.size()) {
+          memcpy(&header, &backBuffer[position], sizeof(header));
+          if(header.stream & RECORD_SCHEMA_FLAG) {
+            schemaOffsets.push_back(fileOffset + position);
+          } else if(numDataWritten++ % RECORD_INDEX_INTERVAL == 0) {
+            RecordIndexEntry entry = {header.time, fileOffset + position};
+            index.push_back(entry);
+          }
+          position += recordSize(header.size);
+        }
+        if(!backBuffer.empty() &&
+           fwrite(&backBuffer[0], backBuffer.size(), 1, file) != 1) {
+          fprintf(stderr, "DataBrokerRecorder: error writing the log\n");
+        }
+        fileOffset += backBuffer.size();
+        backBuffer.clear();
+      }
+
+      void DataBrokerRecorder::writeIndex() {
+        RecordTrailer trailer;
+        trailer.indexOffset = fileOffset;
+        trailer.numStreams = schemaOffsets.size();
+        trailer.numEntries = index.size();
+        strncpy(trailer.magic, RECORD_INDEX_MAGIC, sizeof(trailer.magic));
+        if(!schemaOffsets.empty()) {
+          fwrite(&schemaOffsets[0], sizeof(uint64_t), schemaOffsets.size(),
+                 file);
+        }
+        if(!index.empty()) {
+          fwrite(&index[0], sizeof(RecordIndexEntry), index.size(), file);
+        }
+        fwrite(&trailer, sizeof(trailer), 1, file);
+      }
+
+    } // end of namespace data_broker_recorder
+  } // end of namespace plugins
+} // end of namespace mars
@@ -0,0 +1,136 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file DataBrokerRecorder.h
+ * \brief "DataBrokerRecorder" writes DataBroker streams into a RecordLog.
+ */
+
+#ifndef DATA_BROKER_RECORDER_H
+#define DATA_BROKER_RECORDER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "DataBrokerRecorder.h"
+#endif
+
+#include "RecordLog.h"
+
+#include <mars/data_broker/ReceiverInterface.h>
+#include <mars/utils/Thread.h>
+#include <mars/utils/Mutex.h>
+#include <mars/utils/WaitCondition.h>
+
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace mars {
+
+  namespace data_broker {
+    class DataBrokerInterface;
+  }
+
+  namespace plugins {
+    namespace data_broker_recorder {
+
+      /**
+       * Records every DataPackage of the matching streams. The recorder
+       * registers as sync receiver, thus no package is lost by coalescing.
+       * The receiveData call only serializes the package into a bounded
+       * buffer. A separate thread swaps the full buffer with an empty one
+       * and writes it to the file, so the pushing threads never wait for
+       * the disk. If the buffer is full the record is dropped and counted.
+       */
+      class DataBrokerRecorder : public data_broker::ReceiverInterface,
+                                 public utils::Thread {
+
+      public:
+        DataBrokerRecorder(data_broker::DataBrokerInterface *dataBroker);
+        ~DataBrokerRecorder();
+
+        /**
+         * \brief Starts recording into \a filename.
+         * \param patterns "groupName/dataName" patterns of the streams to
+         *                 record, split at the first '/'. Both parts may
+         *                 contain '*' as wildcard.
+         * \param bufferSize maximum bytes buffered before records are
+         *                   dropped
+         */
+        bool startRecording(const std::string &filename,
+                            const std::vector<std::string> &patterns,
+                            size_t bufferSize);
+        void stopRecording();
+        bool isRecording() const;
+        /// Registers the streams created since the last call.
+        void updateStreams();
+
+        unsigned long getNumRecords() const {return numRecords;}
+        unsigned long getNumDropped() const {return numDropped;}
+
+        virtual void receiveData(const data_broker::DataInfo &info,
+                                 const data_broker::DataPackage &package,
+                                 int callbackParam);
+
+      protected:
+        void run();
+
+      private:
+        struct StreamState {
+          uint32_t stream;
+          std::vector<data_broker::DataType> types;
+          std::vector<const std::string*> names;
+        };
+
+        data_broker::DataBrokerInterface *dataBroker;
+        // guards the start and stop of a recording against updateStreams
+        mutable utils::Mutex recordMutex;
+        std::vector<std::pair<std::string, std::string> > patterns;
+        std::set<std::pair<std::string, std::string> > registered;
+        std::map<unsigned long, StreamState> streamStates;
+        uint32_t numStreams;
+
+        utils::Mutex bufferMutex;
+        utils::WaitCondition bufferCondition;
+        std::vector<char> frontBuffer, backBuffer;
+        size_t bufferSize;
+        bool stop;
+        long long startTime;
+        unsigned long numRecords, numDropped;
+
+        // only used by the writing thread while a recording runs
+        FILE *file;
+        uint64_t fileOffset;
+        unsigned long numDataWritten;
+        std::vector<uint64_t> schemaOffsets;
+        std::vector<RecordIndexEntry> index;
+
+        bool matchStream(const data_broker::DataInfo &info) const;
+        void registerStreams();
+        void writeBuffer();
+        void writeIndex();
+      };
+
+    } // end of namespace data_broker_recorder
+  } // end of namespace plugins
+} // end of namespace mars
+
+#endif // DATA_BROKER_RECORDER_H
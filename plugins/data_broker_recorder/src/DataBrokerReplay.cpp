@@ -0,0 +1,115 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file DataBrokerReplay.cpp
+ * \brief "DataBrokerReplay" pushes the streams of a RecordLog back into
+ *        the DataBroker.
+ */
+
+#include "DataBrokerReplay.h"
+
+#include <mars/data_broker/DataBrokerInterface.h>
+#include <mars/utils/misc.h>
+
+#include <chrono>
+
+// maximal milliseconds to sleep before checking for a stop request
+#define REPLAY_MAX_SLEEP 10
+
+namespace mars {
+  namespace plugins {
+    namespace data_broker_recorder {
+
+      using namespace mars::data_broker;
+      using namespace mars::utils;
+
+      static long long getSteadyTime() {
+        using namespace std::chrono;
+        return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+      }
+
+      DataBrokerReplay::DataBrokerReplay(DataBrokerInterface *dataBroker)
+        : dataBroker(dataBroker), speed(1.0), startTime(0), stop(false) {
+      }
+
+      DataBrokerReplay::~DataBrokerReplay() {
+        stopReplay();
+      }
+
+      bool DataBrokerReplay::startReplay(const std::string &filename,
+                                         const std::string &groupPrefix,
+                                         double speed, double startTime) {
+        stopReplay();
+        if(!reader.open(filename)) return false;
+
+        this->groupPrefix = groupPrefix;
+        this->speed = speed;
+        this->startTime = (int64_t)(startTime * 1000000.0);
+        streams.clear();
+        streams.resize(reader.getNumStreams());
+        reader.seek(this->startTime);
+        stop = false;
+        start();
+        return true;
+      }
+
+      void DataBrokerReplay::stopReplay() {
+        if(!reader.isOpen()) return;
+        stop = true;
+        wait();
+        reader.close();
+      }
+
+      void DataBrokerReplay::run() {
+        RecordEntry entry;
+        long long start = getSteadyTime();
+
+        while(!stop && reader.next(&entry)) {
+          if(speed > 0.0) {
+            long long due = start + (long long)((entry.time - startTime) / speed);
+            long long now;
+            while(!stop && (now = getSteadyTime()) < due) {
+              long long ms = (due - now) / 1000;
+              msleep(ms < REPLAY_MAX_SLEEP ? (ms > 0 ? ms : 1) : REPLAY_MAX_SLEEP);
+            }
+          }
+
+          ReplayStream &stream = streams[entry.stream];
+          if(!stream.valid) {
+            reader.createPackage(entry.stream, &stream.package);
+            stream.valid = true;
+          }
+          if(!reader.decode(entry, &stream.package)) continue;
+
+          if(stream.dataId) {
+            dataBroker->pushData(stream.dataId, stream.package);
+          } else {
+            const RecordStream &info = reader.getStream(entry.stream);
+            stream.dataId = dataBroker->pushData(groupPrefix + info.groupName,
+                                                 info.dataName, stream.package,
+                                                 NULL, DATA_PACKAGE_READ_FLAG);
+          }
+        }
+      }
+
+    } // end of namespace data_broker_recorder
+  } // end of namespace plugins
+} // end of namespace mars
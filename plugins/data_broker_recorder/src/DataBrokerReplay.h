@@ -0,0 +1,97 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file DataBrokerReplay.h
+ * \brief "DataBrokerReplay" pushes the streams of a RecordLog back into
+ *        the DataBroker.
+ */
+
+#ifndef DATA_BROKER_REPLAY_H
+#define DATA_BROKER_REPLAY_H
+
+#ifdef _PRINT_HEADER_
+  #warning "DataBrokerReplay.h"
+#endif
+
+#include "RecordLog.h"
+
+#include <mars/utils/Thread.h>
+
+#include <string>
+#include <vector>
+
+namespace mars {
+
+  namespace data_broker {
+    class DataBrokerInterface;
+  }
+
+  namespace plugins {
+    namespace data_broker_recorder {
+
+      /**
+       * Replays a log from its own thread. Each recorded stream is pushed
+       * as "<prefix><groupName>" / "<dataName>", so the replayed data can
+       * be compared to a live simulation. With a speed of 0 the records
+       * are pushed as fast as possible, otherwise in the recorded timing
+       * scaled by the speed.
+       */
+      class DataBrokerReplay : public utils::Thread {
+
+      public:
+        DataBrokerReplay(data_broker::DataBrokerInterface *dataBroker);
+        ~DataBrokerReplay();
+
+        /**
+         * \brief Starts replaying \a filename.
+         * \param startTime seconds of the log to skip
+         */
+        bool startReplay(const std::string &filename,
+                         const std::string &groupPrefix,
+                         double speed, double startTime=0.0);
+        void stopReplay();
+        bool isReplaying() const {return reader.isOpen() && !isFinished();}
+
+      protected:
+        void run();
+
+      private:
+        struct ReplayStream {
+          ReplayStream() : dataId(0), valid(false) {}
+          unsigned long dataId;
+          bool valid;
+          data_broker::DataPackage package;
+        };
+
+        data_broker::DataBrokerInterface *dataBroker;
+        RecordLogReader reader;
+        std::vector<ReplayStream> streams;
+        std::string groupPrefix;
+        double speed;
+        int64_t startTime;
+        bool stop;
+      };
+
+    } // end of namespace data_broker_recorder
+  } // end of namespace plugins
+} // end of namespace mars
+
+#endif // DATA_BROKER_REPLAY_H
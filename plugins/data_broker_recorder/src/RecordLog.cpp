@@ -0,0 +1,408 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file RecordLog.cpp
+ * \brief Serialization of the DataBrokerRecorder log and RecordLogReader.
+ */
+
+#include "RecordLog.h"
+
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace mars {
+  namespace plugins {
+    namespace data_broker_recorder {
+
+      using namespace mars::data_broker;
+
+      // bytes of the raw value of an item, 0 for strings
+      static size_t getValueSize(DataType type) {
+        switch(type) {
+        case INT_TYPE: return sizeof(int32_t);
+        case UINT_TYPE: return sizeof(uint32_t);
+        case LONG_TYPE: return sizeof(int64_t);
+        case ULONG_TYPE: return sizeof(uint64_t);
+        case FLOAT_TYPE: return sizeof(float);
+        case DOUBLE_TYPE: return sizeof(double);
+        case BOOL_TYPE: return sizeof(uint8_t);
+        default: return 0;
+        }
+      }
+
+      template <typename T>
+      static inline void put(char **dst, T val) {
+        memcpy(*dst, &val, sizeof(T));
+        *dst += sizeof(T);
+      }
+
+      static inline void putString(char **dst, const std::string &s,
+                                   bool shortLength) {
+        if(shortLength) put(dst, (uint16_t)s.size());
+        else put(dst, (uint32_t)s.size());
+        memcpy(*dst, s.data(), s.size());
+        *dst += s.size();
+      }
+
+      // returns the start of the payload of a new record in buffer
+      static char* appendRecord(std::vector<char> *buffer, uint32_t stream,
+                                int64_t time, size_t payloadSize) {
+        size_t offset = buffer->size();
+        buffer->resize(offset + recordSize(payloadSize), 0);
+        RecordHeader header;
+        header.size = payloadSize;
+        header.stream = stream;
+        header.time = time;
+        memcpy(&(*buffer)[offset], &header, sizeof(header));
+        return &(*buffer)[offset + sizeof(header)];
+      }
+
+      size_t getSchemaPayloadSize(const DataInfo &info,
+                                  const DataPackage &package) {
+        size_t size = sizeof(uint32_t) + 2*sizeof(uint16_t);
+        size += info.groupName.size() + info.dataName.size();
+        for(size_t i=0; i<package.size(); ++i) {
+          size += sizeof(uint8_t) + sizeof(uint16_t);
+          size += package[i].getName().size();
+        }
+        return size;
+      }
+
+      size_t getDataPayloadSize(const DataPackage &package) {
+        size_t size = 0;
+        for(size_t i=0; i<package.size(); ++i) {
+          if(package[i].type == STRING_TYPE) {
+            size += sizeof(uint32_t) + package[i].s.size();
+          } else {
+            size += getValueSize(package[i].type);
+          }
+        }
+        return size;
+      }
+
+      void appendSchemaRecord(std::vector<char> *buffer, uint32_t stream,
+                              int64_t time, size_t payloadSize,
+                              const DataInfo &info,
+                              const DataPackage &package) {
+        char *dst = appendRecord(buffer, stream | RECORD_SCHEMA_FLAG, time,
+                                 payloadSize);
+        put(&dst, (uint32_t)package.size());
+        putString(&dst, info.groupName, true);
+        putString(&dst, info.dataName, true);
+        for(size_t i=0; i<package.size(); ++i) {
+          put(&dst, (uint8_t)package[i].type);
+          putString(&dst, package[i].getName(), true);
+        }
+      }
+
+      void appendDataRecord(std::vector<char> *buffer, uint32_t stream,
+                            int64_t time, size_t payloadSize,
+                            const DataPackage &package) {
+        char *dst = appendRecord(buffer, stream, time, payloadSize);
+        for(size_t i=0; i<package.size(); ++i) {
+          const DataItem &item = package[i];
+          switch(item.type) {
+          case INT_TYPE: put(&dst, (int32_t)item.i); break;
+          case UINT_TYPE: put(&dst, (uint32_t)item.ui); break;
+          case LONG_TYPE: put(&dst, (int64_t)item.l); break;
+          case ULONG_TYPE: put(&dst, (uint64_t)item.ul); break;
+          case FLOAT_TYPE: put(&dst, item.f); break;
+          case DOUBLE_TYPE: put(&dst, item.d); break;
+          case BOOL_TYPE: put(&dst, (uint8_t)item.b); break;
+          case STRING_TYPE: putString(&dst, item.s, false); break;
+          default: break;
+          }
+        }
+      }
+
+
+      RecordLogReader::RecordLogReader() : data(0), dataSize(0), position(0),
+                                           endTime(0) {
+      }
+
+      RecordLogReader::~RecordLogReader() {
+        close();
+      }
+
+      bool RecordLogReader::open(const std::string &filename) {
+        close();
+#ifndef WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if(fd == -1) return false;
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(RecordFileHeader)) {
+          ::close(fd);
+          return false;
+        }
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(map == MAP_FAILED) return false;
+        data = (const char*)map;
+        dataSize = st.st_size;
+#else
+        FILE *file = fopen(filename.c_str(), "rb");
+        if(!file) return false;
+        fseek(file, 0, SEEK_END);
+        dataSize = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        char *buffer = new char[dataSize];
+        if(fread(buffer, 1, dataSize, file) != dataSize) dataSize = 0;
+        fclose(file);
+        data = buffer;
+#endif
+        RecordFileHeader header;
+        if(dataSize >= sizeof(header)) {
+          memcpy(&header, data, sizeof(header));
+        }
+        if(dataSize < sizeof(header) ||
+           strncmp(header.magic, RECORD_LOG_MAGIC, sizeof(header.magic)) ||
+           header.version != RECORD_LOG_VERSION) {
+          fprintf(stderr, "RecordLogReader: %s is no record log of version %d\n",
+                  filename.c_str(), RECORD_LOG_VERSION);
+          close();
+          return false;
+        }
+        if(!readIndex()) {
+          // the recording was not closed cleanly
+          scanRecords();
+        }
+        position = sizeof(RecordFileHeader);
+        return true;
+      }
+
+      void RecordLogReader::close() {
+        if(data) {
+#ifndef WIN32
+          munmap((void*)data, dataSize);
+#else
+          delete[] data;
+#endif
+        }
+        data = 0;
+        dataSize = position = 0;
+        endTime = 0;
+        streams.clear();
+        index.clear();
+      }
+
+      bool RecordLogReader::readIndex() {
+        RecordTrailer trailer;
+        if(dataSize < sizeof(RecordFileHeader) + sizeof(trailer)) return false;
+        memcpy(&trailer, data + dataSize - sizeof(trailer), sizeof(trailer));
+        if(strncmp(trailer.magic, RECORD_INDEX_MAGIC, sizeof(trailer.magic))) {
+          return false;
+        }
+        size_t indexSize = trailer.numStreams*sizeof(uint64_t) +
+          trailer.numEntries*sizeof(RecordIndexEntry);
+        if(trailer.indexOffset + indexSize + sizeof(trailer) != dataSize) {
+          return false;
+        }
+        const char *src = data + trailer.indexOffset;
+        for(uint32_t i=0; i<trailer.numStreams; ++i) {
+          uint64_t offset;
+          RecordHeader header;
+          memcpy(&offset, src, sizeof(offset));
+          src += sizeof(offset);
+          if(offset + sizeof(header) > trailer.indexOffset) return false;
+          memcpy(&header, data + offset, sizeof(header));
+          if(!readSchema(header, data + offset + sizeof(header))) return false;
+        }
+        index.resize(trailer.numEntries);
+        if(!index.empty()) {
+          memcpy(&index[0], src, trailer.numEntries*sizeof(RecordIndexEntry));
+          endTime = index.back().time;
+        }
+        // the index entries are not part of the records
+        dataSize = trailer.indexOffset;
+        // the last data record is not necessarily indexed
+        seek(endTime);
+        RecordEntry entry;
+        while(next(&entry)) endTime = entry.time;
+        return true;
+      }
+
+      void RecordLogReader::scanRecords() {
+        RecordHeader header;
+        size_t offset = sizeof(RecordFileHeader);
+        unsigned long numRecords = 0;
+        while(offset + sizeof(header) <= dataSize) {
+          memcpy(&header, data + offset, sizeof(header));
+          size_t size = recordSize(header.size);
+          if(offset + size > dataSize) break;
+          if(header.stream & RECORD_SCHEMA_FLAG) {
+            if(!readSchema(header, data + offset + sizeof(header))) break;
+          } else {
+            if(header.stream >= streams.size()) break;
+            if(numRecords++ % RECORD_INDEX_INTERVAL == 0) {
+              RecordIndexEntry entry = {header.time, offset};
+              index.push_back(entry);
+            }
+            endTime = header.time;
+          }
+          offset += size;
+        }
+        // ignore a truncated record at the end
+        dataSize = offset;
+      }
+
+      bool RecordLogReader::readSchema(const RecordHeader &header,
+                                       const char *payload) {
+        const char *end = payload + header.size;
+        uint32_t numItems;
+        uint16_t length;
+        uint8_t type;
+        RecordStream stream;
+
+        if((header.stream & ~RECORD_SCHEMA_FLAG) != streams.size()) {
+          return false;
+        }
+        if(payload + sizeof(numItems) > end) return false;
+        memcpy(&numItems, payload, sizeof(numItems));
+        payload += sizeof(numItems);
+        for(int i=0; i<2; ++i) {
+          if(payload + sizeof(length) > end) return false;
+          memcpy(&length, payload, sizeof(length));
+          payload += sizeof(length);
+          if(payload + length > end) return false;
+          (i ? stream.dataName : stream.groupName).assign(payload, length);
+          payload += length;
+        }
+        for(uint32_t i=0; i<numItems; ++i) {
+          if(payload + sizeof(type) + sizeof(length) > end) return false;
+          memcpy(&type, payload, sizeof(type));
+          memcpy(&length, payload + sizeof(type), sizeof(length));
+          payload += sizeof(type) + sizeof(length);
+          if(payload + length > end) return false;
+          stream.types.push_back((DataType)type);
+          stream.names.push_back(std::string(payload, length));
+          payload += length;
+        }
+        streams.push_back(stream);
+        return true;
+      }
+
+      static bool indexBefore(const RecordIndexEntry &entry, int64_t time) {
+        return entry.time < time;
+      }
+
+      void RecordLogReader::seek(int64_t time) {
+        std::vector<RecordIndexEntry>::iterator it;
+        RecordEntry entry;
+        size_t last;
+
+        position = sizeof(RecordFileHeader);
+        it = std::lower_bound(index.begin(), index.end(), time, indexBefore);
+        if(it != index.begin()) {
+          position = (it-1)->offset;
+        }
+        // skip the records before time within the index interval
+        do {
+          last = position;
+        } while(next(&entry) && entry.time < time);
+        position = last;
+      }
+
+      bool RecordLogReader::next(RecordEntry *entry) {
+        RecordHeader header;
+        while(position + sizeof(header) <= dataSize) {
+          memcpy(&header, data + position, sizeof(header));
+          size_t offset = position;
+          position += recordSize(header.size);
+          if(header.stream & RECORD_SCHEMA_FLAG) continue;
+          entry->stream = header.stream;
+          entry->time = header.time;
+          entry->payload = data + offset + sizeof(header);
+          entry->size = header.size;
+          return true;
+        }
+        return false;
+      }
+
+      void RecordLogReader::createPackage(uint32_t stream,
+                                          DataPackage *package) const {
+        const RecordStream &s = streams[stream];
+        package->clear();
+        for(size_t i=0; i<s.types.size(); ++i) {
+          switch(s.types[i]) {
+          case INT_TYPE: package->add(s.names[i], (int)0); break;
+          case UINT_TYPE: package->add(s.names[i], (unsigned int)0); break;
+          case LONG_TYPE: package->add(s.names[i], (long)0); break;
+          case ULONG_TYPE: package->add(s.names[i], (unsigned long)0); break;
+          case FLOAT_TYPE: package->add(s.names[i], 0.0f); break;
+          case DOUBLE_TYPE: package->add(s.names[i], 0.0); break;
+          case BOOL_TYPE: package->add(s.names[i], false); break;
+          case STRING_TYPE: package->add(s.names[i], std::string()); break;
+          default: package->add(s.names[i], (int)0); break;
+          }
+        }
+      }
+
+      template <typename T>
+      static inline bool get(const char **src, const char *end, T *val) {
+        if(*src + sizeof(T) > end) return false;
+        memcpy(val, *src, sizeof(T));
+        *src += sizeof(T);
+        return true;
+      }
+
+      bool RecordLogReader::decode(const RecordEntry &entry,
+                                   DataPackage *package) const {
+        const RecordStream &s = streams[entry.stream];
+        const char *src = entry.payload, *end = entry.payload + entry.size;
+        int32_t i32; uint32_t u32; int64_t i64; uint64_t u64;
+        float f; double d; uint8_t b;
+        bool ok = true;
+
+        if(package->size() != s.types.size()) return false;
+        for(size_t i=0; ok && i<s.types.size(); ++i) {
+          DataItem &item = (*package)[i];
+          switch(s.types[i]) {
+          case INT_TYPE: ok = get(&src, end, &i32); item.i = i32; break;
+          case UINT_TYPE: ok = get(&src, end, &u32); item.ui = u32; break;
+          case LONG_TYPE: ok = get(&src, end, &i64); item.l = i64; break;
+          case ULONG_TYPE: ok = get(&src, end, &u64); item.ul = u64; break;
+          case FLOAT_TYPE: ok = get(&src, end, &f); item.f = f; break;
+          case DOUBLE_TYPE: ok = get(&src, end, &d); item.d = d; break;
+          case BOOL_TYPE: ok = get(&src, end, &b); item.b = b; break;
+          case STRING_TYPE:
+            ok = get(&src, end, &u32) && src + u32 <= end;
+            if(ok) {
+              item.s.assign(src, u32);
+              src += u32;
+            }
+            break;
+          default: break;
+          }
+        }
+        return ok;
+      }
+
+    } // end of namespace data_broker_recorder
+  } // end of namespace plugins
+} // end of namespace mars
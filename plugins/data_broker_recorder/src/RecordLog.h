@@ -0,0 +1,174 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file RecordLog.h
+ * \brief The binary log format of the DataBrokerRecorder and the reader
+ *        used by the DataBrokerReplay and offline tools.
+ *
+ * A log starts with a RecordFileHeader followed by records. Each record
+ * is a RecordHeader, \c size bytes of payload and padding to 8 bytes.
+ * A schema record (stream with RECORD_SCHEMA_FLAG) holds the group and
+ * data name and the item names and types of a stream once. The data
+ * records of the stream only hold the raw values in schema order:
+ * int32, uint32, int64 (long), uint64 (unsigned long), float, double,
+ * uint8 (bool) and strings as uint32 length plus bytes.
+ *
+ * A cleanly closed log ends with an index of the schema records and of
+ * every RECORD_INDEX_INTERVAL-th data record followed by a RecordTrailer.
+ * Without the trailer the reader rebuilds the index by scanning the log.
+ */
+
+#ifndef DATA_BROKER_RECORDER_RECORD_LOG_H
+#define DATA_BROKER_RECORDER_RECORD_LOG_H
+
+#ifdef _PRINT_HEADER_
+  #warning "RecordLog.h"
+#endif
+
+#include <mars/data_broker/DataInfo.h>
+#include <mars/data_broker/DataPackage.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define RECORD_LOG_MAGIC "MARSREC"
+#define RECORD_INDEX_MAGIC "MARSIDX"
+#define RECORD_LOG_VERSION 1
+#define RECORD_SCHEMA_FLAG 0x80000000u
+#define RECORD_INDEX_INTERVAL 1024
+
+namespace mars {
+  namespace plugins {
+    namespace data_broker_recorder {
+
+      struct RecordFileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+      };
+
+      struct RecordHeader {
+        uint32_t size; ///< payload size without the padding
+        uint32_t stream; ///< stream index, or'ed with RECORD_SCHEMA_FLAG
+        int64_t time; ///< microseconds since the start of the recording
+      };
+
+      struct RecordIndexEntry {
+        int64_t time;
+        uint64_t offset; ///< file offset of the RecordHeader
+      };
+
+      struct RecordTrailer {
+        uint64_t indexOffset;
+        uint32_t numStreams;
+        uint32_t numEntries;
+        char magic[8];
+      };
+
+      /// The schema of a recorded stream.
+      struct RecordStream {
+        std::string groupName;
+        std::string dataName;
+        std::vector<std::string> names;
+        std::vector<data_broker::DataType> types;
+      };
+
+      /// A data record as returned by RecordLogReader::next.
+      struct RecordEntry {
+        uint32_t stream;
+        int64_t time;
+        const char *payload;
+        uint32_t size;
+      };
+
+      /// Size of a record including header and padding.
+      inline size_t recordSize(size_t payloadSize) {
+        return sizeof(RecordHeader) + ((payloadSize + 7) & ~(size_t)7);
+      }
+
+      size_t getSchemaPayloadSize(const data_broker::DataInfo &info,
+                                  const data_broker::DataPackage &package);
+      size_t getDataPayloadSize(const data_broker::DataPackage &package);
+      /**
+       * Append a record to \a buffer. The payload size has to be given as
+       * returned by getSchemaPayloadSize or getDataPayloadSize.
+       */
+      void appendSchemaRecord(std::vector<char> *buffer, uint32_t stream,
+                              int64_t time, size_t payloadSize,
+                              const data_broker::DataInfo &info,
+                              const data_broker::DataPackage &package);
+      void appendDataRecord(std::vector<char> *buffer, uint32_t stream,
+                            int64_t time, size_t payloadSize,
+                            const data_broker::DataPackage &package);
+
+      /**
+       * Reads a log through a read only memory mapping of the file.
+       */
+      class RecordLogReader {
+      public:
+        RecordLogReader();
+        ~RecordLogReader();
+
+        bool open(const std::string &filename);
+        void close();
+        bool isOpen() const {return data != 0;}
+
+        size_t getNumStreams() const {return streams.size();}
+        const RecordStream& getStream(size_t stream) const {
+          return streams[stream];
+        }
+        /// time of the last data record in microseconds
+        int64_t getEndTime() const {return endTime;}
+
+        /// Continue reading at the first data record at or after \a time.
+        void seek(int64_t time);
+        /// Read the next data record. Returns false at the end of the log.
+        bool next(RecordEntry *entry);
+
+        /// Creates a DataPackage with the items of \a stream.
+        void createPackage(uint32_t stream,
+                           data_broker::DataPackage *package) const;
+        /**
+         * Writes the values of \a entry into \a package, which has to be
+         * created with createPackage for the stream of the entry.
+         */
+        bool decode(const RecordEntry &entry,
+                    data_broker::DataPackage *package) const;
+
+      private:
+        const char *data;
+        size_t dataSize;
+        size_t position;
+        int64_t endTime;
+        std::vector<RecordStream> streams;
+        std::vector<RecordIndexEntry> index;
+
+        bool readIndex();
+        void scanRecords();
+        bool readSchema(const RecordHeader &header, const char *payload);
+      };
+
+    } // end of namespace data_broker_recorder
+  } // end of namespace plugins
+} // end of namespace mars
+
+#endif // DATA_BROKER_RECORDER_RECORD_LOG_H
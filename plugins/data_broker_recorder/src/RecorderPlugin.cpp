@@ -0,0 +1,165 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file RecorderPlugin.cpp
+ * \brief Plugin to record DataBroker streams into a binary log and to
+ *        replay them.
+ */
+
+#include "RecorderPlugin.h"
+
+#include <mars/data_broker/DataBrokerInterface.h>
+#include <mars/utils/misc.h>
+
+// milliseconds of simulation time between checks for new streams
+#define STREAM_UPDATE_PERIOD 1000.0
+
+namespace mars {
+  namespace plugins {
+    namespace data_broker_recorder {
+
+      using namespace mars::utils;
+      using namespace mars::interfaces;
+
+      RecorderPlugin::RecorderPlugin(lib_manager::LibManager *theManager)
+        : MarsPluginTemplate(theManager, "DataBrokerRecorder"),
+          recorder(0), replay(0), streamUpdateTime(0.0) {
+      }
+
+      void RecorderPlugin::init() {
+        recorder = new DataBrokerRecorder(control->dataBroker);
+        replay = new DataBrokerReplay(control->dataBroker);
+
+        cfgRecordFile = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                          "record file",
+                                                          std::string("record.mrec"),
+                                                          this);
+        cfgStreams = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                       "record streams",
+                                                       std::string("mars_sim/*"),
+                                                       this);
+        cfgBufferSize = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                          "buffer size",
+                                                          8192, this);
+        cfgReplayFile = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                          "replay file",
+                                                          std::string("record.mrec"),
+                                                          this);
+        cfgSpeed = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                     "replay speed",
+                                                     1.0, this);
+        cfgReplayStart = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                           "replay start",
+                                                           0.0, this);
+        cfgPrefix = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                      "replay prefix",
+                                                      std::string("replay/"),
+                                                      this);
+        cfgRecord = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                      "record", false, this);
+        cfgReplay = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                      "replay", false, this);
+        if(cfgRecord.bValue) startRecording();
+        if(cfgReplay.bValue) startReplay();
+      }
+
+      void RecorderPlugin::reset() {
+      }
+
+      RecorderPlugin::~RecorderPlugin() {
+        if(control->cfg) {
+          control->cfg->unregisterFromParam(cfgRecord.paramId, this);
+          control->cfg->unregisterFromParam(cfgRecordFile.paramId, this);
+          control->cfg->unregisterFromParam(cfgStreams.paramId, this);
+          control->cfg->unregisterFromParam(cfgBufferSize.paramId, this);
+          control->cfg->unregisterFromParam(cfgReplay.paramId, this);
+          control->cfg->unregisterFromParam(cfgReplayFile.paramId, this);
+          control->cfg->unregisterFromParam(cfgSpeed.paramId, this);
+          control->cfg->unregisterFromParam(cfgReplayStart.paramId, this);
+          control->cfg->unregisterFromParam(cfgPrefix.paramId, this);
+        }
+        delete replay;
+        delete recorder;
+      }
+
+      void RecorderPlugin::update(sReal time_ms) {
+        // streams might be created at any time, e.g. by loading a scene
+        streamUpdateTime += time_ms;
+        if(streamUpdateTime >= STREAM_UPDATE_PERIOD) {
+          streamUpdateTime = 0.0;
+          recorder->updateStreams();
+        }
+      }
+
+      void RecorderPlugin::startRecording() {
+        std::vector<std::string> patterns = explodeString(';', cfgStreams.sValue);
+        recorder->startRecording(cfgRecordFile.sValue, patterns,
+                                 (size_t)cfgBufferSize.iValue * 1024);
+      }
+
+      void RecorderPlugin::startReplay() {
+        if(!replay->startReplay(cfgReplayFile.sValue, cfgPrefix.sValue,
+                                cfgSpeed.dValue, cfgReplayStart.dValue)) {
+          fprintf(stderr, "DataBrokerRecorder: could not replay %s\n",
+                  cfgReplayFile.sValue.c_str());
+        }
+      }
+
+      void RecorderPlugin::cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property) {
+        if(_property.paramId == cfgRecord.paramId) {
+          cfgRecord.bValue = _property.bValue;
+          if(cfgRecord.bValue) startRecording();
+          else recorder->stopRecording();
+        }
+        else if(_property.paramId == cfgReplay.paramId) {
+          cfgReplay.bValue = _property.bValue;
+          if(cfgReplay.bValue) startReplay();
+          else replay->stopReplay();
+        }
+        else if(_property.paramId == cfgRecordFile.paramId) {
+          cfgRecordFile.sValue = _property.sValue;
+        }
+        else if(_property.paramId == cfgStreams.paramId) {
+          cfgStreams.sValue = _property.sValue;
+        }
+        else if(_property.paramId == cfgBufferSize.paramId) {
+          cfgBufferSize.iValue = _property.iValue;
+        }
+        else if(_property.paramId == cfgReplayFile.paramId) {
+          cfgReplayFile.sValue = _property.sValue;
+        }
+        else if(_property.paramId == cfgSpeed.paramId) {
+          cfgSpeed.dValue = _property.dValue;
+        }
+        else if(_property.paramId == cfgReplayStart.paramId) {
+          cfgReplayStart.dValue = _property.dValue;
+        }
+        else if(_property.paramId == cfgPrefix.paramId) {
+          cfgPrefix.sValue = _property.sValue;
+        }
+      }
+
+    } // end of namespace data_broker_recorder
+  } // end of namespace plugins
+} // end of namespace mars
+
+DESTROY_LIB(mars::plugins::data_broker_recorder::RecorderPlugin);
+CREATE_LIB(mars::plugins::data_broker_recorder::RecorderPlugin);
@@ -0,0 +1,101 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file RecorderPlugin.h
+ * \brief Plugin to record DataBroker streams into a binary log and to
+ *        replay them.
+ */
+
+#ifndef MARS_PLUGINS_DATA_BROKER_RECORDER_H
+#define MARS_PLUGINS_DATA_BROKER_RECORDER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "RecorderPlugin.h"
+#endif
+
+#include "DataBrokerRecorder.h"
+#include "DataBrokerReplay.h"
+
+#include <mars/interfaces/sim/MarsPluginTemplate.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
+#include <mars/interfaces/MARSDefs.h>
+
+#include <string>
+
+namespace mars {
+
+  namespace lib_manager {
+    class LibManager;
+  }
+
+  namespace plugins {
+    namespace data_broker_recorder {
+
+      /**
+       * Controls a DataBrokerRecorder and a DataBrokerReplay with the
+       * properties of the cfg group "DataBrokerRecorder":
+       *   - "record": starts and stops the recording
+       *   - "record file", "record streams": the log and the ';' separated
+       *     "groupName/dataName" patterns to record
+       *   - "buffer size": kilobytes buffered before records are dropped
+       *   - "replay": starts and stops the replay of "replay file"
+       *   - "replay speed", "replay start", "replay prefix": see
+       *     DataBrokerReplay::startReplay
+       */
+      class RecorderPlugin: public mars::interfaces::MarsPluginTemplate,
+                            public mars::cfg_manager::CFGClient {
+
+      public:
+        RecorderPlugin(lib_manager::LibManager *theManager);
+        ~RecorderPlugin();
+
+        // LibInterface methods
+        int getLibVersion() const { return 1; }
+        const std::string getLibName() const { return std::string("data_broker_recorder"); }
+        CREATE_MODULE_INFO();
+
+        // MarsPlugin methods
+        void init();
+        void reset();
+        void update(mars::interfaces::sReal time_ms);
+
+        // CFGClient methods
+        virtual void cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property);
+
+      private:
+        DataBrokerRecorder *recorder;
+        DataBrokerReplay *replay;
+        cfg_manager::cfgPropertyStruct cfgRecord, cfgRecordFile, cfgStreams;
+        cfg_manager::cfgPropertyStruct cfgBufferSize;
+        cfg_manager::cfgPropertyStruct cfgReplay, cfgReplayFile, cfgSpeed;
+        cfg_manager::cfgPropertyStruct cfgReplayStart, cfgPrefix;
+        mars::interfaces::sReal streamUpdateTime;
+
+        void startRecording();
+        void startReplay();
+
+      }; // end of class definition RecorderPlugin
+
+    } // end of namespace data_broker_recorder
+  } // end of namespace plugins
+} // end of namespace mars
+
+#endif // MARS_PLUGINS_DATA_BROKER_RECORDER_H
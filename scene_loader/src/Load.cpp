@@ -37,9 +37,13 @@
 
 #include <mars/interfaces/sim/EntityManagerInterface.h>
 #include <mars/interfaces/sim/LoadSceneInterface.h>
+#include <mars/interfaces/sim/LoadCenter.h>
+#include <mars/interfaces/terrainStruct.h>
 #include <mars/utils/misc.h>
 #include <mars/interfaces/Logging.hpp>
 
+#include <cstring>
+
 //#define DEBUG_PARSE 1
 
 namespace mars {
@@ -50,7 +54,7 @@ namespace mars {
 
     Load::Load(std::string fileName, ControlCenter *c,
                std::string tmpPath_, const std::string &robotname) :
-      mFileName(fileName), mRobotName(robotname),
+      fromCache(false), mFileName(fileName), mRobotName(robotname),
       control(c), tmpPath(tmpPath_) {
     	mFileSuffix = utils::getFilenameSuffix(mFileName);
     }
@@ -58,8 +62,33 @@ namespace mars {
     unsigned int Load::load() {
 
       if(!prepareLoad()) return 0;
-      if(!parseScene()) return 0;
-      return loadScene();
+      if(!fromCache && !parseScene()) return 0;
+      if(!loadScene()) return 0;
+
+      if(!fromCache) {
+        SceneCache cache(mFileName);
+        SceneCacheData data = getCacheData();
+        data.info["tmpPath"] = tmpPath;
+        if(!cache.write(data)) {
+          LOG_DEBUG("Load: could not write scene cache: %s",
+                    cache.getCacheFile().c_str());
+        }
+      }
+      return 1;
+    }
+
+    SceneCacheData Load::getCacheData() {
+      SceneCacheData data;
+      data.lists.push_back(&materialList);
+      data.lists.push_back(&nodeList);
+      data.lists.push_back(&jointList);
+      data.lists.push_back(&motorList);
+      data.lists.push_back(&sensorList);
+      data.lists.push_back(&controllerList);
+      data.lists.push_back(&graphicList);
+      data.lists.push_back(&lightList);
+      data.bakedMeshes = &bakedMeshes;
+      return data;
     }
 
     unsigned int Load::prepareLoad() {
@@ -76,19 +105,31 @@ namespace mars {
         control->entities->addEntity(mRobotName);
       }
 
+      utils::removeFilenamePrefix(&filename);
+      utils::removeFilenameSuffix(&filename);
+
+      SceneCache cache(mFileName);
+      SceneCacheData data = getCacheData();
+      fromCache = cache.read(&data);
+      if(fromCache) {
+        LOG_INFO("Load: using scene cache: %s", cache.getCacheFile().c_str());
+        cacheTmpPath = data.info["tmpPath"].getString();
+      }
+
       // need to unzip into a temporary directory
       if (mFileSuffix == ".scn" || mFileSuffix == ".zip") {
-        if(unzip(tmpPath, mFileName) == 0)
-          return 0;
+        // the files of the last unzip can be reused with the cache
+        if(!fromCache || cacheTmpPath != tmpPath ||
+           !utils::pathExists(tmpPath + filename + ".scene")) {
+          if(unzip(tmpPath, mFileName) == 0)
+            return 0;
+        }
       }
       else {
         // can parse file without unzipping
         tmpPath = utils::getPathOfFile(mFileName);
       }
 
-      utils::removeFilenamePrefix(&filename);
-      utils::removeFilenameSuffix(&filename);
-
       mapIndex = control->loadCenter->getMappedSceneByName(mFileName);
       if (mapIndex == 0) {
         control->loadCenter->setMappedSceneName(mFileName);
@@ -270,7 +311,8 @@ namespace mars {
 
     unsigned int Load::loadScene() {
       for(unsigned int i=0; i<materialList.size(); ++i) if(!loadMaterial(materialList[i])) return 0;
-      for(unsigned int i=0; i<nodeList.size(); ++i) if(!loadNode(nodeList[i])) return 0;
+      preloadNodeFiles();
+      for(unsigned int i=0; i<nodeList.size(); ++i) if(!loadNode(nodeList[i], i)) return 0;
       for(unsigned int i=0; i<jointList.size(); ++i) if(!loadJoint(jointList[i])) return 0;
       for(unsigned int i=0; i<motorList.size(); ++i) if(!loadMotor(motorList[i])) return 0;
       for(unsigned int i=0; i<sensorList.size(); ++i) if(!loadSensor(sensorList[i])) return 0;
@@ -281,6 +323,35 @@ namespace mars {
       return 1;
     }
 
+    /**
+     * \brief Hands the meshes and heightmaps of all nodes to the load
+     * interfaces at once, so that they can be decoded in parallel before
+     * the nodes are added one by one.
+     */
+    void Load::preloadNodeFiles() {
+      std::vector<std::string> meshes, heightmaps;
+
+      if(!control->loadCenter) return;
+      for(unsigned int i=0; i<nodeList.size(); ++i) {
+        configmaps::ConfigMap config = nodeList[i];
+        NodeData node;
+        node.fromConfigMap(&config, tmpPath);
+        if(!node.filename.empty() && node.filename != "PRIMITIVE") {
+          meshes.push_back(node.filename);
+        }
+        if(node.terrain) {
+          heightmaps.push_back(node.terrain->srcname);
+          delete node.terrain;
+        }
+      }
+      if(control->loadCenter->loadMesh && !meshes.empty()) {
+        control->loadCenter->loadMesh->preloadMeshes(meshes);
+      }
+      if(control->loadCenter->loadHeightmap && !heightmaps.empty()) {
+        control->loadCenter->loadHeightmap->preloadHeightmaps(heightmaps);
+      }
+    }
+
     unsigned int Load::loadMaterial(configmaps::ConfigMap config) {
       MaterialData material;
       unsigned long id;
@@ -293,7 +364,8 @@ namespace mars {
       return valid;
     }
 
-    unsigned int Load::loadNode(configmaps::ConfigMap config) {
+    unsigned int Load::loadNode(configmaps::ConfigMap config,
+                                unsigned int listIndex) {
       NodeData node;
       config["mapIndex"] = mapIndex;
       int valid = node.fromConfigMap(&config, tmpPath, control->loadCenter);
@@ -314,12 +386,60 @@ namespace mars {
       if(node.groupID)
         node.groupID += groupIDOffset;
 
+      // a baked mesh saves the NodeManager from reading the mesh file
+      std::map<unsigned int, BakedMesh>::iterator meshIt;
+      meshIt = bakedMeshes.find(listIndex);
+      if(fromCache && meshIt != bakedMeshes.end() &&
+         node.physicMode == NODE_TYPE_MESH && !node.terrain &&
+         meshIt->second.file == node.filename &&
+         (!meshIt->second.mtime ||
+          meshIt->second.mtime == SceneCache::getMTime(node.filename))) {
+        const BakedMesh &baked = meshIt->second;
+        node.ext = baked.ext;
+        node.mesh.vertexcount = baked.vertices.size()/3;
+        node.mesh.indexcount = baked.indices.size();
+        if(node.mesh.vertexcount > 0) {
+          node.mesh.vertices = new mydVector3[node.mesh.vertexcount];
+          for(int i=0; i<node.mesh.vertexcount; ++i) {
+            for(int k=0; k<3; ++k) {
+              node.mesh.vertices[i][k] = baked.vertices[i*3+k];
+            }
+          }
+        }
+        if(node.mesh.indexcount > 0) {
+          node.mesh.indices = new int[node.mesh.indexcount];
+          memcpy(node.mesh.indices, &baked.indices[0],
+                 node.mesh.indexcount*sizeof(int));
+        }
+      }
+
       NodeId oldId = node.index;
       NodeId newId = control->nodes->addNode(&node);
       if(!newId) {
         LOG_ERROR("addNode returned 0");
         return 0;
       }
+
+      // the NodeManager filled in the collision mesh, keep it for the cache
+      if(!fromCache && node.physicMode == NODE_TYPE_MESH && !node.terrain &&
+         node.mesh.vertices) {
+        BakedMesh &baked = bakedMeshes[listIndex];
+        baked.file = node.filename;
+        // files of a scene archive change with the archive
+        baked.mtime = 0;
+        if(mFileSuffix != ".scn" && mFileSuffix != ".zip") {
+          baked.mtime = SceneCache::getMTime(node.filename);
+        }
+        baked.ext = node.ext;
+        baked.vertices.resize(node.mesh.vertexcount*3);
+        for(int i=0; i<node.mesh.vertexcount; ++i) {
+          for(int k=0; k<3; ++k) {
+            baked.vertices[i*3+k] = node.mesh.vertices[i][k];
+          }
+        }
+        baked.indices.assign(node.mesh.indices,
+                             node.mesh.indices+node.mesh.indexcount);
+      }
       control->loadCenter->setMappedID(oldId, newId, MAP_TYPE_NODE, mapIndex);
 
       if(mRobotName != "") {
@@ -32,6 +32,8 @@
 #include <mars/interfaces/sensor_bases.h>
 #include <mars/interfaces/MaterialData.h>
 
+#include "SceneCache.h"
+
 class QDomElement;
 
 namespace mars {
@@ -68,6 +70,15 @@ namespace mars {
       unsigned long groupIDOffset;
       bool useYAML;
 
+      // the lists and meshes were read from the scene cache
+      bool fromCache;
+      std::string cacheTmpPath;
+      // baked collision meshes by the position of the node in nodeList
+      std::map<unsigned int, BakedMesh> bakedMeshes;
+
+      // the lists read and written by the scene cache
+      SceneCacheData getCacheData();
+
       unsigned int unzip(const std::string& destinationDir,
                          const std::string& zipFilename);
 
@@ -98,8 +109,9 @@ namespace mars {
       std::string sceneFilename;
       unsigned int mapIndex;
 
+      void preloadNodeFiles();
       unsigned int loadMaterial(configmaps::ConfigMap config);
-      unsigned int loadNode(configmaps::ConfigMap config);
+      unsigned int loadNode(configmaps::ConfigMap config, unsigned int listIndex);
       unsigned int loadJoint(configmaps::ConfigMap config);
       unsigned int loadMotor(configmaps::ConfigMap config);
       interfaces::BaseSensor* loadSensor(configmaps::ConfigMap config);
@@ -0,0 +1,485 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file SceneCache.cpp
+ *
+ */
+
+#include "SceneCache.h"
+
+#include <mars/utils/misc.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+// bump on every change of the file layout
+#define SCENE_CACHE_VERSION 2
+#define SCENE_CACHE_MAGIC "MARSSCN"
+#define SCENE_CACHE_SUFFIX ".cache"
+#define SCENE_CACHE_USER_DIR "/mars/scene_cache/"
+
+namespace mars {
+  namespace scene_loader {
+
+    using namespace configmaps;
+
+    namespace {
+
+      class Writer {
+      public:
+        std::string data;
+
+        void put(const void *v, size_t size) {
+          data.append((const char*)v, size);
+        }
+        template <typename T> void put(T v) {
+          put(&v, sizeof(T));
+        }
+        void putString(const std::string &s) {
+          put<unsigned int>(s.size());
+          data.append(s);
+        }
+      };
+
+      class Reader {
+      public:
+        Reader(const char *data, size_t size) : p(data), end(data+size),
+                                                ok(true) {}
+        const char *p, *end;
+        bool ok;
+
+        bool get(void *v, size_t size) {
+          if(!ok || (size_t)(end-p) < size) return ok = false;
+          memcpy(v, p, size);
+          p += size;
+          return true;
+        }
+        template <typename T> T get() {
+          T v = T();
+          get(&v, sizeof(T));
+          return v;
+        }
+        std::string getString() {
+          unsigned int size = get<unsigned int>();
+          if(!ok || (size_t)(end-p) < size) {
+            ok = false;
+            return std::string();
+          }
+          std::string s(p, size);
+          p += size;
+          return s;
+        }
+      };
+
+      void writeMap(Writer *w, ConfigMap &map);
+
+      void writeItem(Writer *w, ConfigItem &item) {
+        if(item.isMap()) {
+          w->put<char>('m');
+          writeMap(w, item);
+        }
+        else if(item.isVector()) {
+          ConfigVector &v = item;
+          w->put<char>('v');
+          w->put<unsigned int>(v.size());
+          for(size_t i=0; i<v.size(); ++i) writeItem(w, v[i]);
+        }
+        else {
+          ConfigAtom &atom = item;
+          switch(atom.getType()) {
+          case ConfigAtom::STRING_TYPE:
+            w->put<char>('s');
+            w->putString(atom.getString());
+            break;
+          case ConfigAtom::INT_TYPE:
+            w->put<char>('i');
+            w->put<int>(atom.getInt());
+            break;
+          case ConfigAtom::UINT_TYPE:
+            w->put<char>('I');
+            w->put<unsigned int>(atom.getUInt());
+            break;
+          case ConfigAtom::DOUBLE_TYPE:
+            w->put<char>('d');
+            w->put<double>(atom.getDouble());
+            break;
+          case ConfigAtom::ULONG_TYPE:
+            w->put<char>('l');
+            w->put<unsigned long long>(atom.getULong());
+            break;
+          case ConfigAtom::BOOL_TYPE:
+            w->put<char>('b');
+            w->put<char>(atom.getBool());
+            break;
+          default:
+            // values read from yaml are parsed on their first access
+            w->put<char>('u');
+            w->putString(atom.getUnparsedString());
+            break;
+          }
+        }
+      }
+
+      void writeMap(Writer *w, ConfigMap &map) {
+        ConfigMap::iterator it;
+        w->put<unsigned int>(map.size());
+        for(it=map.begin(); it!=map.end(); ++it) {
+          w->putString(it->first);
+          writeItem(w, it->second);
+        }
+      }
+
+      bool readMap(Reader *r, ConfigMap *map);
+
+      bool readItem(Reader *r, ConfigItem *item) {
+        char type = r->get<char>();
+        switch(type) {
+        case 'm': {
+          ConfigMap map;
+          if(!readMap(r, &map)) return false;
+          *item = map;
+          break;
+        }
+        case 'v': {
+          ConfigVector v;
+          unsigned int size = r->get<unsigned int>();
+          for(unsigned int i=0; i<size && r->ok; ++i) {
+            ConfigItem element;
+            if(!readItem(r, &element)) return false;
+            v.push_back(element);
+          }
+          *item = v;
+          break;
+        }
+        case 's': *item = r->getString(); break;
+        case 'i': *item = r->get<int>(); break;
+        case 'I': *item = r->get<unsigned int>(); break;
+        case 'd': *item = r->get<double>(); break;
+        case 'l': *item = (unsigned long)r->get<unsigned long long>(); break;
+        case 'b': *item = (bool)r->get<char>(); break;
+        case 'u': {
+          ConfigAtom atom;
+          atom.setUnparsedString(r->getString());
+          *item = atom;
+          break;
+        }
+        default:
+          return r->ok = false;
+        }
+        return r->ok;
+      }
+
+      bool readMap(Reader *r, ConfigMap *map) {
+        unsigned int size = r->get<unsigned int>();
+        for(unsigned int i=0; i<size && r->ok; ++i) {
+          std::string key = r->getString();
+          if(!readItem(r, &(*map)[key])) return false;
+        }
+        return r->ok;
+      }
+
+      void writeList(Writer *w, std::vector<ConfigMap> *list) {
+        w->put<unsigned int>(list->size());
+        for(size_t i=0; i<list->size(); ++i) writeMap(w, (*list)[i]);
+      }
+
+      bool readList(Reader *r, std::vector<ConfigMap> *list) {
+        unsigned int size = r->get<unsigned int>();
+        list->clear();
+        for(unsigned int i=0; i<size && r->ok; ++i) {
+          list->push_back(ConfigMap());
+          if(!readMap(r, &list->back())) return false;
+        }
+        return r->ok;
+      }
+
+      bool statFile(const std::string &file, long long *mtime,
+                    long long *size) {
+        struct stat fileStat;
+        if(stat(file.c_str(), &fileStat) != 0) {
+          *mtime = 0;
+          *size = -1;
+          return false;
+        }
+        *mtime = fileStat.st_mtime;
+        *size = fileStat.st_size;
+        return true;
+      }
+
+      std::string hashString(const std::string &s) {
+        // FNV-1a
+        unsigned long long hash = 14695981039346656037ull;
+        char buffer[17];
+        for(size_t i=0; i<s.size(); ++i) {
+          hash = (hash ^ (unsigned char)s[i]) * 1099511628211ull;
+        }
+        snprintf(buffer, sizeof(buffer), "%016llx", hash);
+        return buffer;
+      }
+
+      /**
+       * Returns the directory for the caches of scenes whose directory
+       * is not writable, or an empty string if there is no home.
+       */
+      std::string getUserCacheDir() {
+        const char *dir = getenv("XDG_CACHE_HOME");
+        std::string path;
+        if(dir && *dir) {
+          path = dir;
+        }
+        else {
+#ifdef WIN32
+          dir = getenv("LOCALAPPDATA");
+#else
+          dir = getenv("HOME");
+#endif
+          if(!dir || !*dir) return "";
+          path = dir;
+#ifndef WIN32
+          path += "/.cache";
+#endif
+        }
+        return path + SCENE_CACHE_USER_DIR;
+      }
+
+    } // end of anonymous namespace
+
+    long long SceneCache::getMTime(const std::string &file) {
+      long long mtime, size;
+      statFile(file, &mtime, &size);
+      return mtime;
+    }
+
+    SceneCache::SceneCache(const std::string &sceneFile,
+                           const std::string &variant)
+      : sceneFile(sceneFile), variant(variant), haveScene(false) {
+      std::string suffix = SCENE_CACHE_SUFFIX;
+      if(!variant.empty()) {
+        suffix = "." + hashString(variant) + suffix;
+      }
+      cacheFile = sceneFile + suffix;
+
+      // the user cache holds the scenes of all directories, thus the name
+      // contains a hash of the absolute path
+      std::string userDir = getUserCacheDir();
+      if(!userDir.empty()) {
+        std::string absFile = sceneFile, name = sceneFile;
+        if(absFile.empty() || absFile[0] != '/') {
+          absFile = utils::pathJoin(utils::getCurrentWorkingDir(), absFile);
+        }
+        utils::removeFilenamePrefix(&name);
+        userCacheFile = userDir + name + "." + hashString(absFile) + suffix;
+      }
+
+      Dependency scene;
+      scene.file = sceneFile;
+      haveScene = statFile(sceneFile, &scene.mtime, &scene.size);
+      dependencies.push_back(scene);
+    }
+
+    void SceneCache::addDependency(const std::string &file) {
+      Dependency dependency;
+      dependency.file = file;
+      statFile(file, &dependency.mtime, &dependency.size);
+      dependencies.push_back(dependency);
+    }
+
+    bool SceneCache::read(SceneCacheData *data) {
+      if(!haveScene) return false;
+      if(readFile(cacheFile, data)) return true;
+      if(!userCacheFile.empty() && readFile(userCacheFile, data)) {
+        cacheFile = userCacheFile;
+        return true;
+      }
+      return false;
+    }
+
+    bool SceneCache::readFile(const std::string &file, SceneCacheData *data) {
+      const char *content = 0;
+      size_t size = 0;
+
+#ifndef WIN32
+      int fd = open(file.c_str(), O_RDONLY);
+      if(fd < 0) return false;
+      struct stat fileStat;
+      if(fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+        size = fileStat.st_size;
+        void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped != MAP_FAILED) content = (const char*)mapped;
+      }
+      close(fd);
+#else
+      std::vector<char> buffer;
+      FILE *input = fopen(file.c_str(), "rb");
+      if(!input) return false;
+      fseek(input, 0, SEEK_END);
+      size = ftell(input);
+      fseek(input, 0, SEEK_SET);
+      buffer.resize(size);
+      if(size && fread(&buffer[0], 1, size, input) == size) {
+        content = &buffer[0];
+      }
+      fclose(input);
+#endif
+      if(!content) return false;
+
+      Reader r(content, size);
+      char magic[sizeof(SCENE_CACHE_MAGIC)];
+      bool valid = (r.get(magic, sizeof(magic)) &&
+                    memcmp(magic, SCENE_CACHE_MAGIC, sizeof(magic)) == 0 &&
+                    r.get<unsigned int>() == SCENE_CACHE_VERSION &&
+                    r.getString() == variant);
+      if(valid) {
+        // the first dependency is the scene file, it is compared by name
+        // as well since the user cache is shared by all directories
+        unsigned int numDependencies = r.get<unsigned int>();
+        for(unsigned int i=0; i<numDependencies && valid; ++i) {
+          Dependency stored, current;
+          stored.file = r.getString();
+          stored.mtime = r.get<long long>();
+          stored.size = r.get<long long>();
+          statFile(stored.file, &current.mtime, &current.size);
+          valid = (r.ok && stored.mtime == current.mtime &&
+                   stored.size == current.size &&
+                   (i > 0 || stored.file == sceneFile));
+        }
+        valid = valid && numDependencies > 0;
+      }
+      if(valid) {
+        data->info.clear();
+        valid = (readMap(&r, &data->info) &&
+                 r.get<unsigned int>() == data->lists.size());
+        for(size_t i=0; i<data->lists.size() && valid; ++i) {
+          valid = readList(&r, data->lists[i]);
+        }
+      }
+      if(valid) {
+        unsigned int numMeshes = r.get<unsigned int>();
+        data->bakedMeshes->clear();
+        for(unsigned int i=0; i<numMeshes && r.ok; ++i) {
+          BakedMesh &mesh = (*data->bakedMeshes)[r.get<unsigned int>()];
+          mesh.file = r.getString();
+          mesh.mtime = r.get<long long>();
+          double ext[3];
+          r.get(ext, sizeof(ext));
+          mesh.ext = utils::Vector(ext[0], ext[1], ext[2]);
+          mesh.vertices.resize(r.get<unsigned int>()*3);
+          if(r.ok && !mesh.vertices.empty()) {
+            r.get(&mesh.vertices[0], mesh.vertices.size()*sizeof(double));
+          }
+          mesh.indices.resize(r.get<unsigned int>());
+          if(r.ok && !mesh.indices.empty()) {
+            r.get(&mesh.indices[0], mesh.indices.size()*sizeof(int));
+          }
+        }
+        valid = r.ok;
+      }
+
+#ifndef WIN32
+      munmap((void*)content, size);
+#endif
+      if(!valid) {
+        for(size_t i=0; i<data->lists.size(); ++i) {
+          data->lists[i]->clear();
+        }
+        data->bakedMeshes->clear();
+        data->info.clear();
+      }
+      return valid;
+    }
+
+    bool SceneCache::write(const SceneCacheData &data) {
+      std::map<unsigned int, BakedMesh>::const_iterator it;
+      Writer w;
+
+      if(!haveScene) return false;
+      w.put(SCENE_CACHE_MAGIC, sizeof(SCENE_CACHE_MAGIC));
+      w.put<unsigned int>(SCENE_CACHE_VERSION);
+      w.putString(variant);
+      w.put<unsigned int>(dependencies.size());
+      for(size_t i=0; i<dependencies.size(); ++i) {
+        w.putString(dependencies[i].file);
+        w.put<long long>(dependencies[i].mtime);
+        w.put<long long>(dependencies[i].size);
+      }
+      writeMap(&w, const_cast<ConfigMap&>(data.info));
+      w.put<unsigned int>(data.lists.size());
+      for(size_t i=0; i<data.lists.size(); ++i) {
+        writeList(&w, data.lists[i]);
+      }
+      w.put<unsigned int>(data.bakedMeshes->size());
+      for(it=data.bakedMeshes->begin(); it!=data.bakedMeshes->end(); ++it) {
+        const BakedMesh &mesh = it->second;
+        double ext[3] = {mesh.ext.x(), mesh.ext.y(), mesh.ext.z()};
+        w.put<unsigned int>(it->first);
+        w.putString(mesh.file);
+        w.put<long long>(mesh.mtime);
+        w.put(ext, sizeof(ext));
+        w.put<unsigned int>(mesh.vertices.size()/3);
+        if(!mesh.vertices.empty()) {
+          w.put(&mesh.vertices[0], mesh.vertices.size()*sizeof(double));
+        }
+        w.put<unsigned int>(mesh.indices.size());
+        if(!mesh.indices.empty()) {
+          w.put(&mesh.indices[0], mesh.indices.size()*sizeof(int));
+        }
+      }
+
+      if(writeFile(cacheFile, w.data)) return true;
+      // e.g. a scene installed in a read-only directory
+      if(userCacheFile.empty()) return false;
+      utils::createDirectory(utils::getPathOfFile(userCacheFile));
+      if(!writeFile(userCacheFile, w.data)) return false;
+      cacheFile = userCacheFile;
+      return true;
+    }
+
+    bool SceneCache::writeFile(const std::string &file,
+                               const std::string &content) {
+      // write to a temporary file first, so that a concurrent reader
+      // never sees a partial cache
+      std::string tmpFile = file + ".tmp";
+      FILE *output = fopen(tmpFile.c_str(), "wb");
+      if(!output) return false;
+      bool ok = (fwrite(content.data(), 1, content.size(), output) ==
+                 content.size());
+      ok = (fclose(output) == 0) && ok;
+      if(ok) {
+#ifdef WIN32
+        remove(file.c_str());
+#endif
+        ok = (rename(tmpFile.c_str(), file.c_str()) == 0);
+      }
+      if(!ok) remove(tmpFile.c_str());
+      return ok;
+    }
+
+  } // end of namespace scene_loader
+} // end of namespace mars
@@ -0,0 +1,121 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file SceneCache.h
+ * \brief "SceneCache" stores a parsed scene in a binary file that is
+ *        reused as long as the files of the scene are unchanged.
+ */
+
+#ifndef SCENE_CACHE_H
+#define SCENE_CACHE_H
+
+#ifdef _PRINT_HEADER_
+  #warning "SceneCache.h"
+#endif
+
+#include <mars/utils/Vector.h>
+#include <configmaps/ConfigData.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace scene_loader {
+
+    /**
+     * The collision mesh of a node as computed by the LoadMeshInterface.
+     * The vertices are stored as x, y, z triples. mtime is the
+     * modification time of the mesh file, or 0 if the file is part of
+     * the scene archive and thus covered by the scene file itself.
+     */
+    struct BakedMesh {
+      std::string file;
+      long long mtime;
+      utils::Vector ext;
+      std::vector<double> vertices;
+      std::vector<int> indices;
+    };
+
+    /**
+     * The compiled form of a scene or an entity: the config lists of the
+     * materials, nodes, joints etc. in the order of the loader, the baked
+     * collision meshes by the position of the node in its list, and a
+     * map for further values of the loader.
+     */
+    struct SceneCacheData {
+      std::vector<std::vector<configmaps::ConfigMap>*> lists;
+      std::map<unsigned int, BakedMesh> *bakedMeshes;
+      configmaps::ConfigMap info;
+    };
+
+    /**
+     * Reads and writes the compiled form of a scene. The cache file is
+     * stored next to the scene file, or in the cache directory of the
+     * user if the directory of the scene is not writable. It is only used
+     * if the modification time and size of the scene file and of all
+     * files added by addDependency match the stored ones. The file is
+     * memory-mapped for reading.
+     *
+     * A loader whose result depends on more than the files, e.g. the
+     * entity config of a SMURF, passes it as variant. Each variant has a
+     * cache file of its own.
+     */
+    class SceneCache {
+    public:
+      SceneCache(const std::string &sceneFile,
+                 const std::string &variant = "");
+
+      const std::string& getCacheFile() const {return cacheFile;}
+
+      /** \brief Adds a file that was read together with the scene file. */
+      void addDependency(const std::string &file);
+
+      /**
+       * \brief Fills the lists, the baked meshes and the info map of
+       * data. The lists have to be the ones that were written.
+       * \return false if there is no valid cache for the scene file. The
+       *         content of data is undefined in that case.
+       */
+      bool read(SceneCacheData *data);
+      bool write(const SceneCacheData &data);
+
+      /** \brief Returns the modification time of the file or 0. */
+      static long long getMTime(const std::string &file);
+
+    private:
+      struct Dependency {
+        std::string file;
+        long long mtime, size;
+      };
+
+      std::string sceneFile, variant, cacheFile, userCacheFile;
+      std::vector<Dependency> dependencies;
+      bool haveScene;
+
+      bool readFile(const std::string &file, SceneCacheData *data);
+      bool writeFile(const std::string &file, const std::string &content);
+    };
+
+  } // end of namespace scene_loader
+} // end of namespace mars
+
+#endif  // SCENE_CACHE_H
@@ -0,0 +1,52 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file Checkpoint.cpp
+ * \brief Restores the manager sections of a checkpoint of
+ *        Simulator::saveCheckpoint.
+ */
+
+#include "Checkpoint.h"
+
+namespace mars {
+  namespace sim {
+
+    using namespace interfaces;
+
+    bool restoreCheckpointSections(const std::vector<sReal> &checkpoint,
+                                   size_t *pos,
+                                   const std::vector<CheckpointInterface*> &sections) {
+      size_t p = *pos;
+
+      for(size_t i=0; i<sections.size(); ++i) {
+        if(!sections[i]->checkState(checkpoint, &p)) return false;
+      }
+      p = *pos;
+      for(size_t i=0; i<sections.size(); ++i) {
+        // only fails if the scene is changed by another thread meanwhile
+        if(!sections[i]->restoreState(checkpoint, &p)) return false;
+      }
+      *pos = p;
+      return true;
+    }
+
+  } // end of namespace sim
+} // end of namespace mars
@@ -0,0 +1,56 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file Checkpoint.h
+ * \brief Restores the manager sections of a checkpoint of
+ *        Simulator::saveCheckpoint.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#ifdef _PRINT_HEADER_
+  #warning "Checkpoint.h"
+#endif
+
+#include <mars/interfaces/sim/CheckpointInterface.h>
+
+#include <vector>
+
+namespace mars {
+  namespace sim {
+
+    /**
+     * Restores the sections of the checkpoint that start at \c pos in the
+     * order of \c sections. All sections are checked before the first
+     * one is restored, thus a checkpoint that does not match the scene
+     * changes nothing.
+     * \returns \c false if a section does not match; otherwise \c pos is
+     *          moved behind the last section.
+     */
+    bool restoreCheckpointSections(const std::vector<interfaces::sReal> &checkpoint,
+                                   size_t *pos,
+                                   const std::vector<interfaces::CheckpointInterface*> &sections);
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif  // CHECKPOINT_H
@@ -26,6 +26,9 @@
  */
 
 #define PACKAGE_SIZE 2048
+// controllers without updateBuffers expect the fixed arrays of the old ABI
+#define ABI1_SENSOR_VALUES 255
+#define ABI1_MOTOR_VALUES 100
 
 
 #include "Controller.h"
@@ -42,6 +45,7 @@
 #include <mars/cfg_manager/CFGManagerInterface.h>
 
 #include <cmath>
+#include <algorithm>
 #include <cstring>
 
 namespace mars {
@@ -85,7 +89,12 @@ namespace mars {
       sController.dylib_path = "";
       dy = 0;
       dylibController = 0;
+      dylibABI = 1;
+      transport = 0;
       count_ms = 0;
+      // size the buffers once, the updates do not allocate
+      motorBuffer.resize(motors.size());
+      readSensors();
 #ifdef WIN32
       if(!Controller::sock_init) {
         /* Initialisiere TCP f�r Windows ("winsock") */
@@ -132,6 +141,7 @@ namespace mars {
       connected = false;
       while(!isFinished()) 
         msleep(10);
+      if(transport) delete transport;
     }
     
     void Controller::setID(unsigned long id) {
@@ -157,12 +167,7 @@ namespace mars {
       char data[PACKAGE_SIZE];
       char *p = data;
       double value;
-      double t_sensors[255];
-      double *pt_sensors = t_sensors;
-      double t_motors[100];
-      double *pt_motors = t_motors;
-      int flags = 0, count_val, i, command;
-      sReal *sens_val;
+      int flags = 0, i, command;
       char *other_stuff = 0;
       char *pt_stuff;
       unsigned long command_id = 0;
@@ -173,12 +178,17 @@ namespace mars {
       if ((count_ms += time_ms) >= sController.rate) {
         count_ms -= sController.rate;
         if (dylibController) {
-          for (i=0; i<100; i++) t_sensors[i] = t_motors[i] = 0;
-          for (iter = sensors.begin(); iter != sensors.end(); iter++) {
-            count_val = (*iter)->getSensorData(&sens_val);
-            for(i=0; i<count_val; i++) *(pt_sensors++) = (double)sens_val[i];
-            free(sens_val);
+          readSensors();
+          if (dylibABI < 2) {
+            // the resize zeroes the unused values
+            if (sensorBuffer.size() < ABI1_SENSOR_VALUES) {
+              sensorBuffer.resize(ABI1_SENSOR_VALUES, 0.0);
+            }
+            if (motorBuffer.size() < ABI1_MOTOR_VALUES) {
+              motorBuffer.resize(ABI1_MOTOR_VALUES);
+            }
           }
+          std::fill(motorBuffer.begin(), motorBuffer.end(), 0.0);
           /*
           if (sParams.size()) {
             other_stuff = (char*)malloc(sParams.size()*sizeof(sReal)+sizeof(int));
@@ -192,8 +202,17 @@ namespace mars {
           }
           */
 
-          dylibController->update(time_ms, t_sensors, t_motors,
-                                  &flags, &other_stuff);
+          if (dylibABI >= 2) {
+            dylibController->updateBuffers(time_ms, sensorBuffer.data(),
+                                           sensorBuffer.size(),
+                                           motorBuffer.data(),
+                                           motorBuffer.size(),
+                                           &flags, &other_stuff);
+          }
+          else {
+            dylibController->update(time_ms, sensorBuffer.data(),
+                                    motorBuffer.data(), &flags, &other_stuff);
+          }
           if (other_stuff) {
             for (i=0, pt_stuff = other_stuff+sizeof(int);
                  i<*(int*)other_stuff; i++) {
@@ -405,8 +424,19 @@ namespace mars {
             //if(!control->sim->isSimRunning()) control->sim->startStopTrigger();
           }
           else {
-            for (jter = motors.begin(); jter != motors.end(); jter++, pt_motors++)
-              (*jter)->setControlValue((sReal)*pt_motors);
+            for (i=0, jter = motors.begin(); jter != motors.end(); jter++, i++)
+              (*jter)->setControlValue((sReal)motorBuffer[i]);
+          }
+        }
+        else if(transport) {
+          readSensors();
+          if (transport->exchange(control->sim->getTime(), sensorBuffer,
+                                  &motorBuffer, &flags)) {
+            for (i=0, jter = motors.begin(); jter != motors.end(); jter++, i++)
+              (*jter)->setControlValue((sReal)motorBuffer[i]);
+          }
+          if (flags) {
+            control->sim->resetSim();
           }
         }
         else if(connected) {
@@ -612,6 +642,9 @@ namespace mars {
                       control->cfg->setPropertyValue("Simulator", "calc_ms",
                                                      "value", value);
                     }
+                    else {
+                      LOG_ERROR("Controller: calc_ms can not be set without cfg_manager");
+                    }
                   }
                   else if(id==5) {
                     // old id for realtime calc
@@ -620,6 +653,9 @@ namespace mars {
                                                      "realtime calc",
                                                      "value", value);
                     }
+                    else {
+                      LOG_ERROR("Controller: realtime calc can not be set without cfg_manager");
+                    }
                   }
                   getChar(p, &cmd);
                 }
@@ -855,6 +891,8 @@ namespace mars {
           else {
             dylibController = tmp_con();
           }
+          controller_abi_version *tmp_abi = (controller_abi_version*)GetProcAddress(dy, "controller_abi_version");
+          if (tmp_abi) dylibABI = tmp_abi();
         }
 #else
         dy = dlopen(sController.dylib_path.c_str(), RTLD_LAZY);
@@ -869,6 +907,8 @@ namespace mars {
           }
           else {
             dylibController = tmp_con();
+            controller_abi_version *tmp_abi = (controller_abi_version*)dlsym(dy, "controller_abi_version");
+            if (tmp_abi) dylibABI = tmp_abi();
             /*
               if (dylibController->iceInterface && control->ice) {
               control->ice->addInterface(dylibController->iceInterface,
@@ -882,6 +922,39 @@ namespace mars {
     }
 
 
+    void Controller::readSensors(void) {
+      std::vector<BaseSensor*>::iterator iter;
+      size_t offset = 0;
+      int count;
+
+      // a resize within the capacity does not allocate
+      sensorBuffer.resize(sensorBuffer.capacity());
+      for (iter = sensors.begin(); iter != sensors.end(); iter++) {
+        count = (*iter)->fillSensorData(sensorBuffer.data()+offset,
+                                        sensorBuffer.size()-offset);
+        if (offset+count > sensorBuffer.size()) {
+          // only grows until the buffer fits the values of all sensors
+          sensorBuffer.resize(offset+count);
+          (*iter)->fillSensorData(sensorBuffer.data()+offset, count);
+        }
+        offset += count;
+      }
+      sensorBuffer.resize(offset);
+    }
+
+    void Controller::setTransport(const std::string &address, bool lockstep) {
+      // the binary transport replaces the tcp connection
+      auto_connect = false;
+      if(connected) close(conn);
+      connected = false;
+      if(transport) delete transport;
+      transport = new ControllerTransport(address, lockstep);
+      if(!transport->isValid()) {
+        delete transport;
+        transport = 0;
+      }
+    }
+
     int Controller::initServer(int port) {
       int s = 0;
       struct sockaddr_in sa;
@@ -996,6 +1069,9 @@ namespace mars {
     void Controller::run(void) {
 
       while (running) {
+        if (transport && !transport->isConnected()) {
+          transport->connect();
+        }
         if (!connected && auto_connect) {
           if (conn) {
 #ifdef WIN32
@@ -33,6 +33,7 @@
 #endif
 
 #include "SimMotor.h"
+#include "ControllerTransport.h"
 
 #ifdef WIN32
 #include <windows.h>
@@ -82,6 +83,11 @@ namespace mars {
       void getCoreExchange(interfaces::core_objects_exchange *obj) const;
       void resetData(void);
       void setDylibPath(const std::string &dylib_path);
+      /**
+       * Exchanges the values via a binary ControllerTransport instead of
+       * the tcp packages. \sa ControllerTransport
+       */
+      void setTransport(const std::string &address, bool lockstep);
 
       void setAutoMode(bool mode);
       void setIP(const std::string &ip);
@@ -108,6 +114,10 @@ namespace mars {
 #endif
       interfaces::ControllerData sController;
       interfaces::ControllerInterface *dylibController;
+      int dylibABI;
+      ControllerTransport *transport;
+      // sensor and motor values of the dylib and transport controllers
+      std::vector<double> sensorBuffer, motorBuffer;
       interfaces::sReal count_ms;
       bool auto_connect;
       int connected;
@@ -126,6 +136,7 @@ namespace mars {
       int connectClient(void);
       int getSReal(const char *data, interfaces::sReal *value) const;
       int getChar(const char *data, char *c) const;
+      void readSensors(void);
       void run(void);
     };
 
@@ -69,7 +69,7 @@ namespace mars {
      */
     void ControllerManager::getListController(vector<core_objects_exchange> *controllerList) const {
       core_objects_exchange obj;
-      map<unsigned long, Controller*>::const_iterator iter;
+      ControllerMap::const_iterator iter;
       controllerList->clear();
       iMutex.lock();
       for (iter = simController.begin(); iter != simController.end(); iter++) {
@@ -101,7 +101,7 @@ namespace mars {
      */
     const ControllerData ControllerManager::getFullController(unsigned long index) const {
       MutexLocker locker(&iMutex);
-      map<unsigned long, Controller*>::const_iterator iter;
+      ControllerMap::const_iterator iter;
       iter = simController.find(index);
       if (iter != simController.end())
         return iter->second->getSController();
@@ -120,7 +120,7 @@ namespace mars {
     void ControllerManager::removeController(unsigned long index) {
       Controller* tmpController = 0;
       iMutex.lock();
-      map<unsigned long, Controller*>::iterator iter = simController.find(index);
+      ControllerMap::iterator iter = simController.find(index);
       if (iter != simController.end()) {
         tmpController = iter->second;
         simController.erase(iter);
@@ -141,7 +141,7 @@ namespace mars {
      */
     void ControllerManager::setControllerAutoMode(unsigned long id, bool mode) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, Controller*>::iterator iter = simController.find(id);
+      ControllerMap::iterator iter = simController.find(id);
       if (iter != simController.end())
         iter->second->setAutoMode(mode);
     }
@@ -157,7 +157,7 @@ namespace mars {
     void ControllerManager::setControllerIP(unsigned long id,
                                             const std::string &ip) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, Controller*>::iterator iter = simController.find(id);
+      ControllerMap::iterator iter = simController.find(id);
       if (iter != simController.end())
         iter->second->setIP(ip);
     }
@@ -166,7 +166,7 @@ namespace mars {
 
     void ControllerManager::setControllerPort(unsigned long id, int port) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, Controller*>::iterator iter = simController.find(id);
+      ControllerMap::iterator iter = simController.find(id);
       if (iter != simController.end())
         iter->second->setPort(port);
     }
@@ -182,7 +182,7 @@ namespace mars {
      */
     bool ControllerManager::getControllerAutoMode(unsigned long id) const {
       MutexLocker locker(&iMutex);
-      map<unsigned long, Controller*>::const_iterator iter = simController.find(id);
+      ControllerMap::const_iterator iter = simController.find(id);
       if (iter != simController.end())
         return iter->second->getAutoMode();
       else
@@ -198,7 +198,7 @@ namespace mars {
      */
     const std::string ControllerManager::getControllerIP(unsigned long id) const {
       MutexLocker locker(&iMutex);
-      map<unsigned long, Controller*>::const_iterator iter = simController.find(id);
+      ControllerMap::const_iterator iter = simController.find(id);
       if (iter != simController.end()) {
         return iter->second->getIP();
       }
@@ -218,7 +218,7 @@ namespace mars {
      */
     int ControllerManager::getControllerPort(unsigned long id) const {
       MutexLocker locker(&iMutex);
-      map<unsigned long, Controller*>::const_iterator iter = simController.find(id);
+      ControllerMap::const_iterator iter = simController.find(id);
       if (iter != simController.end())
         return iter->second->getPort();
       else
@@ -234,7 +234,7 @@ namespace mars {
      */
     void ControllerManager::connectController(unsigned long id) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, Controller*>::iterator iter = simController.find(id);
+      ControllerMap::iterator iter = simController.find(id);
       if (iter != simController.end())
         iter->second->connect();
     }
@@ -247,7 +247,7 @@ namespace mars {
      */
     void ControllerManager::disconnectController(unsigned long id) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, Controller*>::iterator iter = simController.find(id);
+      ControllerMap::iterator iter = simController.find(id);
       if (iter != simController.end())
         iter->second->connect();
     }
@@ -263,7 +263,7 @@ namespace mars {
     void ControllerManager::updateControllers(double calc_ms) {
       MutexLocker locker(&iMutex);
 
-      map<unsigned long, Controller*>::iterator iter;
+      ControllerMap::iterator iter;
       for(iter = simController.begin(); iter != simController.end(); iter++)
         iter->second->update(calc_ms);
     }
@@ -274,7 +274,7 @@ namespace mars {
      */
     void ControllerManager::resetControllerData(void) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, Controller*>::iterator iter;
+      ControllerMap::iterator iter;
       for(iter = simController.begin(); iter != simController.end(); iter++)
         iter->second->resetData();
     }
@@ -289,23 +289,19 @@ namespace mars {
         return;
       MutexLocker locker(&iMutex);
 
-      map<unsigned long, Controller*>::iterator iter;
-      while(!simController.empty()) {
-        delete simController.begin()->second;
-        simController.erase(simController.begin());
-      }
-      /*
-        for(iter = simController.begin(); iter != simController.end(); iter++)
+      ControllerMap::iterator iter;
+      // erasing the first entry would move all others in the IDMap
+      for(iter = simController.begin(); iter != simController.end(); ++iter) {
         delete iter->second;
-        simController.clear();
-      */
+      }
+      simController.clear();
       next_controller_id = 1;
     }
 
 
     void ControllerManager::handleError(void) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, Controller*>::iterator iter;
+      ControllerMap::iterator iter;
       for(iter = simController.begin(); iter != simController.end(); iter++)
         iter->second->handleError();
     }
@@ -350,6 +346,9 @@ namespace mars {
       newController = new Controller(controller.rate, vmotor, vsensor, nodes,
                                      control, std_port);
       newController->setDylibPath(controller.dylib_path);
+      if(!controller.transport.empty()) {
+        newController->setTransport(controller.transport, controller.lockstep);
+      }
       newController->setID(id);
       iMutex.lock();
       simController[id] = newController;
@@ -395,7 +394,7 @@ namespace mars {
 
     std::list<sReal> ControllerManager::getSensorValues(unsigned long id) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, Controller*>::iterator iter = simController.find(id);
+      ControllerMap::iterator iter = simController.find(id);
       if (iter != simController.end())
         return iter->second->getSensorValues();
       return std::list<sReal>();
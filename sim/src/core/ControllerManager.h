@@ -39,6 +39,7 @@
 #endif
 
 #include "Controller.h"
+#include "IDMap.h"
 
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/sim/ControllerManagerInterface.h>
@@ -47,6 +48,8 @@
 namespace mars {
   namespace sim {
 
+    typedef IDMap<Controller*> ControllerMap;
+
     /**
      * \brief "ControllerManager" imlements the interfaces for all controller 
      * operations that are used for the communication between the simulation 
@@ -247,7 +250,7 @@ namespace mars {
       unsigned long next_controller_id;
 
       //! a containter holding all controllers in the simulation
-      std::map<unsigned long, Controller*> simController;
+      ControllerMap simController;
 
       //! a pointer to the control center
       interfaces::ControlCenter *control;
@@ -0,0 +1,443 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file ControllerTransport.cpp
+ *
+ */
+
+#include "ControllerTransport.h"
+
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/interfaces/Logging.hpp>
+#include <mars/utils/MutexLocker.h>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#endif
+
+#include <algorithm>
+
+// how long a lockstep exchange waits for the motor values of the controller
+#define LOCKSTEP_TIMEOUT_MS 1000
+
+// macOS has no MSG_NOSIGNAL, the socket is created with SO_NOSIGPIPE there
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+namespace mars {
+  namespace sim {
+
+    using namespace interfaces;
+    using namespace utils;
+
+#ifndef WIN32
+    // waits up to timeoutMs for a post of sem
+    static bool waitSemaphore(sem_t *sem, long timeoutMs) {
+      struct timespec timeout;
+#ifdef __APPLE__
+      // macOS has no sem_timedwait
+      long long now, end;
+      clock_gettime(CLOCK_MONOTONIC, &timeout);
+      end = timeout.tv_sec*1000LL + timeout.tv_nsec/1000000 + timeoutMs;
+      while(sem_trywait(sem) == -1) {
+        if(errno != EAGAIN && errno != EINTR) return false;
+        clock_gettime(CLOCK_MONOTONIC, &timeout);
+        now = timeout.tv_sec*1000LL + timeout.tv_nsec/1000000;
+        if(now >= end) return false;
+        usleep(100);
+      }
+      return true;
+#else
+      clock_gettime(CLOCK_REALTIME, &timeout);
+      timeout.tv_sec += timeoutMs / 1000;
+      timeout.tv_nsec += (timeoutMs % 1000) * 1000000L;
+      if(timeout.tv_nsec >= 1000000000L) {
+        timeout.tv_nsec -= 1000000000L;
+        ++timeout.tv_sec;
+      }
+      while(sem_timedwait(sem, &timeout) == -1) {
+        if(errno != EINTR) return false;
+      }
+      return true;
+#endif
+    }
+#endif
+
+    ControllerTransport::ControllerTransport(const std::string &address,
+                                             bool lockstep)
+      : type(TRANSPORT_NONE), lockstep(lockstep), header(0), shmSize(0),
+        lastMotorSeq(0), controllerAttached(false),
+#ifndef WIN32
+        sensorsReady(0), motorsReady(0),
+#endif
+        sock(-1), connectWarned(false) {
+#ifdef WIN32
+      LOG_ERROR("ControllerTransport: \"%s\" is not supported on windows",
+                address.c_str());
+#else
+      if(address.compare(0, 4, "shm:") == 0) {
+        type = TRANSPORT_SHM;
+        name = address.substr(4);
+        // shm_open expects a name with a leading slash
+        if(name.empty() || name[0] != '/') name = "/" + name;
+      }
+      else if(address.compare(0, 5, "unix:") == 0) {
+        type = TRANSPORT_UNIX;
+        name = address.substr(5);
+        connect();
+      }
+      else {
+        LOG_ERROR("ControllerTransport: unknown address \"%s\"",
+                  address.c_str());
+      }
+#endif
+    }
+
+    ControllerTransport::~ControllerTransport() {
+      destroySegment();
+      MutexLocker locker(&sockMutex);
+      closeSocket();
+    }
+
+    bool ControllerTransport::isConnected() const {
+      if(type == TRANSPORT_SHM) return true;
+      MutexLocker locker(&sockMutex);
+      return sock != -1;
+    }
+
+    void ControllerTransport::connect() {
+#ifndef WIN32
+      struct sockaddr_un addr;
+      struct timeval timeout;
+      int fd;
+
+      if(type != TRANSPORT_UNIX || isConnected()) return;
+      if(name.size() >= sizeof(addr.sun_path)) {
+        LOG_ERROR("ControllerTransport: socket path too long: %s",
+                  name.c_str());
+        type = TRANSPORT_NONE;
+        return;
+      }
+      memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      strcpy(addr.sun_path, name.c_str());
+
+      fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+      if(fd == -1) {
+        LOG_ERROR("ControllerTransport: cannot open socket");
+        return;
+      }
+#ifdef SO_NOSIGPIPE
+      int noSigPipe = 1;
+      setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+      // a lockstep receive waits as long as the shared memory transport
+      timeout.tv_sec = LOCKSTEP_TIMEOUT_MS / 1000;
+      timeout.tv_usec = (LOCKSTEP_TIMEOUT_MS % 1000) * 1000;
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      if(::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        if(!connectWarned) {
+          LOG_ERROR("ControllerTransport: cannot connect to %s", name.c_str());
+          connectWarned = true;
+        }
+        close(fd);
+        return;
+      }
+      LOG_INFO("ControllerTransport: connected to %s", name.c_str());
+      connectWarned = false;
+      sockMutex.lock();
+      sock = fd;
+      sockMutex.unlock();
+#endif
+    }
+
+    bool ControllerTransport::exchange(double time_ms,
+                                       const std::vector<double> &sensors,
+                                       std::vector<double> *motors,
+                                       int *flags) {
+      *flags = 0;
+      if(type == TRANSPORT_SHM) {
+        return exchangeShm(time_ms, sensors, motors, flags);
+      }
+      if(type == TRANSPORT_UNIX) {
+        return exchangeUnix(time_ms, sensors, motors, flags);
+      }
+      return false;
+    }
+
+    bool ControllerTransport::createSegment(size_t numSensors,
+                                            size_t numMotors) {
+#ifdef WIN32
+      return false;
+#else
+      int fd;
+      void *mem;
+
+      shmSize = controllerShmSize(numSensors, numMotors);
+      // remove a segment left over by a crashed simulation
+      shm_unlink(name.c_str());
+      fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+      if(fd == -1) {
+        LOG_ERROR("ControllerTransport: cannot create shared memory %s",
+                  name.c_str());
+        return false;
+      }
+      if(ftruncate(fd, shmSize) == -1) {
+        LOG_ERROR("ControllerTransport: cannot resize shared memory %s",
+                  name.c_str());
+        close(fd);
+        shm_unlink(name.c_str());
+        return false;
+      }
+      mem = mmap(0, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if(mem == MAP_FAILED) {
+        LOG_ERROR("ControllerTransport: cannot map shared memory %s",
+                  name.c_str());
+        shm_unlink(name.c_str());
+        return false;
+      }
+      header = (ControllerShmHeader*)mem;
+      memset(header, 0, shmSize);
+      header->version = CONTROLLER_SHM_VERSION;
+      header->numSensors = numSensors;
+      header->numMotors = numMotors;
+      header->lockstep = lockstep;
+      if(!openSemaphores()) {
+        LOG_ERROR("ControllerTransport: cannot create the semaphores of %s",
+                  name.c_str());
+        munmap(header, shmSize);
+        header = 0;
+        shm_unlink(name.c_str());
+        return false;
+      }
+      lastMotorSeq = 0;
+      controllerAttached = false;
+      // the magic marks the header as complete for attaching controllers
+      __atomic_store_n(&header->magic, CONTROLLER_SHM_MAGIC, __ATOMIC_RELEASE);
+      LOG_INFO("ControllerTransport: created shared memory %s", name.c_str());
+      return true;
+#endif
+    }
+
+    void ControllerTransport::destroySegment() {
+#ifndef WIN32
+      if(!header) return;
+      // an attached controller wakes up, finds the cleared magic and
+      // attaches to the next segment
+      __atomic_store_n(&header->magic, 0, __ATOMIC_RELEASE);
+      if(__atomic_load_n(&header->controllerAttached, __ATOMIC_ACQUIRE)) {
+        sem_post(sensorsReady);
+      }
+      closeSemaphores();
+      munmap(header, shmSize);
+      shm_unlink(name.c_str());
+      header = 0;
+#endif
+    }
+
+    bool ControllerTransport::openSemaphores() {
+#ifdef WIN32
+      return false;
+#elif defined(__APPLE__)
+      std::string sensorsName = controllerShmSemName(name, false);
+      std::string motorsName = controllerShmSemName(name, true);
+      sem_unlink(sensorsName.c_str());
+      sem_unlink(motorsName.c_str());
+      sensorsReady = sem_open(sensorsName.c_str(), O_CREAT | O_EXCL, 0600, 0);
+      motorsReady = sem_open(motorsName.c_str(), O_CREAT | O_EXCL, 0600, 0);
+      if(sensorsReady == SEM_FAILED || motorsReady == SEM_FAILED) {
+        if(sensorsReady != SEM_FAILED) sem_close(sensorsReady);
+        if(motorsReady != SEM_FAILED) sem_close(motorsReady);
+        sem_unlink(sensorsName.c_str());
+        sem_unlink(motorsName.c_str());
+        sensorsReady = motorsReady = 0;
+        return false;
+      }
+      return true;
+#else
+      sensorsReady = &header->sensorsReady;
+      motorsReady = &header->motorsReady;
+      if(sem_init(sensorsReady, 1, 0) == -1) return false;
+      if(sem_init(motorsReady, 1, 0) == -1) {
+        sem_destroy(sensorsReady);
+        return false;
+      }
+      return true;
+#endif
+    }
+
+    void ControllerTransport::closeSemaphores() {
+#ifdef __APPLE__
+      sem_close(sensorsReady);
+      sem_close(motorsReady);
+      // a controller keeps its handles of the unlinked semaphores
+      sem_unlink(controllerShmSemName(name, false).c_str());
+      sem_unlink(controllerShmSemName(name, true).c_str());
+#elif !defined(WIN32)
+      // the controller may still wait on the semaphores of its mapping
+      if(!__atomic_load_n(&header->controllerAttached, __ATOMIC_ACQUIRE)) {
+        sem_destroy(sensorsReady);
+        sem_destroy(motorsReady);
+      }
+#endif
+#ifndef WIN32
+      sensorsReady = motorsReady = 0;
+#endif
+    }
+
+    bool ControllerTransport::exchangeShm(double time_ms,
+                                          const std::vector<double> &sensors,
+                                          std::vector<double> *motors,
+                                          int *flags) {
+#ifdef WIN32
+      return false;
+#else
+      if(!header || header->numSensors != sensors.size() ||
+         header->numMotors != motors->size()) {
+        destroySegment();
+        if(!createSegment(sensors.size(), motors->size())) {
+          type = TRANSPORT_NONE;
+          return false;
+        }
+      }
+
+      sendBuffer.resize(sensors.size()+1);
+      sendBuffer[0] = time_ms;
+      std::copy(sensors.begin(), sensors.end(), sendBuffer.begin()+1);
+      controllerShmWrite(header, &header->sensorSeq, &sendBuffer[0],
+                         sendBuffer.size());
+
+      bool attached = __atomic_load_n(&header->controllerAttached,
+                                      __ATOMIC_ACQUIRE);
+      if(attached && !controllerAttached) {
+        // drop the posts of a controller that answered after the timeout
+        while(sem_trywait(motorsReady) == 0);
+      }
+      controllerAttached = attached;
+      if(lockstep && attached) {
+        sem_post(sensorsReady);
+        if(!waitSemaphore(motorsReady, LOCKSTEP_TIMEOUT_MS)) {
+          LOG_ERROR("ControllerTransport: controller does not answer, detach it");
+          __atomic_store_n(&header->controllerAttached, 0, __ATOMIC_RELEASE);
+          controllerAttached = false;
+        }
+      }
+
+      *flags = __atomic_exchange_n(&header->flags, 0, __ATOMIC_ACQ_REL);
+      if(motors->empty()) return false;
+      return controllerShmRead(header, &header->motorSeq, &(*motors)[0],
+                               motors->size(), &lastMotorSeq);
+#endif
+    }
+
+    bool ControllerTransport::exchangeUnix(double time_ms,
+                                           const std::vector<double> &sensors,
+                                           std::vector<double> *motors,
+                                           int *flags) {
+#ifdef WIN32
+      return false;
+#else
+      const size_t headerSize = 2*sizeof(uint32_t);
+      uint32_t values[2];
+      bool received = false, wait;
+      ssize_t size;
+      MutexLocker locker(&sockMutex);
+
+      if(sock == -1) return false;
+
+      values[0] = 0;
+      values[1] = sensors.size();
+      packet.resize(headerSize + (sensors.size()+1)*sizeof(double));
+      memcpy(&packet[0], values, headerSize);
+      memcpy(&packet[headerSize], &time_ms, sizeof(double));
+      if(!sensors.empty()) {
+        memcpy(&packet[headerSize+sizeof(double)], &sensors[0],
+               sensors.size()*sizeof(double));
+      }
+      if(send(sock, &packet[0], packet.size(), SEND_FLAGS) == -1) {
+        LOG_ERROR("ControllerTransport: connection lost");
+        closeSocket();
+        return false;
+      }
+
+      // in lockstep mode block for the answer, afterwards (and without
+      // lockstep) only drain the queued packets to get the newest values
+      packet.resize(headerSize + motors->size()*sizeof(double));
+      while(1) {
+        wait = lockstep && !received;
+        size = recv(sock, &packet[0], packet.size(), wait ? 0 : MSG_DONTWAIT);
+        if(size == -1) {
+          if(errno == EINTR) continue;
+          if((errno == EAGAIN || errno == EWOULDBLOCK) && wait) {
+            // SO_RCVTIMEO expired
+            LOG_ERROR("ControllerTransport: controller does not answer, disconnect it");
+            closeSocket();
+            return false;
+          }
+          if(errno == EAGAIN || errno == EWOULDBLOCK) break;
+          LOG_ERROR("ControllerTransport: connection lost");
+          closeSocket();
+          return false;
+        }
+        if(size == 0) {
+          LOG_ERROR("ControllerTransport: connection closed");
+          closeSocket();
+          return false;
+        }
+        if((size_t)size < headerSize) continue;
+        memcpy(values, &packet[0], headerSize);
+        *flags = values[0];
+        values[1] = std::min((size_t)values[1],
+                             std::min(motors->size(),
+                                      (size-headerSize)/sizeof(double)));
+        if(values[1]) {
+          memcpy(&(*motors)[0], &packet[headerSize],
+                 values[1]*sizeof(double));
+        }
+        received = true;
+      }
+      return received;
+#endif
+    }
+
+    void ControllerTransport::closeSocket() {
+#ifndef WIN32
+      if(sock != -1) {
+        close(sock);
+        sock = -1;
+      }
+#endif
+    }
+
+  } // end of namespace sim
+} // end of namespace mars
@@ -0,0 +1,116 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file ControllerTransport.h
+ * \brief "ControllerTransport" exchanges binary sensor and motor values
+ *        with an external controller via shared memory or a unix socket.
+ */
+
+#ifndef CONTROLLER_TRANSPORT_H
+#define CONTROLLER_TRANSPORT_H
+
+#ifdef _PRINT_HEADER_
+  #warning "ControllerTransport.h"
+#endif
+
+#include <mars/interfaces/sim/ControllerShm.h>
+#include <mars/utils/Mutex.h>
+
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace sim {
+
+    /**
+     * Replaces the ascii package protocol of the Controller with typed
+     * double vectors. The address selects the transport:
+     *  - "shm:<name>" creates the shared memory segment <name> described
+     *    in ControllerShm.h
+     *  - "unix:<path>" connects to a controller listening on the
+     *    SOCK_SEQPACKET unix domain socket <path>. The packets of both
+     *    directions start with two uint32_t values, the flags and the
+     *    number of values n, followed by n doubles. The sensor packets
+     *    carry the simulation time in ms as additional first double.
+     *
+     * In lockstep mode each exchange waits for the motor values of the
+     * controller, else the newest available values are used.
+     */
+    class ControllerTransport {
+    public:
+      ControllerTransport(const std::string &address, bool lockstep);
+      ~ControllerTransport();
+
+      bool isValid() const {return type != TRANSPORT_NONE;}
+      bool isConnected() const;
+      /**
+       * Connects the unix socket, does nothing for shared memory.
+       */
+      void connect();
+
+      /**
+       * Sends the sensor values and receives the motor values.
+       * \return true if new motor values were written to \c motors
+       */
+      bool exchange(double time_ms, const std::vector<double> &sensors,
+                    std::vector<double> *motors, int *flags);
+
+    private:
+      enum TransportType {
+        TRANSPORT_NONE,
+        TRANSPORT_SHM,
+        TRANSPORT_UNIX,
+      };
+
+      TransportType type;
+      std::string name;
+      bool lockstep;
+      // shared memory
+      interfaces::ControllerShmHeader *header;
+      size_t shmSize;
+      uint64_t lastMotorSeq;
+      bool controllerAttached;
+#ifndef WIN32
+      sem_t *sensorsReady, *motorsReady;
+#endif
+      // unix socket, connected by the thread of the Controller
+      mutable utils::Mutex sockMutex;
+      int sock;
+      bool connectWarned;
+      std::vector<char> packet;
+      std::vector<double> sendBuffer;
+
+      bool createSegment(size_t numSensors, size_t numMotors);
+      void destroySegment();
+      bool openSemaphores();
+      void closeSemaphores();
+      bool exchangeShm(double time_ms, const std::vector<double> &sensors,
+                       std::vector<double> *motors, int *flags);
+      bool exchangeUnix(double time_ms, const std::vector<double> &sensors,
+                        std::vector<double> *motors, int *flags);
+      /// Has to be called with sockMutex locked.
+      void closeSocket();
+    };
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif  // CONTROLLER_TRANSPORT_H
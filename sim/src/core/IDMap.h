@@ -0,0 +1,153 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file IDMap.h
+ * \brief "IDMap" maps the ids of the simulation objects to the objects
+ *        with a dense storage and an O(1) lookup.
+ */
+
+#ifndef IDMAP_H
+#define IDMAP_H
+
+#ifdef _PRINT_HEADER_
+  #warning "IDMap.h"
+#endif
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace mars {
+  namespace sim {
+
+    /**
+     * A replacement for std::map<unsigned long, T> for the ids handed out
+     * by the managers. The ids are counted up from one, thus a vector
+     * indexed by the id holds the position of each entry. The entries are
+     * stored sorted by id in one contiguous vector, so the update loops
+     * iterate in the same order as with the std::map.
+     *
+     * Only the part of the std::map interface used by the managers is
+     * provided. Inserting and erasing invalidates all iterators.
+     */
+    template <typename T>
+    class IDMap {
+    public:
+      typedef unsigned long key_type;
+      typedef T mapped_type;
+      typedef std::pair<unsigned long, T> value_type;
+      typedef typename std::vector<value_type>::iterator iterator;
+      typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+      iterator begin() {return entries.begin();}
+      iterator end() {return entries.end();}
+      const_iterator begin() const {return entries.begin();}
+      const_iterator end() const {return entries.end();}
+      size_t size() const {return entries.size();}
+      bool empty() const {return entries.empty();}
+
+      void clear() {
+        entries.clear();
+        slots.clear();
+      }
+
+      iterator find(unsigned long id) {
+        size_t slot = getSlot(id);
+        return slot ? entries.begin() + (slot-1) : entries.end();
+      }
+
+      const_iterator find(unsigned long id) const {
+        size_t slot = getSlot(id);
+        return slot ? entries.begin() + (slot-1) : entries.end();
+      }
+
+      size_t count(unsigned long id) const {
+        return getSlot(id) ? 1 : 0;
+      }
+
+      T& operator[](unsigned long id) {
+        size_t slot = getSlot(id);
+        if(slot) return entries[slot-1].second;
+        return insert(value_type(id, T())).first->second;
+      }
+
+      std::pair<iterator, bool> insert(const value_type &value) {
+        size_t slot = getSlot(value.first);
+        size_t pos;
+
+        if(slot) {
+          return std::make_pair(entries.begin() + (slot-1), false);
+        }
+        if(value.first >= slots.size()) {
+          slots.resize(value.first+1, 0);
+        }
+        // new ids are usually the greatest ones and get appended
+        if(entries.empty() || entries.back().first < value.first) {
+          pos = entries.size();
+          entries.push_back(value);
+        }
+        else {
+          pos = std::upper_bound(entries.begin(), entries.end(), value.first,
+                                 &IDMap::lessID) - entries.begin();
+          entries.insert(entries.begin() + pos, value);
+        }
+        updateSlots(pos);
+        return std::make_pair(entries.begin() + pos, true);
+      }
+
+      iterator erase(iterator iter) {
+        size_t pos = iter - entries.begin();
+        slots[iter->first] = 0;
+        entries.erase(iter);
+        updateSlots(pos);
+        return entries.begin() + pos;
+      }
+
+      size_t erase(unsigned long id) {
+        iterator iter = find(id);
+        if(iter == entries.end()) return 0;
+        erase(iter);
+        return 1;
+      }
+
+    private:
+      std::vector<value_type> entries;
+      std::vector<size_t> slots; ///< position+1 of the entry of an id, 0 if unused
+
+      size_t getSlot(unsigned long id) const {
+        return id < slots.size() ? slots[id] : 0;
+      }
+
+      void updateSlots(size_t first) {
+        for(size_t i=first; i<entries.size(); ++i) {
+          slots[entries[i].first] = i+1;
+        }
+      }
+
+      static bool lessID(unsigned long id, const value_type &value) {
+        return id < value.first;
+      }
+    };
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif  // IDMAP_H
@@ -140,7 +140,7 @@ namespace mars {
 
     void JointManager::editJoint(JointData *jointS) {
       MutexLocker locker(&iMutex);
-      std::map<unsigned long, SimJoint*>::iterator iter = simJoints.find(jointS->index);
+      JointMap::iterator iter = simJoints.find(jointS->index);
       if (iter != simJoints.end()) {
         iter->second->setAnchor(jointS->anchor);
         iter->second->setAxis(jointS->axis1);
@@ -154,7 +154,7 @@ namespace mars {
 
     void JointManager::getListJoints(std::vector<core_objects_exchange>* jointList) {
       core_objects_exchange obj;
-      std::map<unsigned long, SimJoint*>::iterator iter;
+      JointMap::iterator iter;
       MutexLocker locker(&iMutex);
       jointList->clear();
       for (iter = simJoints.begin(); iter != simJoints.end(); iter++) {
@@ -166,7 +166,7 @@ namespace mars {
     void JointManager::getJointExchange(unsigned long id,
                                         core_objects_exchange* obj) {
       MutexLocker locker(&iMutex);
-      std::map<unsigned long, SimJoint*>::iterator iter = simJoints.find(id);
+      JointMap::iterator iter = simJoints.find(id);
       if (iter != simJoints.end())
         iter->second->getCoreExchange(obj);
       else
@@ -176,7 +176,7 @@ namespace mars {
 
     const JointData JointManager::getFullJoint(unsigned long index) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimJoint*>::iterator iter = simJoints.find(index);
+      JointMap::iterator iter = simJoints.find(index);
       if (iter != simJoints.end())
         return iter->second->getSJoint();
       else {
@@ -189,7 +189,7 @@ namespace mars {
     void JointManager::removeJoint(unsigned long index) {
       SimJoint* tmpJoint = 0;
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimJoint*>::iterator iter = simJoints.find(index);
+      JointMap::iterator iter = simJoints.find(index);
 
       if (iter != simJoints.end()) {
         tmpJoint = iter->second;
@@ -213,7 +213,7 @@ namespace mars {
 
     SimJoint* JointManager::getSimJoint(unsigned long id){
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimJoint*>::iterator iter = simJoints.find(id);
+      JointMap::iterator iter = simJoints.find(id);
       if (iter != simJoints.end())
         return iter->second;
       else
@@ -223,7 +223,7 @@ namespace mars {
 
     std::vector<SimJoint*> JointManager::getSimJoints(void) {
       vector<SimJoint*> v_simJoints;
-      map<unsigned long, SimJoint*>::iterator iter;
+      JointMap::iterator iter;
       MutexLocker locker(&iMutex);
       for (iter = simJoints.begin(); iter != simJoints.end(); iter++)
         v_simJoints.push_back(iter->second);
@@ -232,7 +232,7 @@ namespace mars {
 
 
     void JointManager::reattacheJoints(unsigned long node_id) {
-      map<unsigned long, SimJoint*>::iterator iter;
+      JointMap::iterator iter;
       MutexLocker locker(&iMutex);
       for (iter = simJoints.begin(); iter != simJoints.end(); iter++) {
         if (iter->second->getSJoint().nodeIndex1 == node_id ||
@@ -249,24 +249,94 @@ namespace mars {
         addJoint(&(*iter), true);
     }
 
+    void JointManager::getReloadJoints(std::list<JointData> *joints) const {
+      MutexLocker locker(&iMutex);
+      *joints = simJointsReload;
+    }
+
+    void JointManager::setReloadJoints(const std::list<JointData> &joints) {
+      MutexLocker locker(&iMutex);
+      simJointsReload = joints;
+    }
+
     void JointManager::updateJoints(sReal calc_ms) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimJoint*>::iterator iter;
+      JointMap::iterator iter;
       for(iter = simJoints.begin(); iter != simJoints.end(); iter++) {
         iter->second->update(calc_ms);
       }
     }
 
+    /**
+     * \brief Appends the number of joints and the id and state of each
+     * joint.
+     */
+    void JointManager::saveState(std::vector<sReal> *state) {
+      MutexLocker locker(&iMutex);
+      JointMap::iterator iter;
+      state->push_back((sReal)simJoints.size());
+      for(iter = simJoints.begin(); iter != simJoints.end(); iter++) {
+        state->push_back((sReal)iter->first);
+        iter->second->saveState(state);
+      }
+    }
+
+    /**
+     * \brief Returns true if the ids and the number of the joints stored at
+     * pos match the joints of the simulation. Has to be called with iMutex
+     * locked.
+     */
+    bool JointManager::matchState(const std::vector<sReal> &state,
+                                  size_t pos) const {
+      JointMap::const_iterator iter;
+
+      if(pos >= state.size() || (size_t)state[pos] != simJoints.size() ||
+         pos + 1 + simJoints.size()*(JOINT_STATE_SIZE+1) > state.size()) {
+        return false;
+      }
+      ++pos;
+      for(iter = simJoints.begin(); iter != simJoints.end(); iter++) {
+        if((unsigned long)state[pos] != iter->first) return false;
+        pos += JOINT_STATE_SIZE+1;
+      }
+      return true;
+    }
+
+    bool JointManager::checkState(const std::vector<sReal> &state,
+                                  size_t *pos) {
+      MutexLocker locker(&iMutex);
+      if(!matchState(state, *pos)) return false;
+      *pos += 1 + simJoints.size()*(JOINT_STATE_SIZE+1);
+      return true;
+    }
+
+    bool JointManager::restoreState(const std::vector<sReal> &state,
+                                    size_t *pos) {
+      MutexLocker locker(&iMutex);
+      JointMap::iterator iter;
+      size_t p;
+
+      if(!matchState(state, *pos)) return false;
+      p = *pos+1;
+      for(iter = simJoints.begin(); iter != simJoints.end(); iter++) {
+        iter->second->restoreState(&state[p+1]);
+        p += JOINT_STATE_SIZE+1;
+      }
+      *pos = p;
+      return true;
+    }
+
     void JointManager::clearAllJoints(bool clear_all) {
-      map<unsigned long, SimJoint*>::iterator iter;
+      JointMap::iterator iter;
       MutexLocker locker(&iMutex);
       if(clear_all) simJointsReload.clear();
 
-      while(!simJoints.empty()) {
-        control->motors->removeJointFromMotors(simJoints.begin()->first);
-        delete simJoints.begin()->second;
-        simJoints.erase(simJoints.begin());
+      // erasing the first entry would move all others in the IDMap
+      for(iter = simJoints.begin(); iter != simJoints.end(); ++iter) {
+        control->motors->removeJointFromMotors(iter->first);
+        delete iter->second;
       }
+      simJoints.clear();
       control->sim->sceneHasChanged(false);
 
       next_joint_id = 1;
@@ -309,14 +379,14 @@ namespace mars {
 
     void JointManager::setJointTorque(unsigned long id, sReal torque) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimJoint*>::iterator iter = simJoints.find(id);
+      JointMap::iterator iter = simJoints.find(id);
       if (iter != simJoints.end())
         iter->second->setEffort(torque, 0);
     }
 
 
     void JointManager::changeStepSize(void) {
-      map<unsigned long, SimJoint*>::iterator iter;
+      JointMap::iterator iter;
       MutexLocker locker(&iMutex);
       for (iter = simJoints.begin(); iter != simJoints.end(); iter++) {
         iter->second->updateStepSize();
@@ -333,7 +403,7 @@ namespace mars {
 
     void JointManager::setSDParams(unsigned long id, JointData *sJoint) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimJoint*>::iterator iter = simJoints.find(id);
+      JointMap::iterator iter = simJoints.find(id);
       if (iter != simJoints.end())
         iter->second->setSDParams(sJoint);
     }
@@ -341,7 +411,7 @@ namespace mars {
 
     void JointManager::setVelocity(unsigned long id, sReal velocity) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimJoint*>::iterator iter = simJoints.find(id);
+      JointMap::iterator iter = simJoints.find(id);
       if (iter != simJoints.end())
         iter->second->setVelocity(velocity);
     }
@@ -349,7 +419,7 @@ namespace mars {
 
     void JointManager::setVelocity2(unsigned long id, sReal velocity) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimJoint*>::iterator iter = simJoints.find(id);
+      JointMap::iterator iter = simJoints.find(id);
       if (iter != simJoints.end())
         iter->second->setVelocity(velocity, 2);
     }
@@ -358,7 +428,7 @@ namespace mars {
     void JointManager::setForceLimit(unsigned long id, sReal max_force,
                                      bool first_axis) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimJoint*>::iterator iter = simJoints.find(id);
+      JointMap::iterator iter = simJoints.find(id);
       if (iter != simJoints.end()) {
         if (first_axis)
           iter->second->setEffortLimit(max_force);
@@ -369,7 +439,7 @@ namespace mars {
 
 
     unsigned long JointManager::getID(const std::string& joint_name) const {
-      map<unsigned long, SimJoint*>::const_iterator iter;
+      JointMap::const_iterator iter;
       MutexLocker locker(&iMutex);
       for(iter = simJoints.begin(); iter != simJoints.end(); iter++) {
         JointData joint = iter->second->getSJoint();
@@ -380,7 +450,7 @@ namespace mars {
     }
 
     unsigned long JointManager::getIDByNodeIDs(unsigned long id1, unsigned long id2) {
-      map<unsigned long, SimJoint*>::iterator iter;
+      JointMap::iterator iter;
       MutexLocker locker(&iMutex);
 
       for (iter = simJoints.begin(); iter != simJoints.end(); iter++)
@@ -395,7 +465,7 @@ namespace mars {
 
     bool JointManager::getDataBrokerNames(unsigned long id, std::string *groupName,
                                           std::string *dataName) const {
-      map<unsigned long, SimJoint*>::const_iterator iter;
+      JointMap::const_iterator iter;
       iter = simJoints.find(id);
       if(iter == simJoints.end())
         return false;
@@ -404,7 +474,7 @@ namespace mars {
     }
 
     void JointManager::setOfflineValue(unsigned long id, sReal value) {
-      map<unsigned long, SimJoint*>::const_iterator iter;
+      JointMap::const_iterator iter;
       iter = simJoints.find(id);
       if(iter == simJoints.end())
         return;
@@ -412,56 +482,56 @@ namespace mars {
     }
 
     sReal JointManager::getLowStop(unsigned long id) const {
-      map<unsigned long, SimJoint*>::const_iterator iter;
+      JointMap::const_iterator iter;
       iter = simJoints.find(id);
       if(iter == simJoints.end())
         return 0.;
       return iter->second->getLowerLimit();
     }
     sReal JointManager::getHighStop(unsigned long id) const {
-      map<unsigned long, SimJoint*>::const_iterator iter;
+      JointMap::const_iterator iter;
       iter = simJoints.find(id);
       if(iter == simJoints.end())
         return 0.;
       return iter->second->getUpperLimit();
     }
     sReal JointManager::getLowStop2(unsigned long id) const {
-      map<unsigned long, SimJoint*>::const_iterator iter;
+      JointMap::const_iterator iter;
       iter = simJoints.find(id);
       if(iter == simJoints.end())
         return 0.;
       return iter->second->getLowerLimit(2);
     }
     sReal JointManager::getHighStop2(unsigned long id) const {
-      map<unsigned long, SimJoint*>::const_iterator iter;
+      JointMap::const_iterator iter;
       iter = simJoints.find(id);
       if(iter == simJoints.end())
         return 0.;
       return iter->second->getUpperLimit(2);
     }
     void JointManager::setLowStop(unsigned long id, sReal lowStop) {
-      map<unsigned long, SimJoint*>::const_iterator iter;
+      JointMap::const_iterator iter;
       iter = simJoints.find(id);
       if(iter == simJoints.end())
         return;
       return iter->second->setLowerLimit(lowStop);
     }
     void JointManager::setHighStop(unsigned long id, sReal highStop) {
-      map<unsigned long, SimJoint*>::const_iterator iter;
+      JointMap::const_iterator iter;
       iter = simJoints.find(id);
       if(iter == simJoints.end())
         return;
       return iter->second->setUpperLimit(highStop);
     }
     void JointManager::setLowStop2(unsigned long id, sReal lowStop2) {
-      map<unsigned long, SimJoint*>::const_iterator iter;
+      JointMap::const_iterator iter;
       iter = simJoints.find(id);
       if(iter == simJoints.end())
         return;
       return iter->second->setLowerLimit(lowStop2, 2);
     }
     void JointManager::setHighStop2(unsigned long id, sReal highStop2) {
-      map<unsigned long, SimJoint*>::const_iterator iter;
+      JointMap::const_iterator iter;
       iter = simJoints.find(id);
       if(iter == simJoints.end())
         return;
@@ -472,7 +542,7 @@ namespace mars {
     void JointManager::edit(interfaces::JointId id, const std::string &key,
                             const std::string &value) {
       MutexLocker locker(&iMutex);
-      std::map<unsigned long, SimJoint*>::iterator iter = simJoints.find(id);
+      JointMap::iterator iter = simJoints.find(id);
       if (iter != simJoints.end()) {
         if(matchPattern("*/type", key)) {
         }
@@ -33,6 +33,8 @@
   #warning "JointManager.h"
 #endif
 
+#include "IDMap.h"
+
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/sim/JointManagerInterface.h>
 #include <mars/utils/Mutex.h>
@@ -42,6 +44,8 @@ namespace mars {
 
     class SimJoint;
 
+    typedef IDMap<SimJoint*> JointMap;
+
     /**
      * The declaration of the JointManager class.
      */
@@ -61,7 +65,14 @@ namespace mars {
       virtual std::vector<SimJoint*> getSimJoints(void);
       virtual void reattacheJoints(unsigned long node_id);
       virtual void reloadJoints(void);
+      virtual void getReloadJoints(std::list<interfaces::JointData> *joints) const;
+      virtual void setReloadJoints(const std::list<interfaces::JointData> &joints);
       virtual void updateJoints(interfaces::sReal calc_ms);
+      virtual void saveState(std::vector<interfaces::sReal> *state);
+      virtual bool checkState(const std::vector<interfaces::sReal> &state,
+                              size_t *pos);
+      virtual bool restoreState(const std::vector<interfaces::sReal> &state,
+                                size_t *pos);
       virtual void clearAllJoints(bool clear_all=false);
       virtual void setReloadJointOffset(unsigned long id, interfaces::sReal offset);
       virtual void setReloadJointAxis(unsigned long id, const utils::Vector &axis);
@@ -94,8 +105,10 @@ namespace mars {
                         const std::string &value);
 
     private:
+      bool matchState(const std::vector<interfaces::sReal> &state,
+                      size_t pos) const;
       unsigned long next_joint_id;
-      std::map<unsigned long, SimJoint*> simJoints;
+      JointMap simJoints;
       std::list<interfaces::JointData> simJointsReload;
       interfaces::ControlCenter *control;
       mutable utils::Mutex iMutex;
@@ -0,0 +1,348 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file MeshLoader.cpp
+ *
+ */
+
+#include "MeshLoader.h"
+
+#include <mars/interfaces/NodeData.h>
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/interfaces/Logging.hpp>
+#include <mars/utils/mathUtils.h>
+#include <mars/utils/misc.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace mars {
+  namespace sim {
+
+    using namespace interfaces;
+    using mars::utils::Vector;
+
+    static std::vector<char> readFile(const std::string &filename) {
+      std::vector<char> buffer;
+      FILE *input = fopen(filename.c_str(), "rb");
+      if(!input) return buffer;
+      fseek(input, 0, SEEK_END);
+      long size = ftell(input);
+      fseek(input, 0, SEEK_SET);
+      if(size > 0) {
+        buffer.resize(size);
+        if(fread(&buffer[0], 1, size, input) != (size_t)size) {
+          buffer.clear();
+        }
+      }
+      fclose(input);
+      return buffer;
+    }
+
+    MeshLoader::MeshLoader() {
+    }
+
+    MeshLoader::~MeshLoader() {
+      std::map<std::string, MeshFile*>::iterator it;
+      for(it=files.begin(); it!=files.end(); ++it) {
+        delete it->second;
+      }
+    }
+
+    bool MeshLoader::canLoad(const std::string &filename) {
+      std::string suffix = utils::tolower(utils::getFilenameSuffix(filename));
+      return (suffix == ".obj" || suffix == ".stl" || suffix == ".bobj");
+    }
+
+    /**
+     * \brief Returns the parsed triangles of the file or 0 if the file
+     * could not be read. Each file is only parsed once.
+     */
+    const MeshLoader::MeshFile* MeshLoader::getFile(const std::string &filename) {
+      std::map<std::string, MeshFile*>::iterator it;
+      MeshFile *mesh;
+      bool ok = false;
+
+      fileMutex.lock();
+      it = files.find(filename);
+      if(it != files.end()) {
+        mesh = it->second;
+        fileMutex.unlock();
+        return mesh;
+      }
+      mesh = new MeshFile;
+      std::string suffix = utils::tolower(utils::getFilenameSuffix(filename));
+      if(suffix == ".obj") ok = readOBJ(filename, mesh);
+      else if(suffix == ".stl") ok = readSTL(filename, mesh);
+      else if(suffix == ".bobj") ok = readBOBJ(filename, mesh);
+      if(!ok) {
+        delete mesh;
+        fileMutex.unlock();
+        LOG_ERROR("MeshLoader: could not read mesh file: %s",
+                  filename.c_str());
+        return 0;
+      }
+      files[filename] = mesh;
+      fileMutex.unlock();
+      return mesh;
+    }
+
+    /**
+     * \brief Reads the faces of an OBJ file. Polygons are split into
+     * triangle fans. The objects are named by the "o" statements, or by
+     * the "g" statements if the file has no "o" statements.
+     */
+    bool MeshLoader::readOBJ(const std::string &filename, MeshFile *mesh) {
+      std::ifstream input(filename.c_str());
+      std::vector<float> vertices;
+      std::vector<int> face;
+      std::string line, type, token;
+      int objectID = -1;
+      bool haveObjects = false;
+
+      if(!input.is_open()) return false;
+      while(std::getline(input, line)) {
+        std::istringstream stream(line);
+        if(!(stream >> type)) continue;
+        if(type == "v") {
+          float v[3] = {0.0, 0.0, 0.0};
+          stream >> v[0] >> v[1] >> v[2];
+          vertices.insert(vertices.end(), v, v+3);
+        }
+        else if(type == "o" || (type == "g" && !haveObjects)) {
+          if(type == "o") haveObjects = true;
+          std::string name;
+          std::getline(stream >> std::ws, name);
+          name = utils::trim(name);
+          objectID = -1;
+          for(size_t i=0; i<mesh->objects.size(); ++i) {
+            if(mesh->objects[i] == name) objectID = i;
+          }
+          if(objectID < 0) {
+            objectID = mesh->objects.size();
+            mesh->objects.push_back(name);
+          }
+        }
+        else if(type == "f") {
+          int numVertices = vertices.size() / 3;
+          face.clear();
+          while(stream >> token) {
+            // only the vertex index of "v/vt/vn" is needed
+            int index = atoi(token.c_str());
+            if(index < 0) index += numVertices;
+            else index -= 1;
+            if(index < 0 || index >= numVertices) break;
+            face.push_back(index);
+          }
+          for(size_t i=2; i<face.size(); ++i) {
+            const float *v0 = &vertices[face[0]*3];
+            const float *v1 = &vertices[face[i-1]*3];
+            const float *v2 = &vertices[face[i]*3];
+            mesh->vertices.insert(mesh->vertices.end(), v0, v0+3);
+            mesh->vertices.insert(mesh->vertices.end(), v1, v1+3);
+            mesh->vertices.insert(mesh->vertices.end(), v2, v2+3);
+            mesh->objectIDs.push_back(objectID);
+          }
+        }
+      }
+      return true;
+    }
+
+    /**
+     * \brief Reads a binary or ASCII STL file.
+     */
+    bool MeshLoader::readSTL(const std::string &filename, MeshFile *mesh) {
+      std::vector<char> buffer = readFile(filename);
+      unsigned int numTriangles = 0;
+
+      if(buffer.empty()) return false;
+      if(buffer.size() >= 84) {
+        memcpy(&numTriangles, &buffer[80], sizeof(unsigned int));
+      }
+      if(buffer.size() >= 84 && buffer.size() == 84 + 50*(size_t)numTriangles) {
+        float v[9];
+        mesh->vertices.reserve(numTriangles*9);
+        mesh->objectIDs.resize(numTriangles, -1);
+        for(unsigned int i=0; i<numTriangles; ++i) {
+          // skip the normal of the facet
+          memcpy(v, &buffer[84 + 50*i + 12], sizeof(v));
+          mesh->vertices.insert(mesh->vertices.end(), v, v+9);
+        }
+        return true;
+      }
+
+      std::istringstream stream(std::string(buffer.begin(), buffer.end()));
+      std::string token;
+      float v[3];
+      while(stream >> token) {
+        if(token != "vertex") continue;
+        if(!(stream >> v[0] >> v[1] >> v[2])) return false;
+        mesh->vertices.insert(mesh->vertices.end(), v, v+3);
+        if(mesh->vertices.size() % 9 == 0) {
+          mesh->objectIDs.push_back(-1);
+        }
+      }
+      mesh->vertices.resize(mesh->objectIDs.size()*9);
+      return true;
+    }
+
+    /**
+     * \brief Reads the binary .bobj format as written by the MARS
+     * Blender exporter. Each record starts with an int that defines its
+     * type: 1 vertex (3 floats), 2 texture coordinate (2 floats),
+     * 3 normal (3 floats), 4 triangle (3 times vertex, texture and
+     * normal index as int, starting at 1).
+     */
+    bool MeshLoader::readBOBJ(const std::string &filename, MeshFile *mesh) {
+      std::vector<char> buffer = readFile(filename);
+      std::vector<float> vertices;
+      size_t o = 0, size = buffer.size();
+      int da, iData[9];
+      float fData[3];
+
+      if(buffer.empty()) return false;
+      while(o + sizeof(int) <= size) {
+        memcpy(&da, &buffer[o], sizeof(int));
+        o += sizeof(int);
+        if(da == 1 && o + sizeof(fData) <= size) {
+          memcpy(fData, &buffer[o], sizeof(fData));
+          o += sizeof(fData);
+          vertices.insert(vertices.end(), fData, fData+3);
+        }
+        else if(da == 2) {
+          o += 2*sizeof(float);
+        }
+        else if(da == 3) {
+          o += 3*sizeof(float);
+        }
+        else if(da == 4 && o + sizeof(iData) <= size) {
+          memcpy(iData, &buffer[o], sizeof(iData));
+          o += sizeof(iData);
+          for(int i=0; i<9; i+=3) {
+            int index = iData[i]-1;
+            if(index < 0 || (size_t)index*3 >= vertices.size()) {
+              return false;
+            }
+            mesh->vertices.insert(mesh->vertices.end(), &vertices[index*3],
+                                  &vertices[index*3]+3);
+          }
+          mesh->objectIDs.push_back(-1);
+        }
+      }
+      return true;
+    }
+
+    std::vector<double> MeshLoader::getMeshSize(const std::string &filename) {
+      std::vector<double> r(3, 0.0);
+      const MeshFile *file = getFile(filename);
+      if(!file || file->vertices.empty()) return r;
+
+      float min[3], max[3];
+      for(int k=0; k<3; ++k) min[k] = max[k] = file->vertices[k];
+      for(size_t i=0; i<file->vertices.size(); i+=3) {
+        for(int k=0; k<3; ++k) {
+          if(file->vertices[i+k] < min[k]) min[k] = file->vertices[i+k];
+          if(file->vertices[i+k] > max[k]) max[k] = file->vertices[i+k];
+        }
+      }
+      for(int k=0; k<3; ++k) r[k] = max[k] - min[k];
+      return r;
+    }
+
+    void MeshLoader::getPhysicsFromMesh(NodeData *node) {
+      const MeshFile *file = getFile(node->filename);
+      std::vector<size_t> triangles;
+      int objectID = -1;
+
+      if(!file) {
+        throw std::runtime_error("cannot read node from file");
+      }
+      for(size_t i=0; i<file->objects.size(); ++i) {
+        if(file->objects[i] == node->origName) {
+          objectID = i;
+          break;
+        }
+      }
+      // like the GuiHelper, a file without objects is used completely and
+      // an object that is not found gives an empty mesh
+      if(objectID < 0 && !file->objects.empty()) {
+        LOG_WARN("MeshLoader: object \"%s\" not found in mesh file: %s",
+                 node->origName.c_str(), node->filename.c_str());
+      }
+      for(size_t i=0; i<file->objectIDs.size(); ++i) {
+        if(file->objects.empty() || file->objectIDs[i] == objectID) {
+          triangles.push_back(i);
+        }
+      }
+
+      // bounding box of the used triangles
+      float min[3] = {0.0, 0.0, 0.0}, max[3] = {0.0, 0.0, 0.0};
+      for(size_t t=0; t<triangles.size(); ++t) {
+        const float *v = &file->vertices[triangles[t]*9];
+        for(int i=0; i<9; ++i) {
+          if((t == 0 && i < 3) || v[i] < min[i%3]) min[i%3] = v[i];
+          if((t == 0 && i < 3) || v[i] > max[i%3]) max[i%3] = v[i];
+        }
+      }
+      Vector ex(max[0]-min[0], max[1]-min[1], max[2]-min[2]);
+
+      if (node->map.find("loadSizeFromMesh") != node->map.end()) {
+        if (node->map["loadSizeFromMesh"]) {
+          Vector physicalScale;
+          utils::vectorFromConfigItem(&(node->map["physicalScale"][0]), &physicalScale);
+          node->ext=Vector(ex.x()*physicalScale.x(), ex.y()*physicalScale.y(), ex.z()*physicalScale.z());
+        }
+      }
+
+      //compute scale factor
+      double scale[3] = {1, 1, 1};
+      if (ex.x() != 0) scale[0] = node->ext.x() / ex.x();
+      if (ex.y() != 0) scale[1] = node->ext.y() / ex.y();
+      if (ex.z() != 0) scale[2] = node->ext.z() / ex.z();
+      double pivot[3] = {node->pivot.x(), node->pivot.y(), node->pivot.z()};
+
+      int count = triangles.size()*3;
+      snmesh mesh;
+      if(count > 0) {
+        mesh.vertices = new mydVector3[count];
+        mesh.indices = new int[count];
+      }
+      for(size_t t=0; t<triangles.size(); ++t) {
+        const float *v = &file->vertices[triangles[t]*9];
+        for(int i=0; i<3; ++i) {
+          int n = t*3+i;
+          for(int k=0; k<3; ++k) {
+            mesh.vertices[n][k] = (v[i*3+k] - pivot[k]) * scale[k];
+          }
+          mesh.indices[n] = n;
+        }
+      }
+      mesh.vertexcount = count;
+      mesh.indexcount = count;
+      node->mesh = mesh;
+    }
+
+  } // end of namespace sim
+} // end of namespace mars
@@ -0,0 +1,91 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file MeshLoader.h
+ * \brief "MeshLoader" reads the collision meshes of OBJ, STL and .bobj
+ *        files without the graphics library.
+ */
+
+#ifndef MESH_LOADER_H
+#define MESH_LOADER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "MeshLoader.h"
+#endif
+
+#include <mars/interfaces/sim/LoadCenter.h>
+#include <mars/utils/Mutex.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace sim {
+
+    /**
+     * A LoadMeshInterface that parses the mesh files directly into the
+     * snmesh of a node. It is used when mars_graphics is not loaded, so
+     * that a headless simulation does not have to load the graphics
+     * stack for its collision meshes.
+     *
+     * The result matches the one of the GuiHelper: The triangles of an
+     * OBJ file are taken from the objects named like the origName of the
+     * node, scaled to the extent of the node and moved by its pivot. The
+     * mesh is empty if the file has objects but none of them matches,
+     * while files without objects are used completely.
+     */
+    class MeshLoader : public interfaces::LoadMeshInterface {
+    public:
+      MeshLoader();
+      ~MeshLoader();
+
+      virtual void getPhysicsFromMesh(interfaces::NodeData *node);
+      virtual std::vector<double> getMeshSize(const std::string &filename);
+
+      /** \brief Returns true if the format of the file is supported. */
+      static bool canLoad(const std::string &filename);
+
+    private:
+      /**
+       * The triangles of a file. The vertices of the i-th triangle are
+       * stored at vertices[9*i] and the triangle belongs to the object
+       * objects[objectIDs[i]].
+       */
+      struct MeshFile {
+        std::vector<float> vertices;
+        std::vector<int> objectIDs;
+        std::vector<std::string> objects;
+      };
+
+      utils::Mutex fileMutex;
+      std::map<std::string, MeshFile*> files;
+
+      const MeshFile* getFile(const std::string &filename);
+      static bool readOBJ(const std::string &filename, MeshFile *mesh);
+      static bool readSTL(const std::string &filename, MeshFile *mesh);
+      static bool readBOBJ(const std::string &filename, MeshFile *mesh);
+    };
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif  // MESH_LOADER_H
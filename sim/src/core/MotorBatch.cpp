@@ -0,0 +1,289 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file MotorBatch.cpp
+ * \brief "MotorBatch" updates the motors of the MotorManager on
+ *        contiguous arrays instead of one SimMotor after the other.
+ */
+
+#include "MotorBatch.h"
+#include "SimMotor.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace mars {
+  namespace sim {
+
+    using namespace interfaces;
+
+    MotorBatch::MotorBatch() : dirty(true), numPosition(0), numVelocity(0) {
+    }
+
+    /**
+     * \brief Returns whether the update of \a motor only depends on the
+     * values kept in the arrays and thus can be batched.
+     */
+    bool MotorBatch::isBatchable(const SimMotor *motor) {
+      return (motor->active && motor->myJoint &&
+              motor->sMotor.axis == 1 && motor->axis == 1 &&
+              !motor->mimic && motor->mimics.empty() &&
+              motor->maxEffortApproximation == &utils::pipe &&
+              motor->maxeffort_x == &motor->sMotor.maxEffort &&
+              motor->maxSpeedApproximation == &utils::pipe &&
+              motor->maxspeed_x == &motor->sMotor.maxSpeed &&
+              motor->currentApproximation == &SpaceClimberCurrent &&
+              motor->current_coefficients &&
+              motor->current_coefficients->size() >= 4);
+    }
+
+    bool MotorBatch::isChanged() const {
+      for(size_t k=0; k<scalarMotors.size(); ++k) {
+        if(scalarMotors[k]->batchVersion != scalarVersions[k]) return true;
+      }
+      return false;
+    }
+
+    void MotorBatch::rebuild(IDMap<SimMotor*> &motors) {
+      IDMap<SimMotor*>::iterator iter;
+      std::vector<SimMotor*> velocityMotors, effortMotors;
+
+      scalarMotors.clear();
+      scalarVersions.clear();
+      batchMotors.clear();
+      batchVersions.clear();
+      for(iter = motors.begin(); iter != motors.end(); ++iter) {
+        SimMotor *motor = iter->second;
+        if(!isBatchable(motor)) {
+          scalarMotors.push_back(motor);
+          scalarVersions.push_back(motor->batchVersion);
+        }
+        else if(motor->runController == &SimMotor::runPositionController) {
+          batchMotors.push_back(motor);
+        }
+        else if(motor->runController == &SimMotor::runVeloctiyController) {
+          velocityMotors.push_back(motor);
+        }
+        else {
+          effortMotors.push_back(motor);
+        }
+      }
+      numPosition = batchMotors.size();
+      numVelocity = velocityMotors.size();
+      batchMotors.insert(batchMotors.end(), velocityMotors.begin(),
+                         velocityMotors.end());
+      batchMotors.insert(batchMotors.end(), effortMotors.begin(),
+                         effortMotors.end());
+
+      size_t n = batchMotors.size();
+      batchVersions.resize(n);
+      joints.resize(n); playJoints.resize(n);
+      minValue.resize(n); maxValue.resize(n);
+      p.resize(n); i.resize(n); d.resize(n);
+      maxSpeed.resize(n); maxEffort.resize(n); filter.resize(n);
+      c0.resize(n); c1.resize(n); c2.resize(n); c3.resize(n);
+      voltage.resize(n); heatloss.resize(n);
+      heatTransfer.resize(n); ambient.resize(n);
+      position.resize(n); controlValue.resize(n); error.resize(n);
+      integError.resize(n); lastError.resize(n);
+      velocity.resize(n); lastVelocity.resize(n); effort.resize(n);
+      jointVelocity.resize(n); current.resize(n); temperature.resize(n);
+
+      for(size_t k=0; k<n; ++k) {
+        SimMotor *motor = batchMotors[k];
+        const std::vector<sReal> &c = *motor->current_coefficients;
+        batchVersions[k] = motor->batchVersion;
+        joints[k] = motor->myJoint;
+        playJoints[k] = motor->myPlayJoint;
+        // the limits of the pipe approximations only change with a rebuild
+        motor->tmpmaxspeed = motor->sMotor.maxSpeed;
+        motor->tmpmaxeffort = motor->sMotor.maxEffort;
+        minValue[k] = motor->sMotor.minValue;
+        maxValue[k] = motor->sMotor.maxValue;
+        p[k] = motor->sMotor.p;
+        i[k] = motor->sMotor.i;
+        d[k] = motor->sMotor.d;
+        maxSpeed[k] = motor->sMotor.maxSpeed;
+        maxEffort[k] = motor->sMotor.maxEffort;
+        filter[k] = motor->filterValue;
+        c0[k] = c[0];
+        c1[k] = c[1];
+        c2[k] = c[2];
+        c3[k] = c[3];
+        voltage[k] = motor->voltage;
+        heatloss[k] = motor->heatlossCoefficient;
+        heatTransfer[k] = motor->heatTransferCoefficient;
+        ambient[k] = motor->ambientTemperature;
+        // only changed by the update or by restoreState
+        error[k] = motor->error;
+        integError[k] = motor->integ_error;
+        lastError[k] = motor->last_error;
+        velocity[k] = motor->velocity;
+        lastVelocity[k] = motor->lastVelocity;
+        temperature[k] = motor->temperature;
+      }
+      dirty = false;
+    }
+
+    bool MotorBatch::gather() {
+      bool changed = false;
+      for(size_t k=0; k<batchMotors.size(); ++k) {
+        const SimMotor *motor = batchMotors[k];
+        const SimJoint *joint = joints[k];
+        sReal play_position = 0.0;
+        if(playJoints[k]) play_position = playJoints[k]->getPosition();
+        position[k] = joint->getPosition() + play_position;
+        controlValue[k] = motor->controlValue;
+        // the feedback of the last physics step, as in estimateCurrent
+        effort[k] = joint->getMotorTorque();
+        jointVelocity[k] = joint->getVelocity();
+        changed |= (motor->batchVersion != batchVersions[k]);
+      }
+      return !changed;
+    }
+
+    void MotorBatch::update(IDMap<SimMotor*> &motors, sReal time_ms) {
+      size_t n, numServo;
+
+      if(dirty || isChanged() || !gather()) {
+        rebuild(motors);
+        gather();
+      }
+      for(size_t k=0; k<scalarMotors.size(); ++k) {
+        scalarMotors[k]->update(time_ms);
+      }
+      n = batchMotors.size();
+      numServo = numPosition + numVelocity;
+
+      runPositionControllers(0, numPosition, time_ms);
+      runVelocityControllers(numPosition, numServo);
+      runEffortControllers(numServo, n, time_ms);
+      estimateCurrentAndTemperature(time_ms);
+
+      // write back the results and command the joints
+      for(size_t k=0; k<n; ++k) {
+        SimMotor *motor = batchMotors[k];
+        motor->time = time_ms;
+        motor->position1 = position[k];
+        motor->controlValue = controlValue[k];
+        motor->velocity = velocity[k];
+        motor->effort = effort[k];
+        motor->joint_velocity = jointVelocity[k];
+        motor->current = current[k];
+        motor->temperature = temperature[k];
+        if(k < numPosition || k >= numServo) {
+          motor->error = error[k];
+          motor->integ_error = integError[k];
+          motor->last_error = lastError[k];
+          motor->lastVelocity = lastVelocity[k];
+        }
+        joints[k]->setEffortLimit(maxEffort[k], 1);
+        // like SimMotor::update, effort motors pass the torque read above
+        if(k < numServo) joints[k]->setVelocity(velocity[k], 1);
+        else joints[k]->setEffort(effort[k], 1);
+      }
+    }
+
+    /**
+     * \brief The loop version of SimMotor::runPositionController followed
+     * by the speed limit of SimMotor::update.
+     */
+    void MotorBatch::runPositionControllers(size_t begin, size_t end,
+                                            sReal time_ms) {
+      for(size_t k=begin; k<end; ++k) {
+        sReal cv = std::max(minValue[k], std::min(controlValue[k], maxValue[k]));
+        sReal er = cv - position[k];
+        er = std::abs(er) < 0.000001 ? 0.0 : er;
+        sReal integ = integError[k] + er*time_ms;
+        // anti wind up, selects instead of branches to keep the loop flat
+        sReal iPart = integ * i[k];
+        sReal limited = std::max(std::min(iPart, maxSpeed[k]), -maxSpeed[k]);
+        integ = limited != iPart ? limited / i[k] : integ;
+        iPart = limited;
+        sReal v = er * p[k];
+        v += iPart;
+        v += ((er - lastError[k])/time_ms) * d[k];
+        v = lastVelocity[k]*filter[k] + v*(1-filter[k]);
+
+        controlValue[k] = cv;
+        error[k] = er;
+        integError[k] = integ;
+        lastError[k] = er;
+        lastVelocity[k] = v;
+        velocity[k] = std::max(-maxSpeed[k], std::min(v, maxSpeed[k]));
+      }
+    }
+
+    void MotorBatch::runVelocityControllers(size_t begin, size_t end) {
+      for(size_t k=begin; k<end; ++k) {
+        velocity[k] = std::max(-maxSpeed[k],
+                               std::min(controlValue[k], maxSpeed[k]));
+      }
+    }
+
+    /**
+     * \brief The loop version of SimMotor::runEffortController followed
+     * by the speed limit of SimMotor::update.
+     */
+    void MotorBatch::runEffortControllers(size_t begin, size_t end,
+                                          sReal time_ms) {
+      for(size_t k=begin; k<end; ++k) {
+        sReal cv = std::max(minValue[k], std::min(controlValue[k], maxValue[k]));
+        if(cv > 2*M_PI) cv = 0;
+        else if(cv > M_PI) cv = -2*M_PI + cv;
+        else if(cv < -2*M_PI) cv = 0;
+        else if(cv < -M_PI) cv = 2*M_PI + cv;
+        sReal er = cv - position[k];
+        if(er > M_PI) er = -2*M_PI + er;
+        else if(er < -M_PI) er = 2*M_PI + er;
+        sReal integ = integError[k] + er*time_ms;
+
+        controlValue[k] = cv;
+        error[k] = er;
+        integError[k] = integ;
+        lastError[k] = er;
+        velocity[k] = std::max(-maxSpeed[k],
+                               std::min(velocity[k], maxSpeed[k]));
+        // the effort is replaced by the measured motor torque before it
+        // is passed to the joint, thus the PID output is not stored
+      }
+    }
+
+    /**
+     * \brief The loop version of SimMotor::estimateCurrent with the
+     * SpaceClimberCurrent approximation and SimMotor::estimateTemperature.
+     */
+    void MotorBatch::estimateCurrentAndTemperature(sReal time_ms) {
+      size_t n = batchMotors.size();
+      for(size_t k=0; k<n; ++k) {
+        sReal e = effort[k], v = jointVelocity[k];
+        current[k] = std::abs(c0[k]*std::abs(e*v) + c1[k]*std::abs(e) +
+                              c2[k]*std::abs(v) + c3[k]);
+      }
+      for(size_t k=0; k<n; ++k) {
+        sReal dissipation = (heatTransfer[k] * (temperature[k] - ambient[k]))*time_ms/1000.0;
+        sReal production = (current[k] * voltage[k] * heatloss[k])*time_ms/1000.0;
+        temperature[k] = temperature[k] - dissipation + production;
+      }
+    }
+
+  } // end of namespace sim
+} // end of namespace mars
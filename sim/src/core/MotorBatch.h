@@ -0,0 +1,107 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file MotorBatch.h
+ * \brief "MotorBatch" updates the motors of the MotorManager on
+ *        contiguous arrays instead of one SimMotor after the other.
+ */
+
+#ifndef MOTOR_BATCH_H
+#define MOTOR_BATCH_H
+
+#ifdef _PRINT_HEADER_
+  #warning "MotorBatch.h"
+#endif
+
+#include "IDMap.h"
+
+#include <mars/interfaces/MARSDefs.h>
+
+#include <vector>
+
+namespace mars {
+  namespace sim {
+
+    class SimJoint;
+    class SimMotor;
+
+    /**
+     * Does the work of SimMotor::update for all motors of a MotorMap.
+     * The parameters and the controller state of the motors are kept in
+     * one array per value, sorted by controller type. Each step gathers
+     * the joint positions and control values, runs the controllers and
+     * the current and temperature estimation in plain loops over the
+     * arrays and writes the results back to the motors and joints.
+     *
+     * Motors whose update can not be expressed this way (mimic motors,
+     * second axis motors, other approximation functions) are updated by
+     * SimMotor::update in id order. The arrays are rebuilt after
+     * invalidate() or when a SimMotor reports a changed configuration
+     * through its batchVersion.
+     */
+    class MotorBatch {
+    public:
+      MotorBatch();
+
+      /// Has to be called when motors are added or removed.
+      void invalidate() {dirty = true;}
+      void update(IDMap<SimMotor*> &motors, interfaces::sReal time_ms);
+
+    private:
+      bool dirty;
+      std::vector<SimMotor*> scalarMotors;
+      std::vector<unsigned long> scalarVersions;
+      // the batched motors: position, then velocity, then effort controlled
+      std::vector<SimMotor*> batchMotors;
+      std::vector<unsigned long> batchVersions;
+      std::vector<SimJoint*> joints, playJoints;
+      size_t numPosition, numVelocity;
+
+      // parameters
+      std::vector<interfaces::sReal> minValue, maxValue, p, i, d;
+      std::vector<interfaces::sReal> maxSpeed, maxEffort, filter;
+      std::vector<interfaces::sReal> c0, c1, c2, c3;
+      std::vector<interfaces::sReal> voltage, heatloss, heatTransfer, ambient;
+
+      // state
+      std::vector<interfaces::sReal> position, controlValue, error;
+      std::vector<interfaces::sReal> integError, lastError;
+      std::vector<interfaces::sReal> velocity, lastVelocity, effort;
+      std::vector<interfaces::sReal> jointVelocity, current, temperature;
+
+      static bool isBatchable(const SimMotor *motor);
+      /// the scalar motors changed their configuration
+      bool isChanged() const;
+      /// reads the joints and commands, false if a batched motor changed
+      bool gather();
+      void rebuild(IDMap<SimMotor*> &motors);
+      void runPositionControllers(size_t begin, size_t end,
+                                  interfaces::sReal time_ms);
+      void runVelocityControllers(size_t begin, size_t end);
+      void runEffortControllers(size_t begin, size_t end,
+                                interfaces::sReal time_ms);
+      void estimateCurrentAndTemperature(interfaces::sReal time_ms);
+    };
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif  // MOTOR_BATCH_H
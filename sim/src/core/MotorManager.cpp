@@ -96,6 +96,7 @@ namespace mars {
       newMotor->setSMotor(*motorS);
       iMutex.lock();
       simMotors[newMotor->getIndex()] = newMotor;
+      motorBatch.invalidate();
       iMutex.unlock();
       control->sim->sceneHasChanged(false);
 
@@ -167,7 +168,7 @@ namespace mars {
      */
     void MotorManager::editMotor(const MotorData &motorS) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::iterator iter = simMotors.find(motorS.index);
+      MotorMap::iterator iter = simMotors.find(motorS.index);
       if (iter != simMotors.end())
         iter->second->setSMotor(motorS);
     }
@@ -182,7 +183,7 @@ namespace mars {
      */
     void MotorManager::getListMotors(vector<core_objects_exchange> *motorList)const{
       core_objects_exchange obj;
-      map<unsigned long, SimMotor*>::const_iterator iter;
+      MotorMap::const_iterator iter;
       motorList->clear();
       iMutex.lock();
       for (iter = simMotors.begin(); iter != simMotors.end(); iter++) {
@@ -203,7 +204,7 @@ namespace mars {
      */
     const MotorData MotorManager::getFullMotor(unsigned long index) const {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::const_iterator iter = simMotors.find(index);
+      MotorMap::const_iterator iter = simMotors.find(index);
       if (iter != simMotors.end())
         return iter->second->getSMotor();
       else {
@@ -222,10 +223,11 @@ namespace mars {
     void MotorManager::removeMotor(unsigned long index) {
       SimMotor* tmpMotor = NULL;
       iMutex.lock();
-      map<unsigned long, SimMotor*>::iterator iter = simMotors.find(index);
+      MotorMap::iterator iter = simMotors.find(index);
       if (iter != simMotors.end()) {
         tmpMotor = iter->second;
         simMotors.erase(iter);
+        motorBatch.invalidate();
         if (tmpMotor)
           delete tmpMotor;
       }
@@ -249,7 +251,7 @@ namespace mars {
      */
     SimMotor* MotorManager::getSimMotor(unsigned long id) const {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::const_iterator iter = simMotors.find(id);
+      MotorMap::const_iterator iter = simMotors.find(id);
       if (iter != simMotors.end())
         return iter->second;
       else
@@ -272,7 +274,7 @@ namespace mars {
      */
     SimMotor* MotorManager::getSimMotorByName(const std::string &name) const {
       MutexLocker locker(&iMutex);
-      std::map<unsigned long, SimMotor*>::const_iterator iter;
+      MotorMap::const_iterator iter;
       for (iter = simMotors.begin(); iter != simMotors.end(); iter++)
         if (iter->second->getName() == name)
           return iter->second;
@@ -293,7 +295,7 @@ namespace mars {
      */
     void MotorManager::setMotorValue(unsigned long id, sReal value) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::iterator iter = simMotors.find(id);
+      MotorMap::iterator iter = simMotors.find(id);
       if (iter != simMotors.end())
         iter->second->setControlValue(value);
     }
@@ -301,7 +303,7 @@ namespace mars {
 
     void MotorManager::setMotorValueDesiredVelocity(unsigned long id, sReal velocity) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::iterator iter = simMotors.find(id);
+      MotorMap::iterator iter = simMotors.find(id);
       if (iter != simMotors.end())
         iter->second->setVelocity(velocity);
     }
@@ -321,7 +323,7 @@ namespace mars {
      */
     void MotorManager::setMotorP(unsigned long id, sReal value) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::iterator iter = simMotors.find(id);
+      MotorMap::iterator iter = simMotors.find(id);
       if (iter != simMotors.end())
         iter->second->setP(value);
     }
@@ -340,7 +342,7 @@ namespace mars {
      */
     void MotorManager::setMotorI(unsigned long id, sReal value) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::iterator iter = simMotors.find(id);
+      MotorMap::iterator iter = simMotors.find(id);
       if (iter != simMotors.end())
         iter->second->setI(value);
     }
@@ -359,7 +361,7 @@ namespace mars {
      */
     void MotorManager::setMotorD(unsigned long id, sReal value) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::iterator iter = simMotors.find(id);
+      MotorMap::iterator iter = simMotors.find(id);
       if (iter != simMotors.end())
         iter->second->setD(value);
     }
@@ -372,7 +374,7 @@ namespace mars {
      */
     void MotorManager::deactivateMotor(unsigned long id) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::iterator iter = simMotors.find(id);
+      MotorMap::iterator iter = simMotors.find(id);
       if (iter != simMotors.end())
         iter->second->deactivate();
     }
@@ -386,7 +388,7 @@ namespace mars {
      * \return Id of the motor if it exists, otherwise 0
      */
     unsigned long MotorManager::getID(const std::string& name) const {
-      map<unsigned long, SimMotor*>::const_iterator iter;
+      MotorMap::const_iterator iter;
       MutexLocker locker(&iMutex);
 
       for (iter = simMotors.begin(); iter != simMotors.end(); iter++) {
@@ -410,7 +412,7 @@ namespace mars {
      */
     void MotorManager::moveMotor(unsigned long index, double value) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::iterator iter = simMotors.find(index);
+      MotorMap::iterator iter = simMotors.find(index);
       if (iter != simMotors.end())
         iter->second->setControlValue(value);
     }
@@ -427,10 +429,11 @@ namespace mars {
      */
     void MotorManager::clearAllMotors(bool clear_all) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::iterator iter;
+      MotorMap::iterator iter;
       for(iter = simMotors.begin(); iter != simMotors.end(); iter++)
         delete iter->second;
       simMotors.clear();
+      motorBatch.invalidate();
       mimicmotors.clear();
       if(clear_all) simMotorsReload.clear();
       next_motor_id = 1;
@@ -455,6 +458,16 @@ namespace mars {
       connectMimics();
     }
 
+    void MotorManager::getReloadMotors(std::list<MotorData> *motors) const {
+      MutexLocker locker(&iMutex);
+      *motors = simMotorsReload;
+    }
+
+    void MotorManager::setReloadMotors(const std::list<MotorData> &motors) {
+      MutexLocker locker(&iMutex);
+      simMotorsReload = motors;
+    }
+
     /**
      * \brief This function updates all motors with timing value \c calc_ms in miliseconds.
      *
@@ -464,16 +477,73 @@ namespace mars {
      * \param calc_ms The timing value in miliseconds.
      */
     void MotorManager::updateMotors(double calc_ms) {
-      map<unsigned long, SimMotor*>::iterator iter;
       MutexLocker locker(&iMutex);
-      for(iter = simMotors.begin(); iter != simMotors.end(); iter++)
-        iter->second->update(calc_ms);
+      motorBatch.update(simMotors, calc_ms);
+    }
+
+
+    /**
+     * \brief Appends the number of motors and the id and state of each
+     * motor.
+     */
+    void MotorManager::saveState(std::vector<sReal> *state) {
+      MutexLocker locker(&iMutex);
+      MotorMap::iterator iter;
+      state->push_back((sReal)simMotors.size());
+      for(iter = simMotors.begin(); iter != simMotors.end(); iter++) {
+        state->push_back((sReal)iter->first);
+        iter->second->saveState(state);
+      }
     }
 
+    /**
+     * \brief Returns true if the ids and the number of the motors stored at
+     * pos match the motors of the simulation. Has to be called with iMutex
+     * locked.
+     */
+    bool MotorManager::matchState(const std::vector<sReal> &state,
+                                  size_t pos) const {
+      MotorMap::const_iterator iter;
+
+      if(pos >= state.size() || (size_t)state[pos] != simMotors.size() ||
+         pos + 1 + simMotors.size()*(MOTOR_STATE_SIZE+1) > state.size()) {
+        return false;
+      }
+      ++pos;
+      for(iter = simMotors.begin(); iter != simMotors.end(); iter++) {
+        if((unsigned long)state[pos] != iter->first) return false;
+        pos += MOTOR_STATE_SIZE+1;
+      }
+      return true;
+    }
+
+    bool MotorManager::checkState(const std::vector<sReal> &state,
+                                  size_t *pos) {
+      MutexLocker locker(&iMutex);
+      if(!matchState(state, *pos)) return false;
+      *pos += 1 + simMotors.size()*(MOTOR_STATE_SIZE+1);
+      return true;
+    }
+
+    bool MotorManager::restoreState(const std::vector<sReal> &state,
+                                    size_t *pos) {
+      MutexLocker locker(&iMutex);
+      MotorMap::iterator iter;
+      size_t p;
+
+      if(!matchState(state, *pos)) return false;
+      p = *pos+1;
+      for(iter = simMotors.begin(); iter != simMotors.end(); iter++) {
+        iter->second->restoreState(&state[p+1]);
+        p += MOTOR_STATE_SIZE+1;
+      }
+      *pos = p;
+      return true;
+    }
 
     sReal MotorManager::getActualPosition(unsigned long motorId) const {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::const_iterator iter;
+      MotorMap::const_iterator iter;
       iter = simMotors.find(motorId);
       if (iter != simMotors.end())
         return iter->second->getPosition();
@@ -482,7 +552,7 @@ namespace mars {
 
     sReal MotorManager::getTorque(unsigned long motorId) const {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::const_iterator iter;
+      MotorMap::const_iterator iter;
       iter = simMotors.find(motorId);
       if (iter != simMotors.end())
         return iter->second->getEffort();
@@ -491,7 +561,7 @@ namespace mars {
 
     void MotorManager::setMaxTorque(unsigned long id, sReal maxTorque) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::const_iterator iter;
+      MotorMap::const_iterator iter;
       iter = simMotors.find(id);
       if (iter != simMotors.end())
         iter->second->setMaxEffort(maxTorque);
@@ -499,7 +569,7 @@ namespace mars {
 
     void MotorManager::setMaxSpeed(unsigned long id, sReal maxSpeed) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::const_iterator iter;
+      MotorMap::const_iterator iter;
       iter = simMotors.find(id);
       if (iter != simMotors.end())
         iter->second->setMaxSpeed(maxSpeed);
@@ -517,7 +587,7 @@ namespace mars {
      * \param joint_index The id of the joint that is to be detached.
      */
     void MotorManager::removeJointFromMotors(unsigned long joint_index) {
-      map<unsigned long, SimMotor*>::iterator iter;
+      MotorMap::iterator iter;
       MutexLocker locker(&iMutex);
       for (iter = simMotors.begin(); iter != simMotors.end(); iter++)
         if (iter->second->getJointIndex() == joint_index)
@@ -528,7 +598,7 @@ namespace mars {
                                           std::string *groupName,
                                           std::string *dataName) const {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::const_iterator iter = simMotors.find(jointId);
+      MotorMap::const_iterator iter = simMotors.find(jointId);
       if(iter != simMotors.end())
         iter->second->getDataBrokerNames(groupName, dataName);
     }
@@ -545,7 +615,7 @@ namespace mars {
     void MotorManager::edit(interfaces::MotorId id, const std::string &key,
                             const std::string &value) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, SimMotor*>::iterator iter = simMotors.find(id);
+      MotorMap::iterator iter = simMotors.find(id);
       if(iter != simMotors.end()) {
         if(matchPattern("*/p", key)) {
           iter->second->setP(atof(value.c_str()));
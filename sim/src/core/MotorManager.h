@@ -38,6 +38,9 @@
   #warning "MotorManager.h"
 #endif
 
+#include "IDMap.h"
+#include "MotorBatch.h"
+
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/sim/MotorManagerInterface.h>
 #include <mars/utils/Mutex.h>
@@ -47,6 +50,8 @@ namespace mars {
 
     class SimMotor;
 
+    typedef IDMap<SimMotor*> MotorMap;
+
     /**
      * \brief "MotorManager" imlements the interfaces for all motor 
      * operations that are used for the communication between the simulation 
@@ -252,6 +257,8 @@ namespace mars {
        * are added back to the simulation again with a \c reload value of \c true. 
        */
       virtual void reloadMotors(void);
+      virtual void getReloadMotors(std::list<interfaces::MotorData> *motors) const;
+      virtual void setReloadMotors(const std::list<interfaces::MotorData> &motors);
 
       /**
        * \brief This function updates all motors with timing value \c calc_ms in miliseconds.
@@ -262,6 +269,11 @@ namespace mars {
        * \param calc_ms The timing value in miliseconds. 
        */
       virtual void updateMotors(interfaces::sReal calc_ms);
+      virtual void saveState(std::vector<interfaces::sReal> *state);
+      virtual bool checkState(const std::vector<interfaces::sReal> &state,
+                              size_t *pos);
+      virtual bool restoreState(const std::vector<interfaces::sReal> &state,
+                                size_t *pos);
 
       /**
        * \returns the actual position of the motor with the given Id.
@@ -318,11 +330,16 @@ namespace mars {
                         const std::string &value);
 
     private:
+      bool matchState(const std::vector<interfaces::sReal> &state,
+                      size_t pos) const;
       //! the id of the next motor that is added to the simulation
       unsigned long next_motor_id;
 
       //! a container for all motors currently present in the simulation
-      std::map<unsigned long, SimMotor*> simMotors;
+      MotorMap simMotors;
+
+      //! updates the motors of simMotors in updateMotors
+      MotorBatch motorBatch;
 
       //! a containter for all motors that are reloaded after a reset of the simulation
       std::list<interfaces::MotorData> simMotorsReload;
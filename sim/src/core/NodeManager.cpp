@@ -30,6 +30,7 @@
 #include "NodeManager.h"
 #include "JointManager.h"
 #include "PhysicsMapper.h"
+#include "MeshLoader.h"
 
 #include <mars/interfaces/sim/LoadCenter.h>
 #include <mars/interfaces/sim/SimulatorInterface.h>
@@ -44,6 +45,8 @@
 #include <mars/utils/misc.h>
 
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
 
 #include <mars/utils/MutexLocker.h>
 
@@ -54,6 +57,43 @@ namespace mars {
     using namespace utils;
     using namespace interfaces;
 
+    /**
+     * \brief Prepares a terrain that uses a raw float DEM as source.
+     *
+     * The physics maps the DEM by itself, so pixelData is only filled if
+     * it is needed for the graphics. A square DEM without given sample
+     * count gets its size from the file size.
+     */
+    static bool prepareFloatDEM(terrainStruct *terrain, bool needPixelData) {
+      FILE *input = fopen(terrain->srcname.c_str(), "rb");
+      if(!input) return false;
+      fseek(input, 0, SEEK_END);
+      long count = ftell(input) / sizeof(float);
+      if(terrain->width <= 0 || terrain->height <= 0) {
+        terrain->width = terrain->height = (int)(sqrt((double)count)+0.5);
+      }
+      if((long)terrain->width*terrain->height != count) {
+        fclose(input);
+        return false;
+      }
+      terrain->pixelData = 0;
+      if(needPixelData) {
+        // pixelData is stored with the -y edge first
+        std::vector<float> row(terrain->width);
+        terrain->pixelData = (double*)calloc(count, sizeof(double));
+        fseek(input, 0, SEEK_SET);
+        for(int y=terrain->height-1; y>=0; --y) {
+          if(fread(&row[0], sizeof(float), row.size(), input) != row.size()) {
+            break;
+          }
+          double *dst = terrain->pixelData + (size_t)y*terrain->width;
+          for(int x=0; x<terrain->width; ++x) dst[x] = row[x];
+        }
+      }
+      fclose(input);
+      return true;
+    }
+
     /**
      *\brief Initialization of a new NodeManager
      *
@@ -71,6 +111,8 @@ namespace mars {
                                                  control(c),
                                                  libManager(theManager)
     {
+      numUpdateContentions = 0;
+      numLockedReads = numSnapshotReads = 0;
       if(control->graphics) {
         GraphicsUpdateInterface *gui = static_cast<GraphicsUpdateInterface*>(this);
         control->graphics->addGraphicsUpdateInterface(gui);
@@ -115,7 +157,19 @@ namespace mars {
       if (!reload) {
         iMutex.lock();
         NodeData reloadNode = *nodeS;
-        if((nodeS->physicMode == NODE_TYPE_TERRAIN) && nodeS->terrain ) {
+        // a given mesh is owned by the SimNode, a reload reads the file
+        reloadNode.mesh.setZero();
+        if((nodeS->physicMode == NODE_TYPE_TERRAIN) && nodeS->terrain &&
+           nodeS->terrain->isFloatDEM()) {
+          reloadNode.terrain = new(terrainStruct);
+          *(reloadNode.terrain) = *(nodeS->terrain);
+          if(!prepareFloatDEM(reloadNode.terrain, control->graphics != 0)) {
+            LOG_ERROR("NodeManager::addNode: could not read DEM for terrain");
+            iMutex.unlock();
+            return INVALID_ID;
+          }
+        }
+        else if((nodeS->physicMode == NODE_TYPE_TERRAIN) && nodeS->terrain ) {
           if(!control->loadCenter) {
             LOG_ERROR("NodeManager:: loadCenter is missing, can not create Node");
             iMutex.unlock();
@@ -165,13 +219,18 @@ namespace mars {
         maxGroupID = nodeS->groupID;
       }
 
-      // convert obj to ode mesh
-      if((nodeS->physicMode == NODE_TYPE_MESH) && (nodeS->terrain == 0) ) {
+      // convert obj to ode mesh, unless the mesh is given (e.g. baked
+      // into a scene cache)
+      if((nodeS->physicMode == NODE_TYPE_MESH) && (nodeS->terrain == 0) &&
+         !nodeS->mesh.vertices) {
         if(!control->loadCenter) {
           LOG_ERROR("NodeManager:: loadCenter is missing, can not create Node");
           return INVALID_ID;
         }
-        if(!control->loadCenter->loadMesh) {
+        // other formats than OBJ, STL and .bobj need the GuiHelper
+        if(!control->loadCenter->loadMesh ||
+           (dynamic_cast<MeshLoader*>(control->loadCenter->loadMesh) &&
+            !MeshLoader::canLoad(nodeS->filename))) {
           GraphicsManagerInterface *g = libManager->getLibraryAs<GraphicsManagerInterface>("mars_graphics");
           if(!g) {
             libManager->loadLibrary("mars_graphics", NULL, false, true);
@@ -186,7 +245,15 @@ namespace mars {
         }
         control->loadCenter->loadMesh->getPhysicsFromMesh(nodeS);
       }
-      if((nodeS->physicMode == NODE_TYPE_TERRAIN) && nodeS->terrain ) {
+      if((nodeS->physicMode == NODE_TYPE_TERRAIN) && nodeS->terrain &&
+         nodeS->terrain->isFloatDEM()) {
+        if(!nodeS->terrain->pixelData &&
+           !prepareFloatDEM(nodeS->terrain, control->graphics != 0)) {
+          LOG_ERROR("NodeManager::addNode: could not read DEM for terrain");
+          return INVALID_ID;
+        }
+      }
+      else if((nodeS->physicMode == NODE_TYPE_TERRAIN) && nodeS->terrain ) {
         if(!nodeS->terrain->pixelData) {
           if(!control->loadCenter) {
             LOG_ERROR("NodeManager:: loadCenter is missing, can not create Node");
@@ -666,6 +733,7 @@ namespace mars {
       SimNode *tmpNode = 0;
 
       if(lock) iMutex.lock();
+      invalidateSnapshot();
 
       iter = simNodes.find(id);
       if (iter != simNodes.end()) {
@@ -710,6 +778,7 @@ namespace mars {
      */
     void NodeManager::setNodeState(NodeId id, const nodeState &state) {
       MutexLocker locker(&iMutex);
+      invalidateSnapshot();
       NodeMap::iterator iter = simNodes.find(id);
       if (iter != simNodes.end())
         iter->second->setPhysicalState(state);
@@ -719,6 +788,15 @@ namespace mars {
      *\brief Get physical dynamic values for the node with the given id.
      */
     void NodeManager::getNodeState(NodeId id, nodeState *state) const {
+      size_t i;
+      std::shared_ptr<const NodeSnapshot> s = findInSnapshot(id, &i);
+      if(s) {
+        const sReal *v = &s->states.lin_vel[i*3];
+        state->l_vel = Vector(v[0], v[1], v[2]);
+        v = &s->states.ang_vel[i*3];
+        state->a_vel = Vector(v[0], v[1], v[2]);
+        return;
+      }
       MutexLocker locker(&iMutex);
       NodeMap::const_iterator iter = simNodes.find(id);
       if (iter != simNodes.end())
@@ -750,6 +828,7 @@ namespace mars {
      */
     void NodeManager::setPosition(NodeId id, const Vector &pos) {
       MutexLocker locker(&iMutex);
+      invalidateSnapshot();
       NodeMap::iterator iter = simNodes.find(id);
       if (iter != simNodes.end()) {
         iter->second->setPosition(pos, 1);
@@ -760,6 +839,12 @@ namespace mars {
 
     const Vector NodeManager::getPosition(NodeId id) const {
       Vector pos(0.0,0.0,0.0);
+      size_t i;
+      std::shared_ptr<const NodeSnapshot> s = findInSnapshot(id, &i);
+      if(s) {
+        const sReal *v = &s->states.pos[i*3];
+        return Vector(v[0], v[1], v[2]);
+      }
       MutexLocker locker(&iMutex);
       NodeMap::const_iterator iter = simNodes.find(id);
       if (iter != simNodes.end())
@@ -770,6 +855,16 @@ namespace mars {
 
     const Quaternion NodeManager::getRotation(NodeId id) const {
       Quaternion q(Quaternion::Identity());
+      size_t i;
+      std::shared_ptr<const NodeSnapshot> s = findInSnapshot(id, &i);
+      if(s) {
+        const sReal *v = &s->states.rot[i*4];
+        q.x() = v[0];
+        q.y() = v[1];
+        q.z() = v[2];
+        q.w() = v[3];
+        return q;
+      }
       MutexLocker locker(&iMutex);
       NodeMap::const_iterator iter = simNodes.find(id);
       if (iter != simNodes.end())
@@ -780,6 +875,12 @@ namespace mars {
 
     const Vector NodeManager::getLinearVelocity(NodeId id) const {
       Vector vel(0.0,0.0,0.0);
+      size_t i;
+      std::shared_ptr<const NodeSnapshot> s = findInSnapshot(id, &i);
+      if(s) {
+        const sReal *v = &s->states.lin_vel[i*3];
+        return Vector(v[0], v[1], v[2]);
+      }
       MutexLocker locker(&iMutex);
       NodeMap::const_iterator iter = simNodes.find(id);
       if (iter != simNodes.end())
@@ -789,6 +890,12 @@ namespace mars {
 
     const Vector NodeManager::getAngularVelocity(NodeId id) const {
       Vector avel(0.0,0.0,0.0);
+      size_t i;
+      std::shared_ptr<const NodeSnapshot> s = findInSnapshot(id, &i);
+      if(s) {
+        const sReal *v = &s->states.ang_vel[i*3];
+        return Vector(v[0], v[1], v[2]);
+      }
       MutexLocker locker(&iMutex);
       NodeMap::const_iterator iter = simNodes.find(id);
       if (iter != simNodes.end())
@@ -823,6 +930,7 @@ namespace mars {
      */
     void NodeManager::setRotation(NodeId id, const Quaternion &rot) {
       MutexLocker locker(&iMutex);
+      invalidateSnapshot();
       NodeMap::iterator iter = simNodes.find(id);
       if (iter != simNodes.end())
         iter->second->setRotation(rot, 1);
@@ -1176,6 +1284,16 @@ namespace mars {
     }
 
 
+    void NodeManager::getReloadNodes(std::list<NodeData> *nodes) const {
+      MutexLocker locker(&iMutex);
+      *nodes = simNodesReload;
+    }
+
+    void NodeManager::setReloadNodes(const std::list<NodeData> &nodes) {
+      MutexLocker locker(&iMutex);
+      simNodesReload = nodes;
+    }
+
     /**
      *\brief Reloads all nodes in the simulation.
      */
@@ -1195,11 +1313,14 @@ namespace mars {
         if(tmp.terrain) {
           tmp.terrain = new(terrainStruct);
           *(tmp.terrain) = *(iter->terrain);
-          tmp.terrain->pixelData = (double*)calloc((tmp.terrain->width*
-                                                     tmp.terrain->height),
-                                                    sizeof(double));
-          memcpy(tmp.terrain->pixelData, iter->terrain->pixelData,
-                 (tmp.terrain->width*tmp.terrain->height)*sizeof(double));
+          // a DEM terrain only has pixelData for the graphics
+          if(iter->terrain->pixelData) {
+            tmp.terrain->pixelData = (double*)calloc((tmp.terrain->width*
+                                                       tmp.terrain->height),
+                                                      sizeof(double));
+            memcpy(tmp.terrain->pixelData, iter->terrain->pixelData,
+                   (tmp.terrain->width*tmp.terrain->height)*sizeof(double));
+          }
         }
         iMutex.unlock();
         addNode(&tmp, true, reloadGrahpics);
@@ -1264,11 +1385,207 @@ namespace mars {
      *\brief Updates the Node values of dynamical nodes from the physics.
      */
     void NodeManager::updateDynamicNodes(sReal calc_ms, bool physics_thread) {
-      MutexLocker locker(&iMutex);
+      if(iMutex.tryLock() != MUTEX_ERROR_NO_ERROR) {
+        ++numUpdateContentions;
+        iMutex.lock();
+      }
+
+      collectDynamicNodes();
+      // copy the state of all nodes with one lock of the physics
+      control->sim->getPhysics()->getNodeStates(dynNodeInterfaces,
+                                                &dynNodeStates);
+      for(size_t i=0; i<dynNodes.size(); ++i) {
+        dynNodes[i]->update(calc_ms, physics_thread, dynNodeStates, i);
+      }
+      publishSnapshot();
+      iMutex.unlock();
+    }
+
+    /**
+     * \brief Fills dynNodes and dynNodeInterfaces with the dynamic nodes
+     * that have a physical representation.
+     *
+     * pre:
+     *     - iMutex is locked
+     */
+    void NodeManager::collectDynamicNodes(void) {
       NodeMap::iterator iter;
+      NodeInterface *nodeInterface;
+
+      dynNodes.clear();
+      dynNodeInterfaces.clear();
       for(iter = simNodesDyn.begin(); iter != simNodesDyn.end(); iter++) {
-        iter->second->update(calc_ms, physics_thread);
+        nodeInterface = iter->second->getInterface();
+        if(nodeInterface) {
+          dynNodes.push_back(iter->second);
+          dynNodeInterfaces.push_back(nodeInterface);
+        }
+      }
+    }
+
+    static void appendValues(const std::vector<sReal> &values,
+                             std::vector<sReal> *state) {
+      state->insert(state->end(), values.begin(), values.end());
+    }
+
+    static void readValues(const std::vector<sReal> &state, size_t *pos,
+                           std::vector<sReal> *values) {
+      std::copy(state.begin() + *pos, state.begin() + *pos + values->size(),
+                values->begin());
+      *pos += values->size();
+    }
+
+    /**
+     * \brief Appends the number of dynamic nodes, their ids and their
+     * states as stored in a NodeStateBuffer.
+     */
+    void NodeManager::saveState(std::vector<sReal> *state) {
+      MutexLocker locker(&iMutex);
+      collectDynamicNodes();
+      control->sim->getPhysics()->getNodeStates(dynNodeInterfaces,
+                                                &dynNodeStates);
+      state->push_back((sReal)dynNodes.size());
+      for(size_t i=0; i<dynNodes.size(); ++i) {
+        state->push_back((sReal)dynNodes[i]->getID());
+      }
+      appendValues(dynNodeStates.pos, state);
+      appendValues(dynNodeStates.rot, state);
+      appendValues(dynNodeStates.lin_vel, state);
+      appendValues(dynNodeStates.ang_vel, state);
+      appendValues(dynNodeStates.force, state);
+      appendValues(dynNodeStates.torque, state);
+    }
+
+    /**
+     * \brief Returns true if the ids and the number of the dynamic nodes
+     * stored at pos match the dynamic nodes of the simulation and sets
+     * end behind the stored states. Has to be called with iMutex locked
+     * after collectDynamicNodes.
+     */
+    bool NodeManager::matchState(const std::vector<sReal> &state,
+                                 size_t pos, size_t *end) const {
+      size_t numNodes, numValues;
+
+      if(pos >= state.size()) return false;
+      numNodes = (size_t)state[pos++];
+      // ids, positions, rotations and four vectors per node
+      numValues = numNodes*(1+3+4+4*3);
+      if(numNodes != dynNodes.size() || pos + numValues > state.size()) {
+        return false;
+      }
+      for(size_t i=0; i<numNodes; ++i) {
+        if((NodeId)state[pos+i] != dynNodes[i]->getID()) return false;
+      }
+      *end = pos + numValues;
+      return true;
+    }
+
+    bool NodeManager::checkState(const std::vector<sReal> &state,
+                                 size_t *pos) {
+      MutexLocker locker(&iMutex);
+      collectDynamicNodes();
+      return matchState(state, *pos, pos);
+    }
+
+    bool NodeManager::restoreState(const std::vector<sReal> &state,
+                                   size_t *pos) {
+      MutexLocker locker(&iMutex);
+      size_t p = *pos, numNodes, end;
+
+      collectDynamicNodes();
+      if(!matchState(state, p, &end)) return false;
+      numNodes = (size_t)state[p++];
+      dynNodeStates.resize(numNodes);
+      p += numNodes;
+
+      readValues(state, &p, &dynNodeStates.pos);
+      readValues(state, &p, &dynNodeStates.rot);
+      readValues(state, &p, &dynNodeStates.lin_vel);
+      readValues(state, &p, &dynNodeStates.ang_vel);
+      readValues(state, &p, &dynNodeStates.force);
+      readValues(state, &p, &dynNodeStates.torque);
+      control->sim->getPhysics()->setNodeStates(dynNodeInterfaces,
+                                                dynNodeStates);
+      for(size_t i=0; i<numNodes; ++i) {
+        dynNodes[i]->restoreState(dynNodeStates, i);
+      }
+      publishSnapshot();
+      *pos = p;
+      return true;
+    }
+
+    /**
+     * \brief Publishes the state of the dynamic nodes for the readers of
+     * other threads.
+     *
+     * pre:
+     *     - iMutex is locked
+     *     - dynNodes and dynNodeStates are filled by updateDynamicNodes
+     *
+     * post:
+     *     - getPosition, getRotation, getLinearVelocity,
+     *       getAngularVelocity and getNodeState of the dynamic nodes are
+     *       served without locking until the next invalidateSnapshot
+     */
+    void NodeManager::publishSnapshot(void) {
+      std::shared_ptr<NodeSnapshot> next;
+      std::vector<std::shared_ptr<NodeSnapshot> >::iterator iter;
+
+      // reuse a snapshot that is neither published nor held by a reader
+      for(iter = snapshotPool.begin(); iter != snapshotPool.end(); ++iter) {
+        if(iter->use_count() == 1) {
+          std::atomic_thread_fence(std::memory_order_acquire);
+          next = *iter;
+          break;
+        }
+      }
+      if(!next) {
+        next.reset(new NodeSnapshot);
+        snapshotPool.push_back(next);
       }
+      next->ids.resize(dynNodes.size());
+      for(size_t i=0; i<dynNodes.size(); ++i) {
+        next->ids[i] = dynNodes[i]->getID();
+      }
+      next->states = dynNodeStates;
+      std::atomic_store(&snapshot, std::shared_ptr<const NodeSnapshot>(next));
+    }
+
+    /**
+     * \brief Sends the readers back to the locked access because a node
+     * state is changed outside of updateDynamicNodes.
+     *
+     * pre:
+     *     - iMutex is locked
+     */
+    void NodeManager::invalidateSnapshot(void) {
+      std::atomic_store(&snapshot, std::shared_ptr<const NodeSnapshot>());
+    }
+
+    /**
+     * \brief Returns the published snapshot and the index of the node
+     * if the node is part of it. Otherwise a null pointer is returned and
+     * the caller has to lock iMutex.
+     */
+    std::shared_ptr<const NodeManager::NodeSnapshot> NodeManager::findInSnapshot(NodeId id, size_t *index) const {
+      std::shared_ptr<const NodeSnapshot> s = std::atomic_load(&snapshot);
+      if(s) {
+        std::vector<NodeId>::const_iterator iter;
+        iter = std::lower_bound(s->ids.begin(), s->ids.end(), id);
+        if(iter != s->ids.end() && *iter == id) {
+          *index = iter - s->ids.begin();
+          ++numSnapshotReads;
+          return s;
+        }
+      }
+      ++numLockedReads;
+      return std::shared_ptr<const NodeSnapshot>();
+    }
+
+    void NodeManager::getDebugStats(NodeManagerDebugStats *stats) {
+      stats->numUpdateContentions = numUpdateContentions.exchange(0);
+      stats->numLockedReads = numLockedReads.exchange(0);
+      stats->numSnapshotReads = numSnapshotReads.exchange(0);
     }
 
     void NodeManager::preGraphicsUpdate() {
@@ -1322,6 +1639,7 @@ namespace mars {
     void NodeManager::clearAllNodes(bool clear_all, bool clearGraphics) {
       MutexLocker locker(&iMutex);
       NodeMap::iterator iter;
+      invalidateSnapshot();
       while (!simNodes.empty())
         removeNode(simNodes.begin()->first, false, clearGraphics);
       while (!vizNodes.empty())
@@ -1366,6 +1684,7 @@ namespace mars {
 
     void NodeManager::setVelocity(NodeId id, const Vector& vel) {
       MutexLocker locker(&iMutex);
+      invalidateSnapshot();
       NodeMap::iterator iter = simNodesDyn.find(id);
       if (iter != simNodesDyn.end())
         iter->second->setLinearVelocity(vel);
@@ -1374,6 +1693,7 @@ namespace mars {
 
     void NodeManager::setAngularVelocity(NodeId id, const Vector& vel) {
       MutexLocker locker(&iMutex);
+      invalidateSnapshot();
       NodeMap::iterator iter = simNodesDyn.find(id);
       if (iter != simNodesDyn.end())
         iter->second->setAngularVelocity(vel);
@@ -1425,6 +1745,7 @@ namespace mars {
 
     void NodeManager::addRotation(NodeId id, const Quaternion &q) {
       MutexLocker locker(&iMutex);
+      invalidateSnapshot();
       NodeMap::iterator iter = simNodes.find(id);
       if (iter != simNodes.end())
         iter->second->addRotation(q);
@@ -1658,6 +1979,7 @@ namespace mars {
       NodeMap::const_iterator iter = simNodes.find(id);
 
       if (iter != simNodes.end()) {
+        invalidateSnapshot();
         iter->second->updatePR(pos, rot, visOffsetPos, visOffsetRot);
         if(doLock) MutexLocker locker(&iMutex);
         nodesToUpdate[id] = iter->second;
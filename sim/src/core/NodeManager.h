@@ -32,10 +32,16 @@
   #warning "NodeManager.h"
 #endif
 
+#include "IDMap.h"
+
 #include <mars/utils/Mutex.h>
 #include <mars/interfaces/graphics/GraphicsUpdateInterface.h>
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/sim/NodeManagerInterface.h>
+#include <mars/interfaces/sim/PhysicsInterface.h>
+
+#include <atomic>
+#include <memory>
 
 namespace mars {
   namespace sim {
@@ -43,7 +49,7 @@ namespace mars {
     class SimJoint;
     class SimNode;
 
-    typedef std::map<interfaces::NodeId, SimNode*> NodeMap;
+    typedef IDMap<SimNode*> NodeMap;
 
     /**
      * The declaration of the NodeManager class.
@@ -102,11 +108,18 @@ namespace mars {
       virtual SimNode* getSimNode(interfaces::NodeId id);
       virtual const SimNode* getSimNode(interfaces::NodeId id) const;
       virtual void reloadNodes(bool reloadGraphics);
+      virtual void getReloadNodes(std::list<interfaces::NodeData> *nodes) const;
+      virtual void setReloadNodes(const std::list<interfaces::NodeData> &nodes);
       virtual const utils::Vector setReloadExtent(interfaces::NodeId id, const utils::Vector &ext);
       virtual void setReloadPosition(interfaces::NodeId id, const utils::Vector &pos);
       virtual void setReloadFriction(interfaces::NodeId id, interfaces::sReal friction1,
                                      interfaces::sReal friction2);
       virtual void updateDynamicNodes(interfaces::sReal calc_ms, bool physics_thread = true);
+      virtual void saveState(std::vector<interfaces::sReal> *state);
+      virtual bool checkState(const std::vector<interfaces::sReal> &state,
+                              size_t *pos);
+      virtual bool restoreState(const std::vector<interfaces::sReal> &state,
+                                size_t *pos);
       virtual void clearAllNodes(bool clear_all=false, bool clearGraphics=true);
       virtual void setReloadAngle(interfaces::NodeId id, const utils::sRotation &angle);
       virtual void setContactParams(interfaces::NodeId id, const interfaces::contact_params &cp);
@@ -160,8 +173,19 @@ namespace mars {
       virtual unsigned long getMaxGroupID() { return maxGroupID; }
       virtual void edit(interfaces::NodeId id, const std::string &key,
                         const std::string &value);
+      virtual void getDebugStats(interfaces::NodeManagerDebugStats *stats);
 
     private:
+      /**
+       * The state of the dynamic nodes after the last update. A snapshot
+       * is never changed after it is published, thus the readers only
+       * hold a reference and don't lock the node manager.
+       */
+      struct NodeSnapshot {
+        std::vector<interfaces::NodeId> ids; ///< sorted like simNodesDyn
+        interfaces::NodeStateBuffer states;
+      };
+
       interfaces::NodeId next_node_id;
       bool update_all_nodes;
       int visual_rep;
@@ -169,6 +193,15 @@ namespace mars {
       NodeMap simNodesDyn;
       NodeMap nodesToUpdate;
       NodeMap vizNodes;
+      // reused buffers for the bulk update of the dynamic nodes
+      std::vector<SimNode*> dynNodes;
+      std::vector<interfaces::NodeInterface*> dynNodeInterfaces;
+      interfaces::NodeStateBuffer dynNodeStates;
+      // only accessed with std::atomic_load and std::atomic_store
+      std::shared_ptr<const NodeSnapshot> snapshot;
+      std::vector<std::shared_ptr<NodeSnapshot> > snapshotPool;
+      std::atomic<unsigned long> numUpdateContentions;
+      mutable std::atomic<unsigned long> numLockedReads, numSnapshotReads;
       std::list<interfaces::NodeData> simNodesReload;
       unsigned long maxGroupID;
       lib_manager::LibManager *libManager;
@@ -177,6 +210,13 @@ namespace mars {
       interfaces::ControlCenter *control;
 
       std::list<interfaces::NodeData>::iterator getReloadNode(interfaces::NodeId id);
+      void collectDynamicNodes(void);
+      bool matchState(const std::vector<interfaces::sReal> &state,
+                      size_t pos, size_t *end) const;
+      void publishSnapshot(void);
+      void invalidateSnapshot(void);
+      std::shared_ptr<const NodeSnapshot> findInSnapshot(interfaces::NodeId id,
+                                                         size_t *index) const;
 
       // interfaces::NodeInterface* getNodeInterface(NodeId node_id);
       struct Params; // see below.
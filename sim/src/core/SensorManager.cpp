@@ -135,7 +135,7 @@ namespace mars {
      * \return boolean, whether the node exists.
      */
     bool SensorManager::exists(unsigned long index) const {
-      map<unsigned long, BaseSensor*>::const_iterator iter = simSensors.find(index);
+      SensorMap::const_iterator iter = simSensors.find(index);
       if(iter != simSensors.end()) {
         return true;
       }
@@ -151,7 +151,7 @@ namespace mars {
      */
     void SensorManager::getListSensors(vector<core_objects_exchange> *sensorList) const {
       core_objects_exchange obj;
-      map<unsigned long, BaseSensor*>::const_iterator iter;
+      SensorMap::const_iterator iter;
       sensorList->clear();
       iMutex.lock();
       for (iter = simSensors.begin(); iter != simSensors.end(); iter++) {
@@ -171,7 +171,7 @@ namespace mars {
      */
     const BaseSensor* SensorManager::getFullSensor(unsigned long index) const {
       MutexLocker locker(&iMutex);
-      map<unsigned long, BaseSensor*>::const_iterator iter;
+      SensorMap::const_iterator iter;
 
       iter = simSensors.find(index);
       if (iter != simSensors.end())
@@ -185,7 +185,7 @@ namespace mars {
 
     unsigned long SensorManager::getSensorID(std::string name) const {
       MutexLocker locker(&iMutex);
-      std::map<unsigned long, BaseSensor*>::const_iterator it;
+      SensorMap::const_iterator it;
       for(it = simSensors.begin(); it != simSensors.end(); it++){
         if(it->second->name.compare(name) == 0){
           return it->first;
@@ -203,7 +203,7 @@ namespace mars {
     void SensorManager::removeSensor(unsigned long index) {
       BaseSensor* tmpSensor = NULL;
       iMutex.lock();
-      map<unsigned long, BaseSensor*>::iterator iter = simSensors.find(index);
+      SensorMap::iterator iter = simSensors.find(index);
       if (iter != simSensors.end()) {
         tmpSensor = iter->second;
         simSensors.erase(iter);
@@ -225,7 +225,7 @@ namespace mars {
      */
     BaseSensor* SensorManager::getSimSensor(unsigned long index) const {
       MutexLocker locker(&iMutex);
-      map<unsigned long, BaseSensor*>::const_iterator iter = simSensors.find(index);
+      SensorMap::const_iterator iter = simSensors.find(index);
 
       if (iter != simSensors.end())
         return iter->second;
@@ -242,7 +242,7 @@ namespace mars {
      */
     int SensorManager::getSensorData(unsigned long id, sReal **data) const {
       MutexLocker locker(&iMutex);
-      map<unsigned long, BaseSensor*>::const_iterator iter;
+      SensorMap::const_iterator iter;
 
       iter = simSensors.find(id);
       if (iter != simSensors.end())
@@ -275,7 +275,7 @@ namespace mars {
      */
     void SensorManager::clearAllSensors(bool clear_all) {
       MutexLocker locker(&iMutex);
-      map<unsigned long, BaseSensor*>::iterator iter;
+      SensorMap::iterator iter;
       for(iter = simSensors.begin(); iter != simSensors.end(); iter++) {
         assert(iter->second);
         BaseSensor *sensor = iter->second;
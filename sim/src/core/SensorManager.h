@@ -38,6 +38,8 @@
   #warning "SensorManager.h"
 #endif
 
+#include "IDMap.h"
+
 #include <mars/interfaces/sim/SensorManagerInterface.h>
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/utils/Mutex.h>
@@ -46,6 +48,8 @@
 namespace mars {
   namespace sim {
 
+    typedef IDMap<interfaces::BaseSensor*> SensorMap;
+
     class SensorReloadHelper{
     public:
       SensorReloadHelper(std::string type, interfaces::BaseConfig *config):
@@ -222,7 +226,7 @@ namespace mars {
       unsigned long next_sensor_id;
 
       //! a containter for all sensors currently present in the simulation
-      std::map<unsigned long, interfaces::BaseSensor*> simSensors;
+      SensorMap simSensors;
 
       //! a containter for all sensors that are loaded after a reset of the simulation
       std::vector<SensorReloadHelper> simSensorsReload;
@@ -265,6 +265,24 @@ namespace mars {
       }
     }
 
+    /**
+     * \brief Appends the integrated positions and the velocities. All
+     * other values are read from the physics by the next update.
+     */
+    void SimJoint::saveState(std::vector<sReal> *state) const {
+      state->push_back(position1);
+      state->push_back(position2);
+      state->push_back(velocity1);
+      state->push_back(velocity2);
+    }
+
+    void SimJoint::restoreState(const sReal *state) {
+      position1 = state[0];
+      position2 = state[1];
+      velocity1 = state[2];
+      velocity2 = state[3];
+    }
+
     void SimJoint::setSJoint(const JointData &sJoint) {
       this->sJoint = sJoint;
       id = sJoint.index;
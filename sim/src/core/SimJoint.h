@@ -40,6 +40,9 @@ namespace mars {
 
     class SimNode;
 
+    // number of values written by SimJoint::saveState
+#define JOINT_STATE_SIZE 4
+
     /**
      * exchange structure for joint angles
      */
@@ -106,6 +109,8 @@ namespace mars {
       // function members
       void rotateAxis(const utils::Quaternion &rotatem, unsigned char axis_index=1);
       void update(interfaces::sReal calc_ms);
+      void saveState(std::vector<interfaces::sReal> *state) const;
+      void restoreState(const interfaces::sReal *state);
       void reattachJoint(void);
       void attachMotor(unsigned char axis_index);
       void detachMotor(unsigned char axis_index);
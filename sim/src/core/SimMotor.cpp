@@ -41,7 +41,7 @@ namespace mars {
     }
 
     SimMotor::SimMotor(ControlCenter *c, const MotorData &sMotor_)
-      : control(c) {
+      : control(c), batchVersion(0) {
 
       sMotor.index = sMotor_.index;
       sMotor.type = sMotor_.type;
@@ -153,18 +153,22 @@ namespace mars {
     }
 
     void SimMotor::addMimic(SimMotor* mimic) {
+      ++batchVersion;
       mimics[mimic->getName()] = mimic;
     }
 
     void SimMotor::removeMimic(std::string mimicname) {
+      ++batchVersion;
       mimics.erase(mimicname);
     }
 
     void SimMotor::clearMimics() {
+      ++batchVersion;
       mimics.clear();
     }
 
     void SimMotor::setMimic(sReal multiplier, sReal offset) {
+      ++batchVersion;
       mimic = true;
       mimic_multiplier = multiplier;
       mimic_offset = offset;
@@ -172,6 +176,7 @@ namespace mars {
 
     void SimMotor::setMaxEffortApproximation(utils::ApproximationFunction type,
       std::vector<double>* coefficients) {
+      ++batchVersion;
       switch (type) {
         case FUNCTION_PIPE:
           maxEffortApproximation =&utils::pipe;
@@ -195,6 +200,7 @@ namespace mars {
 
     void SimMotor::setMaxSpeedApproximation(utils::ApproximationFunction type,
       std::vector<double>* coefficients) {
+      ++batchVersion;
       switch (type) {
         case FUNCTION_PIPE:
           maxSpeedApproximation = &utils::pipe;
@@ -218,6 +224,7 @@ namespace mars {
 
     void SimMotor::setCurrentApproximation(utils::ApproximationFunction2D type,
       std::vector<double>* coefficients) {
+      ++batchVersion;
       switch (type) {
         case FUNCTION_UNKNOWN2D:
           LOG_WARN("SimMotor: Approximation function not implemented or unknown.");
@@ -230,6 +237,7 @@ namespace mars {
     }
 
     void SimMotor::updateController() {
+      ++batchVersion;
       axis = (unsigned char) sMotor.axis;
       switch (sMotor.type) {
         case MOTOR_TYPE_POSITION:
@@ -402,6 +410,61 @@ namespace mars {
       }
     }
 
+    /**
+     * \brief Appends the values that change while the motor is running,
+     * e.g. the integrated error of the PID controller.
+     */
+    void SimMotor::saveState(std::vector<sReal> *state) const {
+      state->push_back(time);
+      state->push_back(lastVelocity);
+      state->push_back(velocity);
+      state->push_back(position1);
+      state->push_back(position2);
+      state->push_back(effort);
+      state->push_back(tmpmaxeffort);
+      state->push_back(tmpmaxspeed);
+      state->push_back(current);
+      state->push_back(temperature);
+      state->push_back(filterValue);
+      state->push_back(controlValue);
+      state->push_back(last_error);
+      state->push_back(integ_error);
+      state->push_back(joint_velocity);
+      state->push_back(error);
+      state->push_back(active ? 1.0 : 0.0);
+      state->push_back(sMotor.value);
+    }
+
+    /**
+     * \brief Restores the values written by saveState and passes the
+     * restored control parameter to the joint like update does.
+     */
+    void SimMotor::restoreState(const sReal *state) {
+      ++batchVersion;
+      time = state[0];
+      lastVelocity = state[1];
+      velocity = state[2];
+      position1 = state[3];
+      position2 = state[4];
+      effort = state[5];
+      tmpmaxeffort = state[6];
+      tmpmaxspeed = state[7];
+      current = state[8];
+      temperature = state[9];
+      filterValue = state[10];
+      controlValue = state[11];
+      last_error = state[12];
+      integ_error = state[13];
+      joint_velocity = state[14];
+      error = state[15];
+      active = (state[16] != 0.0);
+      sMotor.value = state[17];
+      if(active && myJoint) {
+        myJoint->setEffortLimit(tmpmaxeffort, axis);
+        (myJoint->*setJointControlParameter)(*controlParameter, axis);
+      }
+    }
+
     void SimMotor::estimateCurrent() {
       // calculate current
       effort = myJoint->getMotorTorque();
@@ -493,10 +556,12 @@ namespace mars {
 // from here on only getters and setters
 
     void SimMotor::attachJoint(SimJoint *joint){
+      ++batchVersion;
       myJoint = joint;
     }
 
     void SimMotor::attachPlayJoint(SimJoint *joint){
+      ++batchVersion;
       myPlayJoint = joint;
     }
 
@@ -567,6 +632,7 @@ namespace mars {
     }
 
     void SimMotor::setMaxEffort(sReal force) {
+      ++batchVersion;
       sMotor.maxEffort = force;
       myJoint->setEffortLimit(sMotor.maxEffort, axis);
     }
@@ -600,6 +666,7 @@ namespace mars {
     }
 
     void SimMotor::setMaxSpeed(sReal speed) {
+      ++batchVersion;
       sMotor.maxSpeed = fabs(speed);
     }
 
@@ -650,22 +717,27 @@ namespace mars {
     }
 
     void SimMotor::setMinValue(interfaces::sReal d) {
+      ++batchVersion;
       sMotor.minValue = d;
     }
 
     void SimMotor::setMaxValue(interfaces::sReal d) {
+      ++batchVersion;
       sMotor.maxValue = d;
     }
 
     void SimMotor::setP(sReal p) {
+      ++batchVersion;
       sMotor.p = p;
     }
 
     void SimMotor::setI(sReal i) {
+      ++batchVersion;
       sMotor.i = i;
     }
 
     void SimMotor::setD(sReal d) {
+      ++batchVersion;
       sMotor.d = d;
     }
 
@@ -682,6 +754,7 @@ namespace mars {
     }
 
     void SimMotor::setSMotor(const MotorData &sMotor) {
+      ++batchVersion;
       // todo: handle name change correctly
       this->sMotor = sMotor;
       filterValue = 0.0;
@@ -735,6 +808,7 @@ namespace mars {
     }
 
     void SimMotor::setPID(sReal mP, sReal mI, sReal mD) {
+      ++batchVersion;
       switch (sMotor.type) {
       case MOTOR_TYPE_PID: // deprecated
       case MOTOR_TYPE_POSITION:
@@ -780,18 +854,25 @@ namespace mars {
     }
 
     void SimMotor::deactivate(void) {
-      active = false;
+      // update deactivates a motor without joint in every step
+      if(active) {
+        ++batchVersion;
+        active = false;
+      }
     }
 
     void SimMotor::activate(void) {
-      active = true;
+      if(!active) {
+        ++batchVersion;
+        active = true;
+      }
     }
 
     void SimMotor::getDataBrokerNames(std::string *groupName,
                                       std::string *dataName) const {
       char format[] = "Motors/%05lu_%s";
       int size = snprintf(0, 0, format, sMotor.index, sMotor.name.c_str());
-      char buffer[size];
+      char buffer[size+1];
       sprintf(buffer, format, sMotor.index, sMotor.name.c_str());
       *groupName = "mars_sim";
       *dataName = buffer;
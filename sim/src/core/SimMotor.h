@@ -45,6 +45,9 @@ namespace mars {
 
     double SpaceClimberCurrent(double* torque, double* velocity, std::vector<interfaces::sReal>* c);
 
+    // number of values written by SimMotor::saveState
+#define MOTOR_STATE_SIZE 18
+
     /**
      * Each SimMotor object publishes its state on the dataBroker.
      * The name under which the data is published can be obtained from the
@@ -69,6 +72,8 @@ namespace mars {
       // function methods
 
       void update(interfaces::sReal time_ms);
+      void saveState(std::vector<interfaces::sReal> *state) const;
+      void restoreState(const interfaces::sReal *state);
       void updateController();
       void activate(void);
       void deactivate(void);
@@ -163,6 +168,9 @@ namespace mars {
 
 
     private:
+      friend class MotorBatch;
+      friend class MotorBatchTest; ///< sets up the motors of test_motor_batch
+
       // typedefs for function pointers
       typedef  void (SimJoint::*JointControlFunction)(interfaces::sReal, unsigned char);
       typedef void (SimMotor::*MotorControlFunction)(interfaces::sReal);
@@ -227,6 +235,9 @@ namespace mars {
       unsigned long dbPushId, dbCmdId;
       long dbIdIndex, dbControlParameterIndex, dbPositionIndex, dbCurrentIndex, dbEffortIndex, dbMaxEffortIndex;
       int pushToDataBroker;
+
+      // incremented whenever a value cached by the MotorBatch changes
+      unsigned long batchVersion;
     };
 
   } // end of namespace sim
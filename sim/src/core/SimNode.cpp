@@ -26,6 +26,7 @@
 #include <mars/interfaces/terrainStruct.h>
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/sim/SimulatorInterface.h>
+#include <mars/interfaces/sim/PhysicsInterface.h>
 #include <mars/interfaces/sim/NodeManagerInterface.h>
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
 #include <mars/interfaces/Logging.hpp>
@@ -88,7 +89,9 @@ namespace mars {
         if(frictionDirNode) {
           std::string groupName, dataName;
           control->nodes->getDataBrokerNames(frictionDirNode, &groupName, &dataName);
-          control->dataBroker->registerSyncReceiver(this, groupName, dataName, 0);
+          if(control->dataBroker) {
+            control->dataBroker->registerSyncReceiver(this, groupName, dataName, 0);
+          }
 
           if(map.hasKey("fDirInitial")) {
             fDirNode.x() = map["fDirInitial"]["x"];
@@ -543,8 +546,6 @@ namespace mars {
     void SimNode::update(sReal calc_ms, bool physics_thread) {
       MutexLocker locker(&iMutex);
       if (my_interface) {
-        Vector damping;
-        sReal d;
         last_l_vel = l_vel;
         last_a_vel = a_vel;
         // update the position and rotation of the node
@@ -554,80 +555,148 @@ namespace mars {
         my_interface->getAngularVelocity(&a_vel);
         my_interface->getForce(&f);
         my_interface->getTorque(&t);
-        ground_contact = my_interface->getGroundContact();
-        ground_contact_force = my_interface->getGroundContactForce();
-        if(calc_ms > 0) {
-          l_acc = (l_vel - last_l_vel) / (calc_ms / 1000.);
-          a_acc = (a_vel - last_a_vel) / (calc_ms / 1000.);
-        } else {
-          l_acc = Vector(0, 0, 0);
-          a_acc = Vector(0, 0, 0);
-        }
-        //i_velocity_sum -= i_velocity[vel_ptr];
-        //i_velocity[vel_ptr] = fabs(a_vel.length());
-        //i_velocity_sum += i_velocity[vel_ptr];
-        //d = i_velocity_sum / BACK_VEL;
+        updateState(calc_ms, physics_thread);
+      }
+    }
 
-        //d = fabs(a_vel.length());
-        d = fabs(a_vel.norm());
+    /**
+     * \brief Updates the node from the index-th entry of a state buffer
+     * filled by PhysicsInterface::getNodeStates.
+     */
+    void SimNode::update(sReal calc_ms, bool physics_thread,
+                         const NodeStateBuffer &states, size_t index) {
+      MutexLocker locker(&iMutex);
+      if (my_interface) {
+        last_l_vel = l_vel;
+        last_a_vel = a_vel;
+        readState(states, index);
+        updateState(calc_ms, physics_thread);
+      }
+    }
 
-        // here we can handle damping
-        if (sNode.linear_damping != 0) {
-          damping = l_vel;
-          damping *= 1-sNode.linear_damping;
-          my_interface->setLinearVelocity(damping);
-        }
-        if (sNode.angular_treshold && d < sNode.angular_treshold) {
-          damping = a_vel;
-          /*
-               damping.normalize();
-               damping *= ((i_velocity[1]-i_velocity[2])*(1-sNode.angular_low)+
-               i_velocity[1]);
-               //damping *= i_velocity[0];
-               */
-          damping *= 1-sNode.angular_low;
-          //i_velocity_sum -= i_velocity[vel_ptr];
-          //i_velocity[vel_ptr] = damping.length();
-          //i_velocity_sum += i_velocity[vel_ptr];
-          my_interface->setAngularVelocity(damping);
-        }
-        else if (sNode.angular_damping != 0) {
-          damping = a_vel;
-          /*damping.normalize();
-            damping *= ((i_velocity[1]-i_velocity[2])*(1-sNode.angular_damping)+
-            i_velocity[1]);
-            //damping *= i_velocity[0];
-            */
-          damping *= 1-sNode.angular_damping;
-          //i_velocity_sum -= i_velocity[vel_ptr];
-          //i_velocity[vel_ptr] = damping.length();
-          /*
-            if(i_velocity[vel_ptr] > sNode.angular_damping) {
-            damping.normalize();
-            damping *= i_velocity[0] - sNode.angular_damping;
-            }
-            else {
-            damping *= 0;
-            }*/
-          //i_velocity_sum += i_velocity[vel_ptr];
-          my_interface->setAngularVelocity(damping);
-        }
-        // handle friction direction by mirror node orientation
-        if(frictionDirNode && my_interface) {
-          Vector v = fRotation*fDirNode;
-          if(!sNode.c_params.friction_direction1) {
-            sNode.c_params.friction_direction1 = new Vector();
+    /**
+     * \brief Sets the node to a state that was restored in the physics
+     * without applying the damping of an update step.
+     */
+    void SimNode::restoreState(const NodeStateBuffer &states, size_t index) {
+      MutexLocker locker(&iMutex);
+      if (my_interface) {
+        readState(states, index);
+        last_l_vel = l_vel;
+        last_a_vel = a_vel;
+        l_acc = Vector(0, 0, 0);
+        a_acc = Vector(0, 0, 0);
+      }
+    }
+
+    /**
+     * \brief Copies the index-th entry of the state buffer.
+     *
+     * pre:
+     *     - iMutex is locked
+     */
+    void SimNode::readState(const NodeStateBuffer &states, size_t index) {
+      const sReal *v;
+      v = &states.pos[index*3];
+      sNode.pos = Vector(v[0], v[1], v[2]);
+      v = &states.rot[index*4];
+      sNode.rot.x() = v[0];
+      sNode.rot.y() = v[1];
+      sNode.rot.z() = v[2];
+      sNode.rot.w() = v[3];
+      v = &states.lin_vel[index*3];
+      l_vel = Vector(v[0], v[1], v[2]);
+      v = &states.ang_vel[index*3];
+      a_vel = Vector(v[0], v[1], v[2]);
+      v = &states.force[index*3];
+      f = Vector(v[0], v[1], v[2]);
+      v = &states.torque[index*3];
+      t = Vector(v[0], v[1], v[2]);
+    }
+
+    /**
+     * \brief Handles the new physical state of the node: accelerations,
+     * damping, friction direction and sensor data.
+     *
+     * pre:
+     *     - iMutex is locked and my_interface is set
+     */
+    void SimNode::updateState(sReal calc_ms, bool physics_thread) {
+      Vector damping;
+      sReal d;
+      ground_contact = my_interface->getGroundContact();
+      ground_contact_force = my_interface->getGroundContactForce();
+      if(calc_ms > 0) {
+        l_acc = (l_vel - last_l_vel) / (calc_ms / 1000.);
+        a_acc = (a_vel - last_a_vel) / (calc_ms / 1000.);
+      } else {
+        l_acc = Vector(0, 0, 0);
+        a_acc = Vector(0, 0, 0);
+      }
+      //i_velocity_sum -= i_velocity[vel_ptr];
+      //i_velocity[vel_ptr] = fabs(a_vel.length());
+      //i_velocity_sum += i_velocity[vel_ptr];
+      //d = i_velocity_sum / BACK_VEL;
+
+      //d = fabs(a_vel.length());
+      d = fabs(a_vel.norm());
+
+      // here we can handle damping
+      if (sNode.linear_damping != 0) {
+        damping = l_vel;
+        damping *= 1-sNode.linear_damping;
+        my_interface->setLinearVelocity(damping);
+      }
+      if (sNode.angular_treshold && d < sNode.angular_treshold) {
+        damping = a_vel;
+        /*
+             damping.normalize();
+             damping *= ((i_velocity[1]-i_velocity[2])*(1-sNode.angular_low)+
+             i_velocity[1]);
+             //damping *= i_velocity[0];
+             */
+        damping *= 1-sNode.angular_low;
+        //i_velocity_sum -= i_velocity[vel_ptr];
+        //i_velocity[vel_ptr] = damping.length();
+        //i_velocity_sum += i_velocity[vel_ptr];
+        my_interface->setAngularVelocity(damping);
+      }
+      else if (sNode.angular_damping != 0) {
+        damping = a_vel;
+        /*damping.normalize();
+          damping *= ((i_velocity[1]-i_velocity[2])*(1-sNode.angular_damping)+
+          i_velocity[1]);
+          //damping *= i_velocity[0];
+          */
+        damping *= 1-sNode.angular_damping;
+        //i_velocity_sum -= i_velocity[vel_ptr];
+        //i_velocity[vel_ptr] = damping.length();
+        /*
+          if(i_velocity[vel_ptr] > sNode.angular_damping) {
+          damping.normalize();
+          damping *= i_velocity[0] - sNode.angular_damping;
           }
-          *(sNode.c_params.friction_direction1) = v;
-          my_interface->setContactParams(sNode.c_params);
-        }
-        //vel_ptr = (vel_ptr+1)%BACK_VEL;
-        if(update_ray || true) {
-          my_interface->handleSensorData(physics_thread);
-          update_ray = false;
+          else {
+          damping *= 0;
+          }*/
+        //i_velocity_sum += i_velocity[vel_ptr];
+        my_interface->setAngularVelocity(damping);
+      }
+      // handle friction direction by mirror node orientation
+      if(frictionDirNode && my_interface) {
+        Vector v = fRotation*fDirNode;
+        if(!sNode.c_params.friction_direction1) {
+          sNode.c_params.friction_direction1 = new Vector();
         }
-        checkNodeState();
+        *(sNode.c_params.friction_direction1) = v;
+        my_interface->setContactParams(sNode.c_params);
+      }
+      //vel_ptr = (vel_ptr+1)%BACK_VEL;
+      if(update_ray || true) {
+        my_interface->handleSensorData(physics_thread);
+        update_ray = false;
       }
+      checkNodeState();
     }
 
     void SimNode::getCoreExchange(core_objects_exchange *obj) const {
@@ -38,6 +38,7 @@ namespace mars {
 
   namespace interfaces {
     class ControlCenter;
+    struct NodeStateBuffer;
   }
 
   namespace sim {
@@ -167,6 +168,9 @@ namespace mars {
       
       // manipulation
       void update(interfaces::sReal calc_ms, bool physics_thread = true); ///< Updates the values of the node from the physical layer.
+      void update(interfaces::sReal calc_ms, bool physics_thread,
+                  const interfaces::NodeStateBuffer &states, size_t index); ///< Updates the values of the node from a bulk export of the physical layer.
+      void restoreState(const interfaces::NodeStateBuffer &states, size_t index); ///< Sets the values of the node to a restored physical state.
       void rotateAtPoint(const utils::Vector &rotation_point, const utils::Quaternion &rotation, bool move_group);
       void changeNode(interfaces::NodeData *node);
       void clearRelativePosition(void);
@@ -225,6 +229,8 @@ namespace mars {
 
       void addToDataBroker();
       void removeFromDataBroker();
+      void readState(const interfaces::NodeStateBuffer &states, size_t index);
+      void updateState(interfaces::sReal calc_ms, bool physics_thread);
 
     };
 
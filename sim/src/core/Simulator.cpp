@@ -28,6 +28,7 @@
 
 #include "config.h"
 #include "Simulator.h"
+#include "Checkpoint.h"
 #include "PhysicsMapper.h"
 #include "NodeManager.h"
 #include "JointManager.h"
@@ -36,6 +37,7 @@
 #include "ControllerManager.h"
 #include "EntityManager.h"
 #include "Controller.h"
+#include "MeshLoader.h"
 
 #include <mars/utils/misc.h>
 #include <mars/interfaces/SceneParseException.h>
@@ -61,6 +63,9 @@
     #define DEFAULT_CONFIG_DIR "."
 #endif
 
+// layout version of the checkpoints of Simulator::saveCheckpoint
+#define CHECKPOINT_VERSION 2
+
 namespace mars {
   namespace sim {
 
@@ -75,7 +80,8 @@ namespace mars {
 
     Simulator *Simulator::activeSimulator = 0;
 
-    Simulator::Simulator(lib_manager::LibManager *theManager) :
+    Simulator::Simulator(lib_manager::LibManager *theManager,
+                         Simulator *parent) :
       lib_manager::LibInterface(theManager),
       exit_sim(false), allow_draw(true),
       sync_graphics(false), physics_mutex_count(0), physics(0),
@@ -108,8 +114,12 @@ namespace mars {
       arg_run    = 0;
       arg_grid   = 0;
       arg_ortho  = 0;
+      parentSim = parent;
+      meshLoader = 0;
 
-      Simulator::activeSimulator = this; // set this Simulator object to the active one
+      if(!parentSim) {
+        Simulator::activeSimulator = this; // set this Simulator object to the active one
+      }
 
       gravity = Vector(0.0, 0.0, -9.81); // set gravity to earth conditions
 
@@ -122,12 +132,32 @@ namespace mars {
       dbSimDebugPackage.add("simUpdate", 0.);
       dbSimDebugPackage.add("worldStep", 0.);
       dbSimDebugPackage.add("logStep", 0.);
-
-      // load optional libs
-      checkOptionalDependency("data_broker");
-      checkOptionalDependency("cfg_manager");
-      checkOptionalDependency("mars_graphics");
-      checkOptionalDependency("log_console");
+      dbSimStatsPackage.add("numContacts", 0ul);
+      dbSimStatsPackage.add("contactAllocs", 0ul);
+      dbSimStatsPackage.add("nodeUpdateContentions", 0ul);
+      dbSimStatsPackage.add("nodeLockedReads", 0ul);
+      dbSimStatsPackage.add("nodeSnapshotReads", 0ul);
+
+      if(parentSim) {
+        // a world created by createWorld stays headless and only
+        // shares the loaders for meshes and heightmaps
+        control->loadCenter->loadMesh = parentSim->control->loadCenter->loadMesh;
+        control->loadCenter->loadHeightmap = parentSim->control->loadCenter->loadHeightmap;
+        reloadGraphics = false;
+      }
+      else {
+        // load optional libs
+        checkOptionalDependency("data_broker");
+        checkOptionalDependency("cfg_manager");
+        checkOptionalDependency("mars_graphics");
+        checkOptionalDependency("log_console");
+
+        // without the graphics the meshes are parsed directly
+        if(!control->loadCenter->loadMesh) {
+          meshLoader = new MeshLoader();
+          control->loadCenter->loadMesh = meshLoader;
+        }
+      }
 
       getTimeMutex.lock();
       realStartTime = utils::getTime();
@@ -139,8 +169,35 @@ namespace mars {
         utils::msleep(1);
       //fprintf(stderr, "Delete mars_sim\n");
 
+      // the worlds use our mesh and heightmap loaders
+      worldsMutex.lock();
+      while(!worlds.empty()) {
+        Simulator *world = worlds.back();
+        worlds.pop_back();
+        world->exitMars();
+        delete world;
+      }
+      worldsMutex.unlock();
+
       if (control->controllers) delete control->controllers;
 
+      if(parentSim) {
+        // a world owns all of its objects
+        control->sensors->clearAllSensors(true);
+        control->motors->clearAllMotors(true);
+        control->joints->clearAllJoints(true);
+        control->nodes->clearAllNodes(true, false);
+        delete physics;
+        delete control->entities;
+        delete control->sensors;
+        delete control->motors;
+        delete control->joints;
+        delete control->nodes;
+        delete control->loadCenter;
+        delete control;
+        return;
+      }
+
       if(control->cfg) {
         string saveFile = configPath.sValue;
         saveFile.append("/mars_Config.yaml");
@@ -163,6 +220,7 @@ namespace mars {
       libManager->releaseLibrary("cfg_manager");
       libManager->releaseLibrary("data_broker");
       libManager->releaseLibrary("log_console");
+      if(meshLoader) delete meshLoader;
     }
 
     void Simulator::newLibLoaded(const std::string &libName) {
@@ -184,6 +242,10 @@ namespace mars {
                                                        dbSimDebugPackage,
                                                        NULL,
                                                        data_broker::DATA_PACKAGE_READ_FLAG);
+          dbSimStatsId = control->dataBroker->pushData("mars_sim", "simDebug",
+                                                       dbSimStatsPackage,
+                                                       NULL,
+                                                       data_broker::DATA_PACKAGE_READ_FLAG);
           getTimeMutex.unlock();
           control->dataBroker->createTimer("mars_sim/simTimer");
           control->dataBroker->createTrigger("mars_sim/prePhysicsUpdate");
@@ -268,6 +330,8 @@ namespace mars {
       // the physics step_size is in seconds
       physics->step_size = calc_ms/1000.;
       physics->fast_step = cfgFaststep.bValue;
+      physics->num_threads = cfgPhysicsThreads.iValue;
+      physics->deterministic = cfgDeterministic.bValue;
 
       physics->world_erp = cfgWorldErp.dValue;
       physics->world_cfm = cfgWorldCfm.dValue;
@@ -319,6 +383,7 @@ namespace mars {
        */
     void Simulator::run() {
 
+      physics->initThread();
       while (!kill_sim) {
         stepping_mutex.lock();
         if(simulationStatus == STOPPING)
@@ -377,8 +442,15 @@ namespace mars {
       physics->stepTheWorld();
 
       avg_step_time += getTimeDiff(time);
+      physics->getDebugStats(&physicsStats);
+      dbSimStatsPackage[0].set(physicsStats.numContacts);
+      dbSimStatsPackage[1].set(physicsStats.numContactAllocs);
 
       control->nodes->updateDynamicNodes(calc_ms); //Moved update to here, otherwise RaySensor is one step behind the world every time
+      control->nodes->getDebugStats(&nodeStats);
+      dbSimStatsPackage[2].set(nodeStats.numUpdateContentions);
+      dbSimStatsPackage[3].set(nodeStats.numLockedReads);
+      dbSimStatsPackage[4].set(nodeStats.numSnapshotReads);
       control->joints->updateJoints(calc_ms);
       control->motors->updateMotors(calc_ms);
       control->controllers->updateControllers(calc_ms);
@@ -436,6 +508,8 @@ namespace mars {
       if(control->dataBroker) {
         control->dataBroker->pushData(dbSimDebugId,
                                       dbSimDebugPackage);
+        control->dataBroker->pushData(dbSimStatsId,
+                                      dbSimStatsPackage);
       }
       if (sync_graphics) {
         calc_time += calc_ms;
@@ -578,6 +652,149 @@ namespace mars {
       }
     }
 
+    /**
+     * \brief Stores the simulation time and the state of the sim timer
+     * followed by the states of the node, joint and motor managers. The
+     * vector is cleared first, thus reusing it for every checkpoint
+     * avoids allocations.
+     */
+    void Simulator::saveCheckpoint(std::vector<sReal> *checkpoint) {
+      checkpoint->clear();
+      checkpoint->push_back(CHECKPOINT_VERSION);
+      getTimeMutex.lock();
+      checkpoint->push_back(dbSimTimePackage[0].d);
+      getTimeMutex.unlock();
+      timerState.clear();
+      if(control->dataBroker) {
+        control->dataBroker->saveTimerState("mars_sim/simTimer", &timerState);
+      }
+      checkpoint->push_back(timerState.size());
+      checkpoint->insert(checkpoint->end(), timerState.begin(),
+                         timerState.end());
+      control->nodes->saveState(checkpoint);
+      control->joints->saveState(checkpoint);
+      control->motors->saveState(checkpoint);
+    }
+
+    /**
+     * \brief Restores a checkpoint of saveCheckpoint without reloading
+     * the scene.
+     *
+     * \returns \c false if the checkpoint doesn't belong to the loaded
+     *          scene.
+     */
+    bool Simulator::restoreCheckpoint(const std::vector<sReal> &checkpoint) {
+      std::vector<CheckpointInterface*> sections;
+      size_t pos = 3;
+
+      if(checkpoint.size() < pos || checkpoint[0] != CHECKPOINT_VERSION ||
+         checkpoint.size() < pos + (size_t)checkpoint[2]) {
+        LOG_ERROR("Simulator::restoreCheckpoint: invalid checkpoint");
+        return false;
+      }
+      pos += (size_t)checkpoint[2];
+      sections.push_back(control->nodes);
+      sections.push_back(control->joints);
+      sections.push_back(control->motors);
+      if(!restoreCheckpointSections(checkpoint, &pos, sections)) {
+        LOG_ERROR("Simulator::restoreCheckpoint: checkpoint does not match the scene");
+        return false;
+      }
+      // the timer values are longs, sReal holds them exactly
+      timerState.assign(checkpoint.begin() + 3,
+                        checkpoint.begin() + 3 + (size_t)checkpoint[2]);
+      if(control->dataBroker && !timerState.empty() &&
+         !control->dataBroker->restoreTimerState("mars_sim/simTimer",
+                                                 timerState)) {
+        LOG_WARN("Simulator::restoreCheckpoint: the timed receivers changed, the sim timer is not restored");
+      }
+      getTimeMutex.lock();
+      dbSimTimePackage[0].set(checkpoint[1]);
+      getTimeMutex.unlock();
+      return true;
+    }
+
+    /**
+     * \brief Creates a headless world with the physics settings and the
+     * scene of this simulator.
+     *
+     * The world is built from the reload data of the managers, thus it
+     * starts in the state of a reset. The heightmap images are copied
+     * from the reload data, while meshes are read again by the loaders
+     * of this simulator. The collision buffers of meshes and terrains
+     * are shared with this simulator by the GeomDataCache. The thread
+     * of the world is started but the simulation stays stopped until
+     * StartSimulation is called.
+     */
+    SimulatorInterface* Simulator::createWorld(void) {
+      std::list<NodeData> nodes;
+      std::list<JointData> joints;
+      std::list<MotorData> motors;
+
+      if(!physics) {
+        LOG_ERROR("Simulator::createWorld: the simulation is not running");
+        return 0;
+      }
+
+      Simulator *world = new Simulator(libManager, this);
+      ControlCenter *c = world->control;
+      world->calc_ms = calc_ms;
+      world->gravity = gravity;
+      world->avg_count_steps = avg_count_steps;
+
+      c->nodes = new NodeManager(c, libManager);
+      c->joints = new JointManager(c);
+      c->motors = new MotorManager(c);
+      c->sensors = new SensorManager(c);
+      c->controllers = new ControllerManager(c);
+      c->entities = new EntityManager(c);
+
+      world->physics = PhysicsMapper::newWorldPhysics(c);
+      world->physics->initTheWorld();
+      world->physics->step_size = physics->step_size;
+      world->physics->fast_step = physics->fast_step;
+      world->physics->num_threads = physics->num_threads;
+      world->physics->deterministic = physics->deterministic;
+      world->physics->world_erp = physics->world_erp;
+      world->physics->world_cfm = physics->world_cfm;
+      world->physics->world_gravity = physics->world_gravity;
+      world->physics->draw_contact_points = false;
+
+      control->nodes->getReloadNodes(&nodes);
+      control->joints->getReloadJoints(&joints);
+      control->motors->getReloadMotors(&motors);
+      c->nodes->setReloadNodes(nodes);
+      c->joints->setReloadJoints(joints);
+      c->motors->setReloadMotors(motors);
+      world->reloadWorld();
+
+      worldsMutex.lock();
+      worlds.push_back(world);
+      worldsMutex.unlock();
+
+      world->start();
+      return world;
+    }
+
+    void Simulator::destroyWorld(SimulatorInterface *world) {
+      std::vector<Simulator*>::iterator iter;
+      Simulator *sim;
+
+      worldsMutex.lock();
+      iter = std::find(worlds.begin(), worlds.end(), world);
+      if(iter == worlds.end()) {
+        worldsMutex.unlock();
+        LOG_ERROR("Simulator::destroyWorld: world was not created by this simulator");
+        return;
+      }
+      sim = *iter;
+      worlds.erase(iter);
+      worldsMutex.unlock();
+
+      sim->exitMars();
+      delete sim;
+    }
+
     int Simulator::loadScene(const std::string &filename, const std::string &robotname, bool threadsave, bool blocking) {
       return loadScene(filename, false, robotname,threadsave,blocking);
     }
@@ -1043,8 +1260,14 @@ namespace mars {
       control->controllers->handleError();
 
       string onError;
-      control->cfg->getPropertyValue("Simulator", "onPhysicsError",
-                                     "value", &onError);
+      if(control->cfg) {
+        control->cfg->getPropertyValue("Simulator", "onPhysicsError",
+                                       "value", &onError);
+      }
+      else if(parentSim) {
+        // a failing world must not abort the other worlds
+        onError = "shutdown";
+      }
       std::transform(onError.begin(), onError.end(),
                      onError.begin(), ::tolower);
       if("abort" == onError || "" == onError) {
@@ -1065,6 +1288,11 @@ namespace mars {
       }
     }
 
+    /**
+     * \brief Sets the gravity through the configuration. A world created
+     * by createWorld has no configuration, thus its physics is set
+     * directly.
+     */
     void Simulator::setGravity(const Vector &gravity) {
       if(control->cfg) {
         control->cfg->setPropertyValue("Simulator", "Gravity x", "value",
@@ -1074,6 +1302,10 @@ namespace mars {
         control->cfg->setPropertyValue("Simulator", "Gravity z", "value",
                                        gravity.z());
       }
+      else {
+        this->gravity = gravity;
+        if(physics) physics->world_gravity = gravity;
+      }
     }
 
 
@@ -1232,6 +1464,24 @@ namespace mars {
         return;
       }
 
+      if(_property.paramId == cfgPhysicsThreads.paramId) {
+        if(physics) physics->num_threads = _property.iValue;
+        return;
+      }
+
+      if(_property.paramId == cfgDeterministic.paramId) {
+        if(physics) physics->deterministic = _property.bValue;
+        return;
+      }
+
+      if(_property.paramId == cfgDataBrokerThreads.paramId) {
+        if(control->dataBroker) {
+          int numThreads = std::max(_property.iValue, 1);
+          control->dataBroker->setAsyncDispatchThreads(numThreads);
+        }
+        return;
+      }
+
       if(_property.paramId == cfgRealtime.paramId) {
         my_real_time = _property.bValue;
         return;
@@ -1300,6 +1550,19 @@ namespace mars {
       calc_ms = cfgCalcMs.dValue;
       cfgFaststep = control->cfg->getOrCreateProperty("Simulator", "faststep",
                                                       false, this);
+      cfgPhysicsThreads = control->cfg->getOrCreateProperty("Simulator",
+                                                            "physics threads",
+                                                            (int)1, this);
+      cfgDeterministic = control->cfg->getOrCreateProperty("Simulator",
+                                                           "deterministic threads",
+                                                           false, this);
+      cfgDataBrokerThreads = control->cfg->getOrCreateProperty("Simulator",
+                                                               "data broker threads",
+                                                               (int)1, this);
+      if(control->dataBroker) {
+        int numThreads = std::max(cfgDataBrokerThreads.iValue, 1);
+        control->dataBroker->setAsyncDispatchThreads(numThreads);
+      }
       cfgRealtime = control->cfg->getOrCreateProperty("Simulator", "realtime calc",
                                                       true, this);
       my_real_time = cfgRealtime.bValue;
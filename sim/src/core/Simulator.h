@@ -41,6 +41,7 @@
 #include <mars/utils/ReadWriteLock.h>
 #include <mars/interfaces/sim/SimulatorInterface.h>
 #include <mars/interfaces/sim/PhysicsInterface.h>
+#include <mars/interfaces/sim/NodeManagerInterface.h>
 #include <mars/interfaces/sim/PluginInterface.h>
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/graphics/GraphicsUpdateInterface.h>
@@ -51,6 +52,8 @@
 namespace mars {
   namespace sim {
 
+    class MeshLoader;
+
     /**
      *\brief The Simulator class implements the main functions of the MARS simulation.
      *
@@ -78,7 +81,7 @@ namespace mars {
         STEPPING=3
       };
 
-      Simulator(lib_manager::LibManager *theManager); ///< Constructor of the \c class Simulator.
+      Simulator(lib_manager::LibManager *theManager, Simulator *parent = 0); ///< Constructor of the \c class Simulator.
       virtual ~Simulator();
       static Simulator *activeSimulator;
 
@@ -150,6 +153,10 @@ namespace mars {
       virtual void exportScene() const; ///< Exports the current scene as both *.obj and *.osg file.
       virtual bool sceneChanged() const;
       virtual void sceneHasChanged(bool reset);
+      virtual void saveCheckpoint(std::vector<interfaces::sReal> *checkpoint);
+      virtual bool restoreCheckpoint(const std::vector<interfaces::sReal> &checkpoint);
+      virtual interfaces::SimulatorInterface* createWorld(void);
+      virtual void destroyWorld(interfaces::SimulatorInterface *world);
 
       //threads
       virtual bool allConcurrencysHandled(); ///< Checks if external requests are open.
@@ -231,6 +238,10 @@ namespace mars {
       char was_running;
       bool kill_sim;
       interfaces::ControlCenter *control; ///< Pointer to instance of ControlCenter (created in Simulator::Simulator(lib_manager::LibManager *theManager))
+      Simulator *parentSim; ///< The simulator that created this world, 0 for the main simulator
+      std::vector<Simulator*> worlds; ///< The worlds created by createWorld
+      MeshLoader *meshLoader; ///< Loads the physics meshes while mars_graphics is not loaded
+      utils::Mutex worldsMutex;
       std::vector<LoadOptions> filesToLoad;
       bool sim_fault;
       bool exit_sim;
@@ -267,7 +278,7 @@ namespace mars {
       int std_port; ///< Controller port (default value: 1600)
       utils::Vector gravity;
       unsigned long dbPhysicsUpdateId;
-      unsigned long dbSimTimeId, dbSimDebugId;
+      unsigned long dbSimTimeId, dbSimDebugId, dbSimStatsId;
       unsigned long realStartTime;
 
       // plugins
@@ -287,11 +298,12 @@ namespace mars {
       void initCfgParams(void);
       std::string config_dir;
       cfg_manager::cfgPropertyStruct cfgCalcMs, cfgFaststep;
+      cfg_manager::cfgPropertyStruct cfgPhysicsThreads, cfgDeterministic;
       cfg_manager::cfgPropertyStruct cfgRealtime, cfgDebugTime;
       cfg_manager::cfgPropertyStruct cfgSyncGui, cfgDrawContact;
       cfg_manager::cfgPropertyStruct cfgGX, cfgGY, cfgGZ;
       cfg_manager::cfgPropertyStruct cfgWorldErp, cfgWorldCfm;
-      cfg_manager::cfgPropertyStruct cfgVisRep;
+      cfg_manager::cfgPropertyStruct cfgVisRep, cfgDataBrokerThreads;
       cfg_manager::cfgPropertyStruct cfgSyncTime;
       cfg_manager::cfgPropertyStruct configPath;
       cfg_manager::cfgPropertyStruct cfgUseNow;
@@ -300,7 +312,11 @@ namespace mars {
       // data
       data_broker::DataPackage dbPhysicsUpdatePackage;
       data_broker::DataPackage dbSimTimePackage;
+      std::vector<long> timerState; ///< Reused by the checkpoint methods
       data_broker::DataPackage dbSimDebugPackage;
+      data_broker::DataPackage dbSimStatsPackage;
+      interfaces::PhysicsDebugStats physicsStats;
+      interfaces::NodeManagerDebugStats nodeStats;
 
       // IceServer comServer;
 
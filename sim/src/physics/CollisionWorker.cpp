@@ -0,0 +1,146 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file CollisionWorker.cpp
+ *
+ */
+
+#include "CollisionWorker.h"
+#include "WorldPhysics.h"
+
+namespace mars {
+  namespace sim {
+
+    CollisionWorker::CollisionWorker(WorldPhysics *world) : world(world),
+                                                            jobQuery(0), jobRays(0),
+                                                            jobBegin(0),
+                                                            jobEnd(0),
+                                                            numAllocs(0),
+                                                            hasJob(false),
+                                                            killWorker(false) {
+    }
+
+    CollisionWorker::~CollisionWorker(void) {
+      stop();
+    }
+
+    /**
+     * \brief Starts the contact generation for the geom pairs
+     * [begin, end) of the world.
+     */
+    void CollisionWorker::startJob(size_t begin, size_t end) {
+      jobMutex.lock();
+      jobRays = 0;
+      jobBegin = begin;
+      jobEnd = end;
+      hasJob = true;
+      jobWC.wakeAll();
+      jobMutex.unlock();
+    }
+
+    /**
+     * \brief Starts the casting of the rays [begin, end) of the batch.
+     */
+    void CollisionWorker::startRayJob(const ray_query *query,
+                                      interfaces::RayBatch *rays,
+                                      size_t begin, size_t end) {
+      jobMutex.lock();
+      jobQuery = query;
+      jobRays = rays;
+      jobBegin = begin;
+      jobEnd = end;
+      hasJob = true;
+      jobWC.wakeAll();
+      jobMutex.unlock();
+    }
+
+    /**
+     * \brief Blocks until the current job is finished.
+     *
+     * Returns the number of heap allocations of the contact buffer
+     * that were needed for the job.
+     */
+    unsigned long CollisionWorker::waitForJob(void) {
+      unsigned long allocs;
+      jobMutex.lock();
+      while(hasJob) {
+        doneWC.wait(&jobMutex);
+      }
+      allocs = numAllocs;
+      jobMutex.unlock();
+      return allocs;
+    }
+
+    void CollisionWorker::stop(void) {
+      jobMutex.lock();
+      killWorker = true;
+      jobWC.wakeAll();
+      jobMutex.unlock();
+      if(isRunning()) {
+        wait();
+      }
+    }
+
+    void CollisionWorker::run(void) {
+      size_t begin, end;
+      unsigned long allocs;
+      interfaces::RayBatch *rays;
+      const ray_query *query;
+
+#ifdef ODE11
+      // ode needs thread local data for the trimesh collisions
+      dAllocateODEDataForThread(dAllocateMaskAll);
+#endif
+      WorldPhysics::current_world = world;
+      jobMutex.lock();
+      while(!killWorker) {
+        if(!hasJob) {
+          jobWC.wait(&jobMutex);
+          continue;
+        }
+        rays = jobRays;
+        query = jobQuery;
+        begin = jobBegin;
+        end = jobEnd;
+        jobMutex.unlock();
+
+        if(rays) {
+          world->castRayRange(*query, rays, begin, end);
+          allocs = 0;
+        }
+        else {
+          contacts.clear();
+          allocs = world->generateContacts(begin, end, &contacts);
+        }
+
+        jobMutex.lock();
+        numAllocs = allocs;
+        hasJob = false;
+        doneWC.wakeAll();
+      }
+      jobMutex.unlock();
+#ifdef ODE11
+      dCleanupODEAllDataForThread();
+#endif
+    }
+
+  } // end of namespace sim
+} // end of namespace mars
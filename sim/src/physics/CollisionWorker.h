@@ -0,0 +1,87 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file CollisionWorker.h
+ * \brief "CollisionWorker" generates the contacts of a range of geom pairs
+ *        or casts a range of rays in its own thread.
+ *
+ */
+
+#ifndef COLLISION_WORKER_H
+#define COLLISION_WORKER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "CollisionWorker.h"
+#endif
+
+#include <mars/utils/Thread.h>
+#include <mars/utils/Mutex.h>
+#include <mars/utils/WaitCondition.h>
+
+#include <vector>
+
+#include <mars/interfaces/sim/PhysicsInterface.h>
+
+#include <ode/ode.h>
+
+namespace mars {
+  namespace sim {
+
+    class WorldPhysics;
+    struct ray_query;
+
+    /**
+     * A worker thread that calls WorldPhysics::generateContacts for the
+     * range of geom pairs given by startJob. The contacts are written
+     * into the contact buffer of the worker that is reused over the
+     * steps. A job started by startRayJob casts the rays [begin, end)
+     * of the batch with WorldPhysics::castRayRange instead.
+     */
+    class CollisionWorker : public utils::Thread {
+    public:
+      CollisionWorker(WorldPhysics *world);
+      ~CollisionWorker(void);
+
+      void startJob(size_t begin, size_t end);
+      void startRayJob(const ray_query *query, interfaces::RayBatch *rays,
+                       size_t begin, size_t end);
+      unsigned long waitForJob(void);
+      void stop(void);
+
+    protected:
+      void run(void);
+
+    private:
+      WorldPhysics *world;
+      std::vector<dContact> contacts;
+      utils::Mutex jobMutex;
+      utils::WaitCondition jobWC, doneWC;
+      const ray_query *jobQuery;
+      interfaces::RayBatch *jobRays;
+      size_t jobBegin, jobEnd;
+      unsigned long numAllocs;
+      bool hasJob, killWorker;
+    };
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif  // COLLISION_WORKER_H
@@ -0,0 +1,255 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file GeomDataCache.cpp
+ * \brief "GeomDataCache" shares the read-only collision buffers of meshes
+ *        and heightfields between the worlds of a process.
+ *
+ */
+
+#include "GeomDataCache.h"
+
+#include <mars/utils/Mutex.h>
+#include <mars/utils/MutexLocker.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+#ifndef WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace mars {
+  namespace sim {
+
+    using namespace utils;
+    using namespace interfaces;
+
+    static Mutex cacheMutex;
+    static std::multimap<std::string, SharedTriMesh*> triMeshes;
+    static std::multimap<std::string, SharedHeights*> heightFields;
+
+    /**
+     * \brief Maps a raw float DEM read-only into memory.
+     *
+     * Returns 0 if the file can not be mapped or its size does not match
+     * the samples of the terrain. On success mappedSize holds the size
+     * that has to be passed to munmap.
+     */
+    static float* mapFloatDEM(const terrainStruct *terrain, size_t *mappedSize) {
+      size_t size = (size_t)terrain->width*terrain->height*sizeof(float);
+      float *data = 0;
+      *mappedSize = 0;
+#ifndef WIN32
+      int fd = open(terrain->srcname.c_str(), O_RDONLY);
+      if(fd < 0) return 0;
+      struct stat fileStat;
+      if(size && fstat(fd, &fileStat) == 0 && (size_t)fileStat.st_size == size) {
+        void *mapped = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        if(mapped != MAP_FAILED) {
+          data = (float*)mapped;
+          *mappedSize = size;
+        }
+      }
+      close(fd);
+#else
+      FILE *input = fopen(terrain->srcname.c_str(), "rb");
+      if(!input) return 0;
+      data = (float*)malloc(size);
+      if(data && fread(data, 1, size, input) != size) {
+        free(data);
+        data = 0;
+      }
+      fclose(input);
+#endif
+      return data;
+    }
+
+    static bool matchTriMesh(const SharedTriMesh *mesh, const snmesh &m) {
+      if(mesh->vertexcount != m.vertexcount ||
+         mesh->indexcount != m.indexcount) {
+        return false;
+      }
+      for(int i=0; i<m.vertexcount; ++i) {
+        for(int k=0; k<3; ++k) {
+          if(mesh->vertices[i][k] != (dReal)m.vertices[i][k]) return false;
+        }
+      }
+      for(int i=0; i<m.indexcount; ++i) {
+        if(mesh->indices[i] != (dTriIndex)m.indices[i]) return false;
+      }
+      return true;
+    }
+
+    /**
+     * The pixelData of an image is stored with the -y edge first, ode
+     * expects the rows in the opposite order.
+     */
+    static float imageHeight(const terrainStruct *terrain, int row, int col) {
+      return (float)terrain->pixelData[(size_t)(terrain->height-(row+1))*
+                                       terrain->width + col];
+    }
+
+    static bool matchHeights(const SharedHeights *heights,
+                             const terrainStruct *terrain) {
+      if(heights->width != terrain->width ||
+         heights->height != terrain->height) {
+        return false;
+      }
+      // the same DEM file is mapped with the same content
+      if(heights->mapped || terrain->isFloatDEM()) return true;
+      for(int row=0; row<terrain->height; ++row) {
+        const float *data = heights->data + (size_t)row*terrain->width;
+        for(int col=0; col<terrain->width; ++col) {
+          if(data[col] != imageHeight(terrain, row, col)) return false;
+        }
+      }
+      return true;
+    }
+
+    SharedTriMesh* GeomDataCache::acquireTriMesh(const NodeData *node) {
+      std::multimap<std::string, SharedTriMesh*>::iterator it, end;
+      const snmesh &m = node->mesh;
+      SharedTriMesh *mesh;
+      MutexLocker locker(&cacheMutex);
+
+      if(!node->filename.empty()) {
+        end = triMeshes.upper_bound(node->filename);
+        for(it=triMeshes.lower_bound(node->filename); it!=end; ++it) {
+          if(matchTriMesh(it->second, m)) {
+            ++it->second->references;
+            return it->second;
+          }
+        }
+      }
+
+      mesh = new SharedTriMesh;
+      mesh->filename = node->filename;
+      mesh->vertexcount = m.vertexcount;
+      mesh->indexcount = m.indexcount;
+      mesh->references = 1;
+      // the mesh is copied to prevent errors in case of double to float
+      // conversion
+      mesh->vertices = (dVector3*)calloc(m.vertexcount, sizeof(dVector3));
+      mesh->indices = (dTriIndex*)calloc(m.indexcount, sizeof(dTriIndex));
+      for(int i=0; i<m.vertexcount; ++i) {
+        mesh->vertices[i][0] = (dReal)m.vertices[i][0];
+        mesh->vertices[i][1] = (dReal)m.vertices[i][1];
+        mesh->vertices[i][2] = (dReal)m.vertices[i][2];
+      }
+      for(int i=0; i<m.indexcount; ++i) {
+        mesh->indices[i] = (dTriIndex)m.indices[i];
+      }
+      mesh->data = dGeomTriMeshDataCreate();
+      dGeomTriMeshDataBuildSimple(mesh->data, (dReal*)mesh->vertices,
+                                  m.vertexcount, mesh->indices, m.indexcount);
+      if(!mesh->filename.empty()) {
+        triMeshes.insert(std::make_pair(mesh->filename, mesh));
+      }
+      return mesh;
+    }
+
+    void GeomDataCache::release(SharedTriMesh *mesh) {
+      std::multimap<std::string, SharedTriMesh*>::iterator it, end;
+      MutexLocker locker(&cacheMutex);
+
+      if(--mesh->references > 0) return;
+      end = triMeshes.upper_bound(mesh->filename);
+      for(it=triMeshes.lower_bound(mesh->filename); it!=end; ++it) {
+        if(it->second == mesh) {
+          triMeshes.erase(it);
+          break;
+        }
+      }
+      dGeomTriMeshDataDestroy(mesh->data);
+      free(mesh->vertices);
+      free(mesh->indices);
+      delete mesh;
+    }
+
+    SharedHeights* GeomDataCache::acquireHeights(const terrainStruct *terrain) {
+      std::multimap<std::string, SharedHeights*>::iterator it, end;
+      SharedHeights *heights;
+      float *data;
+      size_t mapped = 0;
+      MutexLocker locker(&cacheMutex);
+
+      end = heightFields.upper_bound(terrain->srcname);
+      for(it=heightFields.lower_bound(terrain->srcname); it!=end; ++it) {
+        if(matchHeights(it->second, terrain)) {
+          ++it->second->references;
+          return it->second;
+        }
+      }
+
+      if(terrain->isFloatDEM()) {
+        data = mapFloatDEM(terrain, &mapped);
+        if(!data) return 0;
+      }
+      else {
+        if(!terrain->pixelData) return 0;
+        data = (float*)malloc((size_t)terrain->width*terrain->height*
+                              sizeof(float));
+        for(int row=0; row<terrain->height; ++row) {
+          float *dst = data + (size_t)row*terrain->width;
+          for(int col=0; col<terrain->width; ++col) {
+            dst[col] = imageHeight(terrain, row, col);
+          }
+        }
+      }
+      heights = new SharedHeights;
+      heights->srcname = terrain->srcname;
+      heights->data = data;
+      heights->width = terrain->width;
+      heights->height = terrain->height;
+      heights->mapped = mapped;
+      heights->references = 1;
+      heightFields.insert(std::make_pair(heights->srcname, heights));
+      return heights;
+    }
+
+    void GeomDataCache::release(SharedHeights *heights) {
+      std::multimap<std::string, SharedHeights*>::iterator it, end;
+      MutexLocker locker(&cacheMutex);
+
+      if(--heights->references > 0) return;
+      end = heightFields.upper_bound(heights->srcname);
+      for(it=heightFields.lower_bound(heights->srcname); it!=end; ++it) {
+        if(it->second == heights) {
+          heightFields.erase(it);
+          break;
+        }
+      }
+#ifndef WIN32
+      if(heights->mapped) munmap(heights->data, heights->mapped);
+      else free(heights->data);
+#else
+      free(heights->data);
+#endif
+      delete heights;
+    }
+
+  } // end of namespace sim
+} // end of namespace mars
@@ -0,0 +1,108 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file GeomDataCache.h
+ * \brief "GeomDataCache" shares the read-only collision buffers of meshes
+ *        and heightfields between the worlds of a process.
+ *
+ */
+
+#ifndef GEOM_DATA_CACHE_H
+#define GEOM_DATA_CACHE_H
+
+#ifdef _PRINT_HEADER_
+  #warning "GeomDataCache.h"
+#endif
+
+#include <mars/interfaces/NodeData.h>
+#include <mars/interfaces/terrainStruct.h>
+
+#include <string>
+
+#include <ode/ode.h>
+
+#ifndef ODE11
+  #define dTriIndex int
+#endif
+
+namespace mars {
+  namespace sim {
+
+    /**
+     * The vertices, indices and the ode data of a triangle mesh. The
+     * buffers are never changed after they are built, thus the geoms of
+     * several worlds can use them at the same time.
+     */
+    struct SharedTriMesh {
+      std::string filename;
+      dVector3 *vertices;
+      dTriIndex *indices;
+      int vertexcount;
+      int indexcount;
+      dTriMeshDataID data;
+      int references;
+    };
+
+    /**
+     * The heights of a heightfield in the sample order of ode. A ".f32"
+     * DEM is mapped, mapped holds the size that is passed to munmap.
+     */
+    struct SharedHeights {
+      std::string srcname;
+      float *data;
+      int width;
+      int height;
+      size_t mapped;
+      int references;
+    };
+
+    /**
+     * Keeps one buffer per file as long as a geom of any world uses it.
+     * Worlds created by Simulator::createWorld load the same scene, thus
+     * they share the converted meshes, the trees that ode builds on them
+     * and the heights instead of building them once per world.
+     *
+     * A buffer is looked up by the file name and only shared if its
+     * content matches the node, thus nodes that scale a mesh differently
+     * or have no file get buffers of their own.
+     */
+    class GeomDataCache {
+    public:
+      /**
+       * \brief Returns the buffers of the snmesh of the node. Each call
+       * has to be paired with a call of release.
+       */
+      static SharedTriMesh* acquireTriMesh(const interfaces::NodeData *node);
+      static void release(SharedTriMesh *mesh);
+
+      /**
+       * \brief Returns the heights of the terrain, or 0 if a ".f32" DEM
+       * can not be read or the image of the terrain is not loaded. Each
+       * result has to be passed to release.
+       */
+      static SharedHeights* acquireHeights(const interfaces::terrainStruct *terrain);
+      static void release(SharedHeights *heights);
+    };
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif  // GEOM_DATA_CACHE_H
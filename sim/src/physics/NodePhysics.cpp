@@ -72,13 +72,12 @@ namespace mars {
       theWorld = (WorldPhysics*)world;
       nBody = 0;
       nGeom = 0;
-      myVertices = 0;
-      myIndices = 0;
-      myTriMeshData = 0;
+      triMesh = 0;
       composite = false;
       //node_data.num_ground_collisions = 0;
       node_data.setZero();
-      height_data = 0;
+      height_id = 0;
+      heights = 0;
       dMassSetZero(&nMass);
     }
 
@@ -94,31 +93,17 @@ namespace mars {
      * are the geom and the body realy all thing to take care of?
      */
     NodePhysics::~NodePhysics(void) {
-      std::vector<sensor_list_element>::iterator iter;
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->invalidateRayTree();
 
       if(nBody) theWorld->destroyBody(nBody, this);
 
       if(nGeom) dGeomDestroy(nGeom);
 
-      if(myVertices) free(myVertices);
-      if(myIndices) free(myIndices);
-      if(height_data) free(height_data);
-
-      // TODO: how does this loop work? why doesn't it run forever?
-      for(iter = sensor_list.begin(); iter != sensor_list.end();) {
-        if((*iter).gd){
-          delete ((*iter).gd);
-          (*iter).gd = 0;
-        }
-        dGeomDestroy((*iter).geom);
-        sensor_list.erase(iter);
-      }
-      if(myTriMeshData) dGeomTriMeshDataDestroy(myTriMeshData);
-    }
+      freeHeightfield();
 
-    dReal heightfield_callback(void* pUserData, int x, int z ) {
-      return ((NodePhysics*)pUserData)->heightCallback(x, z);
+      sensor_list.clear();
+      if(triMesh) GeomDataCache::release(triMesh);
     }
 
     /**
@@ -143,6 +128,7 @@ namespace mars {
               node->mass, node->density);
 #endif
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->invalidateRayTree();
       if(theWorld && theWorld->existsWorld()) {
         bool ret;
         //LOG_DEBUG("physicMode %d", node->physicMode);
@@ -275,6 +261,7 @@ namespace mars {
       dReal npos[3];
       Vector offset;
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->invalidateRayTree();
 
       if(composite) {
         if(move_group) {
@@ -513,6 +500,7 @@ namespace mars {
       dMatrix3 R;
       dVector3 pos, new_pos, new2_pos;
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->invalidateRayTree();
 
       pos[0] = pos[1] = pos[2] = 0;
       tmp[1] = (dReal)q.x();
@@ -598,14 +586,20 @@ namespace mars {
       return nBody;
     }
 
+    /**
+     * \brief Returns the geom of the node; used by the ray queries to
+     * skip the node that carries the sensor.
+     */
+    dGeomID NodePhysics::getGeom() const {
+      return nGeom;
+    }
+
     /**
      * \brief The method creates an ode mesh representation of the given node.
      *
      *
      */
     bool NodePhysics::createMesh(NodeData* node) {
-      int i;
-
       if (!node->inertia_set && 
           (node->ext.x() <= 0 || node->ext.y() <= 0 || node->ext.z() <= 0)) {
         LOG_ERROR("Cannot create Node \"%s\" (id=%lu):\n"
@@ -616,26 +610,10 @@ namespace mars {
         return false;
       }
 
-      myVertices = (dVector3*)calloc(node->mesh.vertexcount, sizeof(dVector3));
-      myIndices = (dTriIndex*)calloc(node->mesh.indexcount, sizeof(dTriIndex));
-      //LOG_DEBUG("%d %d", node->mesh.vertexcount, node->mesh.indexcount);
-      // first we have to copy the mesh data to prevent errors in case
-      // of double to float conversion
-      for(i=0; i<node->mesh.vertexcount; i++) {
-        myVertices[i][0] = (dReal)node->mesh.vertices[i][0];
-        myVertices[i][1] = (dReal)node->mesh.vertices[i][1];
-        myVertices[i][2] = (dReal)node->mesh.vertices[i][2];
-      }
-      for(i=0; i<node->mesh.indexcount; i++) {
-        myIndices[i] = (dTriIndex)node->mesh.indices[i];
-      }
-
-      // then we can build the ode representation
-      myTriMeshData = dGeomTriMeshDataCreate();
-      dGeomTriMeshDataBuildSimple(myTriMeshData, (dReal*)myVertices,
-                                  node->mesh.vertexcount,
-                                  myIndices, node->mesh.indexcount);
-      nGeom = dCreateTriMesh(theWorld->getSpace(), myTriMeshData, 0, 0, 0);
+      // the ode representation of a mesh that another world already
+      // loaded is reused
+      triMesh = GeomDataCache::acquireTriMesh(node);
+      nGeom = dCreateTriMesh(theWorld->getSpace(), triMesh->data, 0, 0, 0);
 
       // at this moment we set the mass properties as the mass of the
       // bounding box if no mass and inertia is set by the user
@@ -794,34 +772,39 @@ namespace mars {
       return true;
     }
 
+    /**
+     * \brief Creates the ode heightfield on a float buffer without copy
+     * and without a height callback.
+     *
+     * A ".f32" DEM is mapped directly, it is already stored in the sample
+     * order of ode. The pixelData of an image is stored with the -y edge
+     * first and is copied flipped into a float buffer. The buffer is
+     * shared with the other worlds that load the same terrain.
+     */
     bool NodePhysics::createHeightfield(NodeData* node) {
       dMatrix3 R;
-      unsigned long size;
-      int x, y;
       terrain = node->terrain;
-      size = terrain->width*terrain->height;
-      if(!height_data) height_data = (dReal*)calloc(size, sizeof(dReal));
-      for(x=0; x<terrain->height; x++) {
-        for(y=0; y<terrain->width; y++) {
-          height_data[(terrain->height-(x+1))*terrain->width+y] = (dReal)terrain->pixelData[x*terrain->width+y];
+      freeHeightfield();
+      heights = GeomDataCache::acquireHeights(terrain);
+      if(!heights) {
+        if(terrain->isFloatDEM()) {
+          LOG_ERROR("NodePhysics: could not map terrain: %s",
+                    terrain->srcname.c_str());
         }
+        return false;
       }
       // build the ode representation
-      dHeightfieldDataID heightid = dGeomHeightfieldDataCreate();
-
-      // Create an finite heightfield.
-      dGeomHeightfieldDataBuildCallback(heightid, this, heightfield_callback,
-                                        terrain->targetWidth,
-                                        terrain->targetHeight,
-                                        terrain->width, terrain->height,
-                                        REAL(1.0), REAL( 0.0 ),
-                                        REAL(1.0), 0);
-      // Give some very bounds which, while conservative,
-      // makes AABB computation more accurate than +/-INF.
-      dGeomHeightfieldDataSetBounds(heightid, REAL(-terrain->scale*2.0),
-                                    REAL(terrain->scale*2.0));
-      //dGeomHeightfieldDataSetBounds(heightid, -terrain->scale, terrain->scale);
-      nGeom = dCreateHeightfield(theWorld->getSpace(), heightid, 1);
+      height_id = dGeomHeightfieldDataCreate();
+
+      // Create an finite heightfield on our buffer.
+      dGeomHeightfieldDataBuildSingle(height_id, heights->data, 0,
+                                      terrain->targetWidth,
+                                      terrain->targetHeight,
+                                      terrain->width, terrain->height,
+                                      (dReal)terrain->scale, REAL( 0.0 ),
+                                      REAL(1.0), 0);
+      // the bounds of the AABB are computed by ode from the samples
+      nGeom = dCreateHeightfield(theWorld->getSpace(), height_id, 1);
       dRSetIdentity(R);
       dRFromAxisAndAngle(R, 1, 0, 0, M_PI/2);
       dGeomSetRotation(nGeom, R);
@@ -903,6 +886,7 @@ namespace mars {
       Vector npos;
       dMatrix3 R;
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->invalidateRayTree();
   
       tmp[1] = (dReal)rotation.x();
       tmp[2] = (dReal)rotation.y();
@@ -1005,6 +989,7 @@ namespace mars {
               node->mass, node->density);
 #endif
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->invalidateRayTree();
 
       if(nGeom && theWorld && theWorld->existsWorld()) {
         if(composite) {
@@ -1017,6 +1002,8 @@ namespace mars {
         // deferre destruction of geom until after the successful creation of 
         // a new geom
         dGeomID tmpGeomId = nGeom;
+        SharedTriMesh *tmpTriMesh = triMesh;
+        triMesh = 0;
         // first we create a ode geometry for the node
         bool success = false;
         switch(node->physicMode) {
@@ -1044,6 +1031,7 @@ namespace mars {
           break;
         }
         if(!success) {
+          triMesh = tmpTriMesh;
           fprintf(stderr, "creation of body geometry failed.\n");
           return 0;
         }
@@ -1052,6 +1040,8 @@ namespace mars {
           nBody = NULL;
         }
         dGeomDestroy(tmpGeomId);
+        // the old mesh buffers are released after the geom that used them
+        if(tmpTriMesh) GeomDataCache::release(tmpTriMesh);
         // now the geom is rebuild and we have to reconnect it to the body
         // and reset the mass of the body
         if(!node->movable) {
@@ -1241,7 +1231,8 @@ namespace mars {
     void NodePhysics::getContactIDs(std::list<interfaces::NodeId> *ids) const {
       ids->clear();
       if(nGeom) {
-        *ids = node_data.contact_ids;
+        ids->assign(node_data.contact_ids.begin(),
+                    node_data.contact_ids.end());
       }
     }
 
@@ -1334,13 +1325,115 @@ namespace mars {
       dMassTranslate(tMass, pos[0], pos[1], pos[2]);
     }
 
-    dReal NodePhysics::heightCallback(int x, int y) {
+    /**
+     * \brief Copies the position, rotation, velocities, force and torque
+     * of the node into the given slot of the state buffer.
+     *
+     * pre:
+     *     - the iMutex of the world is locked by the caller
+     *     - states is resized to hold at least index+1 nodes
+     *
+     * post:
+     *     - the values equal the ones of the single getter functions
+     */
+    void NodePhysics::getState(NodeStateBuffer *states, size_t index) const {
+      // no lock because the world locks for the whole node list
+      sReal *pos = &states->pos[index*3];
+      sReal *rot = &states->rot[index*4];
+      sReal *l_vel = &states->lin_vel[index*3];
+      sReal *a_vel = &states->ang_vel[index*3];
+      sReal *force = &states->force[index*3];
+      sReal *torque = &states->torque[index*3];
+      const dReal *tmp;
+      dQuaternion q;
+      int i;
+
+      if(nGeom) {
+        tmp = dGeomGetPosition(nGeom);
+        dGeomGetQuaternion(nGeom, q);
+        for(i=0; i<3; ++i) pos[i] = (sReal)tmp[i];
+        rot[0] = (sReal)q[1];
+        rot[1] = (sReal)q[2];
+        rot[2] = (sReal)q[3];
+        rot[3] = (sReal)q[0];
+      }
+      else {
+        for(i=0; i<3; ++i) pos[i] = rot[i] = (sReal)0;
+        rot[3] = (sReal)1;
+      }
+
+      if(nBody) {
+        tmp = dBodyGetLinearVel(nBody);
+        for(i=0; i<3; ++i) l_vel[i] = (sReal)tmp[i];
+        tmp = dBodyGetAngularVel(nBody);
+        for(i=0; i<3; ++i) a_vel[i] = (sReal)tmp[i];
+        tmp = dBodyGetForce(nBody);
+        for(i=0; i<3; ++i) force[i] = (sReal)tmp[i];
+        tmp = dBodyGetTorque(nBody);
+        for(i=0; i<3; ++i) torque[i] = (sReal)tmp[i];
+      }
+      else {
+        for(i=0; i<3; ++i) {
+          l_vel[i] = a_vel[i] = force[i] = torque[i] = (sReal)0;
+        }
+      }
+    }
+
+    /**
+     * \brief Sets the node to the values stored by getState.
+     *
+     * pre:
+     *     - the iMutex of the world is locked by the caller
+     *
+     * post:
+     *     - the body of the node is moved so that the geom gets the stored
+     *       pose, the geom offset of composite nodes is kept
+     */
+    void NodePhysics::setState(const NodeStateBuffer &states, size_t index) {
+      // no lock because the world locks for the whole node list
+      const sReal *pos = &states.pos[index*3];
+      const sReal *rot = &states.rot[index*4];
+      const sReal *tmp;
+      dQuaternion q;
+
+      if(!nGeom) return;
+      theWorld->invalidateRayTree();
+
+      q[0] = (dReal)rot[3];
+      q[1] = (dReal)rot[0];
+      q[2] = (dReal)rot[1];
+      q[3] = (dReal)rot[2];
+      // the rotation first, because the position takes the offset
+      // rotated into account
+      dGeomSetQuaternion(nGeom, q);
+      dGeomSetPosition(nGeom, (dReal)pos[0], (dReal)pos[1], (dReal)pos[2]);
+
+      if(nBody) {
+        tmp = &states.lin_vel[index*3];
+        dBodySetLinearVel(nBody, (dReal)tmp[0], (dReal)tmp[1], (dReal)tmp[2]);
+        tmp = &states.ang_vel[index*3];
+        dBodySetAngularVel(nBody, (dReal)tmp[0], (dReal)tmp[1], (dReal)tmp[2]);
+        tmp = &states.force[index*3];
+        dBodySetForce(nBody, (dReal)tmp[0], (dReal)tmp[1], (dReal)tmp[2]);
+        tmp = &states.torque[index*3];
+        dBodySetTorque(nBody, (dReal)tmp[0], (dReal)tmp[1], (dReal)tmp[2]);
+      }
+    }
 
-      return (dReal)height_data[(y*terrain->width)+x]*terrain->scale;
+    /**
+     * \brief Releases the heightfield data. The geom that uses it has to
+     * be destroyed before.
+     */
+    void NodePhysics::freeHeightfield(void) {
+      if(height_id) dGeomHeightfieldDataDestroy(height_id);
+      if(heights) GeomDataCache::release(heights);
+      height_id = 0;
+      heights = 0;
     }
 
     void NodePhysics::setContactParams(contact_params& c_params) {
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->invalidateRayTree();
       node_data.c_params = c_params;
       if(nGeom) {
         dGeomSetCollideBits(nGeom, c_params.coll_bitmask);
@@ -1366,16 +1459,13 @@ namespace mars {
     void NodePhysics::addSensor(BaseSensor* sensor) {
       MutexLocker locker(&(theWorld->iMutex));
       int i;
-      geom_data* gd;
       sensor_list_element sle;
-      const dReal *pos = dGeomGetPosition(nGeom);
-      const dReal *rot = dGeomGetRotation(nGeom);
       Vector direction;
-      dVector3 dest, tmp;
       //sReal rad_angle, rad_steps, rad_start;
       double rad_steps, rad_start;
 
-
+      // the rays are cast by WorldPhysics::castRays in handleSensorData,
+      // thus only the directions in the node frame are stored here
       BasePolarIntersectionSensor *polarSensor;
       polarSensor = dynamic_cast<BasePolarIntersectionSensor*>(sensor);
   
@@ -1383,8 +1473,7 @@ namespace mars {
       if(polarSensor){
         sle.sensor = sensor;
         sle.updateTime = 0.0;
-        //sensor.count_data = sensor.resolution;
-        //sensor.data = (sReal*)malloc(sensor.resolution * sizeof(sReal));
+        sle.ray_pos_offset = Vector(0.0, 0.0, 0.0);
    
         mars::sim::RotatingRaySensor* rotRaySensor = dynamic_cast<RotatingRaySensor*>(sensor);
         if(rotRaySensor){
@@ -1394,33 +1483,11 @@ namespace mars {
             
             // Requests and adds the single rays using the local sensor frame.
             for(i=0; i<N; i++){
-                gd = new geom_data;
-                (*gd).setZero();
-                gd->sense_contact_force = 0;
-                (*polarSensor)[i] = gd->value = polarSensor->maxDistance;//sensor.max_distance;
-                gd->ray_sensor = 1;
-                gd->parent_geom = nGeom;
-                gd->parent_body = nBody;
-                sle.geom = dCreateRay(NULL, polarSensor->maxDistance);
-                dGeomSetCollideBits(sle.geom, 32768);
-                dGeomSetCategoryBits(sle.geom, 32768);
-                
+                (*polarSensor)[i] = polarSensor->maxDistance;
                 // Use the precalculated ray directions of the sensor. 
-                direction = /*polarSensor->getOrientation() **/ directions[i];
-                sle.ray_direction = direction;
-                tmp[0] = direction.x();
-                tmp[1] = direction.y();
-                tmp[2] = direction.z();
-                dMULTIPLY0_331(dest, rot, tmp);
-                dGeomRaySet(sle.geom, pos[0], pos[1], pos[2], dest[0], dest[1], dest[2]);
-                sle.gd = gd;
+                sle.ray_direction = directions[i];
                 sle.index = i;
                 sensor_list.push_back(sle);
-                dGeomSetData(sle.geom, gd);
-                //dGeomRaySetParams(sle.geom, 1, 1);
-                dGeomSetCollideBits(sle.geom, COLLIDE_MASK_SENSOR);
-                dGeomSetCategoryBits(sle.geom, COLLIDE_MASK_SENSOR);
-                dGeomDisable(sle.geom);
             }
         } else {
             //rad_angle = polarSensor->widthX*; //M_PI*sensor.flare_angle/180;
@@ -1430,35 +1497,13 @@ namespace mars {
               rad_start = 0;
             }
             for(i=0; i<rad_steps; i++) {
-              gd = new geom_data;
-              (*gd).setZero();
-              gd->sense_contact_force = 0;
-              (*polarSensor)[i] = gd->value = polarSensor->maxDistance;//sensor.max_distance;
-
-              gd->ray_sensor = 1;
-              gd->parent_geom = nGeom;
-              gd->parent_body = nBody;
-              sle.geom = dCreateRay(NULL, polarSensor->maxDistance);
-              dGeomSetCollideBits(sle.geom, 32768);
-              dGeomSetCategoryBits(sle.geom, 32768);
+              (*polarSensor)[i] = polarSensor->maxDistance;
               direction = Vector(cos(rad_start+i*polarSensor->stepX),
                                  sin(rad_start+i*polarSensor->stepX), 0);
-              //direction = QVRotate(sensor.rotation, direction);
               direction = (polarSensor->getOrientation() * direction);
               sle.ray_direction = direction;
-              tmp[0] = direction.x();
-              tmp[1] = direction.y();
-              tmp[2] = direction.z();
-              dMULTIPLY0_331(dest, rot, tmp);
-              dGeomRaySet(sle.geom, pos[0], pos[1], pos[2], dest[0], dest[1], dest[2]);
-              sle.gd = gd;
               sle.index = i;
               sensor_list.push_back(sle);
-              dGeomSetData(sle.geom, gd);
-              //dGeomRaySetParams(sle.geom, 1, 1);
-              dGeomSetCollideBits(sle.geom, COLLIDE_MASK_SENSOR);
-              dGeomSetCategoryBits(sle.geom, COLLIDE_MASK_SENSOR);
-              dGeomDisable(sle.geom);
             }
         }
       }
@@ -1470,72 +1515,22 @@ namespace mars {
         sle.sensor = sensor;
         sle.updateTime = 0.0;
         int cols, rows;
-        dVector3 dir={0,0,0,0}, xStep={0,0,0,0}, 
-            yStep={0,0,0,0}, xOffset={0,0,0,0}, yOffset={0,0,0,0};
+        // the grid offsets are not used yet; all rays start at the node
+        Vector xStep(0.0, 0.0, 0.0), yStep(0.0, 0.0, 0.0);
 
         cols = polarGridSensor->getCols();
         rows = polarGridSensor->getRows();
-    
-        tmp[0] = 0;
-        tmp[1] = 0;
-        tmp[2] = -1;
-        dMULTIPLY0_331(dir, rot, tmp);
-        tmp[0] = polarGridSensor->stepX;
-        tmp[1] = 0;
-        tmp[2] = 0;
-        //dMULTIPLY0_331(xStep, rot, tmp);
-        tmp[0] = 0;
-        tmp[1] = polarGridSensor->stepY;
-        tmp[2] = 0;
-        //dMULTIPLY0_331(yStep, rot, tmp);
-
+        direction = (polarGridSensor->getOrientation() *
+                     Vector(0.0, 0.0, -1.0));
 
         for(int x=0; x<cols; x++) {
           for(int y=0; y<rows; y++) {
-            gd = new geom_data;
-            (*gd).setZero();
-            gd->sense_contact_force = 0;
-            (*polarGridSensor)[y*cols+x] = gd->value = polarGridSensor->maxDistance;
-      
-            gd->ray_sensor = 1;
-            gd->parent_geom = nGeom;
-            sle.geom = dCreateRay(theWorld->getSpace(),
-                                  polarGridSensor->maxDistance);
-            dGeomSetCollideBits(sle.geom, 32768);
-            dGeomSetCategoryBits(sle.geom, 32768);
-        
-            direction = (polarGridSensor->getOrientation() *
-                         Vector(0.0, 0.0, -1.0));
+            (*polarGridSensor)[y*cols+x] = polarGridSensor->maxDistance;
             sle.ray_direction = direction;
-            tmp[0] = direction.x();
-            tmp[1] = direction.y();
-            tmp[2] = direction.z();
-            dMULTIPLY0_331(dest, rot, tmp);
-            xOffset[0] =  -cols*0.5*xStep[0] + x*xStep[0];
-            xOffset[1] =  -cols*0.5*xStep[1] + x*xStep[1];
-            xOffset[2] =  -cols*0.5*xStep[2] + x*xStep[2];
-
-            yOffset[0] =  -rows*0.5*yStep[0] + y*yStep[0];
-            yOffset[1] =  -rows*0.5*yStep[1] + y*yStep[1];
-            yOffset[2] =  -rows*0.5*yStep[2] + y*yStep[2];
-        
-            sle.ray_pos_offset.x() = xOffset[0] + yOffset[0];
-            sle.ray_pos_offset.y() = xOffset[1] + yOffset[1];
-            sle.ray_pos_offset.z() = xOffset[2] + yOffset[2];
-
-            dGeomRaySet(sle.geom, pos[0] + xOffset[0] + yOffset[0],
-                        pos[1] + xOffset[1] + yOffset[1],
-                        pos[2]  + xOffset[2] + yOffset[2],
-                        dest[0], dest[1], dest[2]);
-            sle.gd = gd;
+            sle.ray_pos_offset = ((x-cols*0.5)*xStep +
+                                  (y-rows*0.5)*yStep);
             sle.index = y*cols+x;
             sensor_list.push_back(sle);      
-            dGeomSetData(sle.geom, gd);
-            //dGeomRaySetParams(sle.geom, 1, 1);      
-            dGeomSetCollideBits(sle.geom, COLLIDE_MASK_SENSOR);
-            dGeomSetCategoryBits(sle.geom, COLLIDE_MASK_SENSOR);
-            dGeomDisable(sle.geom);
-        
           }
         }
       }
@@ -1546,8 +1541,6 @@ namespace mars {
       std::vector<sensor_list_element>::iterator iter;
       for (iter = sensor_list.begin(); iter != sensor_list.end(); ) {
         if (iter->sensor == sensor) {
-          free(iter->gd);
-          dGeomDestroy(iter->geom);
           iter = sensor_list.erase(iter);
         } else
           ++iter;
@@ -1566,120 +1559,84 @@ namespace mars {
       if(!physics_thread) return;
       MutexLocker locker(&(theWorld->iMutex));
       std::vector<sensor_list_element>::iterator iter;
-      const dReal* pos = dGeomGetPosition(nGeom);
-      const dReal* rot = dGeomGetRotation(nGeom);
-      dVector3 dest, tmp, posOffset;
-      dReal steps_size = 1.0, length = 0.0;
-      bool done = false;
-      int steps = 0;
       dReal worldStep = theWorld->getWorldStep();
+      const dReal *geomPos;
+      dQuaternion geomRot;
+      utils::Vector pos, direction, offset;
+      utils::Quaternion rot;
       // RotatingRaySensor
-      utils::Vector tmpV;
       utils::Quaternion turnrotation;
       turnrotation.setIdentity();
       std::set<unsigned long> ids_rotating_ray_sensors;
+      size_t i, n;
 
-      //New Code
-      int i=0;
+      if(sensor_list.empty()) return;
+      geomPos = dGeomGetPosition(nGeom);
+      dGeomGetQuaternion(nGeom, geomRot);
+      pos = Vector(geomPos[0], geomPos[1], geomPos[2]);
+      rot = Quaternion(geomRot[0], geomRot[1], geomRot[2], geomRot[3]);
+
+      // collect the rays of all sensors that are updated in this step
+      sensor_ray_elements.clear();
       for(iter = sensor_list.begin(); iter != sensor_list.end(); iter++) {
-        i+=1;
         if((double)iter->sensor->updateRate * 0.001 > worldStep) {
           iter->updateTime += worldStep;
           if(iter->updateTime < 0.001*iter->sensor->updateRate) continue;
           iter->updateTime -= 0.001*iter->sensor->updateRate;
         }
-        BasePolarIntersectionSensor *polarSensor = dynamic_cast<BasePolarIntersectionSensor*>((*iter).sensor);
-        if(polarSensor){
-          sensor_list_element elem = *iter;
+        sensor_ray_elements.push_back(iter - sensor_list.begin());
+      }
+      if(sensor_ray_elements.empty()) return;
 
-          tmpV[0] = elem.ray_direction.x();
-          tmpV[1] = elem.ray_direction.y();
-          tmpV[2] = elem.ray_direction.z();
-          
+      sensor_rays.resize(sensor_ray_elements.size());
+      sensor_rays.ignoreNode = this;
+      sensor_rays.collideBits = COLLIDE_MASK_SENSOR;
+      for(i=0; i<sensor_ray_elements.size(); ++i) {
+        sensor_list_element &elem = sensor_list[sensor_ray_elements[i]];
+        direction = elem.ray_direction;
+        offset = rot * elem.ray_pos_offset;
+
+        BasePolarIntersectionSensor *polarSensor = dynamic_cast<BasePolarIntersectionSensor*>(elem.sensor);
+        if(polarSensor){
           // Applies orientation_offset (z-Rotation) to the laser rays.
-          mars::sim::RotatingRaySensor *rotRaySensor = dynamic_cast<RotatingRaySensor*>((*iter).sensor);
+          mars::sim::RotatingRaySensor *rotRaySensor = dynamic_cast<RotatingRaySensor*>(elem.sensor);
           if(rotRaySensor){
               std::set<unsigned long>::iterator it = ids_rotating_ray_sensors.find(rotRaySensor->id);
               // Takes care that each rotating ray sensor is only turned once (sensor_list contains each ray independently).
               if(it == ids_rotating_ray_sensors.end()) {
-                  //turnrotation.setIdentity(); // If we set it to identity first, receiveSensorData will not be called anymore.. wtf!?
                   turnrotation = rotRaySensor->turn();
                   ids_rotating_ray_sensors.insert(rotRaySensor->id);
               }
-              //fprintf(stderr, "tmp[%i]: %f, %f, %f\n", i, tmpV.x(), tmpV.y(), tmpV.z());
-              tmpV = turnrotation * tmpV;
-              //fprintf(stderr, "tmp[%i]: %f, %f, %f\n", i, tmpV.x(), tmpV.y(), tmpV.z());
-          }
-          tmp[0] = tmpV.x();//elem.ray_direction.x();
-          tmp[1] = tmpV.y();//elem.ray_direction.y();
-          tmp[2] = tmpV.z();//elem.ray_direction.z();
-          dMULTIPLY0_331(dest, rot, tmp);
-
-          if(physics_thread) {
-            steps = 0;
-            length = 0.0;
-            done = false;
-            dGeomEnable(elem.geom);
-            // make here the collision check
-            while (!done) {
-              dGeomRaySet(elem.geom,
-                          pos[0] + dest[0]*steps_size*steps,
-                          pos[1] + dest[1]*steps_size*steps,
-                          pos[2] + dest[2]*steps_size*steps,
-                          dest[0], dest[1], dest[2]);
-              if(length + steps_size < polarSensor->maxDistance) {
-                steps++;
-                dGeomRaySetLength(elem.geom, steps_size);
-              }
-              else {
-                dGeomRaySetLength(elem.geom, polarSensor->maxDistance- length);
-                done = true;
-              }
-              if(theWorld->handleCollision(elem.geom)) {
-                elem.gd->value += length;
-                done = true;
-              }
-              if(!done) length = steps_size*steps;
-            }
-            dGeomDisable(elem.geom);
+              direction = turnrotation * direction;
           }
-          (*polarSensor)[elem.index] = elem.gd->value;
-          elem.gd->value = polarSensor->maxDistance;
+          sensor_rays.distance[i] = polarSensor->maxDistance;
         }
-    
         BaseGridIntersectionSensor *polarGridSensor;
-        polarGridSensor = dynamic_cast<BaseGridIntersectionSensor*>(iter->sensor);
+        polarGridSensor = dynamic_cast<BaseGridIntersectionSensor*>(elem.sensor);
+        if(polarGridSensor) {
+          sensor_rays.distance[i] = polarGridSensor->maxDistance;
+        }
+        direction = rot * direction;
+        for(n=0; n<3; ++n) {
+          sensor_rays.origin[3*i+n] = pos[n] + offset[n];
+          sensor_rays.direction[3*i+n] = direction[n];
+        }
+      }
 
+      theWorld->castRaysLocked(&sensor_rays);
+
+      for(i=0; i<sensor_ray_elements.size(); ++i) {
+        sensor_list_element &elem = sensor_list[sensor_ray_elements[i]];
+        BasePolarIntersectionSensor *polarSensor = dynamic_cast<BasePolarIntersectionSensor*>(elem.sensor);
+        if(polarSensor) {
+          (*polarSensor)[elem.index] = sensor_rays.distance[i];
+        }
+        BaseGridIntersectionSensor *polarGridSensor;
+        polarGridSensor = dynamic_cast<BaseGridIntersectionSensor*>(elem.sensor);
         if(polarGridSensor) {
-          sensor_list_element elem = *iter;
-
-          if(physics_thread) {
-        
-            tmp[0] = elem.ray_direction.x();
-            tmp[1] = elem.ray_direction.y();
-            tmp[2] = elem.ray_direction.z();
-            dMULTIPLY0_331(dest, rot, tmp);
-
-            tmp[0] = elem.ray_pos_offset.x();
-            tmp[1] = elem.ray_pos_offset.y();
-            tmp[2] = elem.ray_pos_offset.z();
-            dMULTIPLY0_331(posOffset, rot, tmp);
-
-            dGeomEnable(elem.geom);
-
-            dGeomRaySet(elem.geom, pos[0] + posOffset[0],
-                        pos[1] + posOffset[1],
-                        pos[2] + posOffset[2],
-                        dest[0], dest[1], dest[2]);
-
-            dGeomRaySetLength(elem.geom, polarGridSensor->maxDistance);
-            theWorld->handleCollision(elem.geom);
-            dGeomDisable(elem.geom);        
-          }
-          (*polarGridSensor)[elem.index] = elem.gd->value;
-          elem.gd->value = polarGridSensor->maxDistance;      
+          (*polarGridSensor)[elem.index] = sensor_rays.distance[i];
         }
-      } // end for loop.
+      }
     }
 
     /**
@@ -1691,23 +1648,20 @@ namespace mars {
      */
     void NodePhysics::destroyNode(void) {
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->invalidateRayTree();
       if(nBody) theWorld->destroyBody(nBody, this);
 
       if(nGeom) dGeomDestroy(nGeom);
 
-      if(myVertices) free(myVertices);
-      if(myIndices) free(myIndices);
-      if(myTriMeshData) dGeomTriMeshDataDestroy(myTriMeshData);
+      if(triMesh) GeomDataCache::release(triMesh);
+      freeHeightfield();
 
       nBody = 0;
       nGeom = 0;
-      myVertices = 0;
-      myIndices = 0;
-      myTriMeshData = 0;
+      triMesh = 0;
       composite = false;
       //node_data.num_ground_collisions = 0;
       node_data.setZero();
-      height_data = 0;
     }
 
     void NodePhysics::setInertiaMass(NodeData* node) {
@@ -33,13 +33,10 @@
 #endif
 
 #include "WorldPhysics.h"
+#include "GeomDataCache.h"
 
 #include <mars/interfaces/sim/NodeInterface.h>
 
-#ifndef ODE11
-  #define dTriIndex int
-#endif
-
 namespace mars {
   namespace sim {
 
@@ -63,7 +60,7 @@ namespace mars {
       unsigned long id;
       int num_ground_collisions;
       std::vector<utils::Vector> contact_points;
-      std::list<unsigned long> contact_ids;
+      std::vector<unsigned long> contact_ids;
       std::vector<dJointFeedback*> ground_feedbacks;
       bool node1;
       interfaces::contact_params c_params;
@@ -76,8 +73,6 @@ namespace mars {
 
     struct sensor_list_element {
       interfaces::BaseSensor *sensor;
-      geom_data *gd;
-      dGeomID geom;
       utils::Vector ray_direction;
       utils::Vector ray_pos_offset;
       unsigned int index;
@@ -129,24 +124,29 @@ namespace mars {
       ///return the body; this function is created to make it possible to get the 
       ///body from joint physics s
       dBodyID getBody() const;
+      dGeomID getGeom() const;
       dMass getODEMass(void) const;
       void addMassToCompositeBody(dBodyID theBody, dMass *bodyMass);
       void getAbsMass(dMass *pMass) const;
-      dReal heightCallback(int x, int y);
+      void getState(interfaces::NodeStateBuffer *states, size_t index) const;
+      void setState(const interfaces::NodeStateBuffer &states, size_t index);
 
     protected:
       WorldPhysics *theWorld;
       dBodyID nBody;
       dGeomID nGeom;
       dMass nMass;
-      dVector3 *myVertices;
-      dTriIndex *myIndices;
-      dTriMeshDataID myTriMeshData;
+      SharedTriMesh *triMesh; ///< buffers of a mesh, shared between worlds
       bool composite;
       geom_data node_data;
       interfaces::terrainStruct *terrain;
-      dReal *height_data;
+      dHeightfieldDataID height_id;
+      SharedHeights *heights; ///< heights, shared between worlds
       std::vector<sensor_list_element> sensor_list;
+      // the rays of all sensors that are updated in one step are cast
+      // as one batch; the buffers are reused over the steps
+      interfaces::RayBatch sensor_rays;
+      std::vector<size_t> sensor_ray_elements;
       bool createMesh(interfaces::NodeData *node);
       bool createBox(interfaces::NodeData *node);
       bool createSphere(interfaces::NodeData *node);
@@ -154,6 +154,7 @@ namespace mars {
       bool createCylinder(interfaces::NodeData *node);
       bool createPlane(interfaces::NodeData *node);
       bool createHeightfield(interfaces::NodeData *node);
+      void freeHeightfield(void);
       void setProperties(interfaces::NodeData *node);
       void setInertiaMass(interfaces::NodeData *node);
     };
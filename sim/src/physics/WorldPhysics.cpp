@@ -38,6 +38,7 @@
 
 #include "WorldPhysics.h"
 #include "NodePhysics.h"
+#include "CollisionWorker.h"
 
 
 #include <mars/utils/MutexLocker.h>
@@ -46,13 +47,29 @@
 #include <mars/interfaces/sim/SimulatorInterface.h>
 #include <mars/interfaces/Logging.hpp>
 
+#include <algorithm>
+#include <cstring>
+
+// number of contact feedbacks that are allocated at once by the arena
+#define FEEDBACK_BLOCK_SIZE 256
+// maximum number of contacts that are recorded per step for drawing
+#define MAX_DRAW_CONTACTS 4096
+// minimum number of rays per thread for splitting a ray batch
+#define MIN_RAYS_PER_THREAD 64
+// maximum number of geoms in a leaf of the ray query tree
+#define RAY_TREE_LEAF_SIZE 4
+// number of steps the ray query tree is only refitted before it is rebuilt
+#define RAY_TREE_REBUILD_STEPS 100
+// the tree is split at the median, thus this is enough for any size
+#define RAY_TREE_STACK_SIZE 64
+
 namespace mars {
   namespace sim {
 
     using namespace utils;
     using namespace interfaces;
 
-    PhysicsError WorldPhysics::error = PHYSICS_NO_ERROR;
+    thread_local WorldPhysics *WorldPhysics::current_world = 0;
 
     void myMessageFunction(int errnum, const char *msg, va_list ap) {
       CPP_UNUSED(errnum);
@@ -62,13 +79,18 @@ namespace mars {
     void myDebugFunction(int errnum, const char *msg, va_list ap) {
       CPP_UNUSED(errnum);
       LOG_DEBUG(msg, ap);
-      WorldPhysics::error = PHYSICS_DEBUG;
+      // errors of ode's own island threads can't be assigned to a world
+      if(WorldPhysics::current_world) {
+        WorldPhysics::current_world->error = PHYSICS_DEBUG;
+      }
     }
 
     void myErrorFunction(int errnum, const char *msg, va_list ap) {
       CPP_UNUSED(errnum);
       LOG_ERROR(msg, ap);
-      WorldPhysics::error = PHYSICS_ERROR;
+      if(WorldPhysics::current_world) {
+        WorldPhysics::current_world->error = PHYSICS_ERROR;
+      }
     }
 
     /**
@@ -87,6 +109,13 @@ namespace mars {
       this->control = control;
       draw_contact_points = 0;
       fast_step = 0;
+      num_threads = old_num_threads = 1;
+      deterministic = false;
+      error = PHYSICS_NO_ERROR;
+#ifdef ODE_THREADING
+      threading = 0;
+      thread_pool = 0;
+#endif
       world_cfm = 1e-10;
       world_erp = 0.1;
       world_gravity = Vector(0.0, 0.0, -9.81);
@@ -100,6 +129,16 @@ namespace mars {
       num_contacts = 0;
       create_contacts = 1;
       log_contacts = 0;
+      num_feedbacks = 0;
+      num_contact_allocs = 0;
+      num_bounded_ray_geoms = 0;
+      ray_tree_valid = false;
+      ray_tree_refits = 0;
+      // the contact records are preallocated once
+      draw_intern.resize(MAX_DRAW_CONTACTS);
+      draw_extern.resize(MAX_DRAW_CONTACTS);
+      num_draw_intern = num_draw_extern = 0;
+      draw_registered = record_contacts = false;
 
       // the step size in seconds
       step_size = 0.01;
@@ -116,6 +155,7 @@ namespace mars {
       dSetErrorHandler (myErrorFunction);
       dSetDebugHandler (myDebugFunction);
       dSetMessageHandler (myMessageFunction);
+      threaded_trimesh = dCheckConfiguration("ODE_EXT_mt_collisions");
     }
 
     /**
@@ -133,6 +173,7 @@ namespace mars {
       freeTheWorld();
       // and close the ODE ...
       MutexLocker locker(&iMutex);
+      freeContactArena();
       dCloseODE();
     }
 
@@ -166,16 +207,33 @@ namespace mars {
         dWorldSetERP (world, (dReal)world_erp);
 
         dWorldSetAutoDisableFlag (world,0);
+        // start every world with the same random sequence of ode
+        if(deterministic) dRandSetSeed(0);
         // if usefull for some tests a ground can be created here
         plane = 0; //dCreatePlane (space,0,0,1,0);
         world_init = 1;
         drawStruct draw;
         draw.ptr_draw = (DrawInterface*)this;
-        if(control->graphics)
+        if(control->graphics) {
           control->graphics->addDrawItems(&draw);
+          draw_registered = true;
+        }
       }
     }
 
+    /**
+     * \brief Allocates the thread local data of ode for the calling thread.
+     *
+     * The constructor does this for the thread creating the world. With
+     * several worlds stepped in parallel each stepping thread needs its
+     * own collision data.
+     */
+    void WorldPhysics::initThread(void) {
+#ifdef ODE11
+      dAllocateODEDataForThread(dAllocateMaskAll);
+#endif
+    }
+
     /**
      * \brief This functions destroys the ode world.
      *
@@ -190,10 +248,17 @@ namespace mars {
       MutexLocker locker(&iMutex);
       if(world_init) {
         //LOG_DEBUG("free physics world");
+        // the threads are created again with the next world
+        setupThreads(1);
+        old_num_threads = 1;
         dJointGroupDestroy(contactgroup);
         dSpaceDestroy(space);
         dWorldDestroy(world);
         world_init = 0;
+        ray_geoms.clear();
+        ray_tree.clear();
+        num_bounded_ray_geoms = 0;
+        ray_tree_valid = false;
       }
       // else debug something
     }
@@ -225,12 +290,12 @@ namespace mars {
      */
     void WorldPhysics::stepTheWorld(void) {
       MutexLocker locker(&iMutex);
-      std::vector<dJointFeedback*>::iterator iter;
       geom_data* data;
       int i;
 
       // if world_init = false or step_size <= 0 debug something
       if(world_init && step_size > 0) {
+        current_world = this;
         if(old_gravity != world_gravity) {
           old_gravity = world_gravity;
           dWorldSetGravity(world, world_gravity.x(),
@@ -247,6 +312,11 @@ namespace mars {
           dWorldSetERP(world, (dReal)world_erp);
         }
 
+        if(old_num_threads != num_threads) {
+          old_num_threads = num_threads;
+          setupThreads(num_threads);
+        }
+
         /// first clear the collision counters of all geoms
         for(i=0; i<dSpaceGetNumGeoms(space); i++) {
           data = (geom_data*)dGeomGetData(dSpaceGetGeom(space, i));
@@ -255,23 +325,40 @@ namespace mars {
           data->contact_points.clear();
           data->ground_feedbacks.clear();
         }
-        for(iter = contact_feedback_list.begin();
-            iter != contact_feedback_list.end(); iter++) {
-          free((*iter));
-        }
-        contact_feedback_list.clear();
-        draw_intern.clear();
+        // the feedbacks of the last step are not referenced anymore
+        num_feedbacks = 0;
+        num_contact_allocs = 0;
+        num_draw_intern = 0;
+        // contacts are only recorded if someone is drawing them
+        record_contacts = draw_registered && draw_contact_points;
         /// then we have to clear the contacts
         dJointGroupEmpty(contactgroup);
         /// first check for collisions
         num_contacts = log_contacts = 0;
         create_contacts = 1;
-        dSpaceCollide(space,this, &WorldPhysics::callbackForward);
-        
-        drawLock.lock();
-        draw_extern.swap(draw_intern);
-        drawLock.unlock();
+        if(collision_workers.empty()) {
+          dSpaceCollide(space,this, &WorldPhysics::callbackForward);
+        }
+        else {
+          collideThreaded();
+        }
 
+        if(draw_registered) {
+          drawLock.lock();
+          draw_extern.swap(draw_intern);
+          num_draw_extern = num_draw_intern;
+          drawLock.unlock();
+        }
+
+#ifdef ODE_THREADING
+        if(threading) {
+          // the quickstep reorders the constraints by using the global
+          // random number generator of ode; thus, the islands are processed
+          // one after the other to get reproducible results
+          dWorldSetStepIslandsProcessingMaxThreadCount(world,
+                                                       (deterministic && fast_step) ? 1 : num_threads);
+        }
+#endif
         /// then calculate the next state for a time of step_size seconds
         try {
           if(fast_step) dWorldQuickStep(world, step_size);
@@ -279,9 +366,11 @@ namespace mars {
         } catch (...) {
           control->sim->handleError(PHYSICS_UNKNOWN);
         }
-	if(WorldPhysics::error) {
-          control->sim->handleError(WorldPhysics::error);
-          WorldPhysics::error = PHYSICS_NO_ERROR;
+        updateRayTree();
+        current_world = 0;
+	if(error) {
+          control->sim->handleError(error);
+          error = PHYSICS_NO_ERROR;
 	}
       }
     }
@@ -432,24 +521,33 @@ namespace mars {
      * in the simulation.
      */
     void WorldPhysics::nearCallback (dGeomID o1, dGeomID o2) {
-      int i;
-      int numc;
-      //up to MAX_CONTACTS contact per Box-box
-      //dContact contact[MAX_CONTACTS];
-      dVector3 v1, v;
-      //dMatrix3 R;
-      dReal dot;
-  
+      int numc, maxNumContacts;
+      dContact *contact;
+
       if (dGeomIsSpace(o1) || dGeomIsSpace(o2)) {
         /// test if a space is colliding with something
         dSpaceCollide2(o1,o2,this,& WorldPhysics::callbackForward);
         return;
       }
-  
-      /// exit without doing anything if the two bodies are connected by a joint 
-      dBodyID b1=dGeomGetBody(o1);
-      dBodyID b2=dGeomGetBody(o2);
 
+      if(handleRaySensor(o1, o2)) return;
+
+      maxNumContacts = getMaxNumContacts(o1, o2);
+      if(!maxNumContacts) return;
+
+      contact = getContactBuffer(maxNumContacts);
+      numc = collideGeoms(o1, o2, contact, maxNumContacts);
+      if(numc) addContacts(o1, o2, contact, numc);
+    }
+
+    /**
+     * \brief Handles the collision of a ray sensor geom with an other geom.
+     *
+     * Returns true if one of the geoms is a ray sensor. In that case no
+     * contacts have to be created for the geom pair.
+     */
+    bool WorldPhysics::handleRaySensor(dGeomID o1, dGeomID o2) {
+      int numc;
       geom_data* geom_data1 = (geom_data*)dGeomGetData(o1);
       geom_data* geom_data2 = (geom_data*)dGeomGetData(o2);
 
@@ -457,11 +555,11 @@ namespace mars {
       if(geom_data1->ray_sensor) {
         dContact contact;
         if(geom_data1->parent_geom == o2) {
-          return;
+          return true;
         }
         
         if(geom_data1->parent_body == dGeomGetBody(o2)) {
-          return;
+          return true;
         }
         
         numc = dCollide(o2, o1, 1|CONTACTS_UNIMPORTANT, &(contact.geom), sizeof(dContact));
@@ -470,15 +568,15 @@ namespace mars {
             geom_data1->value = contact.geom.depth;
           ray_collision = 1;
         }
-        return;
+        return true;
       }
       else if(geom_data2->ray_sensor) {
         dContact contact;
         if(geom_data2->parent_geom == o1) {
-          return;
+          return true;
         }
         if(geom_data2->parent_body == dGeomGetBody(o1)) {
-          return;
+          return true;
         }
         numc = dCollide(o2, o1, 1|CONTACTS_UNIMPORTANT, &(contact.geom), sizeof(dContact));
         if(numc) {
@@ -486,24 +584,52 @@ namespace mars {
             geom_data2->value = contact.geom.depth;
           ray_collision = 1;
         }
-        return;
+        return true;
       }
-      
+      return false;
+    }
+
+    /**
+     * \brief Returns the number of contacts that can be created for
+     * the geom pair.
+     *
+     * Returns 0 if the geoms should not collide, e.g. if the two bodies are
+     * connected by a joint.
+     */
+    int WorldPhysics::getMaxNumContacts(dGeomID o1, dGeomID o2) {
+      /// exit without doing anything if the two bodies are connected by a joint 
+      dBodyID b1=dGeomGetBody(o1);
+      dBodyID b2=dGeomGetBody(o2);
+
+      geom_data* geom_data1 = (geom_data*)dGeomGetData(o1);
+      geom_data* geom_data2 = (geom_data*)dGeomGetData(o2);
+
       if(b1 && b2 && dAreConnectedExcluding(b1,b2,dJointTypeContact))
-        return;
+        return 0;
 
-      if(!b1 && !b2 && !geom_data1->ray_sensor && !geom_data2->ray_sensor) return;
+      if(!b1 && !b2 && !geom_data1->ray_sensor && !geom_data2->ray_sensor) return 0;
 
-      int maxNumContacts = 0;
       if(geom_data1->c_params.max_num_contacts <
          geom_data2->c_params.max_num_contacts) {
-        maxNumContacts = geom_data1->c_params.max_num_contacts;
+        return geom_data1->c_params.max_num_contacts;
       }
-      else {
-        maxNumContacts = geom_data2->c_params.max_num_contacts;
-      }
-      dContact *contact = new dContact[maxNumContacts];
+      return geom_data2->c_params.max_num_contacts;
+    }
 
+    /**
+     * \brief Sets the surface parameters and collides the two geoms.
+     *
+     * This function only reads the geom data and writes into the given
+     * contact array. Thus, it can be called for different geom pairs
+     * in parallel.
+     */
+    int WorldPhysics::collideGeoms(dGeomID o1, dGeomID o2, dContact *contact,
+                                   int maxNumContacts) const {
+      int i;
+      dVector3 v1;
+
+      geom_data* geom_data1 = (geom_data*)dGeomGetData(o1);
+      geom_data* geom_data2 = (geom_data*)dGeomGetData(o2);
 
       //for granular test
       //if( (plane != o2) && (plane !=o1)) return ;
@@ -654,36 +780,48 @@ namespace mars {
         contact[i] = contact[0];
       }
 
-      numc=dCollide(o1,o2, maxNumContacts, &contact[0].geom,sizeof(dContact));
+      return dCollide(o1,o2, maxNumContacts, &contact[0].geom,sizeof(dContact));
+    }
+
+    /**
+     * \brief Creates the contact joints for the contacts of a geom pair.
+     *
+     * pre:
+     *     - contact holds numc contacts created by collideGeoms
+     *
+     * post:
+     *     - the contact joints are created if create_contacts is set
+     *     - the contact information of the geom data is updated
+     */
+    void WorldPhysics::addContacts(dGeomID o1, dGeomID o2, dContact *contact,
+                                   int numc) {
+      int i;
+      dVector3 v;
+      dReal dot;
+      dBodyID b1=dGeomGetBody(o1);
+      dBodyID b2=dGeomGetBody(o2);
+
+      geom_data* geom_data1 = (geom_data*)dGeomGetData(o1);
+      geom_data* geom_data2 = (geom_data*)dGeomGetData(o2);
+
       if(numc){ 
         dJointFeedback *fb;
-        draw_item item;
         Vector contact_point;
 
         num_contacts++;
         if(create_contacts) {
           fb = 0;
-          item.id = 0;
-          item.type = DRAW_LINE;
-          item.draw_state = DRAW_STATE_CREATE;
-          item.point_size = 10;
-          item.myColor.r = 1;
-          item.myColor.g = 0;
-          item.myColor.b = 0;
-          item.myColor.a = 1;
-          item.label = "";
-          item.t_width = item.t_height = 0;
-          item.texture = "";
-          item.get_light = 0;
 
           for(i=0;i<numc;i++){
-            item.start.x() = contact[i].geom.pos[0];
-            item.start.y() = contact[i].geom.pos[1];
-            item.start.z() = contact[i].geom.pos[2];
-            item.end.x() = contact[i].geom.pos[0] + contact[i].geom.normal[0];
-            item.end.y() = contact[i].geom.pos[1] + contact[i].geom.normal[1];
-            item.end.z() = contact[i].geom.pos[2] + contact[i].geom.normal[2];
-            draw_intern.push_back(item);
+            if(record_contacts && num_draw_intern < draw_intern.size()) {
+              contact_record &record = draw_intern[num_draw_intern++];
+              record.pos[0] = contact[i].geom.pos[0];
+              record.pos[1] = contact[i].geom.pos[1];
+              record.pos[2] = contact[i].geom.pos[2];
+              record.normal[0] = contact[i].geom.normal[0];
+              record.normal[1] = contact[i].geom.normal[1];
+              record.normal[2] = contact[i].geom.normal[2];
+            }
             if(geom_data1->c_params.friction_direction1 ||
                geom_data2->c_params.friction_direction1) {
               v[0] = contact[i].geom.normal[0];
@@ -717,18 +855,16 @@ namespace mars {
             //if(dGeomGetClass(o1) == dPlaneClass) {
             fb = 0;
             if(geom_data2->sense_contact_force) {
-              fb = (dJointFeedback*)malloc(sizeof(dJointFeedback));
+              fb = getFeedback();
               dJointSetFeedback(c, fb);
-              contact_feedback_list.push_back(fb);
               geom_data2->ground_feedbacks.push_back(fb);
               geom_data2->node1 = false;
             } 
             //else if(dGeomGetClass(o2) == dPlaneClass) {
             if(geom_data1->sense_contact_force) {
               if(!fb) {
-                fb = (dJointFeedback*)malloc(sizeof(dJointFeedback));
+                fb = getFeedback();
                 dJointSetFeedback(c, fb);
-                contact_feedback_list.push_back(fb);
               }
               geom_data1->ground_feedbacks.push_back(fb);
               geom_data1->node1 = true;
@@ -736,7 +872,48 @@ namespace mars {
           }
         }
       }
-      delete[] contact;
+    }
+
+    /**
+     * \brief Returns the reusable contact buffer with at least size elements.
+     *
+     * The buffer only grows if a geom pair requests more contacts than
+     * any pair before. In steady state no memory is allocated here.
+     */
+    dContact* WorldPhysics::getContactBuffer(int size) {
+      if(contact_buffer.size() < (size_t)size) {
+        contact_buffer.resize(size);
+        ++num_contact_allocs;
+      }
+      return &contact_buffer[0];
+    }
+
+    /**
+     * \brief Returns a joint feedback from the contact arena.
+     *
+     * The feedbacks are allocated in blocks that are never moved, thus the
+     * pointers stay valid until the next call of stepTheWorld resets the
+     * arena.
+     */
+    dJointFeedback* WorldPhysics::getFeedback(void) {
+      size_t block = num_feedbacks / FEEDBACK_BLOCK_SIZE;
+      if(block >= feedback_blocks.size()) {
+        feedback_blocks.push_back(new dJointFeedback[FEEDBACK_BLOCK_SIZE]);
+        ++num_contact_allocs;
+      }
+      return feedback_blocks[block] + (num_feedbacks++ % FEEDBACK_BLOCK_SIZE);
+    }
+
+    void WorldPhysics::freeContactArena(void) {
+      std::vector<dJointFeedback*>::iterator iter;
+
+      for(iter = feedback_blocks.begin(); iter != feedback_blocks.end();
+          ++iter) {
+        delete[] (*iter);
+      }
+      feedback_blocks.clear();
+      contact_buffer.clear();
+      num_feedbacks = 0;
     }
 
     /**
@@ -754,6 +931,197 @@ namespace mars {
       wp->nearCallback(o1, o2);
     }
 
+    void WorldPhysics::collectForward(void *data, dGeomID o1, dGeomID o2) {
+      WorldPhysics *wp = (WorldPhysics*)data;
+      wp->collectCallback(o1, o2);
+    }
+
+    /**
+     * \brief Collects the geom pairs of the broadphase for the threaded
+     * contact generation.
+     *
+     * The ray sensors are handled directly since they only update the
+     * value of their geom data.
+     */
+    void WorldPhysics::collectCallback(dGeomID o1, dGeomID o2) {
+      collision_pair pair;
+
+      if (dGeomIsSpace(o1) || dGeomIsSpace(o2)) {
+        dSpaceCollide2(o1,o2,this,& WorldPhysics::collectForward);
+        return;
+      }
+
+      if(handleRaySensor(o1, o2)) return;
+
+      pair.max_contacts = getMaxNumContacts(o1, o2);
+      if(!pair.max_contacts) return;
+
+      pair.o1 = o1;
+      pair.o2 = o2;
+      pair.num_contacts = 0;
+      pair.first_contact = 0;
+      pair.contacts = 0;
+      collision_pairs.push_back(pair);
+    }
+
+    /**
+     * \brief Returns true if colliding the geom writes data of the geom.
+     *
+     * The heightfield collider of ode uses temporary buffers of the geom,
+     * the trimesh collider caches are only thread local if ode is built
+     * with OU. Such geoms must not be collided by several threads at once.
+     */
+    bool WorldPhysics::isSharedGeom(dGeomID geom) const {
+      int geomClass = dGeomGetClass(geom);
+      return (geomClass == dHeightfieldClass ||
+              (geomClass == dTriMeshClass && !threaded_trimesh));
+    }
+
+    void WorldPhysics::generatePairContacts(collision_pair *pair,
+                                            std::vector<dContact> *contacts,
+                                            unsigned long *allocs) {
+      size_t capacity = contacts->capacity();
+
+      pair->contacts = contacts;
+      pair->first_contact = contacts->size();
+      contacts->resize(pair->first_contact + pair->max_contacts);
+      if(contacts->capacity() != capacity) ++(*allocs);
+      pair->num_contacts = collideGeoms(pair->o1, pair->o2,
+                                        &(*contacts)[pair->first_contact],
+                                        pair->max_contacts);
+      contacts->resize(pair->first_contact + pair->num_contacts);
+    }
+
+    /**
+     * \brief Generates the contacts for the geom pairs [begin, end) of
+     * the pairs without a shared geom.
+     *
+     * This function is called in parallel by the collision workers. Every
+     * caller passes its own contact buffer. Returns the number of heap
+     * allocations done by the contact buffer.
+     */
+    unsigned long WorldPhysics::generateContacts(size_t begin, size_t end,
+                                                 std::vector<dContact> *contacts) {
+      unsigned long allocs = 0;
+
+      for(size_t i=begin; i<end; ++i) {
+        generatePairContacts(&collision_pairs[parallel_pairs[i]], contacts,
+                             &allocs);
+      }
+      return allocs;
+    }
+
+    /**
+     * \brief Handles the collisions with the collision workers.
+     *
+     * pre:
+     *     - num_threads > 1
+     *
+     * post:
+     *     - the contact joints are created in the order of the geom pairs
+     *       found by the broadphase; the result does not depend on the
+     *       scheduling of the threads
+     */
+    void WorldPhysics::collideThreaded(void) {
+      size_t numPairs, numThreads, chunk, i;
+      size_t capacity = collision_pairs.capacity();
+
+      collision_pairs.clear();
+      dSpaceCollide(space, this, &WorldPhysics::collectForward);
+      if(collision_pairs.capacity() != capacity) ++num_contact_allocs;
+
+      parallel_pairs.clear();
+      serial_pairs.clear();
+      for(i=0; i<collision_pairs.size(); ++i) {
+        if(isSharedGeom(collision_pairs[i].o1) ||
+           isSharedGeom(collision_pairs[i].o2)) {
+          serial_pairs.push_back(i);
+        }
+        else {
+          parallel_pairs.push_back(i);
+        }
+      }
+
+      // the calling thread processes the first range of pairs
+      numPairs = parallel_pairs.size();
+      numThreads = collision_workers.size()+1;
+      chunk = (numPairs + numThreads - 1) / numThreads;
+      for(i=0; i<collision_workers.size(); ++i) {
+        collision_workers[i]->startJob(std::min(numPairs, (i+1)*chunk),
+                                       std::min(numPairs, (i+2)*chunk));
+      }
+      thread_contacts.clear();
+      num_contact_allocs += generateContacts(0, std::min(numPairs, chunk),
+                                             &thread_contacts);
+      for(i=0; i<collision_workers.size(); ++i) {
+        num_contact_allocs += collision_workers[i]->waitForJob();
+      }
+      for(i=0; i<serial_pairs.size(); ++i) {
+        generatePairContacts(&collision_pairs[serial_pairs[i]],
+                             &thread_contacts, &num_contact_allocs);
+      }
+
+      numPairs = collision_pairs.size();
+      for(i=0; i<numPairs; ++i) {
+        collision_pair &pair = collision_pairs[i];
+        if(pair.num_contacts) {
+          addContacts(pair.o1, pair.o2,
+                      &(*pair.contacts)[pair.first_contact],
+                      pair.num_contacts);
+        }
+      }
+    }
+
+    /**
+     * \brief Creates the collision workers and the threading
+     * implementation of ode for the island solving.
+     *
+     * pre:
+     *     - world_init = true
+     *
+     * post:
+     *     - numThreads-1 collision workers are running
+     *     - the old threads are stopped
+     */
+    void WorldPhysics::setupThreads(int numThreads) {
+      std::vector<CollisionWorker*>::iterator iter;
+      CollisionWorker *worker;
+
+      for(iter = collision_workers.begin(); iter != collision_workers.end();
+          ++iter) {
+        delete (*iter);
+      }
+      collision_workers.clear();
+#ifdef ODE_THREADING
+      if(threading) {
+        dThreadingImplementationShutdownProcessing(threading);
+        dThreadingFreeThreadPool(thread_pool);
+        dWorldSetStepThreadingImplementation(world, NULL, NULL);
+        dThreadingFreeImplementation(threading);
+        threading = 0;
+        thread_pool = 0;
+      }
+#endif
+      if(numThreads < 2) return;
+
+      for(int i=1; i<numThreads; ++i) {
+        worker = new CollisionWorker(this);
+        worker->start();
+        collision_workers.push_back(worker);
+      }
+#ifdef ODE_THREADING
+      threading = dThreadingAllocateMultiThreadedImplementation();
+      thread_pool = dThreadingAllocateThreadPool(numThreads, 0,
+                                                 dAllocateFlagBasicData, NULL);
+      dThreadingThreadPoolServeMultiThreadedImplementation(thread_pool,
+                                                           threading);
+      dWorldSetStepThreadingImplementation(world,
+                                           dThreadingImplementationGetFunctions(threading),
+                                           threading);
+#endif
+      LOG_INFO("WorldPhysics: step the world with %d threads", numThreads);
+    }
+
     /**
      * \brief resets the mass of a composite body
      *
@@ -820,16 +1188,44 @@ namespace mars {
       return center;
     }
 
+    /**
+     * \brief Creates the draw items for the contacts recorded in the
+     * last step.
+     *
+     * This function is called by the graphics thread. The draw items are
+     * only created here and only if the contact drawing is enabled.
+     */
     void WorldPhysics::update(std::vector<draw_item>* drawItems) {
       MutexLocker locker(&drawLock);
       std::vector<draw_item>::iterator iter;
+      draw_item item;
   
       for(iter=drawItems->begin(); iter!=drawItems->end(); iter++) {
         iter->draw_state = DRAW_STATE_ERASE;
       }
       if(draw_contact_points) {
-        for(iter=draw_extern.begin(); iter!=draw_extern.end(); iter++) {
-          drawItems->push_back(*iter);
+        item.id = 0;
+        item.type = DRAW_LINE;
+        item.draw_state = DRAW_STATE_CREATE;
+        item.point_size = 10;
+        item.myColor.r = 1;
+        item.myColor.g = 0;
+        item.myColor.b = 0;
+        item.myColor.a = 1;
+        item.label = "";
+        item.t_width = item.t_height = 0;
+        item.texture = "";
+        item.get_light = 0;
+
+        for(size_t i=0; i<num_draw_extern; ++i) {
+          const contact_record &record = draw_extern[i];
+          item.start.x() = record.pos[0];
+          item.start.y() = record.pos[1];
+          item.start.z() = record.pos[2];
+          item.end.x() = record.pos[0] + record.normal[0];
+          item.end.y() = record.pos[1] + record.normal[1];
+          item.end.z() = record.pos[2] + record.normal[2];
+          drawItems->push_back(item);
         }
       }
     }
@@ -885,30 +1281,409 @@ namespace mars {
     double WorldPhysics::getVectorCollision(const Vector &pos, 
                                             const Vector &ray) const {
       MutexLocker locker(&iMutex);
-      dGeomID otherGeom;
-      dContact contact[1];
-      //double depth = ray.length();
-      double depth = ray.norm();
-      int numc;
-  
-      dGeomID theGeom = dCreateRay(space, depth);
-      dGeomRaySet(theGeom, pos.x(), pos.y(), pos.z(), ray.x(), ray.y(), ray.z()); 
+      RayBatch rays;
 
-      for(int i=0; i<dSpaceGetNumGeoms(space); i++) {
-        otherGeom = dSpaceGetGeom(space, i);
+      rays.resize(1);
+      for(int i=0; i<3; ++i) {
+        rays.origin[i] = pos[i];
+        rays.direction[i] = ray[i];
+      }
+      rays.distance[0] = ray.norm();
+      castRaysLocked(&rays);
+      return rays.distance[0];
+    }
 
-        if(!(dGeomGetCollideBits(theGeom) & dGeomGetCollideBits(otherGeom)))
+    /**
+     * \brief Casts all rays of the batch and stores the distance to the
+     * closest hit in rays->distance.
+     *
+     * pre:
+     *     - rays->distance holds the maximum length of each ray
+     *
+     * post:
+     *     - rays->distance holds the distance of the closest geom that
+     *       matches rays->collideBits and does not belong to
+     *       rays->ignoreNode, or the unchanged maximum length
+     */
+    void WorldPhysics::castRays(RayBatch *rays) const {
+      MutexLocker locker(&iMutex);
+      castRaysLocked(rays);
+    }
+
+    /**
+     * \brief Adds the enabled geoms of the space and its sub spaces to
+     * the ray query list. The rays of the sensors are skipped.
+     */
+    void WorldPhysics::collectRayGeoms(dSpaceID theSpace,
+                                       std::vector<ray_geom> *geoms) const {
+      ray_geom rg;
+      dGeomID geom;
+
+      for(int i=0; i<dSpaceGetNumGeoms(theSpace); ++i) {
+        geom = dSpaceGetGeom(theSpace, i);
+        if(dGeomIsSpace(geom)) {
+          collectRayGeoms((dSpaceID)geom, geoms);
+          continue;
+        }
+        if(!dGeomIsEnabled(geom) || dGeomGetClass(geom) == dRayClass) {
           continue;
-        numc = dCollide(theGeom, otherGeom, 1 | CONTACTS_UNIMPORTANT,
-                        &(contact[0].geom), sizeof(dContact));
-        if(numc) {
-          if(contact[0].geom.depth < depth)
-            depth = contact[0].geom.depth;
         }
+        rg.geom = geom;
+        rg.body = dGeomGetBody(geom);
+        rg.category_bits = dGeomGetCategoryBits(geom);
+        rg.collide_bits = dGeomGetCollideBits(geom);
+        rg.shared = isSharedGeom(geom);
+        dGeomGetAABB(geom, rg.aabb);
+        geoms->push_back(rg);
       }
+    }
 
-      dGeomDestroy(theGeom);
-      return depth;
+    /**
+     * \brief Same as castRays for a caller that already holds iMutex.
+     *
+     * The rays are cast against the tree of the last step. If a geom
+     * was changed since then, the geoms are collected for this batch
+     * and every ray is tested against all of them.
+     */
+    void WorldPhysics::castRaysLocked(RayBatch *rays) const {
+      size_t numRays, numThreads, chunk, i;
+      std::vector<ray_geom> changedGeoms;
+      ray_query query;
+
+      numRays = rays->size();
+      if(!world_init || !numRays) return;
+
+      if(ray_tree_valid) {
+        query.geoms = ray_geoms.empty() ? 0 : &ray_geoms[0];
+        query.num_geoms = ray_geoms.size();
+        query.num_bounded = num_bounded_ray_geoms;
+        query.tree = ray_tree.empty() ? 0 : &ray_tree[0];
+      }
+      else {
+        // the bounding boxes are collected by one thread, since updating
+        // the geom positions is not thread safe; afterwards the geoms are
+        // only read by the narrowphase
+        collectRayGeoms(space, &changedGeoms);
+        query.geoms = changedGeoms.empty() ? 0 : &changedGeoms[0];
+        query.num_geoms = changedGeoms.size();
+        query.num_bounded = 0;
+        query.tree = 0;
+      }
+      query.ignore_geom = 0;
+      query.ignore_body = 0;
+      query.geom_filter = RAY_ALL_GEOMS;
+      if(rays->ignoreNode) {
+        const NodePhysics *node = (const NodePhysics*)rays->ignoreNode;
+        query.ignore_geom = node->getGeom();
+        query.ignore_body = node->getBody();
+      }
+
+      numThreads = std::min(collision_workers.size()+1,
+                            numRays/MIN_RAYS_PER_THREAD);
+      if(numThreads < 2) {
+        castRayRange(query, rays, 0, numRays);
+        return;
+      }
+      // the calling thread processes the first range of rays; the
+      // shared geoms are skipped by all threads and afterwards tested
+      // by the calling thread alone
+      query.geom_filter = RAY_UNSHARED_GEOMS;
+      chunk = (numRays + numThreads - 1) / numThreads;
+      for(i=0; i<numThreads-1; ++i) {
+        collision_workers[i]->startRayJob(&query, rays,
+                                          std::min(numRays, (i+1)*chunk),
+                                          std::min(numRays, (i+2)*chunk));
+      }
+      castRayRange(query, rays, 0, std::min(numRays, chunk));
+      for(i=0; i<numThreads-1; ++i) {
+        collision_workers[i]->waitForJob();
+      }
+      for(i=0; i<query.num_geoms; ++i) {
+        if(query.geoms[i].shared) {
+          query.geom_filter = RAY_SHARED_GEOMS;
+          castRayRange(query, rays, 0, numRays);
+          break;
+        }
+      }
+    }
+
+    static bool isBoundedRayGeom(const ray_geom &rg) {
+      for(int i=0; i<3; ++i) {
+        if(!(rg.aabb[2*i] > -dInfinity && rg.aabb[2*i+1] < dInfinity)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // orders the geoms by the center of their boxes along one axis
+    struct RayGeomCenterLess {
+      int axis;
+      bool operator()(const ray_geom &a, const ray_geom &b) const {
+        return (a.aabb[2*axis] + a.aabb[2*axis+1] <
+                b.aabb[2*axis] + b.aabb[2*axis+1]);
+      }
+    };
+
+    static void mergeBox(dReal *aabb, const dReal *other) {
+      for(int i=0; i<3; ++i) {
+        if(other[2*i] < aabb[2*i]) aabb[2*i] = other[2*i];
+        if(other[2*i+1] > aabb[2*i+1]) aabb[2*i+1] = other[2*i+1];
+      }
+    }
+
+    /**
+     * \brief Refits the ray query tree to the new geom positions of the
+     * step, or rebuilds it if the geoms have changed.
+     *
+     * pre:
+     *     - called with iMutex locked after the world is stepped
+     *
+     * post:
+     *     - the tree is valid until invalidateRayTree is called
+     */
+    void WorldPhysics::updateRayTree(void) {
+      std::vector<ray_geom>::iterator bounded;
+
+      if(ray_tree_valid && ++ray_tree_refits < RAY_TREE_REBUILD_STEPS) {
+        refitRayTree();
+        return;
+      }
+      ray_geoms.clear();
+      ray_tree.clear();
+      collectRayGeoms(space, &ray_geoms);
+      // geoms with an infinite box like planes would spoil the tree
+      bounded = std::stable_partition(ray_geoms.begin(), ray_geoms.end(),
+                                      isBoundedRayGeom);
+      num_bounded_ray_geoms = bounded - ray_geoms.begin();
+      if(num_bounded_ray_geoms) {
+        ray_tree.resize(1);
+        buildRayTree(0, 0, num_bounded_ray_geoms);
+      }
+      ray_tree_valid = true;
+      ray_tree_refits = 0;
+    }
+
+    /**
+     * \brief Builds the sub tree at index for the geoms [first, first+count)
+     * by splitting them at the median along the longest axis.
+     */
+    void WorldPhysics::buildRayTree(size_t index, size_t first,
+                                    size_t count) {
+      RayGeomCenterLess less;
+      dReal center, centerMin[3], centerMax[3];
+      size_t i, child;
+
+      memcpy(ray_tree[index].aabb, ray_geoms[first].aabb, sizeof(dReal)*6);
+      for(int k=0; k<3; ++k) {
+        centerMin[k] = centerMax[k] = (ray_geoms[first].aabb[2*k] +
+                                       ray_geoms[first].aabb[2*k+1]);
+      }
+      for(i=first+1; i<first+count; ++i) {
+        mergeBox(ray_tree[index].aabb, ray_geoms[i].aabb);
+        for(int k=0; k<3; ++k) {
+          center = ray_geoms[i].aabb[2*k] + ray_geoms[i].aabb[2*k+1];
+          if(center < centerMin[k]) centerMin[k] = center;
+          if(center > centerMax[k]) centerMax[k] = center;
+        }
+      }
+      ray_tree[index].first = first;
+      if(count <= RAY_TREE_LEAF_SIZE) {
+        ray_tree[index].child = 0;
+        ray_tree[index].count = count;
+        return;
+      }
+      less.axis = 0;
+      for(int k=1; k<3; ++k) {
+        if(centerMax[k] - centerMin[k] >
+           centerMax[less.axis] - centerMin[less.axis]) {
+          less.axis = k;
+        }
+      }
+      std::nth_element(ray_geoms.begin()+first,
+                       ray_geoms.begin()+first+count/2,
+                       ray_geoms.begin()+first+count, less);
+      // the children are stored behind their parent, thus refitRayTree
+      // can update the tree from the back to the front
+      child = ray_tree.size();
+      ray_tree[index].child = child;
+      ray_tree[index].count = 0;
+      ray_tree.resize(child+2);
+      buildRayTree(child, first, count/2);
+      buildRayTree(child+1, first+count/2, count-count/2);
+    }
+
+    /**
+     * \brief Updates the boxes of the geoms and of the tree nodes without
+     * changing the structure of the tree.
+     */
+    void WorldPhysics::refitRayTree(void) {
+      std::vector<ray_geom>::iterator iter;
+      std::vector<ray_tree_node>::reverse_iterator node;
+      size_t i;
+
+      for(iter = ray_geoms.begin(); iter != ray_geoms.end(); ++iter) {
+        iter->category_bits = dGeomGetCategoryBits(iter->geom);
+        iter->collide_bits = dGeomGetCollideBits(iter->geom);
+        dGeomGetAABB(iter->geom, iter->aabb);
+      }
+      for(node = ray_tree.rbegin(); node != ray_tree.rend(); ++node) {
+        if(node->count) {
+          memcpy(node->aabb, ray_geoms[node->first].aabb, sizeof(dReal)*6);
+          for(i=node->first+1; i<node->first+node->count; ++i) {
+            mergeBox(node->aabb, ray_geoms[i].aabb);
+          }
+        }
+        else {
+          memcpy(node->aabb, ray_tree[node->child].aabb, sizeof(dReal)*6);
+          mergeBox(node->aabb, ray_tree[node->child+1].aabb);
+        }
+      }
+    }
+
+    /**
+     * \brief Returns true if the ray from origin along dir enters the
+     * bounding box before maxDistance.
+     */
+    static bool rayHitsBox(const dReal *origin, const dReal *dir,
+                           const dReal *aabb, dReal maxDistance) {
+      dReal tEnter = 0.0, tExit = maxDistance, t1, t2;
+
+      for(int i=0; i<3; ++i) {
+        if(dir[i] == 0.0) {
+          if(origin[i] < aabb[2*i] || origin[i] > aabb[2*i+1]) return false;
+          continue;
+        }
+        t1 = (aabb[2*i] - origin[i]) / dir[i];
+        t2 = (aabb[2*i+1] - origin[i]) / dir[i];
+        if(t1 > t2) std::swap(t1, t2);
+        if(t1 > tEnter) tEnter = t1;
+        if(t2 < tExit) tExit = t2;
+        if(tEnter > tExit) return false;
+      }
+      return true;
+    }
+
+    /**
+     * \brief Returns the distance of the closest hit of the ray with the
+     * geom if it is closer than distance, else distance.
+     */
+    static dReal castRayAtGeom(dGeomID ray, const ray_query &query,
+                               const ray_geom &rg, unsigned long bits,
+                               const dReal *origin, const dReal *dir,
+                               dReal distance) {
+      dContact contact;
+
+      if((query.geom_filter == WorldPhysics::RAY_UNSHARED_GEOMS && rg.shared) ||
+         (query.geom_filter == WorldPhysics::RAY_SHARED_GEOMS && !rg.shared)) {
+        return distance;
+      }
+      if(!(bits & rg.collide_bits) && !(bits & rg.category_bits)) {
+        return distance;
+      }
+      if(rg.geom == query.ignore_geom ||
+         (query.ignore_body && rg.body == query.ignore_body)) {
+        return distance;
+      }
+      // the boxes behind the closest hit so far are skipped
+      if(!rayHitsBox(origin, dir, rg.aabb, distance)) return distance;
+      dGeomRaySet(ray, origin[0], origin[1], origin[2],
+                  dir[0], dir[1], dir[2]);
+      dGeomRaySetLength(ray, distance);
+      if(dCollide(ray, rg.geom, 1, &contact.geom, sizeof(dContact)) &&
+         contact.geom.depth < distance) {
+        return contact.geom.depth;
+      }
+      return distance;
+    }
+
+    /**
+     * \brief Casts the rays [begin, end) of the batch against the geoms
+     * of the query. Can be called by several threads for distinct ranges
+     * if the shared geoms are filtered out.
+     */
+    void WorldPhysics::castRayRange(const ray_query &query, RayBatch *rays,
+                                    size_t begin, size_t end) const {
+      dReal origin[3], dir[3], length, distance;
+      unsigned long bits = rays->collideBits;
+      size_t stack[RAY_TREE_STACK_SIZE], numStack, k;
+      const ray_tree_node *node;
+      // each thread uses its own ray geom that is not part of any space
+      dGeomID ray = dCreateRay(0, 1.0);
+
+      dGeomRaySetClosestHit(ray, 1);
+      for(size_t i=begin; i<end; ++i) {
+        distance = rays->distance[i];
+        length = 0.0;
+        for(int n=0; n<3; ++n) {
+          origin[n] = rays->origin[3*i+n];
+          dir[n] = rays->direction[3*i+n];
+          length += dir[n]*dir[n];
+        }
+        if(length <= 0.0 || distance <= 0.0) continue;
+        length = dSqrt(length);
+        for(int n=0; n<3; ++n) dir[n] /= length;
+
+        numStack = 0;
+        if(query.tree) stack[numStack++] = 0;
+        while(numStack) {
+          node = query.tree + stack[--numStack];
+          if(!rayHitsBox(origin, dir, node->aabb, distance)) continue;
+          if(node->count) {
+            for(k=node->first; k<node->first+node->count; ++k) {
+              distance = castRayAtGeom(ray, query, query.geoms[k], bits,
+                                       origin, dir, distance);
+            }
+          }
+          else {
+            stack[numStack++] = node->child;
+            stack[numStack++] = node->child+1;
+          }
+        }
+        for(k=query.num_bounded; k<query.num_geoms; ++k) {
+          distance = castRayAtGeom(ray, query, query.geoms[k], bits,
+                                   origin, dir, distance);
+        }
+        rays->distance[i] = distance;
+      }
+      dGeomDestroy(ray);
+    }
+
+    void WorldPhysics::getDebugStats(PhysicsDebugStats *stats) const {
+      MutexLocker locker(&iMutex);
+      stats->numContacts = num_contacts;
+      stats->numContactAllocs = num_contact_allocs;
+    }
+
+    /**
+     * \brief Copies the state of all given nodes into the contiguous
+     * buffers of states with a single lock of the world.
+     *
+     * post:
+     *     - states holds nodes.size() entries in the order of nodes
+     */
+    void WorldPhysics::getNodeStates(const std::vector<NodeInterface*> &nodes,
+                                     NodeStateBuffer *states) const {
+      MutexLocker locker(&iMutex);
+      states->resize(nodes.size());
+      for(size_t i=0; i<nodes.size(); ++i) {
+        ((NodePhysics*)nodes[i])->getState(states, i);
+      }
+    }
+
+    /**
+     * \brief Sets the state of all given nodes from the buffers of states
+     * with a single lock of the world.
+     *
+     * pre:
+     *     - states holds nodes.size() entries in the order of nodes
+     */
+    void WorldPhysics::setNodeStates(const std::vector<NodeInterface*> &nodes,
+                                     const NodeStateBuffer &states) {
+      MutexLocker locker(&iMutex);
+      for(size_t i=0; i<nodes.size(); ++i) {
+        ((NodePhysics*)nodes[i])->setState(states, i);
+      }
     }
 
   } // end of namespace sim
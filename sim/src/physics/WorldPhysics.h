@@ -50,6 +50,7 @@ namespace mars {
   namespace sim {
 
     class NodePhysics;
+    class CollisionWorker;
 
     /**
      * The struct is used to handle some sensors in the physical
@@ -78,6 +79,67 @@ namespace mars {
       std::vector<NodePhysics*> comp_nodes;
     };
 
+    /**
+     * Compact record of a contact that is used to visualize the
+     * contacts. The draw items are only created from these records
+     * if the contact drawing is enabled.
+     */
+    struct contact_record {
+      dReal pos[3];
+      dReal normal[3];
+    };
+
+    /**
+     * A geom pair found by the broadphase. The contacts of the pair
+     * are generated into the contact buffer of the thread that processed
+     * the pair.
+     */
+    struct collision_pair {
+      dGeomID o1, o2;
+      int max_contacts;
+      int num_contacts;
+      size_t first_contact;
+      std::vector<dContact> *contacts;
+    };
+
+    /**
+     * A geom of the ray query list with its bounding box in the layout
+     * of dGeomGetAABB (min x, max x, min y, max y, min z, max z).
+     */
+    struct ray_geom {
+      dGeomID geom;
+      dBodyID body;
+      unsigned long category_bits, collide_bits;
+      dReal aabb[6];
+      // the geom must not be collided by several threads at once
+      bool shared;
+    };
+
+    /**
+     * A node of the bounding volume hierarchy over the ray query list.
+     * An inner node has its children at child and child+1, a leaf holds
+     * the geoms [first, first+count) of the list.
+     */
+    struct ray_tree_node {
+      dReal aabb[6];
+      size_t child, first, count;
+    };
+
+    /**
+     * The geoms a batch of rays is cast against. The first num_bounded
+     * geoms are sorted into the tree, the other geoms are tested by
+     * every ray.
+     */
+    struct ray_query {
+      const ray_geom *geoms;
+      size_t num_geoms, num_bounded;
+      const ray_tree_node *tree;
+      dGeomID ignore_geom;
+      dBodyID ignore_body;
+      // RAY_ALL_GEOMS, RAY_UNSHARED_GEOMS or RAY_SHARED_GEOMS
+      int geom_filter;
+    };
+
     /**
      * Declaration of the physical class, that implements the
      * physics interface.
@@ -88,12 +150,19 @@ namespace mars {
       virtual ~WorldPhysics(void);
       virtual void initTheWorld(void);
       virtual void freeTheWorld(void);
+      virtual void initThread(void);
       virtual void stepTheWorld(void);
       virtual bool existsWorld(void) const;
       virtual const utils::Vector getCenterOfMass(const std::vector<interfaces::NodeInterface*> &nodes)const;
       virtual void update(std::vector<interfaces::draw_item> *drawItems);
       virtual int checkCollisions(void);
       virtual interfaces::sReal getVectorCollision(const utils::Vector &pos, const utils::Vector &ray) const;
+      virtual void castRays(interfaces::RayBatch *rays) const;
+      virtual void getDebugStats(interfaces::PhysicsDebugStats *stats) const;
+      virtual void getNodeStates(const std::vector<interfaces::NodeInterface*> &nodes,
+                                 interfaces::NodeStateBuffer *states) const;
+      virtual void setNodeStates(const std::vector<interfaces::NodeInterface*> &nodes,
+                                 const interfaces::NodeStateBuffer &states);
 
       // this functions are used by the other physical classes
       dWorldID getWorld(void) const;
@@ -105,9 +174,22 @@ namespace mars {
       void moveCompositeMassCenter(dBodyID theBody, dReal x, dReal y, dReal z);
       int handleCollision(dGeomID theGeom);
       interfaces::sReal getCollisionDepth(dGeomID theGeom);
+      unsigned long generateContacts(size_t begin, size_t end,
+                                     std::vector<dContact> *contacts);
+      void castRaysLocked(interfaces::RayBatch *rays) const;
+      void castRayRange(const ray_query &query, interfaces::RayBatch *rays,
+                        size_t begin, size_t end) const;
+
+      enum {RAY_ALL_GEOMS, RAY_UNSHARED_GEOMS, RAY_SHARED_GEOMS};
+      /// Has to be called after a geom is created, destroyed or moved
+      /// outside of a step.
+      void invalidateRayTree(void) {ray_tree_valid = false;}
       mutable utils::Mutex iMutex;
 
-      static interfaces::PhysicsError error;
+      interfaces::PhysicsError error;
+      /// the world the calling thread is stepping, the ode message
+      /// handlers report their errors to it
+      static thread_local WorldPhysics *current_world;
 
     private:
       utils::Mutex drawLock;
@@ -119,17 +201,72 @@ namespace mars {
       interfaces::ControlCenter *control;
       utils::Vector old_gravity;
       interfaces::sReal old_cfm, old_erp;
+      int old_num_threads;
 
       std::vector<body_nbr_tupel> comp_body_list;
-      std::vector<interfaces::draw_item> draw_intern;
-      std::vector<interfaces::draw_item> draw_extern;
-      std::vector<dJointFeedback*> contact_feedback_list;
+      std::vector<contact_record> draw_intern;
+      std::vector<contact_record> draw_extern;
+      size_t num_draw_intern, num_draw_extern;
+      bool draw_registered, record_contacts;
       bool create_contacts, log_contacts;
       int num_contacts;
       int ray_collision;
+
+      // contact arena: the contact buffer and the feedback blocks are
+      // reused over the steps and only grow if a step needs more space
+      std::vector<dContact> contact_buffer;
+      std::vector<dJointFeedback*> feedback_blocks;
+      size_t num_feedbacks;
+      unsigned long num_contact_allocs;
+
+      // threaded collision handling: the broadphase collects the geom
+      // pairs, the contacts are generated by the worker threads and
+      // merged in the order of the pairs; the pairs with a shared geom
+      // (see isSharedGeom) are collided by the calling thread afterwards
+      std::vector<collision_pair> collision_pairs;
+      std::vector<size_t> parallel_pairs, serial_pairs;
+      std::vector<dContact> thread_contacts;
+      // ode is built with thread local trimesh collider caches
+      bool threaded_trimesh;
+      std::vector<CollisionWorker*> collision_workers;
+
+      // ray queries: the bounding boxes of the geoms are refitted into
+      // the tree after each step, the tree is rebuilt if the geoms have
+      // changed or after RAY_TREE_REBUILD_STEPS refits
+      std::vector<ray_geom> ray_geoms;
+      std::vector<ray_tree_node> ray_tree;
+      size_t num_bounded_ray_geoms;
+      bool ray_tree_valid;
+      int ray_tree_refits;
+#ifdef ODE_THREADING
+      dThreadingImplementationID threading;
+      dThreadingThreadPoolID thread_pool;
+#endif
+
       // this functions are for the collision implementation
       void nearCallback (dGeomID o1, dGeomID o2);
+      void collectCallback (dGeomID o1, dGeomID o2);
+      bool handleRaySensor(dGeomID o1, dGeomID o2);
+      int getMaxNumContacts(dGeomID o1, dGeomID o2);
+      int collideGeoms(dGeomID o1, dGeomID o2, dContact *contact,
+                       int maxNumContacts) const;
+      void addContacts(dGeomID o1, dGeomID o2, dContact *contact, int numc);
+      void collideThreaded(void);
+      bool isSharedGeom(dGeomID geom) const;
+      void generatePairContacts(collision_pair *pair,
+                                std::vector<dContact> *contacts,
+                                unsigned long *allocs);
+      void setupThreads(int numThreads);
+      void collectRayGeoms(dSpaceID theSpace,
+                           std::vector<ray_geom> *geoms) const;
+      void updateRayTree(void);
+      void buildRayTree(size_t index, size_t first, size_t count);
+      void refitRayTree(void);
+      dContact* getContactBuffer(int size);
+      dJointFeedback* getFeedback(void);
+      void freeContactArena(void);
       static void callbackForward(void *data, dGeomID o1, dGeomID o2);
+      static void collectForward(void *data, dGeomID o1, dGeomID o2);
     };
 
   } // end of namespace sim
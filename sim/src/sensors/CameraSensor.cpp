@@ -106,6 +106,9 @@ namespace mars {
         gw = control->graphics->get3DWindow(cam_window_id);
         gw->setGrabFrames(false);
         if(gw) {
+          // the images are one render of the camera old, but the
+          // frame does not wait for their transfer
+          if(config.asyncReadback) gw->setAsyncReadback(true);
           gc = gw->getCameraInterface();
           control->graphics->addGraphicsUpdateInterface(this);
           gc->setFrustumFromRad(config.opening_width/180.0*M_PI, config.opening_height/180.0*M_PI, 0.5, 100);
@@ -443,6 +446,9 @@ namespace mars {
         cfg->enabled = true;
       }
 
+      if((it = config->find("async_readback")) != config->end())
+        cfg->asyncReadback = it->second;
+
       if((it = config->find("hud_size")) != config->end()) {
         cfg->hud_width = it->second["x"];
         cfg->hud_height = it->second["y"];
@@ -494,6 +500,7 @@ namespace mars {
 
       cfg["attached_node"] = config.attached_node;
       cfg["frame_offset"] = config.frameOffset;
+      if(config.asyncReadback) cfg["async_readback"] = true;
 
       cfg["width"] = config.width;
       cfg["height"] = config.height;
@@ -85,6 +85,7 @@ namespace mars {
         depthImage = false;
         logicalImage = false;
         frameOffset = 1;
+        asyncReadback = false;
       }
 
       unsigned long attached_node;
@@ -102,6 +103,7 @@ namespace mars {
       bool depthImage;
       bool logicalImage;
       bool enabled;
+      bool asyncReadback; // read the images back without stalling the frame
       configmaps::ConfigMap map;
     };
 
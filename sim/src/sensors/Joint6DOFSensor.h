@@ -70,6 +70,7 @@ namespace mars {
 
       virtual int getAsciiData(char* data) const;
       virtual int getSensorData(interfaces::sReal **data) const;
+      virtual int fillSensorData(interfaces::sReal *data, int size) const;
 
       void getForceData(utils::Vector *force);
       void getTorqueData(utils::Vector *torque);
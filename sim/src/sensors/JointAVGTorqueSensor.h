@@ -49,6 +49,7 @@ namespace mars {
 
       virtual int getAsciiData(char* data) const;
       virtual int getSensorData(interfaces::sReal **data) const;
+      virtual int fillSensorData(interfaces::sReal *data, int size) const;
       virtual void produceData(const data_broker::DataInfo &info,
                                data_broker::DataPackage *package,
                                int callbackParam);
@@ -110,14 +110,18 @@ namespace mars {
     }
 
     int JointArraySensor::getSensorData(sReal** data) const {
+      *data = (sReal*)calloc(doubleArray.size(), sizeof(sReal));
+      return fillSensorData(*data, doubleArray.size());
+    }
+
+    int JointArraySensor::fillSensorData(sReal *data, int size) const {
       std::vector<double>::const_iterator iter;
       int i=0;
 
-      *data = (sReal*)calloc(doubleArray.size(), sizeof(sReal));
+      if((int)doubleArray.size() > size) return doubleArray.size();
       for(iter = doubleArray.begin(); iter != doubleArray.end(); iter++) {
-        (*data)[i++] = *iter;
+        data[i++] = *iter;
       }
-
       return i;
     }
 
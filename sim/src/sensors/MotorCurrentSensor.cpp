@@ -99,12 +99,17 @@ namespace mars {
     }
 
     int MotorCurrentSensor::getSensorData(sReal** data) const {
+      *data = (sReal*)calloc(doubleArray.size(), sizeof(sReal));
+      return fillSensorData(*data, doubleArray.size());
+    }
+
+    int MotorCurrentSensor::fillSensorData(sReal *data, int size) const {
       std::vector<double>::const_iterator iter;
       int i=0;
 
-      *data = (sReal*)calloc(doubleArray.size(), sizeof(sReal));
+      if((int)doubleArray.size() > size) return doubleArray.size();
       for(iter = doubleArray.begin(); iter != doubleArray.end(); iter++) {
-        (*data)[i++] = *iter;
+        data[i++] = *iter;
       }
       return i;
     }
@@ -39,6 +39,8 @@ MultiLevelLaserRangeFinder::MultiLevelLaserRangeFinder(ControlCenter *control, M
         positionIndices[i] = -1;
     for(int i = 0; i < 4; ++i)
         rotationIndices[i] = -1;
+    renderCam = 0;
+    readDepth = false;
 
     control->nodes->addNodeSensor(this);
     bool erg = control->nodes->getDataBrokerNames(attached_node, &groupName, &dataName);
@@ -101,6 +103,8 @@ MultiLevelLaserRangeFinder::MultiLevelLaserRangeFinder(ControlCenter *control, M
                 
                 gc->setFrustumFromRad(anglePerCamera, anglePerCamera, 0.5, 100);
             }
+            // the cameras are only rendered once after each update
+            control->graphics->deactivate3DWindow(cam_window_id);
             
             RaySubSensor *rs = &(subSensors[i]);
             rs->cam_window_id = cam_window_id;
@@ -152,6 +156,7 @@ MultiLevelLaserRangeFinder::~MultiLevelLaserRangeFinder(void) {
 
 void MultiLevelLaserRangeFinder::preGraphicsUpdate(void )
 {
+    mutex.lock();
     for(std::vector<RaySubSensor>::iterator it = subSensors.begin(); it != subSensors.end(); it++)
     {
         if(it->gc) {
@@ -159,7 +164,20 @@ void MultiLevelLaserRangeFinder::preGraphicsUpdate(void )
             it->gc->updateViewportQuat(position.x(), position.y(), position.z(),
                                 subSensorOrientation.x(), subSensorOrientation.y(), subSensorOrientation.z(), subSensorOrientation.w());
         }
+        if(renderCam == 2)
+            control->graphics->activate3DWindow(it->cam_window_id);
+        else if(renderCam == 1)
+            control->graphics->deactivate3DWindow(it->cam_window_id);
     }
+    // the depth images of the frame rendered after the last update
+    // are read once in the following update call
+    if(renderCam == 2)
+        renderCam = 1;
+    else if(renderCam == 1) {
+        renderCam = 0;
+        readDepth = true;
+    }
+    mutex.unlock();
 }
 
 const std::vector<double> &MultiLevelLaserRangeFinder::getSensorData() const {
@@ -190,6 +208,7 @@ void MultiLevelLaserRangeFinder::receiveData(const data_broker::DataInfo &info,
         rotationIndices[2] = package.getIndexByName("rotation/z");
         rotationIndices[3] = package.getIndexByName("rotation/w");
     }
+    mutex.lock();
     for(int i = 0; i < 3; ++i)
         package.get(positionIndices[i], &position[i]);
     
@@ -197,7 +216,8 @@ void MultiLevelLaserRangeFinder::receiveData(const data_broker::DataInfo &info,
     package.get(rotationIndices[1], &orientation.y());
     package.get(rotationIndices[2], &orientation.z());
     package.get(rotationIndices[3], &orientation.w());
-
+    renderCam = 2;
+    mutex.unlock();
 }
 
 void MultiLevelLaserRangeFinder::calculateSamplingPixels()
@@ -277,6 +297,10 @@ void MultiLevelLaserRangeFinder::update(std::vector<draw_item>* drawItems) {
     
 //     std::cout << "Update Called " << std::endl;
     
+    if(!readDepth)
+        return;
+    readDepth = false;
+
     //update distance images
     for(std::vector<RaySubSensor>::iterator it = subSensors.begin(); it != subSensors.end();it++)
     {
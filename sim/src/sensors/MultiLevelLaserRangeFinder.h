@@ -9,6 +9,7 @@
 #include <mars/data_broker/ReceiverInterface.h>
 #include <mars/utils/Vector.h>
 #include <mars/utils/Quaternion.h>
+#include <mars/utils/Mutex.h>
 #include <mars/interfaces/graphics/draw_structs.h>
 #include <mars/interfaces/graphics/GraphicsUpdateInterface.h>
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
@@ -109,6 +110,9 @@ namespace mars {
         std::vector<utils::Vector> directions;
         long positionIndices[3];
         long rotationIndices[4];
+        utils::Mutex mutex;
+        int renderCam;
+        bool readDepth;
     };
 
   } // end of namespace sim
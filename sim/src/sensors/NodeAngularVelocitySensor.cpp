@@ -69,14 +69,19 @@ namespace mars {
     }
 
     int NodeAngularVelocitySensor::getSensorData(sReal** data) const {
+      *data = (sReal*)calloc(3*values.size(), sizeof(sReal));
+      return fillSensorData(*data, 3*values.size());
+    }
+
+    int NodeAngularVelocitySensor::fillSensorData(sReal *data, int size) const {
       std::vector<Vector>::const_iterator iter;
       int i=0;
 
-      *data = (sReal*)calloc(3*values.size(), sizeof(sReal));
+      if((int)values.size()*3 > size) return values.size()*3;
       for(iter = values.begin(); iter != values.end(); iter++) {
-        (*data)[i++] = iter->x();
-        (*data)[i++] = iter->y();
-        (*data)[i++] = iter->z();
+        data[i++] = iter->x();
+        data[i++] = iter->y();
+        data[i++] = iter->z();
       }
       return i;
     }
@@ -59,12 +59,17 @@ namespace mars {
     }
 
     int NodeCOMSensor::getSensorData(sReal** data) const {
-      Vector center = control->nodes->getCenterOfMass(config.ids);
-  
       *data = (sReal*)calloc(3, sizeof(sReal));
-      (*data)[0] = center.x();
-      (*data)[1] = center.y();
-      (*data)[2] = center.z();
+      return fillSensorData(*data, 3);
+    }
+
+    int NodeCOMSensor::fillSensorData(sReal *data, int size) const {
+      if(size < 3) return 3;
+      Vector center = control->nodes->getCenterOfMass(config.ids);
+
+      data[0] = center.x();
+      data[1] = center.y();
+      data[2] = center.z();
       return 3;
     }
 
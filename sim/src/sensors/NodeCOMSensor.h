@@ -45,6 +45,7 @@ namespace mars {
       ~NodeCOMSensor(void) {}
       virtual int getAsciiData(char* data) const;
       virtual int getSensorData(interfaces::sReal** data) const;
+      virtual int fillSensorData(interfaces::sReal *data, int size) const;
       static interfaces::BaseSensor* instanciate(interfaces::ControlCenter *control,
                                            interfaces::BaseConfig *config);
     };
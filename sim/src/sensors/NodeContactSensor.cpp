@@ -127,14 +127,19 @@ namespace mars {
     }
 
     int NodeContactSensor::getSensorData(sReal** data) const {
+      *data = (sReal*)malloc(sizeof(sReal));
+      return fillSensorData(*data, 1);
+    }
+
+    int NodeContactSensor::fillSensorData(sReal *data, int size) const {
       bool contact = 0;
       std::vector<bool>::const_iterator iter;
 
-      *data = (sReal*)malloc(sizeof(sReal));
+      if(size < 1) return 1;
       for(iter = values.begin(); iter != values.end(); iter++) {
         contact |= *iter;
       }
-      **data = contact;
+      *data = contact;
       return 1;
     }
 
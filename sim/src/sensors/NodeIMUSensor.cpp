@@ -94,21 +94,28 @@ namespace mars{
     }
 
     int NodeIMUSensor::getSensorData(sReal** data) const{
+      *data = (sReal*)calloc(3*(values_ang.size()+values_lin.size()), sizeof(sReal));
+      return fillSensorData(*data, 3*(values_ang.size()+values_lin.size()));
+    }
+
+    int NodeIMUSensor::fillSensorData(sReal *data, int size) const{
       std::vector<Vector>::const_iterator iter_ang;
       std::vector<Vector>::const_iterator iter_lin;
       int i=0;
 
-      *data = (sReal*)calloc(6*values_ang.size(), sizeof(sReal));
+      if((int)(values_ang.size()+values_lin.size())*3 > size) {
+        return (values_ang.size()+values_lin.size())*3;
+      }
       for(iter_ang= values_ang.begin(); iter_ang!= values_ang.end(); iter_ang++){
-        (*data)[i++] = iter_ang->x();
-        (*data)[i++] = iter_ang->y();
-        (*data)[i++] = iter_ang->z();
+        data[i++] = iter_ang->x();
+        data[i++] = iter_ang->y();
+        data[i++] = iter_ang->z();
       }
 
       for(iter_lin= values_lin.begin(); iter_lin!= values_lin.end(); iter_lin++){
-        (*data)[i++] = iter_lin->x();
-        (*data)[i++] = iter_lin->y();
-        (*data)[i++] = iter_lin->z();
+        data[i++] = iter_lin->x();
+        data[i++] = iter_lin->y();
+        data[i++] = iter_lin->z();
       }
 
       return i;
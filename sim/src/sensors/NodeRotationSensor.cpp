@@ -98,13 +98,19 @@ namespace mars {
     }
 
     int NodeRotationSensor::getSensorData(sReal** data) const {
-      std::vector<sRotation>::const_iterator iter;
-  
       *data = (sReal*)calloc(3, sizeof(sReal));
+      return fillSensorData(*data, 3);
+    }
+
+    int NodeRotationSensor::fillSensorData(sReal *data, int size) const {
+      std::vector<sRotation>::const_iterator iter;
+
+      if(size < 3) return 3;
+      data[0] = data[1] = data[2] = 0;
       for(iter = values.begin(); iter != values.end(); iter++) {
-        (*data)[0] = iter->alpha;
-        (*data)[1] = iter->beta;
-        (*data)[2] = iter->gamma;
+        data[0] = iter->alpha;
+        data[1] = iter->beta;
+        data[2] = iter->gamma;
       }
       return 3;
     }
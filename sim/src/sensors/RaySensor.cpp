@@ -145,8 +145,13 @@ namespace mars {
 
     int RaySensor::getSensorData(double **data_) const {
       *data_ = (double*)malloc(data.size()*sizeof(double));
+      return fillSensorData(*data_, data.size());
+    }
+
+    int RaySensor::fillSensorData(double *data_, int size) const {
+      if((int)data.size() > size) return data.size();
       for(unsigned int i=0; i<data.size(); i++) {
-        (*data_)[i] = data[i];
+        data_[i] = data[i];
       }
       return data.size();
     }
@@ -71,8 +71,9 @@ namespace mars {
       current_pose.setIdentity();
       num_points = 0;
       toCloud = &pointcloud1;
+      fromCloud = &pointcloud2;
       convertPointCloud = false;
-      nextCloud = 2;
+      scan_pose.setIdentity();
       this->attached_node = config.attached_node;
 
       std::string groupName, dataName;
@@ -154,6 +155,14 @@ namespace mars {
         }
       }
 
+      // Reserves the scan buffers for the number of turning steps of a scan.
+      size_t scanSize = directions.size() *
+        (size_t)(std::ceil(turning_end_fullscan / turning_step) + 1);
+      pointcloud1.reserve(scanSize);
+      pointcloud2.reserve(scanSize);
+      pointcloud_convert.reserve(scanSize);
+      pointcloud_full.reserve(scanSize);
+
       // Add sensor after everything has been initialized.
       control->nodes->addNodeSensor(this);
 
@@ -170,7 +179,10 @@ namespace mars {
     RotatingRaySensor::~RotatingRaySensor(void) {
       control->graphics->removeDrawItems((DrawInterface*)this);
       control->dataBroker->unregisterTimedReceiver(this, "*", "*", "mars_sim/simTimer");
+      convertMutex.lock();
       closeThread = true;
+      convertWC.wakeAll();
+      convertMutex.unlock();
       this->wait();
     }
 
@@ -185,6 +197,19 @@ namespace mars {
       }
     }
 
+    bool RotatingRaySensor::getPackedPointcloud(std::vector<float>& pcloud) {
+      mars::utils::MutexLocker lock(&mutex_pointcloud);
+      if(!full_scan) return false;
+      full_scan = false;
+      pcloud.resize(pointcloud_full.size()*3);
+      if(!pointcloud_full.empty()) {
+        Eigen::Map<Eigen::Matrix3Xf>(pcloud.data(), 3, pointcloud_full.size()) =
+          Eigen::Map<const Eigen::Matrix3Xd>(pointcloud_full[0].data(), 3,
+                                             pointcloud_full.size()).cast<float>();
+      }
+      return true;
+    }
+
     int RotatingRaySensor::getSensorData(double** data_) const {
       mars::utils::MutexLocker lock(&mutex_pointcloud);
       *data_ = (double*)malloc(pointcloud_full.size()*3*sizeof(double));
@@ -237,25 +262,16 @@ namespace mars {
       // data[] contains all the measured distances according to the define directions.
       assert((int)data.size() == config.bands * config.lasers);
 
-      int i = 0; // data_counter
-      utils::Vector local_ray, tmpvec;
-      for(int b=0; b<config.bands; ++b) {
-        base::Orientation base_orientation;
-        base_orientation.x() = orientation_offset.x();
-        base_orientation.y() = orientation_offset.y();
-        base_orientation.z() = orientation_offset.z();
-        base_orientation.w() = orientation_offset.w();
-
+      // Gathers pointcloud in the world frame to prevent/reduce movement distortion.
+      // This necessitates a back-transformation (world2node) in run().
+      // The turn of the sensor and the node pose are combined once per call.
+      Eigen::Matrix3d ray2world = current_pose.linear() *
+        orientation_offset.toRotationMatrix();
+      Eigen::Vector3d translation = current_pose.translation();
+      for(size_t i=0; i<data.size(); ++i) {
         // If min/max are exceeded distance will be ignored.
-        for(int l=0; l<config.lasers; ++l, ++i){
-          if (data[i] >= config.minDistance && data[i] < config.maxDistance-0.01) {
-            // Calculates the ray/vector within the sensor frame.
-            local_ray = orientation_offset * directions[i] * data[i];
-            // Gathers pointcloud in the world frame to prevent/reduce movement distortion.
-            // This necessitates a back-transformation (world2node) in getPointcloud().
-            tmpvec = current_pose * local_ray;
-            toCloud->push_back(tmpvec); // Scale normalized vector.
-          }
+        if (data[i] >= config.minDistance && data[i] < config.maxDistance-0.01) {
+          toCloud->push_back(ray2world * (directions[i] * data[i]) + translation);
         }
       }
       num_points += data.size();
@@ -287,25 +303,24 @@ namespace mars {
 
     utils::Quaternion RotatingRaySensor::turn() {  
       
-      // If the scan is full the pointcloud will be copied.
-      mutex_pointcloud.lock();
+      // If the scan is full the scan buffers are swapped and the full one
+      // is handed to run() for the conversion.
       turning_offset += turning_step;
       if(turning_offset >= turning_end_fullscan) {
-        while(convertPointCloud) msleep(1);
-        fromCloud = toCloud;
-        if(nextCloud == 2) {
-          toCloud = &pointcloud2;
-          nextCloud = 1;
-        }
-        else {
-          toCloud = &pointcloud1;
-          nextCloud = 2;
-        }
+        convertMutex.lock();
+        // only waits if the conversion of the last scan is not done yet
+        while(convertPointCloud) convertDoneWC.wait(&convertMutex);
+        std::swap(toCloud, fromCloud);
+        toCloud->clear();
+        poseMutex.lock();
+        scan_pose = current_pose;
+        poseMutex.unlock();
         convertPointCloud = true;
+        convertWC.wakeAll();
+        convertMutex.unlock();
         turning_offset = 0;
       }
       orientation_offset = utils::angleAxisToQuaternion(turning_offset, utils::Vector(0.0, 0.0, 1.0));
-      mutex_pointcloud.unlock();
       
       return orientation_offset;
     }
@@ -315,36 +330,44 @@ namespace mars {
     }
 
     void RotatingRaySensor::run() {
+      Eigen::Affine3d rot;
+      Eigen::Affine3d world2sensor;
+      size_t n;
+
+      rot.setIdentity();
+      rot.rotate(config.transf_sensor_rot_to_sensor);
+      convertMutex.lock();
       while(!closeThread) {
-        if(convertPointCloud) {
-          poseMutex.lock();
-          Eigen::Affine3d current_pose2 = current_pose;
-          Eigen::Affine3d rot;
-          rot.setIdentity();
-          rot.rotate(config.transf_sensor_rot_to_sensor);
-          poseMutex.unlock();
-
-          // Copies current full pointcloud to pointcloud_full.
-          std::list<utils::Vector>::iterator it = fromCloud->begin();
-          mutex_pointcloud.lock();
-          pointcloud_full.clear();
-          pointcloud_full.reserve(fromCloud->size());
-          base::Vector3d vec_local;
-
-          for(int i=0; it != fromCloud->end(); it++, i++) {
-            // Transforms the pointcloud back from world to current node (see receiveDate()).
-            // In addition 'transf_sensor_rot_to_sensor' is applied which describes
-            // the orientation of the sensor in the unturned sensor frame.
-            vec_local = rot * current_pose2.inverse() * (*it);
-            pointcloud_full.push_back(vec_local);
-          }
-          mutex_pointcloud.unlock();
-          fromCloud->clear();
-          convertPointCloud = false;
-          full_scan = true;
+        if(!convertPointCloud) {
+          convertWC.wait(&convertMutex);
+          continue;
+        }
+        convertMutex.unlock();
+
+        // Transforms the pointcloud back from world to current node (see receiveDate()).
+        // In addition 'transf_sensor_rot_to_sensor' is applied which describes
+        // the orientation of the sensor in the unturned sensor frame.
+        // The whole scan is transformed at once as a 3xN matrix.
+        world2sensor = rot * scan_pose.inverse();
+        n = fromCloud->size();
+        pointcloud_convert.resize(n);
+        if(n) {
+          Eigen::Map<Eigen::Matrix3Xd> dst(pointcloud_convert[0].data(), 3, n);
+          dst = world2sensor.linear() *
+            Eigen::Map<const Eigen::Matrix3Xd>((*fromCloud)[0].data(), 3, n);
+          dst.colwise() += world2sensor.translation();
         }
-        else msleep(2);
+
+        mutex_pointcloud.lock();
+        pointcloud_full.swap(pointcloud_convert);
+        full_scan = true;
+        mutex_pointcloud.unlock();
+
+        convertMutex.lock();
+        convertPointCloud = false;
+        convertDoneWC.wakeAll();
       }
+      convertMutex.unlock();
     }
 
     BaseConfig* RotatingRaySensor::parseConfig(ControlCenter *control,
@@ -39,6 +39,7 @@
 #include <mars/utils/Thread.h>
 #include <mars/utils/mathUtils.h>
 #include <mars/utils/Mutex.h>
+#include <mars/utils/WaitCondition.h>
 #include <mars/interfaces/graphics/draw_structs.h>
 
 #include <base/Pose.hpp>
@@ -108,6 +109,14 @@ namespace mars {
        */
       bool getPointcloud(std::vector<utils::Vector>& pointcloud);
 
+      /**
+       * Same as getPointcloud() but returns the full scan packed as
+       * float (x, y, z) triples. The buffer of the caller is reused, thus
+       * no memory is allocated once it has the size of a scan.
+       * A full scan is only returned once by either of the two methods.
+       */
+      bool getPackedPointcloud(std::vector<float>& pointcloud);
+
       /**
        * Copies the current full pointcloud to a double array with (x,y,z).
        * \warning Memory has to be freed manually!
@@ -148,10 +157,11 @@ namespace mars {
       /**
        * Turns the sensor during each simulation step.
        * As soon as a full scan has been done (depends on the number of bands)
-       * the pointcloud is copied to pointcloud_full and a new scan
-       * is initiated. Runs in the same thread than receiveData, so only the use of 
-       * full_pointcloud (turn(), getPointcloud() and getSensorData()) has to be 
-       * synchronized.
+       * the scan buffers are swapped, the conversion thread is woken up
+       * and a new scan is initiated. Runs in the same thread than
+       * receiveData, so only the handoff of the scan buffer to run() and
+       * the use of pointcloud_full (run(), getPointcloud() and
+       * getSensorData()) have to be synchronized.
        */
       utils::Quaternion turn();
       
@@ -173,15 +183,17 @@ namespace mars {
     private:
       /** Contains the normalized scan directions. */ 
       std::vector<utils::Vector> directions;
-      // TODO Storing the pointcloud four times is not very effective.
-      // Maybe: Integrate distortion-prevention (use current sensor pose)
-      // in mlls and only create the pointcloud on demand.
-      std::list<utils::Vector> pointcloud1; // TODO Replace with array with fix size.
-      std::list<utils::Vector> pointcloud2; // TODO Replace with array with fix size.
-      std::list<utils::Vector> *toCloud, *fromCloud; // TODO Replace with array with fix size.
+      // The scan is gathered in the world frame into one of the two scan
+      // buffers while run() converts the other one. The buffers are
+      // reserved for a full scan and only cleared, so gathering a scan
+      // does not allocate.
+      std::vector<utils::Vector> pointcloud1, pointcloud2;
+      std::vector<utils::Vector> *toCloud, *fromCloud;
+      std::vector<utils::Vector> pointcloud_convert; // Written by run().
       std::vector<utils::Vector> pointcloud_full; // Stores the full scan.
       bool convertPointCloud;
-      int nextCloud;
+      utils::Mutex convertMutex;
+      utils::WaitCondition convertWC, convertDoneWC;
       double vertical_resolution;
       bool update_available;
       bool full_scan;
@@ -193,6 +205,7 @@ namespace mars {
       double turning_step;
       int nsamples;
       mutable mars::utils::Mutex mutex_pointcloud, poseMutex;
+      Eigen::Affine3d scan_pose; // Pose at the end of the scan in fromCloud.
       Eigen::Affine3d current_pose;
       bool closeThread;
       unsigned int num_points;
@@ -75,6 +75,7 @@ namespace mars {
       jointID[1] = 0;
       rayID = 0;
       raySensor = 0;
+      renderCam = 0;
 
       config.extension -= Vector(0, 0, config.extension[2]/2.0); //Split the Sonar in two parts, to separate fixed and moving part
 
@@ -183,6 +184,8 @@ namespace mars {
 
         if(config.show_cam)
           control->graphics->setHUDElementTextureRTT(cam_id, cam_window_id,false);
+        // the camera is only rendered once after each update
+        control->graphics->deactivate3DWindow(cam_window_id);
       }
       control->nodes->addNodeSensor(this);
     }
@@ -239,6 +242,16 @@ namespace mars {
     }
 
     void ScanningSonar::preGraphicsUpdate(void) {
+      mutex.lock();
+      if(renderCam == 2) {
+        control->graphics->activate3DWindow(cam_window_id);
+        renderCam = 1;
+      }
+      else if(renderCam == 1) {
+        control->graphics->deactivate3DWindow(cam_window_id);
+        renderCam = 0;
+      }
+      mutex.unlock();
     }
 
     void ScanningSonar::receiveData(const data_broker::DataInfo &info,
@@ -266,6 +279,9 @@ namespace mars {
 
       if(gc) {
         gc->updateViewportQuat(head_position.x(), head_position.y(), head_position.z(),head_orientation.x(), head_orientation.y(), head_orientation.z(), head_orientation.w());
+        mutex.lock();
+        renderCam = 2;
+        mutex.unlock();
       }
   
       SimMotor *motor = control->motors->getSimMotor(motorID);
@@ -30,6 +30,7 @@
 #include <mars/utils/Vector.h>
 #include <mars/utils/Quaternion.h>
 #include <mars/utils/mathUtils.h>
+#include <mars/utils/Mutex.h>
 #include <mars/interfaces/sim/SensorInterface.h>
 #include <mars/interfaces/graphics/GraphicsWindowInterface.h>
 #include <mars/interfaces/graphics/GraphicsUpdateInterface.h>
@@ -125,6 +126,8 @@ namespace mars {
       unsigned long rayID;
       unsigned long cam_window_id;
       bool switch_motor_direction;
+      utils::Mutex mutex;
+      int renderCam;
 
       utils::Quaternion head_orientation;
       utils::Vector head_position;
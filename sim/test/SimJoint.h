@@ -0,0 +1,67 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file SimJoint.h
+ * \brief Replaces the SimJoint of the simulation in the MotorBatch test.
+ *        The joint stores the last commands and returns the state set
+ *        by the test instead of a physics state.
+ */
+
+// the include guard of the real SimJoint.h, thus the fake replaces it
+#ifndef SIMJOINT_H
+#define SIMJOINT_H
+
+// SimMotor relies on the includes of the real SimJoint
+#include <mars/interfaces/MARSDefs.h>
+#include <mars/interfaces/core_objects_exchange.h>
+#include <mars/interfaces/sim/ControlCenter.h>
+
+namespace mars {
+  namespace sim {
+
+    class SimJoint {
+    public:
+      SimJoint() : position(0), torque(0), velocity(0), effortLimit(0),
+                   commandedVelocity(0), commandedEffort(0) {}
+
+      interfaces::sReal getPosition(unsigned char axis=1) const
+      {return position;}
+      interfaces::sReal getMotorTorque() const {return torque;}
+      interfaces::sReal getVelocity(unsigned char axis=1) const
+      {return velocity;}
+      void setEffortLimit(interfaces::sReal value, unsigned char axis=1)
+      {effortLimit = value;}
+      void setVelocity(interfaces::sReal value, unsigned char axis=1)
+      {commandedVelocity = value;}
+      void setEffort(interfaces::sReal value, unsigned char axis=1)
+      {commandedEffort = value;}
+      void attachMotor(unsigned char axis) {}
+      void detachMotor(unsigned char axis) {}
+      void setOfflinePosition(interfaces::sReal value) {}
+
+      interfaces::sReal position, torque, velocity, effortLimit;
+      interfaces::sReal commandedVelocity, commandedEffort;
+    };
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif  // SIMJOINT_H
@@ -0,0 +1,158 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file test_checkpoint.cpp
+ * \brief Checks that a checkpoint with a section that does not match the
+ *        scene leaves all sections unchanged.
+ *
+ * Fake sections write their objects like the managers of the simulation:
+ * the number of objects, then the id and the values of each object. A
+ * checkpoint whose motor section has a wrong id must not change the node
+ * section that is restored before it.
+ */
+
+#include "Checkpoint.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace mars::sim;
+using namespace mars::interfaces;
+
+#define VALUES_PER_OBJECT 3
+
+class FakeSection : public CheckpointInterface {
+public:
+  std::vector<unsigned long> ids;
+  std::vector<sReal> values;
+
+  FakeSection(size_t numObjects, unsigned long firstId) {
+    for(size_t i=0; i<numObjects; ++i) {
+      ids.push_back(firstId+i);
+      for(int k=0; k<VALUES_PER_OBJECT; ++k) {
+        values.push_back(firstId*100.0 + i*10.0 + k);
+      }
+    }
+  }
+
+  void saveState(std::vector<sReal> *state) {
+    state->push_back((sReal)ids.size());
+    for(size_t i=0; i<ids.size(); ++i) {
+      state->push_back((sReal)ids[i]);
+      for(int k=0; k<VALUES_PER_OBJECT; ++k) {
+        state->push_back(values[i*VALUES_PER_OBJECT+k]);
+      }
+    }
+  }
+
+  bool checkState(const std::vector<sReal> &state, size_t *pos) {
+    size_t p = *pos;
+    if(p >= state.size() || (size_t)state[p] != ids.size() ||
+       p + 1 + ids.size()*(VALUES_PER_OBJECT+1) > state.size()) {
+      return false;
+    }
+    ++p;
+    for(size_t i=0; i<ids.size(); ++i) {
+      if((unsigned long)state[p] != ids[i]) return false;
+      p += VALUES_PER_OBJECT+1;
+    }
+    *pos = p;
+    return true;
+  }
+
+  bool restoreState(const std::vector<sReal> &state, size_t *pos) {
+    size_t p = *pos;
+    if(!checkState(state, &p)) return false;
+    p = *pos+1;
+    for(size_t i=0; i<ids.size(); ++i) {
+      for(int k=0; k<VALUES_PER_OBJECT; ++k) {
+        values[i*VALUES_PER_OBJECT+k] = state[p+1+k];
+      }
+      p += VALUES_PER_OBJECT+1;
+    }
+    *pos = p;
+    return true;
+  }
+};
+
+int main(void) {
+  FakeSection nodes(4, 1), joints(2, 10), motors(3, 20);
+  std::vector<CheckpointInterface*> sections;
+  std::vector<sReal> checkpoint, badCheckpoint, savedNodes, savedMotors;
+  size_t pos, motorsPos;
+  int errors = 0;
+
+  sections.push_back(&nodes);
+  sections.push_back(&joints);
+  sections.push_back(&motors);
+  nodes.saveState(&checkpoint);
+  joints.saveState(&checkpoint);
+  motorsPos = checkpoint.size();
+  motors.saveState(&checkpoint);
+
+  // the scene moves on after the checkpoint
+  for(size_t i=0; i<nodes.values.size(); ++i) nodes.values[i] += 1.0;
+  for(size_t i=0; i<motors.values.size(); ++i) motors.values[i] += 1.0;
+  savedNodes = nodes.values;
+  savedMotors = motors.values;
+
+  // the id of the second motor does not exist in the scene
+  badCheckpoint = checkpoint;
+  badCheckpoint[motorsPos + 1 + (VALUES_PER_OBJECT+1)] = 99;
+  pos = 0;
+  if(restoreCheckpointSections(badCheckpoint, &pos, sections)) {
+    fprintf(stderr, "a checkpoint with a wrong motor id was restored\n");
+    ++errors;
+  }
+  if(pos != 0 || nodes.values != savedNodes ||
+     motors.values != savedMotors) {
+    fprintf(stderr, "the failed restore changed the sections\n");
+    ++errors;
+  }
+
+  // a truncated motor section is rejected as well
+  badCheckpoint.assign(checkpoint.begin(), checkpoint.end()-1);
+  pos = 0;
+  if(restoreCheckpointSections(badCheckpoint, &pos, sections) ||
+     nodes.values != savedNodes) {
+    fprintf(stderr, "a truncated checkpoint changed the sections\n");
+    ++errors;
+  }
+
+  pos = 0;
+  if(!restoreCheckpointSections(checkpoint, &pos, sections) ||
+     pos != checkpoint.size()) {
+    fprintf(stderr, "the valid checkpoint was not restored\n");
+    ++errors;
+  }
+  for(size_t i=0; i<nodes.values.size(); ++i) {
+    if(nodes.values[i] != savedNodes[i] - 1.0) {
+      fprintf(stderr, "node value %lu was not restored\n",
+              (unsigned long)i);
+      ++errors;
+      break;
+    }
+  }
+
+  if(errors) return 1;
+  printf("checkpoint sections: ok\n");
+  return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file test_motor_batch.cpp
+ * \brief Checks that MotorBatch gives the results of SimMotor::update.
+ *
+ * Two sets of motors on fake joints get the same commands. One set is
+ * updated motor by motor, the other by a MotorBatch. After each step the
+ * motor states and the joint commands have to be equal.
+ */
+
+#include <mars/interfaces/MotorData.h>
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/data_broker/DataPackage.h>
+#include <mars/utils/mathUtils.h>
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "SimJoint.h"
+#include "IDMap.h"
+#include "SimMotor.h"
+#include "MotorBatch.h"
+
+using namespace mars::sim;
+using namespace mars::interfaces;
+
+namespace mars {
+  namespace sim {
+
+    /**
+     * Sets the values of the motors that are not part of the MotorData
+     * and reads the version counters of the MotorBatch.
+     */
+    class MotorBatchTest {
+    public:
+      static void setTemperatureModel(SimMotor *motor) {
+        motor->ambientTemperature = 20.0;
+        motor->heatTransferCoefficient = 0.01;
+        motor->heatlossCoefficient = 0.1;
+        motor->voltage = 24.0;
+      }
+      // setControlValue asks the simulator whether it is running
+      static void setControlValue(SimMotor *motor, sReal value) {
+        motor->controlValue = value;
+      }
+      static unsigned long getBatchVersion(const SimMotor *motor) {
+        return motor->batchVersion;
+      }
+      static bool isActive(const SimMotor *motor) {
+        return motor->active;
+      }
+    };
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#define NUM_MOTORS 60
+#define NUM_STEPS 5000
+#define MAX_DIFF 1e-12
+
+struct Motors {
+  std::vector<SimJoint> joints;
+  std::vector<SimMotor*> motors;
+  IDMap<SimMotor*> map;
+};
+
+static void createMotors(Motors *m, ControlCenter *control) {
+  m->joints.resize(NUM_MOTORS);
+  for(int k=0; k<NUM_MOTORS; ++k) {
+    MotorData motorData;
+    motorData.index = k+1;
+    motorData.name = "motor" + std::to_string(k);
+    motorData.type = (k%3 == 0) ? MOTOR_TYPE_POSITION :
+      ((k%3 == 1) ? MOTOR_TYPE_VELOCITY : MOTOR_TYPE_EFFORT);
+    motorData.maxSpeed = 2.0;
+    motorData.maxEffort = 5.0;
+    motorData.minValue = -3.0;
+    motorData.maxValue = 3.0;
+    motorData.p = 3.0;
+    motorData.i = 0.5;
+    motorData.d = 0.1;
+    motorData.axis = 1;
+    motorData.config["filterValue"] = 0.2;
+    SimMotor *motor = new SimMotor(control, motorData);
+    MotorBatchTest::setTemperatureModel(motor);
+    motor->attachJoint(&m->joints[k]);
+    motor->setSMotor(motorData);
+    m->motors.push_back(motor);
+    m->map[k+1] = motor;
+  }
+  // updated by SimMotor::update within the batch
+  m->motors[4]->setCurrentApproximation(mars::utils::FUNCTION_POLYNOM2D2,
+                                        new std::vector<sReal>(9, 0.1));
+}
+
+static void stepPhysics(Motors *m, int step) {
+  for(size_t k=0; k<m->joints.size(); ++k) {
+    SimJoint &joint = m->joints[k];
+    sReal command = joint.commandedVelocity + 0.05*joint.commandedEffort;
+    joint.velocity = command*0.9 + 0.01*sin(step*0.1+k);
+    joint.position += joint.velocity*0.001;
+    joint.torque = 0.3*command + 0.1*cos(step+k);
+  }
+}
+
+static void setCommands(Motors *m, int step) {
+  for(size_t k=0; k<m->motors.size(); ++k) {
+    MotorBatchTest::setControlValue(m->motors[k], 2.5*sin(step*0.003+k));
+  }
+}
+
+static double compare(const Motors &a, const Motors &b) {
+  std::vector<sReal> stateA, stateB;
+  double diff = 0.0;
+  for(size_t k=0; k<a.motors.size(); ++k) {
+    stateA.clear();
+    stateB.clear();
+    a.motors[k]->saveState(&stateA);
+    b.motors[k]->saveState(&stateB);
+    for(size_t n=0; n<stateA.size(); ++n) {
+      diff = std::max(diff, std::fabs(stateA[n]-stateB[n]));
+    }
+    const SimJoint &x = a.joints[k], &y = b.joints[k];
+    diff = std::max(diff, std::fabs(x.commandedVelocity-y.commandedVelocity));
+    diff = std::max(diff, std::fabs(x.commandedEffort-y.commandedEffort));
+    diff = std::max(diff, std::fabs(x.effortLimit-y.effortLimit));
+  }
+  return diff;
+}
+
+static bool testEquivalence(ControlCenter *control) {
+  Motors a, b;
+  MotorBatch batch;
+  double diff = 0.0;
+
+  createMotors(&a, control);
+  createMotors(&b, control);
+  for(int step=0; step<NUM_STEPS; ++step) {
+    setCommands(&a, step);
+    setCommands(&b, step);
+    for(int k=0; k<NUM_MOTORS; ++k) {
+      a.motors[k]->update(1.0);
+    }
+    batch.update(b.map, 1.0);
+    // a changed parameter has to reach the batch
+    if(step == NUM_STEPS/2) {
+      a.motors[7]->setP(1.0);
+      b.motors[7]->setP(1.0);
+    }
+    diff = std::max(diff, compare(a, b));
+    stepPhysics(&a, step);
+    stepPhysics(&b, step);
+  }
+  printf("equivalence: max difference %g\n", diff);
+  return diff <= MAX_DIFF;
+}
+
+static bool testUnattachedMotor(ControlCenter *control) {
+  Motors m;
+  MotorBatch batch;
+
+  createMotors(&m, control);
+  // e.g. after MotorManager::removeJointFromMotors
+  SimMotor *motor = m.motors[3];
+  motor->attachJoint(0);
+  batch.update(m.map, 1.0);
+  unsigned long version = MotorBatchTest::getBatchVersion(motor);
+  for(int step=0; step<10; ++step) {
+    batch.update(m.map, 1.0);
+  }
+  printf("unattached motor: %lu version changes\n",
+         MotorBatchTest::getBatchVersion(motor) - version);
+  // an inactive motor must not force a rebuild in every step
+  return (!MotorBatchTest::isActive(motor) &&
+          MotorBatchTest::getBatchVersion(motor) == version);
+}
+
+int main(int argc, char **argv) {
+  ControlCenter control;
+  bool ok = true;
+
+  control.dataBroker = 0;
+  control.sim = 0;
+  ok &= testEquivalence(&control);
+  ok &= testUnattachedMotor(&control);
+  return ok ? 0 : 1;
+}